@@ -17,6 +17,7 @@
  */
 
 #import "AppDelegate.h"
+#import "EQRenderPrewarm.h"
 
 @interface AppDelegate ()
 
@@ -27,6 +28,8 @@
 
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
     // Override point for customization after application launch.
+    // Loads the fonts and tables before the first equation is shown.
+    [EQRenderPrewarm prewarmInBackgroundWithCompletion:nil];
     return YES;
 }
 
@@ -0,0 +1,73 @@
+//
+//  ConvertMathQueue.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+// Asynchronous version of ConvertMathToImage, for lists that request more math than they end up showing.
+// Conversions run one at a time on a background queue, highest priority first.
+// Identical requests that are waiting or running at the same time share one conversion.
+// Cancelling a request stops its completion block from being called. The conversion itself stops between
+// the import, layout and raster steps once every request that shares it has been cancelled.
+
+typedef enum
+{
+    convertPriorityLow,
+    convertPriorityNormal,
+    convertPriorityHigh,
+} ConvertMathPriority;
+
+typedef void (^ConvertMathImageCompletion)(UIImage *image);
+typedef void (^ConvertMathDataCompletion)(NSData *pngData);
+
+@interface ConvertMathRequest : NSObject
+
+@property (strong, readonly, nonatomic) NSString *mathStr;
+@property (readonly, nonatomic) ConvertMathPriority priority;
+
+- (void)cancel;
+- (BOOL)isCancelled;
+
+@end
+
+@interface ConvertMathQueue : NSObject
+
++ (ConvertMathQueue *)sharedQueue;
+
+// Defaults to 1.0, as the queue may be created off the main thread where UIScreen can't be used.
+// Set it from the main thread, for example to the screen scale, when the images are shown on screen.
+@property (nonatomic) CGFloat pixelScale;
+
+// TeX and MathML are both accepted, as in ConvertMathToImage.
+// The completion is called on the completion queue, or the main queue if it is NULL. It is passed nil if the conversion fails.
+- (ConvertMathRequest *)convertMathToImage: (NSString *)mathStr
+                                  priority: (ConvertMathPriority)priority
+                           completionQueue: (dispatch_queue_t)completionQueue
+                                completion: (ConvertMathImageCompletion)completion;
+
+- (ConvertMathRequest *)convertMathToPNGData: (NSString *)mathStr
+                                    priority: (ConvertMathPriority)priority
+                             completionQueue: (dispatch_queue_t)completionQueue
+                                  completion: (ConvertMathDataCompletion)completion;
+
+// Number of conversions waiting or running, after duplicates are shared.
+- (NSUInteger)pendingConversionCount;
+
+- (void)cancelAllRequests;
+
+@end
@@ -0,0 +1,387 @@
+//
+//  ConvertMathQueue.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import "ConvertMathQueue.h"
+#import "ConvertMathToImage.h"
+#import "ConvertBlahtex.h"
+#import "EQRenderEquation.h"
+#import "EQRenderRasterizer.h"
+
+// Keep the default compression used by the worker for PNG data.
+static const NSInteger kQUEUE_PNG_COMPRESSION_LEVEL = 6;
+
+typedef enum
+{
+    convertOutputImage,
+    convertOutputPNGData,
+} ConvertMathOutput;
+
+@class ConvertMathJob;
+
+@interface ConvertMathRequest()
+{
+    BOOL requestCancelled;
+}
+
+@property (strong, nonatomic) id completion;
+@property (strong, nonatomic) dispatch_queue_t completionQueue;
+@property (weak, nonatomic) ConvertMathJob *job;
+@property (weak, nonatomic) ConvertMathQueue *convertQueue;
+
+- (id)initWithMathStr: (NSString *)mathStr priority: (ConvertMathPriority)priority;
+- (void)markCancelled;
+
+@end
+
+// One conversion, shared by every request with the same math, output and pixel scale.
+@interface ConvertMathJob : NSObject
+
+@property (strong, nonatomic) NSString *jobKey;
+@property (strong, nonatomic) NSString *mathStr;
+@property (nonatomic) ConvertMathOutput output;
+@property (nonatomic) CGFloat pixelScale;
+@property (strong, nonatomic) NSMutableArray *requests;
+@property (strong, nonatomic) NSOperation *operation;
+
+@end
+
+@implementation ConvertMathJob
+
+@end
+
+@interface ConvertMathQueue()
+{
+    NSOperationQueue *operationQueue;
+    NSMutableDictionary *activeJobs;
+}
+
+- (ConvertMathRequest *)addRequestForMath: (NSString *)mathStr
+                                   output: (ConvertMathOutput)output
+                                 priority: (ConvertMathPriority)priority
+                          completionQueue: (dispatch_queue_t)completionQueue
+                               completion: (id)completion;
+- (BOOL)jobIsCancelled: (ConvertMathJob *)job;
+- (void)runJob: (ConvertMathJob *)job;
+- (void)finishJob: (ConvertMathJob *)job withResult: (id)result;
+- (void)cancelRequest: (ConvertMathRequest *)request;
+
++ (NSOperationQueuePriority)operationPriorityForPriority: (ConvertMathPriority)priority;
+
+@end
+
+@implementation ConvertMathRequest
+
+- (id)initWithMathStr: (NSString *)mathStr priority: (ConvertMathPriority)priority
+{
+    self = [super init];
+    if (self)
+    {
+        self->_mathStr = mathStr;
+        self->_priority = priority;
+        self->requestCancelled = NO;
+    }
+    return self;
+}
+
+- (void)cancel
+{
+    [self.convertQueue cancelRequest:self];
+}
+
+- (BOOL)isCancelled
+{
+    @synchronized(self)
+    {
+        return self->requestCancelled;
+    }
+}
+
+- (void)markCancelled
+{
+    @synchronized(self)
+    {
+        self->requestCancelled = YES;
+    }
+}
+
+@end
+
+@implementation ConvertMathQueue
+
++ (ConvertMathQueue *)sharedQueue
+{
+    static ConvertMathQueue *sharedQueue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedQueue = [[ConvertMathQueue alloc] init];
+    });
+    return sharedQueue;
+}
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        // Each conversion has its own data source and equation, and the caches shared with the main thread
+        // (style attributes, MATH tables, layout memo, TTF fonts and the glyph atlas) are locked or built once.
+        // Conversions still run one at a time so a long list doesn't take every core, and the most urgent request goes next.
+        self->operationQueue = [[NSOperationQueue alloc] init];
+        self->operationQueue.maxConcurrentOperationCount = 1;
+        self->operationQueue.name = @"ConvertMathQueue";
+        self->activeJobs = [[NSMutableDictionary alloc] init];
+        self->_pixelScale = 1.0;
+    }
+    return self;
+}
+
++ (NSOperationQueuePriority)operationPriorityForPriority: (ConvertMathPriority)priority
+{
+    if (priority == convertPriorityHigh)
+        return NSOperationQueuePriorityHigh;
+    if (priority == convertPriorityLow)
+        return NSOperationQueuePriorityLow;
+
+    return NSOperationQueuePriorityNormal;
+}
+
+- (ConvertMathRequest *)convertMathToImage: (NSString *)mathStr
+                                  priority: (ConvertMathPriority)priority
+                           completionQueue: (dispatch_queue_t)completionQueue
+                                completion: (ConvertMathImageCompletion)completion
+{
+    return [self addRequestForMath:mathStr output:convertOutputImage priority:priority completionQueue:completionQueue completion:completion];
+}
+
+- (ConvertMathRequest *)convertMathToPNGData: (NSString *)mathStr
+                                    priority: (ConvertMathPriority)priority
+                             completionQueue: (dispatch_queue_t)completionQueue
+                                  completion: (ConvertMathDataCompletion)completion
+{
+    return [self addRequestForMath:mathStr output:convertOutputPNGData priority:priority completionQueue:completionQueue completion:completion];
+}
+
+- (ConvertMathRequest *)addRequestForMath: (NSString *)mathStr
+                                   output: (ConvertMathOutput)output
+                                 priority: (ConvertMathPriority)priority
+                          completionQueue: (dispatch_queue_t)completionQueue
+                               completion: (id)completion
+{
+    ConvertMathRequest *request = [[ConvertMathRequest alloc] initWithMathStr:mathStr priority:priority];
+    request.completion = [completion copy];
+    request.completionQueue = (NULL != completionQueue) ? completionQueue : dispatch_get_main_queue();
+    request.convertQueue = self;
+
+    CGFloat usePixelScale = self.pixelScale;
+    NSString *jobKey = [NSString stringWithFormat:@"%d|%.2f|%@", output, usePixelScale, (nil != mathStr) ? mathStr : @""];
+
+    @synchronized(self)
+    {
+        ConvertMathJob *job = self->activeJobs[jobKey];
+        if (nil != job)
+        {
+            // Join the existing conversion, and move it up the queue if this request is more urgent.
+            [job.requests addObject:request];
+            request.job = job;
+            NSOperationQueuePriority usePriority = [ConvertMathQueue operationPriorityForPriority:priority];
+            if (usePriority > job.operation.queuePriority && !job.operation.isExecuting)
+            {
+                job.operation.queuePriority = usePriority;
+            }
+            return request;
+        }
+
+        job = [[ConvertMathJob alloc] init];
+        job.jobKey = jobKey;
+        job.mathStr = mathStr;
+        job.output = output;
+        job.pixelScale = usePixelScale;
+        job.requests = [[NSMutableArray alloc] initWithObjects:request, nil];
+        request.job = job;
+
+        // The job holds the operation, so the block only keeps a weak reference back to it.
+        // activeJobs holds the job until it finishes or every request is cancelled.
+        __weak ConvertMathQueue *weakSelf = self;
+        __weak ConvertMathJob *weakJob = job;
+        NSBlockOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
+            ConvertMathJob *runningJob = weakJob;
+            if (nil != runningJob)
+            {
+                [weakSelf runJob:runningJob];
+            }
+        }];
+        operation.queuePriority = [ConvertMathQueue operationPriorityForPriority:priority];
+        job.operation = operation;
+        self->activeJobs[jobKey] = job;
+        [self->operationQueue addOperation:operation];
+    }
+
+    return request;
+}
+
+- (NSUInteger)pendingConversionCount
+{
+    @synchronized(self)
+    {
+        return self->activeJobs.count;
+    }
+}
+
+- (void)cancelRequest: (ConvertMathRequest *)request
+{
+    [request markCancelled];
+
+    @synchronized(self)
+    {
+        ConvertMathJob *job = request.job;
+        if (nil == job)
+            return;
+
+        [job.requests removeObject:request];
+        if (job.requests.count == 0)
+        {
+            // Nobody is waiting on it. A running job stops at its next check.
+            [job.operation cancel];
+            if (self->activeJobs[job.jobKey] == job)
+            {
+                [self->activeJobs removeObjectForKey:job.jobKey];
+            }
+        }
+    }
+}
+
+- (void)cancelAllRequests
+{
+    NSArray *allRequests = nil;
+    @synchronized(self)
+    {
+        allRequests = [self->activeJobs.allValues valueForKeyPath:@"@unionOfArrays.requests"];
+    }
+
+    for (ConvertMathRequest *request in allRequests)
+    {
+        [request cancel];
+    }
+}
+
+- (BOOL)jobIsCancelled: (ConvertMathJob *)job
+{
+    @synchronized(self)
+    {
+        return (job.requests.count == 0 || job.operation.isCancelled);
+    }
+}
+
+// Runs the import, layout and raster steps, checking between each of them whether anyone still wants the result.
+- (void)runJob: (ConvertMathJob *)job
+{
+    if ([self jobIsCancelled:job])
+        return;
+
+    id result = nil;
+    @autoreleasepool
+    {
+        NSString *mathMLStr = job.mathStr;
+        BOOL mathIsInline = NO;
+        if ([ConvertMathToImage mathIsEmpty:mathMLStr])
+        {
+            mathMLStr = nil;
+        }
+        else if ([ConvertMathToImage isMathML:mathMLStr])
+        {
+            mathIsInline = [ConvertMathToImage isInlineMathML:mathMLStr];
+        }
+        else
+        {
+            mathIsInline = [ConvertMathToImage isInlineMath:mathMLStr];
+            mathMLStr = [ConvertBlahtex convertTexToMML:mathMLStr isInline:mathIsInline];
+        }
+
+        EQRenderEquation *renderEquation = (mathMLStr.length > 0) ? [ConvertMathToImage importMathML:mathMLStr] : nil;
+        if ([self jobIsCancelled:job])
+            return;
+
+        CGRect drawRect = CGRectZero;
+        CGSize imageSize = CGSizeZero;
+        if (nil != renderEquation)
+        {
+            imageSize = [ConvertMathToImage layoutRenderEquation:renderEquation isInline:mathIsInline margin:kDEFAULT_IMAGE_MARGIN drawRect:&drawRect];
+        }
+        if ([self jobIsCancelled:job])
+            return;
+
+        if (imageSize.width > 0.0 && imageSize.height > 0.0)
+        {
+            EQRenderRasterizer *rasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:renderEquation];
+            rasterizer.pixelScale = job.pixelScale;
+            if (job.output == convertOutputPNGData)
+            {
+                result = [rasterizer pngDataWithSize:imageSize drawRect:drawRect compressionLevel:kQUEUE_PNG_COMPRESSION_LEVEL];
+            }
+            else
+            {
+                CGImageRef rasterImage = [rasterizer createImageWithSize:imageSize drawRect:drawRect];
+                if (NULL != rasterImage)
+                {
+                    result = [UIImage imageWithCGImage:rasterImage scale:rasterizer.pixelScale orientation:UIImageOrientationUp];
+                    CGImageRelease(rasterImage);
+                }
+            }
+        }
+    }
+
+    [self finishJob:job withResult:result];
+}
+
+- (void)finishJob: (ConvertMathJob *)job withResult: (id)result
+{
+    NSArray *finishedRequests = nil;
+    @synchronized(self)
+    {
+        finishedRequests = job.requests.copy;
+        [job.requests removeAllObjects];
+        if (self->activeJobs[job.jobKey] == job)
+        {
+            [self->activeJobs removeObjectForKey:job.jobKey];
+        }
+    }
+
+    for (ConvertMathRequest *request in finishedRequests)
+    {
+        dispatch_async(request.completionQueue, ^{
+            // The request may have been cancelled while the result was on its way.
+            if (request.isCancelled)
+                return;
+
+            if (job.output == convertOutputPNGData)
+            {
+                ConvertMathDataCompletion completion = request.completion;
+                if (nil != completion)
+                    completion(result);
+            }
+            else
+            {
+                ConvertMathImageCompletion completion = request.completion;
+                if (nil != completion)
+                    completion(result);
+            }
+        });
+    }
+}
+
+@end
@@ -19,6 +19,11 @@
 #import <Foundation/Foundation.h>
 #import <UIKit/UIKit.h>
 
+// Empty space added around the ink bounds of the math, in points.
+extern CGFloat const kDEFAULT_IMAGE_MARGIN;
+
+@class EQRenderEquation;
+
 // This class is included partially as a demonstration/example.
 // It should handle most use cases but you can tweak the code as needed.
 
@@ -26,6 +31,49 @@
 
 + (UIImage *)convertTeXMathToPNG: (NSString *)mathStr;
 + (UIImage *)convertMathMLToPNG: (NSString *)mathStr;
++ (UIImage *)convertMathMLToPNG: (NSString *)mathStr margin: (CGFloat)margin;
+
+// Same output size as convertMathMLToPNG:, but glyphs are drawn from the shared glyph atlas.
++ (UIImage *)convertMathMLToPNGUsingGlyphAtlas: (NSString *)mathStr;
+
+// Renders into an alpha-only buffer and encodes the PNG bytes directly, without a UIImage.
+// Compression levels use the zlib range of 0-9.
+// These don't use UIScreen, so they can run on any thread. The pixel scale is 1.0 unless one is passed in.
++ (NSData *)convertTeXMathToPNGData: (NSString *)mathStr compressionLevel: (NSInteger)compressionLevel;
++ (NSData *)convertMathMLToPNGData: (NSString *)mathStr compressionLevel: (NSInteger)compressionLevel;
++ (NSData *)convertMathMLToPNGData: (NSString *)mathStr pixelScale: (CGFloat)pixelScale compressionLevel: (NSInteger)compressionLevel;
++ (BOOL)writeMathML: (NSString *)mathStr toPNGFileDescriptor: (int)fileDescriptor compressionLevel: (NSInteger)compressionLevel;
++ (BOOL)writeMathML: (NSString *)mathStr
+toPNGFileDescriptor: (int)fileDescriptor
+         pixelScale: (CGFloat)pixelScale
+   compressionLevel: (NSInteger)compressionLevel;
+
+// Returns an SVG document instead of a bitmap. Doesn't need a graphics context.
++ (NSString *)convertTeXMathToSVG: (NSString *)mathStr;
++ (NSString *)convertMathMLToSVG: (NSString *)mathStr;
+
+// Lays the math out once and renders it for each target, such as 1x, 2x and 3x images plus a thumbnail.
+// A target is either an NSNumber with the pixels per point or an NSValue with a CGSize in pixels that the image is scaled to fit.
+// The ink bounds and glyph runs are measured once and shared by every target, and glyph masks are reused through the glyph atlas.
+// Returns one entry per target in the same order, with NSNull for a target that couldn't be drawn.
++ (NSArray *)convertMathMLToPNGs: (NSString *)mathStr forTargets: (NSArray *)targets;
++ (NSArray *)convertRenderEquation: (EQRenderEquation *)renderEquation toPNGsForTargets: (NSArray *)targets margin: (CGFloat)margin;
++ (NSArray *)convertRenderEquation: (EQRenderEquation *)renderEquation
+              toPNGDataForTargets: (NSArray *)targets
+                           margin: (CGFloat)margin
+                 compressionLevel: (NSInteger)compressionLevel;
+
+// The separate steps used by the conversions above, for callers that need to run or cancel them one at a time.
++ (EQRenderEquation *)importMathML: (NSString *)mathMLStr;
++ (CGSize)layoutRenderEquation: (EQRenderEquation *)renderEquation
+                      isInline: (BOOL)mathIsInline
+                        margin: (CGFloat)margin
+                      drawRect: (CGRect *)drawRect;
+
+// Computes the image size and draw rect for an equation that is already laid out.
++ (CGSize)imageSizeForRenderEquation: (EQRenderEquation *)renderEquation
+                              margin: (CGFloat)margin
+                            drawRect: (CGRect *)drawRect;
 
 + (BOOL)isInlineMath: (NSString *)inputStr;
 + (BOOL)isInlineMathML: (NSString *)inputStr;
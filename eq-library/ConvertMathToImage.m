@@ -21,6 +21,10 @@
 #import "EquationViewDataSource.h"
 #import "EQXMLImporter.h"
 #import "EQRenderEquation.h"
+#import "EQRenderSVGExporter.h"
+#import "EQRenderRasterizer.h"
+
+CGFloat const kDEFAULT_IMAGE_MARGIN = 2.0;
 
 @implementation ConvertMathToImage
 
@@ -38,7 +42,7 @@
     if (convertedMathML.length == 0)
         return nil;
 
-    return [self convertMathMLToPNG:convertedMathML isInline:mathIsInline];
+    return [self convertMathMLToPNG:convertedMathML isInline:mathIsInline margin:kDEFAULT_IMAGE_MARGIN useGlyphAtlas:NO];
 }
 
 + (UIImage *)convertMathMLToPNG: (NSString *)mathStr
@@ -52,68 +56,127 @@
     // Safe to adjust the code as needed here.
     BOOL mathIsInline = [self isInlineMathML:mathStr];
 
-    return [self convertMathMLToPNG:mathStr isInline:mathIsInline];
+    return [self convertMathMLToPNG:mathStr isInline:mathIsInline margin:kDEFAULT_IMAGE_MARGIN useGlyphAtlas:NO];
 }
 
++ (UIImage *)convertMathMLToPNGUsingGlyphAtlas: (NSString *)mathStr
+{
+    if ([self mathIsEmpty:mathStr])
+        return nil;
 
-+ (UIImage *)convertMathMLToPNG: (NSString *)mathMLStr isInline: (BOOL)mathIsInline
+    BOOL mathIsInline = [self isInlineMathML:mathStr];
+
+    return [self convertMathMLToPNG:mathStr isInline:mathIsInline margin:kDEFAULT_IMAGE_MARGIN useGlyphAtlas:YES];
+}
+
++ (UIImage *)convertMathMLToPNG: (NSString *)mathStr margin: (CGFloat)margin
 {
-    // Creates a datasource that parses the XML string and loads it into a model object that can be rendered into draw commands.
-    EquationViewDataSource *newDataSource = [EQXMLImporter populateDataSourceWithXMLString:mathMLStr];
+    if ([self mathIsEmpty:mathStr])
+        return nil;
 
-    // Creates a class that can read the internal model object and draw the math in a CoreGraphics context.
-    EQRenderEquation *newEquationData = [newDataSource buildRenderEquation];
+    BOOL mathIsInline = [self isInlineMathML:mathStr];
+
+    return [self convertMathMLToPNG:mathStr isInline:mathIsInline margin:margin useGlyphAtlas:NO];
+}
+
+// Creates a datasource that parses the XML string and loads it into a model object that can be rendered into draw commands.
+// Then creates a class that can read the internal model object and draw the math in a CoreGraphics context.
++ (EQRenderEquation *)importMathML: (NSString *)mathMLStr
+{
+    EquationViewDataSource *newDataSource = [EQXMLImporter populateDataSourceWithXMLString:mathMLStr];
+    return [newDataSource buildRenderEquation];
+}
 
+// Lays out the equation for drawing in an iOS graphics context.
++ (void)layoutRenderEquation: (EQRenderEquation *)newEquationData isInline: (BOOL)mathIsInline
+{
     // This tells the class not to use the included TTF fonts.
     newEquationData.usePDFMode = NO;
 
     // This tells the class that you are drawing in an iOS graphics context and need to flip the display.
     newEquationData.shouldFlipContext = YES;
 
+    // The math is laid out before it is actually drawn in the context.
+    // It currently doesn't handle "true" inline math but scales the display down.
+    newEquationData.pdfScale = mathIsInline ? 0.9 : 1.0;
+    [newEquationData layoutEquationLines];
+}
+
+// Lays out the equation and computes the image size and the rect to draw it in.
+// The image is sized to the ink bounds of the math plus the margin on every side.
++ (CGSize)layoutRenderEquation: (EQRenderEquation *)newEquationData
+                      isInline: (BOOL)mathIsInline
+                        margin: (CGFloat)margin
+                      drawRect: (CGRect *)drawRect
+{
+    [self layoutRenderEquation:newEquationData isInline:mathIsInline];
+    return [self imageSizeForRenderEquation:newEquationData margin:margin drawRect:drawRect];
+}
+
++ (CGSize)imageSizeForRenderEquation: (EQRenderEquation *)renderEquation
+                              margin: (CGFloat)margin
+                            drawRect: (CGRect *)drawRect
+{
+    CGRect inkBounds = [renderEquation inkBounds];
+    if (nil == renderEquation || CGRectIsNull(inkBounds))
+    {
+        *drawRect = CGRectZero;
+        return CGSizeZero;
+    }
+
+    // Snap the scaled bounds to whole points so the math isn't shifted by a fraction of a pixel.
+    CGFloat useScale = renderEquation.pdfScale;
+    CGRect scaledBounds = CGRectMake(inkBounds.origin.x * useScale, inkBounds.origin.y * useScale,
+                                     inkBounds.size.width * useScale, inkBounds.size.height * useScale);
+    scaledBounds = CGRectIntegral(scaledBounds);
+    CGFloat useMargin = MAX(margin, 0.0);
+
+    CGSize scaledSize = CGSizeMake(scaledBounds.size.width + 2.0 * useMargin, scaledBounds.size.height + 2.0 * useMargin);
+    *drawRect = CGRectMake(useMargin - scaledBounds.origin.x, useMargin - scaledBounds.origin.y, scaledSize.width, scaledSize.height);
+
+    return scaledSize;
+}
+
++ (EQRenderEquation *)layoutMathML: (NSString *)mathMLStr
+                          isInline: (BOOL)mathIsInline
+                            margin: (CGFloat)margin
+                         imageSize: (CGSize *)imageSize
+                          drawRect: (CGRect *)drawRect
+{
+    EQRenderEquation *newEquationData = [self importMathML:mathMLStr];
+    *imageSize = [self layoutRenderEquation:newEquationData isInline:mathIsInline margin:margin drawRect:drawRect];
+    return newEquationData;
+}
+
++ (UIImage *)convertMathMLToPNG: (NSString *)mathMLStr
+                        isInline: (BOOL)mathIsInline
+                          margin: (CGFloat)margin
+                   useGlyphAtlas: (BOOL)useGlyphAtlas
+{
+    CGSize scaledSize;
+    CGRect drawRect;
+    EQRenderEquation *newEquationData = [self layoutMathML:mathMLStr isInline:mathIsInline margin:margin imageSize:&scaledSize drawRect:&drawRect];
+    if (scaledSize.width <= 0.0 || scaledSize.height <= 0.0)
+        return nil;
+
     // May make this user configurable.
     // This just tells the math render class to not draw any background color.
     BOOL useTransparency = YES;
 
-    // The math is laid out before it is actually drawn in the context.
-    // It currently doesn't handle "true" inline math but scales the display down and makes some adjustment to layout.
-    // If you don't draw inline math, you can just ignore this.
-    // If you don't like the result, you can tweak it somewhat.
-    CGSize scaledSize;
-    CGFloat adjustY = 0.0;
-    CGFloat adjustX = 0.0;
-    if (mathIsInline)
-    {
-        newEquationData.pdfScale = 0.9;
-        [newEquationData layoutEquationLines];
-        scaledSize = [newEquationData computeInlineSize];
-        adjustY = -12.0;
-        adjustX = -35.0;
-        scaledSize.width *= 1.5;
-        scaledSize.height *= 2.0;
-        CGSize testDrawSize = [newEquationData drawSize];
-        testDrawSize.height -= 20.0;
-        testDrawSize.width -= 30.0;
-        if (testDrawSize.width > 90.0)
-        {
-            testDrawSize.width -= 45.0;
-        }
-        scaledSize = testDrawSize;
-    }
-    else
+    // The glyph atlas path draws straight into a bitmap and reuses glyph masks between equations.
+    if (useGlyphAtlas)
     {
-        // This is the default display equation layout.
-        // You need to compute the size of the math to ensure it sizes relatively close without clipping.
-        newEquationData.pdfScale = 1.0;
-        [newEquationData layoutEquationLines];
-
-        scaledSize = newEquationData.drawSize;
-        scaledSize.width *= newEquationData.pdfScale;
-        scaledSize.height *= newEquationData.pdfScale;
-        scaledSize.width += 40.0;
+        EQRenderRasterizer *rasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:newEquationData];
+        rasterizer.pixelScale = [UIScreen mainScreen].scale;
+        CGImageRef atlasImage = [rasterizer createImageWithSize:scaledSize drawRect:drawRect];
+        if (NULL == atlasImage)
+            return nil;
+
+        UIImage *newImage = [UIImage imageWithCGImage:atlasImage scale:rasterizer.pixelScale orientation:UIImageOrientationUp];
+        CGImageRelease(atlasImage);
+        return newImage;
     }
 
-    CGRect drawRect = CGRectMake(-20.0 + adjustX, -45.0 + adjustY, scaledSize.width, scaledSize.height);
-
     // You need to create a UIGraphics context to draw in before calling the method to draw the equation.
     UIGraphicsBeginImageContextWithOptions(scaledSize, !useTransparency, 0.0);
     CGContextRef context = UIGraphicsGetCurrentContext();
@@ -153,6 +216,191 @@
     return newImage;
 }
 
++ (NSData *)convertTeXMathToPNGData: (NSString *)mathStr compressionLevel: (NSInteger)compressionLevel
+{
+    if ([self mathIsEmpty:mathStr])
+        return nil;
+
+    BOOL mathIsInline = [self isInlineMath:mathStr];
+    NSString *convertedMathML = [ConvertBlahtex convertTexToMML:mathStr isInline:mathIsInline];
+    if (convertedMathML.length == 0)
+        return nil;
+
+    return [self convertMathMLToPNGData:convertedMathML pixelScale:1.0 compressionLevel:compressionLevel];
+}
+
++ (NSData *)convertMathMLToPNGData: (NSString *)mathStr compressionLevel: (NSInteger)compressionLevel
+{
+    return [self convertMathMLToPNGData:mathStr pixelScale:1.0 compressionLevel:compressionLevel];
+}
+
++ (NSData *)convertMathMLToPNGData: (NSString *)mathStr pixelScale: (CGFloat)pixelScale compressionLevel: (NSInteger)compressionLevel
+{
+    if ([self mathIsEmpty:mathStr])
+        return nil;
+
+    CGSize scaledSize;
+    CGRect drawRect;
+    EQRenderEquation *newEquationData = [self layoutMathML:mathStr isInline:[self isInlineMathML:mathStr]
+                                                    margin:kDEFAULT_IMAGE_MARGIN imageSize:&scaledSize drawRect:&drawRect];
+
+    EQRenderRasterizer *rasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:newEquationData];
+    rasterizer.pixelScale = pixelScale;
+    return [rasterizer pngDataWithSize:scaledSize drawRect:drawRect compressionLevel:compressionLevel];
+}
+
++ (BOOL)writeMathML: (NSString *)mathStr toPNGFileDescriptor: (int)fileDescriptor compressionLevel: (NSInteger)compressionLevel
+{
+    return [self writeMathML:mathStr toPNGFileDescriptor:fileDescriptor pixelScale:1.0 compressionLevel:compressionLevel];
+}
+
++ (BOOL)writeMathML: (NSString *)mathStr
+toPNGFileDescriptor: (int)fileDescriptor
+         pixelScale: (CGFloat)pixelScale
+   compressionLevel: (NSInteger)compressionLevel
+{
+    if ([self mathIsEmpty:mathStr])
+        return NO;
+
+    CGSize scaledSize;
+    CGRect drawRect;
+    EQRenderEquation *newEquationData = [self layoutMathML:mathStr isInline:[self isInlineMathML:mathStr]
+                                                    margin:kDEFAULT_IMAGE_MARGIN imageSize:&scaledSize drawRect:&drawRect];
+
+    EQRenderRasterizer *rasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:newEquationData];
+    rasterizer.pixelScale = pixelScale;
+    return [rasterizer writePNGWithSize:scaledSize drawRect:drawRect compressionLevel:compressionLevel toFileDescriptor:fileDescriptor];
+}
+
++ (NSArray *)convertMathMLToPNGs: (NSString *)mathStr forTargets: (NSArray *)targets
+{
+    if ([self mathIsEmpty:mathStr] || nil == targets)
+        return nil;
+
+    // The image size is worked out for the targets below, so this only lays the math out.
+    EQRenderEquation *newEquationData = [self importMathML:mathStr];
+    [self layoutRenderEquation:newEquationData isInline:[self isInlineMathML:mathStr]];
+
+    return [self convertRenderEquation:newEquationData toPNGsForTargets:targets margin:kDEFAULT_IMAGE_MARGIN];
+}
+
++ (NSArray *)convertRenderEquation: (EQRenderEquation *)renderEquation toPNGsForTargets: (NSArray *)targets margin: (CGFloat)margin
+{
+    CGSize imageSize;
+    CGRect drawRect;
+    NSArray *pixelScales = [self pixelScalesForRenderEquation:renderEquation targets:targets margin:margin imageSize:&imageSize drawRect:&drawRect];
+    if (nil == pixelScales)
+        return nil;
+
+    // Typeset the glyph runs once for all of the targets.
+    EQRenderFrozenEquation *frozenEquation = [renderEquation frozenEquation];
+    EQRenderRasterizer *rasterizer = [[EQRenderRasterizer alloc] initWithFrozenEquation:frozenEquation];
+
+    NSMutableArray *returnImages = [[NSMutableArray alloc] initWithCapacity:pixelScales.count];
+    for (NSNumber *pixelScale in pixelScales)
+    {
+        rasterizer.pixelScale = pixelScale.doubleValue;
+        CGImageRef rasterImage = (rasterizer.pixelScale > 0.0) ? [rasterizer createImageWithSize:imageSize drawRect:drawRect] : NULL;
+        if (NULL == rasterImage)
+        {
+            [returnImages addObject:[NSNull null]];
+            continue;
+        }
+
+        [returnImages addObject:[UIImage imageWithCGImage:rasterImage scale:rasterizer.pixelScale orientation:UIImageOrientationUp]];
+        CGImageRelease(rasterImage);
+    }
+
+    return returnImages;
+}
+
++ (NSArray *)convertRenderEquation: (EQRenderEquation *)renderEquation
+              toPNGDataForTargets: (NSArray *)targets
+                           margin: (CGFloat)margin
+                 compressionLevel: (NSInteger)compressionLevel
+{
+    CGSize imageSize;
+    CGRect drawRect;
+    NSArray *pixelScales = [self pixelScalesForRenderEquation:renderEquation targets:targets margin:margin imageSize:&imageSize drawRect:&drawRect];
+    if (nil == pixelScales)
+        return nil;
+
+    EQRenderFrozenEquation *frozenEquation = [renderEquation frozenEquation];
+    EQRenderRasterizer *rasterizer = [[EQRenderRasterizer alloc] initWithFrozenEquation:frozenEquation];
+
+    NSMutableArray *returnData = [[NSMutableArray alloc] initWithCapacity:pixelScales.count];
+    for (NSNumber *pixelScale in pixelScales)
+    {
+        rasterizer.pixelScale = pixelScale.doubleValue;
+        NSData *pngData = (rasterizer.pixelScale > 0.0) ? [rasterizer pngDataWithSize:imageSize drawRect:drawRect compressionLevel:compressionLevel] : nil;
+        [returnData addObject:(nil != pngData) ? pngData : [NSNull null]];
+    }
+
+    return returnData;
+}
+
+// Converts each target to pixels per point. Pixel sizes use the largest scale that fits both dimensions.
++ (NSArray *)pixelScalesForRenderEquation: (EQRenderEquation *)renderEquation
+                                  targets: (NSArray *)targets
+                                   margin: (CGFloat)margin
+                                imageSize: (CGSize *)imageSize
+                                 drawRect: (CGRect *)drawRect
+{
+    if (nil == renderEquation || nil == targets)
+        return nil;
+
+    *imageSize = [self imageSizeForRenderEquation:renderEquation margin:margin drawRect:drawRect];
+    if (imageSize->width <= 0.0 || imageSize->height <= 0.0)
+        return nil;
+
+    NSMutableArray *pixelScales = [[NSMutableArray alloc] initWithCapacity:targets.count];
+    for (id target in targets)
+    {
+        CGFloat pixelScale = 0.0;
+        if ([target isKindOfClass:[NSNumber class]])
+        {
+            pixelScale = [(NSNumber *)target doubleValue];
+        }
+        else if ([target isKindOfClass:[NSValue class]])
+        {
+            CGSize pixelSize = [(NSValue *)target CGSizeValue];
+            pixelScale = MIN(pixelSize.width / imageSize->width, pixelSize.height / imageSize->height);
+        }
+        [pixelScales addObject:@(pixelScale)];
+    }
+
+    return pixelScales;
+}
+
++ (NSString *)convertTeXMathToSVG: (NSString *)mathStr
+{
+    if ([self mathIsEmpty:mathStr])
+        return nil;
+
+    BOOL mathIsInline = [self isInlineMath:mathStr];
+    NSString *convertedMathML = [ConvertBlahtex convertTexToMML:mathStr isInline:mathIsInline];
+    if (convertedMathML.length == 0)
+        return nil;
+
+    return [self convertMathMLToSVG:convertedMathML];
+}
+
++ (NSString *)convertMathMLToSVG: (NSString *)mathStr
+{
+    if ([self mathIsEmpty:mathStr])
+        return nil;
+
+    EquationViewDataSource *newDataSource = [EQXMLImporter populateDataSourceWithXMLString:mathStr];
+    EQRenderEquation *newEquationData = [newDataSource buildRenderEquation];
+
+    // Uses the same scale as the PNG output.
+    newEquationData.usePDFMode = NO;
+    newEquationData.pdfScale = [self isInlineMathML:mathStr] ? 0.9 : 1.0;
+    [newEquationData layoutEquationLines];
+
+    return [EQRenderSVGExporter svgStringWithRenderEquation:newEquationData];
+}
+
 // Assumes the string is valid, so this method is intended
 // to just be a quick check before passing the string to BlahTex.
 + (BOOL)isInlineMath: (NSString *)inputStr
@@ -23,9 +23,15 @@
 #import "EQRenderBracers.h"
 #import "EQRenderFontDictionary.h"
 #import "EQRenderStretchyBracers.h"
+#import "EQMathTable.h"
 
 @interface EQRenderBracers()
 
++ (id)buildMathTableDataForBracerCharacter: (NSAttributedString *)bracerCharacter
+                                withHeight: (NSNumber *)heightNumber
+                               originValue: (NSValue *)useOrigin
+                                  useTable: (EQMathTable *)mathTable;
+
 @end
 
 
@@ -40,6 +46,16 @@
     if (nil == bracerCharacter || nil == heightNumber)
         return nil;
 
+    // When the math font is bundled, its variants and assemblies replace the measurements below.
+    EQMathTable *mathTable = [EQMathTable defaultMathTable];
+    if (nil != mathTable && [mathTable hasConstructionForGlyph:[mathTable glyphForCharacter:bracerCharacter.string] vertical:YES])
+    {
+        id mathBracerData = [EQRenderBracers buildMathTableDataForBracerCharacter:bracerCharacter withHeight:heightNumber
+                                                                      originValue:useOrigin useTable:mathTable];
+        if (nil != mathBracerData)
+            return mathBracerData;
+    }
+
     CGFloat bracerHeight = [heightNumber floatValue];
     EQRenderData *bracerData = [[EQRenderData alloc] initWithAttributedString:bracerCharacter];
 
@@ -146,6 +162,52 @@
     return returnData;
 }
 
+// Picks the smallest pre-sized variant that covers the height, or an assembly if none of them do.
+// Returns nil if the unstretched glyph is tall enough or the font can't reach the height, so the caller can fall back.
++ (id)buildMathTableDataForBracerCharacter: (NSAttributedString *)bracerCharacter
+                                withHeight: (NSNumber *)heightNumber
+                               originValue: (NSValue *)useOrigin
+                                  useTable: (EQMathTable *)mathTable
+{
+    NSDictionary *currentFontDictionary = [bracerCharacter attributesAtIndex:0 effectiveRange:NULL];
+    UIFont *currentFont = currentFontDictionary[NSFontAttributeName];
+    NSNumber *currentKern = currentFontDictionary[NSKernAttributeName];
+    CGFloat currentFontSize = (nil != currentFont) ? currentFont.pointSize : kDEFAULT_FONT_SIZE;
+
+    CGGlyph baseGlyph = [mathTable glyphForCharacter:bracerCharacter.string];
+    CGGlyph variantGlyph = 0;
+    if ([mathTable variantForGlyph:baseGlyph minAdvance:heightNumber.floatValue fontSize:currentFontSize
+                          vertical:YES variantGlyph:&variantGlyph variantAdvance:NULL])
+    {
+        if (variantGlyph == baseGlyph)
+            return nil;
+
+        NSAttributedString *variantStr = [mathTable attributedStringForGlyph:variantGlyph baseString:bracerCharacter.string
+                                                                    fontSize:currentFontSize kernValue:currentKern.floatValue];
+        if (nil == variantStr)
+            return nil;
+
+        EQRenderData *returnData = [[EQRenderData alloc] initWithAttributedString:variantStr];
+        returnData.storedKern = currentKern.floatValue;
+        if (nil != useOrigin)
+        {
+            returnData.drawOrigin = useOrigin.CGPointValue;
+        }
+
+        return returnData;
+    }
+
+    if ([mathTable hasAssemblyForGlyph:baseGlyph vertical:YES])
+    {
+        EQRenderStretchyBracers *returnBracerData = [[EQRenderStretchyBracers alloc] initWithBracerCharacter:bracerCharacter withHeight:heightNumber useKern:@(currentKern.floatValue) originValue:useOrigin];
+        [returnBracerData buildMetricsDictionary];
+
+        return returnBracerData;
+    }
+
+    return nil;
+}
+
 + (id)addDescenderDataToBracerData: (id)bracerData withDescenderPoint: (CGPoint)descenderPoint
 {
     if (nil == bracerData)
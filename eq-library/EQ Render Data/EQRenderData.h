@@ -61,6 +61,12 @@
 - (CGRect)imageBounds;
 - (CGRect)imageBoundsWithStretchyData;
 
+// Unlike imageBounds, this keeps the origin relative to the baseline (y-up) so it can be used for ascent and descent.
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context useStretchy: (BOOL)useStretchy;
+
+// Also returns the image bounds before the whitespace adjustment in inkBounds, measured from the same line.
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context useStretchy: (BOOL)useStretchy inkBounds: (CGRect *)inkBounds;
+
 - (CGRect)typographicBounds;
 - (CGRect)typographicBoundsWithStretchyData;
 - (CGRect)cursorRectForStringIndex: (NSUInteger)index;
@@ -68,6 +74,7 @@
 - (Boolean)shouldUseSmaller;
 - (id)getFractionBarParent;
 - (id)getNRootParent;
+- (id)getMatrixCellParent;
 
 - (void)resetStretchyCharacterData;
 - (void)addStretchyCharacterData: (id)stretchyData forTextRange: (EQTextRange *)stretchyDataRange;
@@ -29,6 +29,8 @@
 
 - (void)initializeStretchyCharacterArray;
 - (CGRect)computeCursorRectForStringIndex: (NSUInteger)index inAttributedString: (NSAttributedString *)renderString;
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context withAttributedString: (NSAttributedString *)renderString;
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context withAttributedString: (NSAttributedString *)renderString inkBounds: (CGRect *)inkBounds;
 
 @end
 
@@ -172,6 +174,28 @@
 // Use this when calling from an active graphics context.
 - (CGRect)imageBoundsInContext: (CGContextRef)context withAttributedString: (NSAttributedString *)renderString
 {
+    if (nil == renderString || renderString.length == 0)
+        return CGRectZero;
+
+    CGRect imageBounds = [self baselineImageBoundsInContext:context withAttributedString:renderString];
+    imageBounds.origin = CGPointZero;
+
+    return imageBounds;
+}
+
+// Returns the image bounds without moving the origin, with the same whitespace adjustment as imageBounds.
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context withAttributedString: (NSAttributedString *)renderString
+{
+    return [self baselineImageBoundsInContext:context withAttributedString:renderString inkBounds:NULL];
+}
+
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context withAttributedString: (NSAttributedString *)renderString inkBounds: (CGRect *)inkBounds
+{
+    if (NULL != inkBounds)
+    {
+        *inkBounds = CGRectNull;
+    }
+
     if (nil == renderString || renderString.length == 0)
         return CGRectZero;
 
@@ -180,9 +204,13 @@
     CGRect imageBounds = CTLineGetImageBounds(testLine, context);
     CGFloat ascent, descent;
     double lineWidth = CTLineGetTypographicBounds(testLine, &ascent, &descent, NULL);
-    imageBounds.origin = CGPointZero;
     CFRelease(testLine);
 
+    if (NULL != inkBounds && !CGRectIsEmpty(imageBounds))
+    {
+        *inkBounds = imageBounds;
+    }
+
     // The typographic bounds may be larger if there is a large amount of whitespace in the line.
     // The image bounds should make an adjustment for that, though the height should be retained.
     CGFloat typoDelta = lineWidth - imageBounds.size.width;
@@ -239,6 +267,20 @@
     return [self computeImageBoundsUseStretchy:YES];
 }
 
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context useStretchy: (BOOL)useStretchy
+{
+    return [self baselineImageBoundsInContext:context useStretchy:useStretchy inkBounds:NULL];
+}
+
+- (CGRect)baselineImageBoundsInContext: (CGContextRef)context useStretchy: (BOOL)useStretchy inkBounds: (CGRect *)inkBounds
+{
+    if (useStretchy == YES)
+    {
+        return [self baselineImageBoundsInContext:context withAttributedString:[self renderStringWithStretchyCharacters] inkBounds:inkBounds];
+    }
+    return [self baselineImageBoundsInContext:context withAttributedString:self.renderString inkBounds:inkBounds];
+}
+
 // Returns a rect at origin 0,0 containing the typographical width and height of the line.
 - (CGRect)computeTypographicBoundsUseStretchy: (BOOL)useStretchy
 {
@@ -353,6 +395,21 @@
     return nil;
 }
 
+// Returns the innermost matrix cell stem that contains this data, or nil if it is not inside a matrix.
+- (id)getMatrixCellParent
+{
+    EQRenderStem *testStem = self.parentStem;
+    while (nil != testStem)
+    {
+        if (testStem.stemType == stemTypeMatrixCell)
+            return testStem;
+
+        testStem = testStem.parentStem;
+    }
+
+    return nil;
+}
+
 - (void)initializeStretchyCharacterArray
 {
     self->stretchyCharacterData = [[NSMutableArray alloc] initWithCapacity:self.renderString.length];
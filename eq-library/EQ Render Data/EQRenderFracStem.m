@@ -65,7 +65,7 @@
     return self;
 }
 
-- (void)layoutChildren
+- (void)layoutStemChildren
 {
     if (self.renderArray.count < 2)
     {
@@ -77,6 +77,21 @@
     id numObj = [self.renderArray objectAtIndex:0];
     id denObj = [self.renderArray objectAtIndex:1];
 
+    // Measure the numerator and denominator at your origin first.
+    // They are independent of each other, so this may run concurrently.
+    NSMutableArray *childStems = [[NSMutableArray alloc] initWithCapacity:2];
+    if ([numObj isKindOfClass:[EQRenderStem class]])
+    {
+        [numObj setDrawOrigin:self.drawOrigin];
+        [childStems addObject:numObj];
+    }
+    if ([denObj isKindOfClass:[EQRenderStem class]])
+    {
+        [denObj setDrawOrigin:self.drawOrigin];
+        [childStems addObject:denObj];
+    }
+    [self layoutChildStems:childStems];
+
     // Compute the sizes you will use for the numerator and denominator.
     // Will need to have it check if you are using a reduced font size later.
     CGSize numSize;
@@ -128,8 +143,6 @@
         drawFont = [UIFont fontWithName:kDEFAULT_FONT size:kDEFAULT_FONT_SIZE];
 
         EQRenderStem *numStem = (EQRenderStem *)numObj;
-        numStem.drawOrigin = self.drawOrigin;
-        [numStem layoutChildren];
 
         CGPoint testPoint = [EQRenderLayout findLowestChildOrigin:numStem];
         if (numStem.stemType == stemTypeNRoot || numStem.stemType == stemTypeSqRoot)
@@ -182,8 +195,6 @@
     else if ([denObj isKindOfClass:[EQRenderStem class]])
     {
         EQRenderStem *denStem = (EQRenderStem *)denObj;
-        denStem.drawOrigin = self.drawOrigin;
-        [denStem layoutChildren];
 
         CGPoint testPoint = [EQRenderLayout findHighestChildOrigin:denStem];
         if (testPoint.y < denStem.drawOrigin.y)
@@ -423,15 +434,7 @@
     [denObj setDrawOrigin:denOrigin];
 
     // Layout the stems again with the new origin.
-    if ([numObj isKindOfClass:[EQRenderStem class]])
-    {
-        [numObj layoutChildren];
-    }
-
-    if ([denObj isKindOfClass:[EQRenderStem class]])
-    {
-        [denObj layoutChildren];
-    }
+    [self layoutChildStems:childStems];
 
     self.startLinePoint = startPoint;
     self.endLinePoint = endPoint;
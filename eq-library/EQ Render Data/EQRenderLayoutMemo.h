@@ -0,0 +1,52 @@
+//
+//  EQRenderLayoutMemo.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+
+@class EQRenderStem;
+
+// Reuses the layout of repeated subexpressions, such as the same fraction appearing twice in one equation.
+// Each stem gets a structural key built from its subtree's strings, attributes and stem types,
+// plus the context that changes its layout (the size from shouldUseSmaller and shouldUseSmallest and its ancestors).
+// Keys are built bottom up from the interned keys of the child stems and the parent's context,
+// and are kept for the whole layout pass, so each stem is only read once.
+// A stem with a stored layout is restored from it and translated to its new origin instead of being laid out again.
+// It is off by default.
+
+@interface EQRenderLayoutMemo : NSObject
+
++ (void)setUsesLayoutMemo: (BOOL)usesLayoutMemo;
++ (BOOL)usesLayoutMemo;
++ (void)clearLayoutMemo;
+
+// The number of layouts restored since the memo was last cleared.
++ (NSUInteger)layoutMemoHitCount;
+
+// Calls can nest. The keys built during a pass are dropped once the outermost pass ends.
++ (void)beginLayoutPass;
++ (void)endLayoutPass;
+
+// Returns nil for subtrees that can not be reused, such as ones with stretchy bracers or matrices,
+// as those are also laid out by their ancestors.
++ (NSString *)structuralKeyForStem: (EQRenderStem *)renderStem;
+
+// Returns NO if there is no stored layout for the key that can be moved to the stem's origin.
++ (BOOL)restoreLayoutForStem: (EQRenderStem *)renderStem withKey: (NSString *)structuralKey;
++ (void)storeLayoutForStem: (EQRenderStem *)renderStem withKey: (NSString *)structuralKey;
+
+@end
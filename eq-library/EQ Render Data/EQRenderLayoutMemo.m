@@ -0,0 +1,581 @@
+//
+//  EQRenderLayoutMemo.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <UIKit/UIKit.h>
+#import "EQRenderLayoutMemo.h"
+#import "EQRenderStem.h"
+#import "EQRenderFracStem.h"
+#import "EQRenderData.h"
+#import "EQRenderTypesetter.h"
+
+// Keeps the memo from growing without bound when many different equations are laid out.
+static const NSUInteger kLAYOUT_MEMO_LIMIT = 1024;
+static const NSUInteger kLAYOUT_MEMO_KEY_LIMIT = 16384;
+static NSString * const kLAYOUT_MEMO_PASS_KEY = @"EQRenderLayoutMemoPass";
+
+static BOOL sUsesLayoutMemo = NO;
+static NSUInteger sLayoutMemoHitCount = 0;
+
+// Ids are never reused, so a key built before the interned keys were cleared can't match a newer one.
+static NSUInteger sNextKeyId = 0;
+
+static CGPoint EQOffsetFromOrigin(CGPoint drawPoint, CGPoint drawOrigin)
+{
+    return CGPointMake(drawPoint.x - drawOrigin.x, drawPoint.y - drawOrigin.y);
+}
+
+static CGPoint EQPointFromOffset(CGPoint offsetPoint, CGPoint drawOrigin)
+{
+    return CGPointMake(offsetPoint.x + drawOrigin.x, offsetPoint.y + drawOrigin.y);
+}
+
+// Holds the keys built during one layout on the current thread.
+// Stems are compared by pointer, as two stems with the same contents still need their own entries.
+@interface EQLayoutMemoPass : NSObject
+
+@property (nonatomic) NSUInteger passDepth;
+@property (strong, nonatomic) NSMapTable *subtreeKeys;
+@property (strong, nonatomic) NSMapTable *contextKeys;
+
+@end
+
+@implementation EQLayoutMemoPass
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        NSPointerFunctionsOptions stemOptions = NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality;
+        self->_subtreeKeys = [[NSMapTable alloc] initWithKeyOptions:stemOptions valueOptions:NSPointerFunctionsStrongMemory capacity:0];
+        self->_contextKeys = [[NSMapTable alloc] initWithKeyOptions:stemOptions valueOptions:NSPointerFunctionsStrongMemory capacity:0];
+    }
+    return self;
+}
+
+@end
+
+@interface EQRenderLayoutMemo()
+
++ (NSMutableDictionary *)layoutMemo;
++ (NSMutableDictionary *)internedKeys;
++ (NSString *)internKey: (NSString *)keyString;
++ (EQLayoutMemoPass *)currentLayoutPass;
++ (void)forgetKeysForNodes: (NSArray *)renderNodes;
++ (NSString *)subtreeKeyForStem: (EQRenderStem *)renderStem inPass: (EQLayoutMemoPass *)layoutPass;
++ (NSString *)contextKeyForStem: (EQRenderStem *)renderStem inPass: (EQLayoutMemoPass *)layoutPass;
++ (BOOL)appendKeyForStem: (EQRenderStem *)renderStem inPass: (EQLayoutMemoPass *)layoutPass toString: (NSMutableString *)keyString;
++ (BOOL)appendKeyForData: (EQRenderData *)renderData toString: (NSMutableString *)keyString;
++ (NSString *)keyForAttributeValue: (id)attributeValue;
++ (void)addNodesForStem: (EQRenderStem *)renderStem toArray: (NSMutableArray *)renderNodes;
++ (NSDictionary *)snapshotForStem: (EQRenderStem *)renderStem relativeTo: (CGPoint)rootOrigin;
++ (NSDictionary *)snapshotForData: (EQRenderData *)renderData relativeTo: (CGPoint)rootOrigin;
++ (void)restoreStem: (EQRenderStem *)renderStem fromSnapshot: (NSDictionary *)snapshot relativeTo: (CGPoint)rootOrigin;
++ (void)restoreData: (EQRenderData *)renderData fromSnapshot: (NSDictionary *)snapshot relativeTo: (CGPoint)rootOrigin;
+
+@end
+
+@implementation EQRenderLayoutMemo
+
++ (void)setUsesLayoutMemo: (BOOL)usesLayoutMemo
+{
+    sUsesLayoutMemo = usesLayoutMemo;
+    if (usesLayoutMemo == NO)
+    {
+        [EQRenderLayoutMemo clearLayoutMemo];
+    }
+}
+
++ (BOOL)usesLayoutMemo
+{
+    return sUsesLayoutMemo;
+}
+
++ (NSMutableDictionary *)layoutMemo
+{
+    static NSMutableDictionary *layoutMemo = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        layoutMemo = [[NSMutableDictionary alloc] init];
+    });
+    return layoutMemo;
+}
+
+// Maps each subtree and context key to a short id, so a parent key only has to list the ids of its children.
+// Uses the layoutMemo lock.
++ (NSMutableDictionary *)internedKeys
+{
+    static NSMutableDictionary *internedKeys = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        internedKeys = [[NSMutableDictionary alloc] init];
+    });
+    return internedKeys;
+}
+
++ (void)clearLayoutMemo
+{
+    NSMutableDictionary *layoutMemo = [EQRenderLayoutMemo layoutMemo];
+    @synchronized(layoutMemo)
+    {
+        [layoutMemo removeAllObjects];
+        [[EQRenderLayoutMemo internedKeys] removeAllObjects];
+        sLayoutMemoHitCount = 0;
+    }
+}
+
++ (NSUInteger)layoutMemoHitCount
+{
+    NSMutableDictionary *layoutMemo = [EQRenderLayoutMemo layoutMemo];
+    @synchronized(layoutMemo)
+    {
+        return sLayoutMemoHitCount;
+    }
+}
+
++ (NSString *)internKey: (NSString *)keyString
+{
+    NSMutableDictionary *layoutMemo = [EQRenderLayoutMemo layoutMemo];
+    @synchronized(layoutMemo)
+    {
+        NSMutableDictionary *internedKeys = [EQRenderLayoutMemo internedKeys];
+        NSString *keyId = internedKeys[keyString];
+        if (nil == keyId)
+        {
+            // The stored layouts use the old ids, so they go as well.
+            if (internedKeys.count >= kLAYOUT_MEMO_KEY_LIMIT)
+            {
+                [internedKeys removeAllObjects];
+                [layoutMemo removeAllObjects];
+            }
+            keyId = [NSString stringWithFormat:@"#%lu", (unsigned long)sNextKeyId];
+            sNextKeyId ++;
+            internedKeys[[keyString copy]] = keyId;
+        }
+        return keyId;
+    }
+}
+
++ (void)beginLayoutPass
+{
+    NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+    EQLayoutMemoPass *layoutPass = threadDictionary[kLAYOUT_MEMO_PASS_KEY];
+    if (nil == layoutPass)
+    {
+        layoutPass = [[EQLayoutMemoPass alloc] init];
+        threadDictionary[kLAYOUT_MEMO_PASS_KEY] = layoutPass;
+    }
+    layoutPass.passDepth ++;
+}
+
++ (void)endLayoutPass
+{
+    NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+    EQLayoutMemoPass *layoutPass = threadDictionary[kLAYOUT_MEMO_PASS_KEY];
+    if (nil == layoutPass)
+        return;
+
+    layoutPass.passDepth --;
+    if (layoutPass.passDepth == 0)
+    {
+        [threadDictionary removeObjectForKey:kLAYOUT_MEMO_PASS_KEY];
+    }
+}
+
++ (EQLayoutMemoPass *)currentLayoutPass
+{
+    return [NSThread currentThread].threadDictionary[kLAYOUT_MEMO_PASS_KEY];
+}
+
+// Layout can change the strings under a stem, so its subtree key is only used up to the point it is laid out or restored.
++ (void)forgetKeysForNodes: (NSArray *)renderNodes
+{
+    EQLayoutMemoPass *layoutPass = [EQRenderLayoutMemo currentLayoutPass];
+    if (nil == layoutPass)
+        return;
+
+    for (id renderNode in renderNodes)
+    {
+        [layoutPass.subtreeKeys removeObjectForKey:renderNode];
+    }
+}
+
++ (NSString *)structuralKeyForStem: (EQRenderStem *)renderStem
+{
+    if (nil == renderStem)
+        return nil;
+
+    // Outside of a layout pass the keys are only shared within this call.
+    EQLayoutMemoPass *layoutPass = [EQRenderLayoutMemo currentLayoutPass];
+    if (nil == layoutPass)
+    {
+        layoutPass = [[EQLayoutMemoPass alloc] init];
+    }
+
+    NSString *subtreeKey = [EQRenderLayoutMemo subtreeKeyForStem:renderStem inPass:layoutPass];
+    [layoutPass.subtreeKeys removeObjectForKey:renderStem];
+    if (nil == subtreeKey)
+        return nil;
+
+    // Layout rounds x coordinates up, so the fractional part of the origin has to match as well.
+    CGPoint drawOrigin = renderStem.drawOrigin;
+    return [NSString stringWithFormat:@"%@@%.17g,%.17g%@", subtreeKey, drawOrigin.x - floor(drawOrigin.x), drawOrigin.y - floor(drawOrigin.y),
+            [EQRenderLayoutMemo contextKeyForStem:renderStem inPass:layoutPass]];
+}
+
+// Built from the stored keys of the child stems, so each stem is only read once per layout pass.
+// Stems that can not be reused are stored as NSNull, so their ancestors fail without reading them again.
++ (NSString *)subtreeKeyForStem: (EQRenderStem *)renderStem inPass: (EQLayoutMemoPass *)layoutPass
+{
+    id storedKey = [layoutPass.subtreeKeys objectForKey:renderStem];
+    if (nil != storedKey)
+        return (storedKey == [NSNull null]) ? nil : storedKey;
+
+    NSString *subtreeKey = nil;
+    NSMutableString *keyString = [[NSMutableString alloc] init];
+    if ([EQRenderLayoutMemo appendKeyForStem:renderStem inPass:layoutPass toString:keyString] == YES)
+    {
+        subtreeKey = [EQRenderLayoutMemo internKey:keyString];
+    }
+    [layoutPass.subtreeKeys setObject:(nil != subtreeKey ? subtreeKey : [NSNull null]) forKey:renderStem];
+
+    return subtreeKey;
+}
+
++ (BOOL)appendKeyForStem: (EQRenderStem *)renderStem inPass: (EQLayoutMemoPass *)layoutPass toString: (NSMutableString *)keyString
+{
+    // Matrices size their cells against each other, so only the plain stems and fractions are reused.
+    Class stemClass = [renderStem class];
+    if (stemClass != [EQRenderStem class] && stemClass != [EQRenderFracStem class])
+        return NO;
+
+    [keyString appendFormat:@"(%@ %d %d %d %d %d", NSStringFromClass(stemClass), (int)renderStem.stemType, renderStem.hasLargeOp,
+                            (int)renderStem.useAlign, renderStem.hasOverline, renderStem.hasAccentCharacter];
+    if (stemClass == [EQRenderFracStem class])
+    {
+        [keyString appendFormat:@" %g", ((EQRenderFracStem *)renderStem).lineThickness];
+    }
+    if (renderStem.hasStoredCharacterData == YES && nil != renderStem.storedCharacterData)
+    {
+        [keyString appendFormat:@" [%lu:%@]", (unsigned long)renderStem.storedCharacterData.length, renderStem.storedCharacterData];
+    }
+    if (renderStem.hasSupplementaryData == YES && nil != renderStem.supplementaryData)
+    {
+        if (![renderStem.supplementaryData isKindOfClass:[EQRenderData class]])
+            return NO;
+
+        [keyString appendString:@" s"];
+        if ([EQRenderLayoutMemo appendKeyForData:renderStem.supplementaryData toString:keyString] == NO)
+            return NO;
+    }
+
+    for (id renderObj in renderStem.renderArray)
+    {
+        if ([renderObj isKindOfClass:[EQRenderStem class]])
+        {
+            NSString *childKey = [EQRenderLayoutMemo subtreeKeyForStem:renderObj inPass:layoutPass];
+            if (nil == childKey)
+                return NO;
+
+            [keyString appendFormat:@" %@", childKey];
+        }
+        else if ([renderObj isKindOfClass:[EQRenderData class]])
+        {
+            if ([EQRenderLayoutMemo appendKeyForData:renderObj toString:keyString] == NO)
+                return NO;
+        }
+        else
+        {
+            return NO;
+        }
+    }
+
+    [keyString appendString:@")"];
+    return YES;
+}
+
++ (BOOL)appendKeyForData: (EQRenderData *)renderData toString: (NSMutableString *)keyString
+{
+    // Stretchy bracers are sized by the rest of their row, so they can not be laid out on their own.
+    if (renderData.hasStretchyCharacterData == YES || renderData.hasStretchyDescenderPoint == YES)
+        return NO;
+
+    NSString *dataString = renderData.renderString.string;
+    NSSet *stretchyBracers = [EQRenderTypesetter getStretchyBracerCharacters];
+    __block BOOL hasStretchyBracer = NO;
+    [dataString enumerateSubstringsInRange:NSMakeRange(0, dataString.length)
+                                   options:NSStringEnumerationByComposedCharacterSequences
+                                usingBlock:^(NSString *substring, NSRange substringRange, NSRange enclosingRange, BOOL *stop)
+     {
+         if ([stretchyBracers containsObject:substring])
+         {
+             hasStretchyBracer = YES;
+             *stop = YES;
+         }
+     }];
+    if (hasStretchyBracer == YES)
+        return NO;
+
+    [keyString appendFormat:@"<%lu:%@", (unsigned long)dataString.length, dataString];
+    [renderData.renderString enumerateAttributesInRange:NSMakeRange(0, renderData.renderString.length)
+                                                options:0
+                                             usingBlock:^(NSDictionary *attributes, NSRange range, BOOL *stop)
+     {
+         [keyString appendFormat:@" %lu,%lu", (unsigned long)range.location, (unsigned long)range.length];
+         for (NSString *attributeName in [attributes.allKeys sortedArrayUsingSelector:@selector(compare:)])
+         {
+             [keyString appendFormat:@" %@=%@", attributeName, [EQRenderLayoutMemo keyForAttributeValue:attributes[attributeName]]];
+         }
+     }];
+    [keyString appendFormat:@" %d>", renderData.hasAutoReplacedSpace];
+
+    return YES;
+}
+
++ (NSString *)keyForAttributeValue: (id)attributeValue
+{
+    if ([attributeValue isKindOfClass:[UIFont class]])
+    {
+        UIFont *attributeFont = (UIFont *)attributeValue;
+        return [NSString stringWithFormat:@"%@@%g", attributeFont.fontName, attributeFont.pointSize];
+    }
+    else if ([attributeValue isKindOfClass:[NSNumber class]])
+    {
+        return [(NSNumber *)attributeValue stringValue];
+    }
+    return [attributeValue description];
+}
+
+// The font sizes, the fraction and radical parents and the large op adjustments all come from the ancestors,
+// so their types and the stem's position under them are part of the key.
+// Each context extends the stored context of the parent, so it is built once per stem.
++ (NSString *)contextKeyForStem: (EQRenderStem *)renderStem inPass: (EQLayoutMemoPass *)layoutPass
+{
+    EQRenderStem *parentStem = renderStem.parentStem;
+    if (nil == parentStem)
+        return @"";
+
+    NSString *contextKey = [layoutPass.contextKeys objectForKey:renderStem];
+    if (nil != contextKey)
+        return contextKey;
+
+    NSMutableString *contextString = [[NSMutableString alloc] initWithString:[EQRenderLayoutMemo contextKeyForStem:parentStem inPass:layoutPass]];
+    [contextString appendFormat:@"/%@ %d %d", NSStringFromClass([parentStem class]), (int)parentStem.stemType, parentStem.hasLargeOp];
+
+    // Rows size all of their children the same way.
+    if (parentStem.isRowStemType == NO)
+    {
+        [contextString appendFormat:@" %lu", (unsigned long)[parentStem.renderArray indexOfObject:renderStem]];
+    }
+
+    contextKey = [EQRenderLayoutMemo internKey:contextString];
+    [layoutPass.contextKeys setObject:contextKey forKey:renderStem];
+    return contextKey;
+}
+
+// Stems, radical symbols and render data in the same order for every stem with the same key.
++ (void)addNodesForStem: (EQRenderStem *)renderStem toArray: (NSMutableArray *)renderNodes
+{
+    [renderNodes addObject:renderStem];
+    if (renderStem.hasSupplementaryData == YES && [renderStem.supplementaryData isKindOfClass:[EQRenderData class]])
+    {
+        [renderNodes addObject:renderStem.supplementaryData];
+    }
+
+    for (id renderObj in renderStem.renderArray)
+    {
+        if ([renderObj isKindOfClass:[EQRenderStem class]])
+        {
+            [EQRenderLayoutMemo addNodesForStem:renderObj toArray:renderNodes];
+        }
+        else if ([renderObj isKindOfClass:[EQRenderData class]])
+        {
+            [renderNodes addObject:renderObj];
+        }
+    }
+}
+
++ (void)storeLayoutForStem: (EQRenderStem *)renderStem withKey: (NSString *)structuralKey
+{
+    if (nil == renderStem || nil == structuralKey)
+        return;
+
+    NSMutableArray *renderNodes = [[NSMutableArray alloc] init];
+    [EQRenderLayoutMemo addNodesForStem:renderStem toArray:renderNodes];
+    [EQRenderLayoutMemo forgetKeysForNodes:renderNodes];
+
+    CGPoint rootOrigin = renderStem.drawOrigin;
+    CGPoint minPoint = CGPointMake(CGFLOAT_MAX, CGFLOAT_MAX);
+    NSMutableArray *snapshotArray = [[NSMutableArray alloc] initWithCapacity:renderNodes.count];
+    for (id renderNode in renderNodes)
+    {
+        CGPoint testPoint = CGPointMake(CGFLOAT_MAX, CGFLOAT_MAX);
+        if ([renderNode isKindOfClass:[EQRenderStem class]])
+        {
+            EQRenderStem *nodeStem = (EQRenderStem *)renderNode;
+            [snapshotArray addObject:[EQRenderLayoutMemo snapshotForStem:nodeStem relativeTo:rootOrigin]];
+            if (nodeStem != renderStem)
+            {
+                testPoint = nodeStem.drawOrigin;
+            }
+            if (nodeStem.hasOverline == YES)
+            {
+                testPoint.x = MIN(testPoint.x, nodeStem.overlineStartPoint.x);
+                testPoint.y = MIN(testPoint.y, nodeStem.overlineStartPoint.y);
+            }
+        }
+        else
+        {
+            EQRenderData *nodeData = (EQRenderData *)renderNode;
+            [snapshotArray addObject:[EQRenderLayoutMemo snapshotForData:nodeData relativeTo:rootOrigin]];
+            testPoint = nodeData.drawOrigin;
+        }
+        minPoint.x = MIN(minPoint.x, testPoint.x);
+        minPoint.y = MIN(minPoint.y, testPoint.y);
+    }
+
+    // updateBounds clamps the child origins at zero, so only layouts that stay clear of it can be moved.
+    if (minPoint.x < 0.0 || minPoint.y < 0.0)
+        return;
+
+    CGPoint minOffset = EQOffsetFromOrigin(minPoint, rootOrigin);
+    NSArray *memoEntry = @[snapshotArray, [NSValue valueWithCGPoint:minOffset]];
+
+    NSMutableDictionary *layoutMemo = [EQRenderLayoutMemo layoutMemo];
+    @synchronized(layoutMemo)
+    {
+        if (layoutMemo.count >= kLAYOUT_MEMO_LIMIT)
+        {
+            [layoutMemo removeAllObjects];
+        }
+        layoutMemo[structuralKey] = memoEntry;
+    }
+}
+
++ (BOOL)restoreLayoutForStem: (EQRenderStem *)renderStem withKey: (NSString *)structuralKey
+{
+    if (nil == renderStem || nil == structuralKey)
+        return NO;
+
+    NSArray *memoEntry = nil;
+    NSMutableDictionary *layoutMemo = [EQRenderLayoutMemo layoutMemo];
+    @synchronized(layoutMemo)
+    {
+        memoEntry = layoutMemo[structuralKey];
+    }
+    if (nil == memoEntry)
+        return NO;
+
+    CGPoint rootOrigin = renderStem.drawOrigin;
+    CGPoint minOffset = [(NSValue *)memoEntry[1] CGPointValue];
+    if (rootOrigin.x + minOffset.x < 0.0 || rootOrigin.y + minOffset.y < 0.0)
+        return NO;
+
+    NSArray *snapshotArray = memoEntry[0];
+    NSMutableArray *renderNodes = [[NSMutableArray alloc] initWithCapacity:snapshotArray.count];
+    [EQRenderLayoutMemo addNodesForStem:renderStem toArray:renderNodes];
+    if (renderNodes.count != snapshotArray.count)
+        return NO;
+
+    [EQRenderLayoutMemo forgetKeysForNodes:renderNodes];
+
+    for (NSUInteger i = 0; i < renderNodes.count; i++)
+    {
+        id renderNode = renderNodes[i];
+        if ([renderNode isKindOfClass:[EQRenderStem class]])
+        {
+            [EQRenderLayoutMemo restoreStem:renderNode fromSnapshot:snapshotArray[i] relativeTo:rootOrigin];
+        }
+        else
+        {
+            [EQRenderLayoutMemo restoreData:renderNode fromSnapshot:snapshotArray[i] relativeTo:rootOrigin];
+        }
+    }
+
+    @synchronized(layoutMemo)
+    {
+        sLayoutMemoHitCount ++;
+    }
+    return YES;
+}
+
++ (NSDictionary *)snapshotForStem: (EQRenderStem *)renderStem relativeTo: (CGPoint)rootOrigin
+{
+    NSMutableDictionary *snapshot = [[NSMutableDictionary alloc] init];
+    snapshot[@"origin"] = [NSValue valueWithCGPoint:EQOffsetFromOrigin(renderStem.drawOrigin, rootOrigin)];
+    snapshot[@"size"] = [NSValue valueWithCGSize:renderStem.drawSize];
+    snapshot[@"bounds"] = [NSValue valueWithCGRect:renderStem.drawBounds];
+    snapshot[@"overline"] = @[[NSValue valueWithCGPoint:EQOffsetFromOrigin(renderStem.overlineStartPoint, rootOrigin)],
+                              [NSValue valueWithCGPoint:EQOffsetFromOrigin(renderStem.overlineEndPoint, rootOrigin)]];
+    snapshot[@"hasSupplementalLine"] = @(renderStem.hasSupplementalLine);
+    snapshot[@"supplementalLine"] = @[[NSValue valueWithCGPoint:EQOffsetFromOrigin(renderStem.supplementalLineStartPoint, rootOrigin)],
+                                      [NSValue valueWithCGPoint:EQOffsetFromOrigin(renderStem.supplementalLineEndPoint, rootOrigin)]];
+    snapshot[@"hasAccentCharacter"] = @(renderStem.hasAccentCharacter);
+
+    if ([renderStem isKindOfClass:[EQRenderFracStem class]])
+    {
+        EQRenderFracStem *fracStem = (EQRenderFracStem *)renderStem;
+        snapshot[@"bar"] = @[[NSValue valueWithCGPoint:EQOffsetFromOrigin(fracStem.startLinePoint, rootOrigin)],
+                             [NSValue valueWithCGPoint:EQOffsetFromOrigin(fracStem.endLinePoint, rootOrigin)]];
+    }
+
+    return snapshot;
+}
+
++ (NSDictionary *)snapshotForData: (EQRenderData *)renderData relativeTo: (CGPoint)rootOrigin
+{
+    // Layout can change the kerning in the string, so it is kept along with the position.
+    return @{@"origin": [NSValue valueWithCGPoint:EQOffsetFromOrigin(renderData.drawOrigin, rootOrigin)],
+             @"size": [NSValue valueWithCGSize:renderData.drawSize],
+             @"string": [renderData.renderString copy]};
+}
+
++ (void)restoreStem: (EQRenderStem *)renderStem fromSnapshot: (NSDictionary *)snapshot relativeTo: (CGPoint)rootOrigin
+{
+    renderStem.drawOrigin = EQPointFromOffset([(NSValue *)snapshot[@"origin"] CGPointValue], rootOrigin);
+    renderStem.drawSize = [(NSValue *)snapshot[@"size"] CGSizeValue];
+    renderStem.drawBounds = [(NSValue *)snapshot[@"bounds"] CGRectValue];
+
+    NSArray *overlinePoints = snapshot[@"overline"];
+    renderStem.overlineStartPoint = EQPointFromOffset([(NSValue *)overlinePoints[0] CGPointValue], rootOrigin);
+    renderStem.overlineEndPoint = EQPointFromOffset([(NSValue *)overlinePoints[1] CGPointValue], rootOrigin);
+
+    NSArray *supplementalPoints = snapshot[@"supplementalLine"];
+    renderStem.hasSupplementalLine = [(NSNumber *)snapshot[@"hasSupplementalLine"] boolValue];
+    renderStem.supplementalLineStartPoint = EQPointFromOffset([(NSValue *)supplementalPoints[0] CGPointValue], rootOrigin);
+    renderStem.supplementalLineEndPoint = EQPointFromOffset([(NSValue *)supplementalPoints[1] CGPointValue], rootOrigin);
+    renderStem.hasAccentCharacter = [(NSNumber *)snapshot[@"hasAccentCharacter"] boolValue];
+
+    NSArray *barPoints = snapshot[@"bar"];
+    if (nil != barPoints && [renderStem isKindOfClass:[EQRenderFracStem class]])
+    {
+        EQRenderFracStem *fracStem = (EQRenderFracStem *)renderStem;
+        fracStem.startLinePoint = EQPointFromOffset([(NSValue *)barPoints[0] CGPointValue], rootOrigin);
+        fracStem.endLinePoint = EQPointFromOffset([(NSValue *)barPoints[1] CGPointValue], rootOrigin);
+    }
+}
+
++ (void)restoreData: (EQRenderData *)renderData fromSnapshot: (NSDictionary *)snapshot relativeTo: (CGPoint)rootOrigin
+{
+    renderData.drawOrigin = EQPointFromOffset([(NSValue *)snapshot[@"origin"] CGPointValue], rootOrigin);
+    renderData.drawSize = [(NSValue *)snapshot[@"size"] CGSizeValue];
+    renderData.renderString = [(NSAttributedString *)snapshot[@"string"] mutableCopy];
+    renderData.needsRedrawn = YES;
+}
+
+@end
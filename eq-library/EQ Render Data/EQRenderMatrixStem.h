@@ -24,4 +24,10 @@
 - (void) addChildDataToRenderArray: (NSMutableArray *)renderData;
 - (id)getFirstCellObj;
 
+// Row frames, stored as NSValue CGRects from top to bottom during layoutChildren.
+- (NSArray *)rowFrames;
+
+// Returns the cell stems whose padded frames intersect testRect, found by binary searching the rows and columns.
+- (NSSet *)cellStemsIntersectingRect: (CGRect)testRect;
+
 @end
@@ -24,9 +24,21 @@
 @interface EQRenderMatrixStem()
 {
     CGSize storedLayoutSize;
+    NSArray *storedRowFrames;
+    NSArray *storedColumnFrames;
+    CGFloat storedCellPadding;
 }
 
 - (CGFloat)computeBaseSizeUsingArray: (NSArray *)sizeArray;
+- (void)storeGridFramesWithBoundsArray: (NSArray *)boundsArray;
+- (NSRange)rangeOfFrames: (NSArray *)frameArray intersectingMin: (CGFloat)testMin max: (CGFloat)testMax useVertical: (BOOL)useVertical;
+
+// Columns are stored left to right. The frames are grown by cellPadding before testing them,
+// as glyphs can reach past the measured cell bounds.
+- (NSArray *)columnFrames;
+- (CGFloat)cellPadding;
+- (NSRange)rowRangeIntersectingRect: (CGRect)testRect;
+- (NSRange)columnRangeIntersectingRect: (CGRect)testRect;
 
 @end
 
@@ -39,6 +51,9 @@
     {
         self.stemType = stemTypeMatrix;
         self->storedLayoutSize = CGSizeZero;
+        self->storedRowFrames = nil;
+        self->storedColumnFrames = nil;
+        self->storedCellPadding = 0.0;
     }
 
     return self;
@@ -51,6 +66,9 @@
     {
         self.stemType = stemTypeMatrix;
         self->storedLayoutSize = CGSizeZero;
+        self->storedRowFrames = nil;
+        self->storedColumnFrames = nil;
+        self->storedCellPadding = 0.0;
     }
 
     return self;
@@ -63,6 +81,9 @@
     {
         self.stemType = stemTypeMatrix;
         self->storedLayoutSize = CGSizeZero;
+        self->storedRowFrames = nil;
+        self->storedColumnFrames = nil;
+        self->storedCellPadding = 0.0;
     }
 
     return self;
@@ -123,6 +144,9 @@
 - (void)layoutChildren
 {
     self->storedLayoutSize = CGSizeZero;
+    self->storedRowFrames = nil;
+    self->storedColumnFrames = nil;
+    self->storedCellPadding = 0.0;
 
     if (nil == self.renderArray || self.renderArray.count == 0)
     {
@@ -138,6 +162,9 @@
         return;
     }
 
+    // Position every cell first, then lay out the cells.
+    // The cells don't depend on each other, so the second pass may run concurrently.
+    NSMutableArray *childStems = [[NSMutableArray alloc] init];
     int childCounter = 0;
     for (id renderObj in self.renderArray)
     {
@@ -147,14 +174,23 @@
             NSAssert(childCounter < boundsArray.count, @"Child location is outside computed bounds array!");
             NSArray *rowBounds = [boundsArray objectAtIndex:childCounter];
             [matrixRowStem updateChildOriginsWithBoundsArray:rowBounds];
-            [matrixRowStem layoutChildren];
+            for (id cellObj in matrixRowStem.renderArray)
+            {
+                if ([cellObj isKindOfClass:[EQRenderStem class]])
+                {
+                    [childStems addObject:cellObj];
+                }
+            }
         }
         else if ([renderObj isKindOfClass:[EQRenderStem class]])
         {
-            [(EQRenderStem *)renderObj layoutChildren];
+            [childStems addObject:renderObj];
         }
         childCounter ++;
     }
+    [self layoutChildStems:childStems];
+
+    [self storeGridFramesWithBoundsArray:boundsArray];
 
     // Should always update bounds after calling this method.
     [self updateBounds];
@@ -388,4 +424,154 @@
     return returnObj;
 }
 
+/**********************
+ * Cell grid geometry *
+ *********************/
+
+// Every row in the bounds array shares the same column widths, and every cell in a row shares the same height.
+// So the grid reduces to one frame per row and one frame per column.
+- (void)storeGridFramesWithBoundsArray: (NSArray *)boundsArray
+{
+    if (nil == boundsArray || boundsArray.count == 0)
+        return;
+
+    NSMutableArray *rowFrames = [[NSMutableArray alloc] initWithCapacity:boundsArray.count];
+    NSMutableArray *columnFrames = [[NSMutableArray alloc] init];
+    CGFloat cellPadding = 0.0;
+
+    for (NSArray *rowBounds in boundsArray)
+    {
+        CGRect rowRect = CGRectNull;
+        NSUInteger colCounter = 0;
+        for (NSValue *cellBoundsValue in rowBounds)
+        {
+            CGRect cellBounds = cellBoundsValue.CGRectValue;
+            rowRect = CGRectUnion(rowRect, cellBounds);
+            cellPadding = MAX(cellPadding, cellBounds.size.height);
+
+            if (colCounter < columnFrames.count)
+            {
+                CGRect colRect = [(NSValue *)columnFrames[colCounter] CGRectValue];
+                columnFrames[colCounter] = [NSValue valueWithCGRect:CGRectUnion(colRect, cellBounds)];
+            }
+            else
+            {
+                [columnFrames addObject:cellBoundsValue];
+            }
+            colCounter ++;
+        }
+        if (CGRectIsNull(rowRect))
+        {
+            rowRect = CGRectZero;
+        }
+        [rowFrames addObject:[NSValue valueWithCGRect:rowRect]];
+    }
+
+    self->storedRowFrames = rowFrames;
+    self->storedColumnFrames = columnFrames;
+
+    // The cell bounds are measured from the text origin, so glyphs can sit up to a full cell height outside of them.
+    self->storedCellPadding = cellPadding;
+}
+
+- (CGFloat)cellPadding
+{
+    return self->storedCellPadding;
+}
+
+- (NSArray *)rowFrames
+{
+    return self->storedRowFrames;
+}
+
+- (NSArray *)columnFrames
+{
+    return self->storedColumnFrames;
+}
+
+- (NSRange)rowRangeIntersectingRect: (CGRect)testRect
+{
+    CGRect useRect = CGRectInset(testRect, 0.0, -self->storedCellPadding);
+    return [self rangeOfFrames:self->storedRowFrames intersectingMin:CGRectGetMinY(useRect) max:CGRectGetMaxY(useRect) useVertical:YES];
+}
+
+- (NSRange)columnRangeIntersectingRect: (CGRect)testRect
+{
+    CGRect useRect = CGRectInset(testRect, -self->storedCellPadding, 0.0);
+    return [self rangeOfFrames:self->storedColumnFrames intersectingMin:CGRectGetMinX(useRect) max:CGRectGetMaxX(useRect) useVertical:NO];
+}
+
+// Binary search for the first frame that ends after testMin, then for the first frame that starts after testMax.
+// Returns a range with location NSNotFound if nothing intersects.
+- (NSRange)rangeOfFrames: (NSArray *)frameArray intersectingMin: (CGFloat)testMin max: (CGFloat)testMax useVertical: (BOOL)useVertical
+{
+    if (nil == frameArray || frameArray.count == 0 || testMax < testMin)
+        return NSMakeRange(NSNotFound, 0);
+
+    NSUInteger lowIndex = 0;
+    NSUInteger highIndex = frameArray.count;
+    while (lowIndex < highIndex)
+    {
+        NSUInteger midIndex = lowIndex + (highIndex - lowIndex) / 2;
+        CGRect midRect = [(NSValue *)frameArray[midIndex] CGRectValue];
+        CGFloat midMax = useVertical ? CGRectGetMaxY(midRect) : CGRectGetMaxX(midRect);
+        if (midMax < testMin)
+        {
+            lowIndex = midIndex + 1;
+        }
+        else
+        {
+            highIndex = midIndex;
+        }
+    }
+    NSUInteger startIndex = lowIndex;
+
+    highIndex = frameArray.count;
+    while (lowIndex < highIndex)
+    {
+        NSUInteger midIndex = lowIndex + (highIndex - lowIndex) / 2;
+        CGRect midRect = [(NSValue *)frameArray[midIndex] CGRectValue];
+        CGFloat midMin = useVertical ? CGRectGetMinY(midRect) : CGRectGetMinX(midRect);
+        if (midMin <= testMax)
+        {
+            lowIndex = midIndex + 1;
+        }
+        else
+        {
+            highIndex = midIndex;
+        }
+    }
+
+    if (lowIndex <= startIndex)
+        return NSMakeRange(NSNotFound, 0);
+
+    return NSMakeRange(startIndex, lowIndex - startIndex);
+}
+
+// Returns the matrix cell stems whose row and column both intersect the given rect.
+// Only visits the visible rows and columns, so the cost depends on the visible cells instead of the matrix size.
+- (NSSet *)cellStemsIntersectingRect: (CGRect)testRect
+{
+    NSRange rowRange = [self rowRangeIntersectingRect:testRect];
+    NSRange colRange = [self columnRangeIntersectingRect:testRect];
+    if (rowRange.location == NSNotFound || colRange.location == NSNotFound)
+        return [NSSet set];
+
+    NSMutableSet *returnSet = [[NSMutableSet alloc] initWithCapacity:(rowRange.length * colRange.length)];
+    for (NSUInteger i = rowRange.location; i < NSMaxRange(rowRange) && i < self.renderArray.count; i ++)
+    {
+        id rowObj = self.renderArray[i];
+        if (![rowObj isKindOfClass:[EQRenderMatrixRowStem class]])
+            continue;
+
+        NSArray *rowChildren = [(EQRenderMatrixRowStem *)rowObj renderArray];
+        for (NSUInteger j = colRange.location; j < NSMaxRange(colRange) && j < rowChildren.count; j ++)
+        {
+            [returnSet addObject:rowChildren[j]];
+        }
+    }
+
+    return returnSet;
+}
+
 @end
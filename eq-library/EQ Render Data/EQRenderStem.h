@@ -53,6 +53,13 @@ typedef enum
 
 @interface EQRenderStem : NSObject <NSCoding>
 
+// Optional concurrent layout of independent child subtrees, such as the parts of a fraction or the cells of a matrix.
+// It is off by default and is only used once the subtrees contain at least the threshold number of descendents.
++ (void)setUsesParallelLayout: (BOOL)usesParallelLayout;
++ (BOOL)usesParallelLayout;
++ (void)setParallelLayoutThreshold: (NSUInteger)parallelLayoutThreshold;
++ (NSUInteger)parallelLayoutThreshold;
+
 @property (nonatomic) CGPoint drawOrigin;
 @property (nonatomic) CGSize drawSize;
 @property (nonatomic) CGRect drawBounds;
@@ -121,6 +128,12 @@ typedef enum
 - (void)removeChild: (id)childToRemove;
 
 - (void)layoutChildren;
+
+// Does the layout for layoutChildren, which may reuse an earlier layout instead when the layout memo is on.
+// Subclasses that can be reused override this rather than layoutChildren.
+- (void)layoutStemChildren;
+- (void)layoutChildStems: (NSArray *)childStems;
+- (NSUInteger)countDescendentsUpToLimit: (NSUInteger)countLimit;
 - (void)updateBounds;
 - (CGRect)computeImageBounds;
 - (CGRect)computeTypographicalLayout;
@@ -25,6 +25,28 @@
 #import "EQRenderFracStem.h"
 #import "EQRenderMatrixStem.h"
 #import "EQRenderStretchyBracers.h"
+#import "EQRenderLayoutMemo.h"
+
+// The height and lowest descender of the data between a pair of stretchy bracers.
+typedef struct
+{
+    CGFloat height;
+    BOOL hasDescender;
+    CGPoint descenderOrigin;
+} EQStretchyExtent;
+
+static const EQStretchyExtent kEMPTY_STRETCHY_EXTENT = {0.0, NO, {0.0, 0.0}};
+
+// Adds an extent that comes later in the row. The first of the lowest descenders is kept.
+static void EQStretchyExtentMerge(EQStretchyExtent *extent, EQStretchyExtent laterExtent)
+{
+    extent->height = MAX(extent->height, laterExtent.height);
+    if (laterExtent.hasDescender && (!extent->hasDescender || extent->descenderOrigin.y < laterExtent.descenderOrigin.y))
+    {
+        extent->hasDescender = YES;
+        extent->descenderOrigin = laterExtent.descenderOrigin;
+    }
+}
 
 @interface EQRenderStem ()
 {
@@ -113,6 +135,10 @@
 - (CGSize)getStoredRadicalSize;
 
 - (NSArray *)sizedPairsForStretchyCharacters: (NSArray *)stretchyCharacters;
+- (EQStretchyExtent)stretchyExtentForPairWithLeftRange: (EQTextRange *)leftRange
+                                            rightRange: (EQTextRange *)rightRange
+                                        measuredExtent: (EQStretchyExtent)measuredExtent;
+- (EQStretchyExtent)stretchyExtentForChildAtLoc: (NSUInteger)childLoc afterRange: (EQTextRange *)leftRange;
 - (void)layoutStretchyBracersWithSizedPairs: (NSArray *)sizedPairs;
 - (NSArray *)collectStringAndOriginForCharacterRange: (EQTextRange *)characterRange;
 - (void)attachBracerData: (id)bracerData forCharacterRange: (EQTextRange *)characterRange;
@@ -121,8 +147,31 @@
 
 @end
 
+static BOOL sUsesParallelLayout = NO;
+static NSUInteger sParallelLayoutThreshold = 256;
+
 @implementation EQRenderStem
 
++ (void)setUsesParallelLayout: (BOOL)usesParallelLayout
+{
+    sUsesParallelLayout = usesParallelLayout;
+}
+
++ (BOOL)usesParallelLayout
+{
+    return sUsesParallelLayout;
+}
+
++ (void)setParallelLayoutThreshold: (NSUInteger)parallelLayoutThreshold
+{
+    sParallelLayoutThreshold = parallelLayoutThreshold;
+}
+
++ (NSUInteger)parallelLayoutThreshold
+{
+    return sParallelLayoutThreshold;
+}
+
 - (id)init
 {
     self = [super init];
@@ -401,6 +450,29 @@
 
 
 - (void)layoutChildren
+{
+    if ([EQRenderLayoutMemo usesLayoutMemo] == NO)
+    {
+        [self layoutStemChildren];
+        return;
+    }
+
+    // The children reuse the keys built for this stem until the outermost layout finishes.
+    [EQRenderLayoutMemo beginLayoutPass];
+    NSString *structuralKey = [EQRenderLayoutMemo structuralKeyForStem:self];
+    if (nil == structuralKey || [EQRenderLayoutMemo restoreLayoutForStem:self withKey:structuralKey] == NO)
+    {
+        [self layoutStemChildren];
+
+        if (nil != structuralKey)
+        {
+            [EQRenderLayoutMemo storeLayoutForStem:self withKey:structuralKey];
+        }
+    }
+    [EQRenderLayoutMemo endLayoutPass];
+}
+
+- (void)layoutStemChildren
 {
     if (self.renderArray.count == 0)
     {
@@ -462,6 +534,64 @@
     [self updateBounds];
 }
 
+// Lays out sibling stems that do not depend on each other.
+// The caller should set their origins first and is responsible for positioning them afterwards.
+// Runs them on the global concurrent queue if parallel layout is on and they are large enough.
+- (void)layoutChildStems: (NSArray *)childStems
+{
+    if (nil == childStems || childStems.count == 0)
+        return;
+
+    BOOL useParallel = NO;
+    if (sUsesParallelLayout == YES && childStems.count > 1)
+    {
+        NSUInteger totalCount = 0;
+        for (EQRenderStem *childStem in childStems)
+        {
+            totalCount += [childStem countDescendentsUpToLimit:(sParallelLayoutThreshold - totalCount)];
+            if (totalCount >= sParallelLayoutThreshold)
+            {
+                useParallel = YES;
+                break;
+            }
+        }
+    }
+
+    if (useParallel == YES)
+    {
+        dispatch_queue_t layoutQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
+        dispatch_apply(childStems.count, layoutQueue, ^(size_t i)
+        {
+            [(EQRenderStem *)childStems[i] layoutChildren];
+        });
+    }
+    else
+    {
+        for (EQRenderStem *childStem in childStems)
+        {
+            [childStem layoutChildren];
+        }
+    }
+}
+
+// Counts the stems and renderData below this stem, stopping early once the limit is reached.
+- (NSUInteger)countDescendentsUpToLimit: (NSUInteger)countLimit
+{
+    NSUInteger returnCount = 0;
+    for (id renderObj in self.renderArray)
+    {
+        if (returnCount >= countLimit)
+            break;
+
+        returnCount ++;
+        if ([renderObj isKindOfClass:[EQRenderStem class]])
+        {
+            returnCount += [(EQRenderStem *)renderObj countDescendentsUpToLimit:(countLimit - returnCount)];
+        }
+    }
+    return returnCount;
+}
+
 - (void)applyAccentCharacter
 {
     // Accent characters only apply for under/over types.
@@ -776,26 +906,62 @@
     }
 }
 
+// Matches the bracers and measures the data between them in one pass over the row.
+// Each open left bracer keeps the extent of the children after it, and passes it down to the enclosing bracer when it is closed,
+// so every child is only measured once no matter how deeply the bracers are nested.
+// The pairs are returned in the same order as before, sorted by the location of the left bracer.
 - (NSArray *)sizedPairsForStretchyCharacters: (NSArray *)foundStretchyCharacters
 {
     NSSet *leftStretchyChars = [EQRenderTypesetter getLeftStretchyBracerCharacters];
     NSSet *rightStretchyChars = [EQRenderTypesetter getRightStretchyBracerCharacters];
     NSSet *verticalStretchyChars = [EQRenderTypesetter getVerticalStretchyBracerCharacters];
-    NSMutableArray *leftStretchyStack = [[NSMutableArray alloc] initWithCapacity:foundStretchyCharacters.count];
-    NSMutableArray *matchedStretchyArray = [[NSMutableArray alloc] initWithCapacity:self.renderArray.count];
-    // Initialize matched array.
-    for (int i = 0; i < self.renderArray.count; i++)
-    {
-        NSMutableArray *matchedPairs = [[NSMutableArray alloc] init];
-        [matchedStretchyArray addObject:matchedPairs];
-    }
 
-    // Loop through the found stretchy array and match up pairs of locations.
-    EQTextRange *currentLeftStretchy = nil;
-    EQTextRange *currentVerticalStretchy = nil;
-    for (EQTextRange *charRange in foundStretchyCharacters)
+    NSUInteger foundCount = foundStretchyCharacters.count;
+    if (foundCount == 0)
+        return @[];
+
+    // Stack of open left bracers, stored as indexes into the found array along with the extent measured so far.
+    NSUInteger leftStack[foundCount];
+    EQStretchyExtent leftStackExtents[foundCount];
+    NSUInteger stackCount = 0;
+
+    // Vertical bracers pair with each other and are never nested.
+    NSUInteger verticalIndex = NSNotFound;
+    EQStretchyExtent verticalExtent = kEMPTY_STRETCHY_EXTENT;
+
+    NSMutableArray *matchedPairs = [[NSMutableArray alloc] init];
+    NSUInteger nextDataLoc = [(EQTextRange *)foundStretchyCharacters[0] dataLoc];
+
+    for (NSUInteger foundIndex = 0; foundIndex < foundCount; foundIndex ++)
     {
-        id renderObj = [self.renderArray objectAtIndex:charRange.dataLoc];
+        EQTextRange *charRange = foundStretchyCharacters[foundIndex];
+        NSUInteger dataLoc = charRange.dataLoc;
+
+        // Add the children that have been passed to the innermost open bracer that started before them.
+        // Bracers that start in the same child only measure the text after them, which is handled when they are closed.
+        for (; nextDataLoc < dataLoc; nextDataLoc ++)
+        {
+            NSInteger stackLoc = (NSInteger)stackCount - 1;
+            while (stackLoc >= 0 && [(EQTextRange *)foundStretchyCharacters[leftStack[stackLoc]] dataLoc] == nextDataLoc)
+            {
+                stackLoc --;
+            }
+            BOOL addToVertical = (verticalIndex != NSNotFound && [(EQTextRange *)foundStretchyCharacters[verticalIndex] dataLoc] < nextDataLoc);
+            if (stackLoc < 0 && !addToVertical)
+                continue;
+
+            EQStretchyExtent childExtent = [self stretchyExtentForChildAtLoc:nextDataLoc afterRange:nil];
+            if (stackLoc >= 0)
+            {
+                EQStretchyExtentMerge(&leftStackExtents[stackLoc], childExtent);
+            }
+            if (addToVertical)
+            {
+                EQStretchyExtentMerge(&verticalExtent, childExtent);
+            }
+        }
+
+        id renderObj = [self.renderArray objectAtIndex:dataLoc];
         NSString *stretchyChar = nil;
         if ([renderObj isKindOfClass:[EQRenderData class]])
         {
@@ -807,197 +973,180 @@
             stretchyChar = [(EQRenderStem *)renderObj nestedStretchyBracerCheck];
         }
 
-        // If you found a matching character, add the data you need.
-        if (nil != stretchyChar)
+        if (nil == stretchyChar)
+            continue;
+
+        if ([leftStretchyChars containsObject:stretchyChar])
+        {
+            leftStack[stackCount] = foundIndex;
+            leftStackExtents[stackCount] = kEMPTY_STRETCHY_EXTENT;
+            stackCount ++;
+        }
+        else if ([rightStretchyChars containsObject:stretchyChar])
         {
-            if ([leftStretchyChars containsObject:stretchyChar])
+            if (stackCount > 0)
             {
-                if (nil == currentLeftStretchy)
+                stackCount --;
+                EQTextRange *leftRange = foundStretchyCharacters[leftStack[stackCount]];
+                EQStretchyExtent pairExtent = [self stretchyExtentForPairWithLeftRange:leftRange rightRange:charRange
+                                                                       measuredExtent:leftStackExtents[stackCount]];
+                [matchedPairs addObject:@[leftRange, charRange, [NSValue valueWithBytes:&pairExtent objCType:@encode(EQStretchyExtent)]]];
+
+                // The enclosing bracer also contains everything that was inside this pair.
+                if (stackCount > 0)
                 {
-                    currentLeftStretchy = charRange;
-                }
-                else
-                {
-                    [leftStretchyStack addObject:currentLeftStretchy];
-                    currentLeftStretchy = charRange;
+                    EQStretchyExtentMerge(&leftStackExtents[stackCount - 1], leftStackExtents[stackCount]);
                 }
             }
-            else if ([rightStretchyChars containsObject:stretchyChar])
+        }
+        else if ([verticalStretchyChars containsObject:stretchyChar])
+        {
+            if (verticalIndex == NSNotFound)
             {
-                if (nil != currentLeftStretchy)
-                {
-                    NSUInteger storeLoc = currentLeftStretchy.dataLoc;
-                    NSArray *matchedPair = @[currentLeftStretchy, charRange];
-                    NSMutableArray *matchedPairs = matchedStretchyArray[storeLoc];
-                    [matchedPairs addObject:matchedPair];
-                    // Pop the stack to get the new last object.
-                    if (leftStretchyStack.count > 0)
-                    {
-                        currentLeftStretchy = [leftStretchyStack lastObject];
-                        [leftStretchyStack removeLastObject];
-                    }
-                    else
-                    {
-                        //stack is empty, so set to nil.
-                        currentLeftStretchy = nil;
-                    }
-                }
+                verticalIndex = foundIndex;
+                verticalExtent = kEMPTY_STRETCHY_EXTENT;
             }
-            else if ([verticalStretchyChars containsObject:stretchyChar])
+            else
             {
-                // These act can act as either a left or right bracer.
-                // Should only be paired with other vertical stretchy characters.
-                // Shouldn't be nested so it will not need a stack.
-                if (nil == currentVerticalStretchy)
+                EQTextRange *leftRange = foundStretchyCharacters[verticalIndex];
+                EQStretchyExtent pairExtent = [self stretchyExtentForPairWithLeftRange:leftRange rightRange:charRange
+                                                                       measuredExtent:verticalExtent];
+                [matchedPairs addObject:@[leftRange, charRange, [NSValue valueWithBytes:&pairExtent objCType:@encode(EQStretchyExtent)]]];
+                verticalIndex = NSNotFound;
+            }
+        }
+    }
+
+    // Keep the pairs in the order of their left bracer, and in the order they were closed for the same location.
+    [matchedPairs sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSArray *firstPair, NSArray *secondPair)
+    {
+        NSUInteger firstLoc = [(EQTextRange *)firstPair[0] dataLoc];
+        NSUInteger secondLoc = [(EQTextRange *)secondPair[0] dataLoc];
+        return (firstLoc < secondLoc) ? NSOrderedAscending : ((firstLoc > secondLoc) ? NSOrderedDescending : NSOrderedSame);
+    }];
+
+    NSMutableArray *sizedPairs = [[NSMutableArray alloc] initWithCapacity:matchedPairs.count];
+    for (NSArray *matchedData in matchedPairs)
+    {
+        EQTextRange *leftLoc = matchedData[0];
+        EQTextRange *rightLoc = matchedData[1];
+        NSArray *matchedPair = @[leftLoc, rightLoc];
+        EQStretchyExtent pairExtent;
+        [(NSValue *)matchedData[2] getValue:&pairExtent];
+
+        if (pairExtent.height > 0)
+        {
+            NSNumber *useHeightNumber = [NSNumber numberWithFloat:pairExtent.height];
+            NSNumber *hasDescenderDataNumber = [NSNumber numberWithBool:pairExtent.hasDescender];
+            NSValue *useDescenderPointValue = [NSValue valueWithCGPoint:pairExtent.descenderOrigin];
+            NSArray *storedPairData = @[useHeightNumber, hasDescenderDataNumber, useDescenderPointValue];
+            [sizedPairs addObject:@[matchedPair, storedPairData]];
+        }
+        else
+        {
+            // Vertical bracers that are not stretchy need a separate kerning applied to them.
+            // This is the best place as it is the only location where you have matched the left and right bracer locations.
+            id testLeftObj = [self.renderArray objectAtIndex:leftLoc.dataLoc];
+            id testRightObj = [self.renderArray objectAtIndex:rightLoc.dataLoc];
+            if ([testLeftObj isKindOfClass:[EQRenderData class]] && [testRightObj isKindOfClass:[EQRenderData class]])
+            {
+                EQRenderData *leftData = (EQRenderData *)testLeftObj;
+                EQRenderData *rightData = (EQRenderData *)testRightObj;
+                NSString *leftBracerStr = [leftData.renderString.string substringWithRange:leftLoc.range];
+                NSString *rightBracerStr = [rightData.renderString.string substringWithRange:rightLoc.range];
+                if ([verticalStretchyChars containsObject:leftBracerStr])
                 {
-                    currentVerticalStretchy = charRange;
+                    [EQRenderFontDictionary addAttributes:@{NSKernAttributeName: @4.0} toAttributedString:leftData.renderString range:leftLoc.range];
                 }
-                else
+                if ([verticalStretchyChars containsObject:rightBracerStr] && rightLoc.range.location > 0)
                 {
-                    NSUInteger storeLoc = currentVerticalStretchy.dataLoc;
-                    NSArray *matchedPair = @[currentVerticalStretchy, charRange];
-                    NSMutableArray *matchedPairs = matchedStretchyArray[storeLoc];
-                    [matchedPairs addObject:matchedPair];
-                    currentVerticalStretchy = nil;
+                    NSRange useRange = rightLoc.range;
+                    useRange.location -= 1;
+                    useRange.length = 1;
+                    [EQRenderFontDictionary addAttributes:@{NSKernAttributeName: @4.0} toAttributedString:rightData.renderString range:useRange];
                 }
             }
         }
     }
+    return [NSArray arrayWithArray:sizedPairs];
+}
 
-    NSMutableArray *sizedPairs = [[NSMutableArray alloc] init];
-    for (NSMutableArray *matchedPairs in matchedStretchyArray)
-    {
-        if (matchedPairs.count > 0)
-        {
-            for (NSArray *matchedPair in matchedPairs)
-            {
-                // Should always be the case.
-                NSAssert(nil != matchedPair, @"Should never be nil in this array.");
-                NSAssert(matchedPair.count == 2, @"Should only store pairs in this array.");
-                EQTextRange *leftLoc = matchedPair[0];
-                EQTextRange *rightLoc = matchedPair[1];
+// The bracer is sized from the data between the left and right bracer, starting with the data that holds the left bracer.
+// Pairs in the same renderData don't need to be stretched.
+- (EQStretchyExtent)stretchyExtentForPairWithLeftRange: (EQTextRange *)leftRange
+                                            rightRange: (EQTextRange *)rightRange
+                                        measuredExtent: (EQStretchyExtent)measuredExtent
+{
+    if (leftRange.dataLoc >= rightRange.dataLoc)
+        return kEMPTY_STRETCHY_EXTENT;
 
-                // Compute the size you should use by searching the data between the two bracers.
-                // Ignore pairs that are in the same renderData or immediately next to each other.
-                CGFloat useHeight = 0;
-                BOOL containsDescenderData = NO;
-                CGPoint useDescenderOrigin = CGPointZero;
-                int locCounter = 0;
+    EQStretchyExtent pairExtent = [self stretchyExtentForChildAtLoc:leftRange.dataLoc afterRange:leftRange];
+    EQStretchyExtentMerge(&pairExtent, measuredExtent);
+    return pairExtent;
+}
 
-                for (NSUInteger testLoc = leftLoc.dataLoc; testLoc < rightLoc.dataLoc; testLoc ++)
-                {
-                    id renderObj = [self.renderArray objectAtIndex:testLoc];
-                    if ([renderObj isKindOfClass:[EQRenderStem class]])
-                    {
-                        EQRenderStem *renderStem = (EQRenderStem *)renderObj;
-                        CGFloat testHeight = renderStem.drawSize.height;
+// Measures a single child of the row for the bracers around it.
+// If a range is given and the child is renderData, only the text after the range is measured.
+- (EQStretchyExtent)stretchyExtentForChildAtLoc: (NSUInteger)childLoc afterRange: (EQTextRange *)leftRange
+{
+    EQStretchyExtent childExtent = kEMPTY_STRETCHY_EXTENT;
+    id renderObj = [self.renderArray objectAtIndex:childLoc];
+    if ([renderObj isKindOfClass:[EQRenderStem class]])
+    {
+        EQRenderStem *renderStem = (EQRenderStem *)renderObj;
+        CGFloat testHeight = renderStem.drawSize.height;
 
-                        // Need to not add as much height when you have sups that are not nested.
-                        BOOL testSupHeight = (renderStem.stemType == stemTypeSup || renderStem.stemType == stemTypeSub || renderStem.stemType == stemTypeSubSup) && [renderStem hasOnlyRenderDataChildren];
+        // Need to not add as much height when you have sups that are not nested.
+        BOOL testSupHeight = (renderStem.stemType == stemTypeSup || renderStem.stemType == stemTypeSub || renderStem.stemType == stemTypeSubSup) && [renderStem hasOnlyRenderDataChildren];
 
-                        // Add code to compute the offset for stems with descenders.
-                        // This allows you to center the bracer vertically around the stem.
-                        BOOL testDescender = [renderStem isStemWithDescender];
-                        if (testDescender == YES)
-                        {
-                            CGPoint testDescenderOrigin = [EQRenderLayout findLowestChildOrigin:renderStem];
-
-                            if (![renderStem isKindOfClass:[EQRenderMatrixStem class]])
-                            {
-                                CGPoint testOrigin = renderStem.drawOrigin;
-                                CGFloat heightAdjust = testDescenderOrigin.y - testOrigin.y;
-                                testHeight += heightAdjust * 0.3333;
-                                testDescenderOrigin.y -= heightAdjust * 0.3333;
-                                if (locCounter == 0 && (renderStem.stemType == stemTypeFraction || renderStem.isBinomialStemType))
-                                {
-                                    testDescenderOrigin.y += 3.0;
-                                    testHeight += 6.0;
-                                }
-                            }
-
-                            if (containsDescenderData == NO)
-                            {
-                                containsDescenderData = YES;
-                                useDescenderOrigin = testDescenderOrigin;
-                            }
-                            else
-                            {
-                                if (useDescenderOrigin.y < testDescenderOrigin.y)
-                                {
-                                    useDescenderOrigin = testDescenderOrigin;
-                                }
-                            }
-                        }
-                        else if (testSupHeight == YES)
-                        {
-                            EQRenderData *testChildData = renderStem.getFirstChild;
-                            useHeight = MAX(useHeight, testChildData.imageBounds.size.height);
-                            continue;
-                        }
-                        useHeight = MAX(useHeight, testHeight);
-                    }
-                    else if ([renderObj isKindOfClass:[EQRenderData class]])
-                    {
-                        EQRenderData *renderData = (EQRenderData *)renderObj;
+        // Add code to compute the offset for stems with descenders.
+        // This allows you to center the bracer vertically around the stem.
+        BOOL testDescender = [renderStem isStemWithDescender];
+        if (testDescender == YES)
+        {
+            CGPoint testDescenderOrigin = [EQRenderLayout findLowestChildOrigin:renderStem];
 
-                        // If you are in the first location, you should only check after the bracer.
-                        if (testLoc == leftLoc.dataLoc)
-                        {
-                            NSInteger subStrLoc = leftLoc.range.location + leftLoc.range.length;
-                            NSInteger subStrLength = renderData.renderString.length - subStrLoc;
-                            if ((subStrLoc + subStrLength) <= renderData.renderString.length && subStrLength > 0)
-                            {
-                                NSAttributedString *subStr = [renderData.renderString attributedSubstringFromRange:NSMakeRange(subStrLoc, subStrLength)];
-                                renderData = [[EQRenderData alloc] initWithAttributedString:subStr];
-                            }
-                        }
-                        useHeight = MAX(useHeight, renderData.imageBounds.size.height);
-                    }
-                }
-                if (useHeight > 0)
-                {
-                    NSNumber *useHeightNumber = [NSNumber numberWithFloat:useHeight];
-                    NSNumber *hasDescenderDataNumber = [NSNumber numberWithBool:containsDescenderData];
-                    NSValue *useDescenderPointValue = [NSValue valueWithCGPoint:useDescenderOrigin];
-                    NSArray *storedPairData = @[useHeightNumber, hasDescenderDataNumber, useDescenderPointValue];
-                    [sizedPairs addObject:@[matchedPair, storedPairData]];
-                }
-                else
+            if (![renderStem isKindOfClass:[EQRenderMatrixStem class]])
+            {
+                CGPoint testOrigin = renderStem.drawOrigin;
+                CGFloat heightAdjust = testDescenderOrigin.y - testOrigin.y;
+                testHeight += heightAdjust * 0.3333;
+                testDescenderOrigin.y -= heightAdjust * 0.3333;
+                if (renderStem.stemType == stemTypeFraction || renderStem.isBinomialStemType)
                 {
-                    // Vertical bracers that are not stretchy need a separate kerning applied to them.
-                    // This is the best place as it is the only location where you have matched the left and right bracer locations.
-                    id testLeftObj = [self.renderArray objectAtIndex:leftLoc.dataLoc];
-                    id testRightObj = [self.renderArray objectAtIndex:rightLoc.dataLoc];
-                    if ([testLeftObj isKindOfClass:[EQRenderData class]] && [testRightObj isKindOfClass:[EQRenderData class]])
-                    {
-                        EQRenderData *leftData = (EQRenderData *)testLeftObj;
-                        EQRenderData *rightData = (EQRenderData *)testRightObj;
-                        NSString *leftBracerStr = [leftData.renderString.string substringWithRange:leftLoc.range];
-                        NSString *rightBracerStr = [rightData.renderString.string substringWithRange:rightLoc.range];
-                        if ([verticalStretchyChars containsObject:leftBracerStr])
-                        {
-                            NSDictionary *currentDict = [leftData.renderString attributesAtIndex:leftLoc.range.location effectiveRange:NULL];
-                            NSMutableDictionary *newDict = currentDict.mutableCopy;
-                            newDict[NSKernAttributeName] = @4.0;
-                            [leftData.renderString setAttributes:newDict.copy range:leftLoc.range];
-                        }
-                        if ([verticalStretchyChars containsObject:rightBracerStr] && rightLoc.range.location > 0)
-                        {
-                            NSRange useRange = rightLoc.range;
-                            useRange.location -= 1;
-                            useRange.length = 1;
-                            NSDictionary *currentDict = [rightData.renderString attributesAtIndex:useRange.location effectiveRange:NULL];
-                            NSMutableDictionary *newDict = currentDict.mutableCopy;
-                            newDict[NSKernAttributeName] = @4.0;
-                            [rightData.renderString setAttributes:newDict.copy range:useRange];
-                        }
-                    }
+                    testDescenderOrigin.y += 3.0;
+                    testHeight += 6.0;
                 }
-                locCounter ++;
             }
+            childExtent.hasDescender = YES;
+            childExtent.descenderOrigin = testDescenderOrigin;
+        }
+        else if (testSupHeight == YES)
+        {
+            EQRenderData *testChildData = renderStem.getFirstChild;
+            childExtent.height = testChildData.imageBounds.size.height;
+            return childExtent;
         }
+        childExtent.height = testHeight;
     }
-    return [NSArray arrayWithArray:sizedPairs];
+    else if ([renderObj isKindOfClass:[EQRenderData class]])
+    {
+        EQRenderData *renderData = (EQRenderData *)renderObj;
+
+        // If you are in the first location, you should only check after the bracer.
+        if (nil != leftRange)
+        {
+            NSInteger subStrLoc = leftRange.range.location + leftRange.range.length;
+            NSInteger subStrLength = renderData.renderString.length - subStrLoc;
+            if ((subStrLoc + subStrLength) <= renderData.renderString.length && subStrLength > 0)
+            {
+                NSAttributedString *subStr = [renderData.renderString attributedSubstringFromRange:NSMakeRange(subStrLoc, subStrLength)];
+                renderData = [[EQRenderData alloc] initWithAttributedString:subStr];
+            }
+        }
+        childExtent.height = renderData.imageBounds.size.height;
+    }
+    return childExtent;
 }
 
 - (void)layoutStretchyBracersWithSizedPairs: (NSArray *)sizedPairs
@@ -1166,6 +1315,7 @@
         {
             baseData.hasStretchyCharacterData = YES;
             [baseData addStretchyCharacterData:bracerData forTextRange:characterRange];
+            // Only moves and lays out the script of this stem, never its ancestors, so it runs once per pair.
             [(EQRenderStem *)renderObj adjustLayoutForNestedStretchyDataWithBracerData:bracerData];
         }
     }
@@ -1907,11 +2057,8 @@
                 UIFont *testFont = [stringDict valueForKey:NSFontAttributeName];
                 if (testFont.pointSize <= kDEFAULT_FONT_SIZE)
                 {
-                    NSNumber *kernValue = @0.0;
-                    NSMutableDictionary *newDict = stringDict.mutableCopy;
-                    newDict[NSKernAttributeName] = kernValue;
                     NSRange updatedRange = NSMakeRange((stringPeek.length - 1), 1);
-                    [stringPeek setAttributes:newDict range:updatedRange];
+                    [EQRenderFontDictionary addAttributes:@{NSKernAttributeName: @0.0} toAttributedString:stringPeek range:updatedRange];
                     drawData.renderString = stringPeek;
                 }
             }
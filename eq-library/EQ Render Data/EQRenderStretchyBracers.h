@@ -47,6 +47,10 @@ typedef enum
 @property (strong, nonatomic) NSValue *useOrigin;
 @property (strong, nonatomic) NSDictionary *bracerMetricsDict;
 
+// Set by buildMetricsDictionary when the math font has an assembly for the bracer.
+// Holds @[glyph number, offset number] tuples from the bottom part up.
+@property (strong, nonatomic) NSArray *mathAssemblyArray;
+
 @property (nonatomic) Boolean hasStretchyDescenderPoint;
 @property (nonatomic) CGPoint stretchyDescenderPoint;
 
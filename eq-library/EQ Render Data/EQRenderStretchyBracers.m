@@ -20,6 +20,7 @@
 #import <CoreText/CoreText.h>
 #import "EQRenderStretchyBracers.h"
 #import "EQRenderFontDictionary.h"
+#import "EQMathTable.h"
 
 NSString* const kSTRETCHY_BRACER_TYPE_KEY = @"Key containing bracer layout type.";
 NSString* const kSTRETCHY_BRACER_TOP_CHAR_KEY = @"Key for top extender character.";
@@ -31,6 +32,14 @@ NSString* const kSTRETCHY_KERN_KEY = @"Key containing amount of post character k
 NSString* const kSTRETCHY_GLYPH_KEY = @"Key containing the glyph to draw.";
 NSString* const kSTRETCHY_ORIGIN_KEY = @"Key containing the location to draw the glyph.";
 
+@interface EQRenderStretchyBracers()
+
+- (CGFloat)bracerFontSize;
+- (NSArray *)mathAssemblyDrawArray;
++ (NSDictionary *)buildStretchyBracerMetrics;
+
+@end
+
 @implementation EQRenderStretchyBracers
 
 - (id)initWithBracerCharacter: (NSAttributedString *)bracerChar
@@ -46,6 +55,7 @@ NSString* const kSTRETCHY_ORIGIN_KEY = @"Key containing the location to draw the
         self->_useKern = useKern;
         self->_useOrigin = useOrigin;
         self->_bracerMetricsDict = @{};
+        self->_mathAssemblyArray = nil;
         self->_hasStretchyDescenderPoint = NO;
         self->_stretchyDescenderPoint = CGPointZero;
     }
@@ -58,6 +68,17 @@ NSString* const kSTRETCHY_ORIGIN_KEY = @"Key containing the location to draw the
     if (nil == self.bracerChar || self.bracerChar.length == 0)
         return;
 
+    // Prefer the assembly from the math font, which is already sized to the requested height.
+    EQMathTable *mathTable = [EQMathTable defaultMathTable];
+    CGGlyph baseGlyph = [mathTable glyphForCharacter:self.bracerChar.string];
+    if (nil != mathTable && baseGlyph != 0 && nil != self.heightNumber)
+    {
+        self.mathAssemblyArray = [mathTable assemblyForGlyph:baseGlyph minAdvance:self.heightNumber.floatValue
+                                                    fontSize:[self bracerFontSize] vertical:YES totalAdvance:NULL];
+        if (nil != self.mathAssemblyArray)
+            return;
+    }
+
     NSDictionary *allMetrics = [EQRenderStretchyBracers getStretchyBracerMetrics];
     NSDictionary *stretchyMetrics = allMetrics[self.bracerChar.string];
     if (nil != stretchyMetrics)
@@ -66,6 +87,15 @@ NSString* const kSTRETCHY_ORIGIN_KEY = @"Key containing the location to draw the
     }
 }
 
+- (CGFloat)bracerFontSize
+{
+    if (self.bracerChar.length == 0)
+        return kDEFAULT_FONT_SIZE;
+
+    UIFont *bracerFont = [self.bracerChar attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL];
+    return (nil != bracerFont) ? bracerFont.pointSize : kDEFAULT_FONT_SIZE;
+}
+
 - (NSAttributedString *)getClearStretchyCharacter
 {
     return [self getClearStretchyCharacterWithKern:NO];
@@ -112,6 +142,11 @@ NSString* const kSTRETCHY_ORIGIN_KEY = @"Key containing the location to draw the
         return nil;
     }
 
+    if (nil != self.mathAssemblyArray)
+    {
+        return [self mathAssemblyDrawArray];
+    }
+
     // Retrieve the values you will need to render the extender bracer.
     NSNumber *stretchyTypeNum = self.bracerMetricsDict[kSTRETCHY_BRACER_TYPE_KEY];
     StretchyBracerType stretchyType = stretchyTypeNum.intValue;
@@ -420,12 +455,57 @@ NSString* const kSTRETCHY_ORIGIN_KEY = @"Key containing the location to draw the
     return returnArray;
 }
 
+// The assembly offsets are already computed, so this just stacks the parts upward from the bottom point.
+- (NSArray *)mathAssemblyDrawArray
+{
+    EQMathTable *mathTable = [EQMathTable defaultMathTable];
+    CGFloat fontSize = [self bracerFontSize];
+    CGPoint drawOrigin = self.useOrigin.CGPointValue;
+
+    if (self.hasStretchyDescenderPoint)
+    {
+        drawOrigin.y = self.stretchyDescenderPoint.y;
+    }
+
+    NSMutableArray *returnArray = [[NSMutableArray alloc] initWithCapacity:self.mathAssemblyArray.count];
+    for (NSArray *partTuple in self.mathAssemblyArray)
+    {
+        CGGlyph partGlyph = [(NSNumber *)partTuple[0] unsignedShortValue];
+        CGFloat partOffset = [(NSNumber *)partTuple[1] floatValue];
+        NSAttributedString *partStr = [mathTable attributedStringForGlyph:partGlyph baseString:self.bracerChar.string
+                                                                 fontSize:fontSize kernValue:0.0];
+        if (nil == partStr)
+            continue;
+
+        CGPoint partOrigin = CGPointMake(floor(drawOrigin.x), drawOrigin.y - partOffset);
+        [returnArray addObject:@[partStr, [NSValue valueWithCGPoint:partOrigin]]];
+    }
+
+    if (returnArray.count == 0)
+    {
+        return nil;
+    }
+
+    return returnArray;
+}
+
 
 /***********************
  * Begin Class methods *
  ***********************/
 
+// The metrics are built once and shared by every bracer.
 + (NSDictionary *)getStretchyBracerMetrics
+{
+    static NSDictionary *storedMetrics = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        storedMetrics = [EQRenderStretchyBracers buildStretchyBracerMetrics];
+    });
+    return storedMetrics;
+}
+
++ (NSDictionary *)buildStretchyBracerMetrics
 {
     NSMutableDictionary *stretchyReturnDict = [[NSMutableDictionary alloc] init];
 
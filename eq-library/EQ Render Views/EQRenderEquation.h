@@ -17,6 +17,29 @@
  */
 
 #import <Foundation/Foundation.h>
+#import <CoreText/CoreText.h>
+
+@class EQRenderData;
+@class EQRenderStem;
+@class EQRenderFracStem;
+@class EQRenderFrozenEquation;
+@class EQRenderSpatialIndex;
+@class EQTextPosition;
+
+// Used to walk the laid out equation without drawing it.
+// Points use the same unscaled, top-down coordinates as drawEquationLinesInRect: with a zero origin.
+typedef void (^EQRenderStringBlock)(NSAttributedString *renderString, CGPoint drawPoint);
+typedef void (^EQRenderLineBlock)(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth);
+
+// Sizes used to place inline math next to text, after the pdfScale has been applied.
+// The baseline origin is the left edge of the math on the first baseline, relative to the rect passed to drawEquationLinesInRect:.
+typedef struct
+{
+    CGFloat width;
+    CGFloat ascent;
+    CGFloat descent;
+    CGPoint baselineOrigin;
+} EQInlineMetrics;
 
 // This class is used to store the resulting equation data and draw that data in a graphics context.
 // See documentation for more details on some of the different methods.
@@ -29,9 +52,48 @@
 @property (nonatomic) CGSize drawSize;
 @property (nonatomic) BOOL shouldFlipContext;
 
+// Width, ascent and descent of the ink around the baseline of the first line, scaled by pdfScale.
+// They are read from inkBounds, so they don't measure anything that layout hasn't already measured.
+@property (readonly, nonatomic) EQInlineMetrics inlineMetrics;
+
 - (id)initWithEquationLines: (NSArray *)equationLines andEquationStems: (NSArray *)equationStems;
+
+// Equations built with the same line metrics cache share the measured frame of each line.
+// Only the cache is shared, so scale, PDF mode and the line arrays stay separate for each equation.
+- (id)initWithEquationLines: (NSArray *)equationLines andEquationStems: (NSArray *)equationStems lineMetricsCache: (NSMapTable *)lineMetricsCache;
++ (NSMapTable *)newLineMetricsCache;
 - (void)layoutEquationLines;
+- (void)invalidateLayoutForEquationLine: (NSArray *)equationLine;
+- (void)invalidateAllLineLayouts;
 - (void)drawEquationLinesInRect: (CGRect)useRect;
+- (void)drawEquationLinesInRect: (CGRect)useRect visibleRect: (CGRect)visibleRect;
+- (NSRange)lineRangeIntersectingRect: (CGRect)visibleRect inRect: (CGRect)useRect;
 - (CGSize)computeInlineSize;
+- (EQInlineMetrics)layoutInlineEquation;
+
+// The union of the glyph and rule bounds, in the same unscaled coordinates as enumerateDrawElementsInContext:.
+// Each line's ink is collected while the line is measured and cached with its frame, so this only offsets and joins them.
+// Returns CGRectNull if nothing is drawn.
+- (CGRect)inkBounds;
+
+// Copies the laid out result into a compact, read-only form that can be drawn or saved without the render data.
+- (EQRenderFrozenEquation *)frozenEquation;
+
+// Hit testing uses a spatial index that is built once after each layout.
+// The point and rect use the same coordinates as drawEquationLinesInRect: with the same rect.
+- (EQRenderSpatialIndex *)spatialIndex;
+- (EQTextPosition *)closestPositionToPoint: (CGPoint)point inRect: (CGRect)useRect;
+- (CGRect)caretRectForPosition: (EQTextPosition *)textPosition inRect: (CGRect)useRect;
+
+// Layout geometry shared by the drawing code and the exporters.
+- (CGRect)drawRectForLineAtIndex: (NSUInteger)lineIndex;
+- (NSArray *)stretchyDrawArrayForRenderData: (EQRenderData *)viewRenderData inContext: (CGContextRef)context;
+- (CGFloat)fractionBarYForStem: (EQRenderFracStem *)fracParent withData: (EQRenderData *)viewRenderData;
+- (NSArray *)radicalLinesForStem: (EQRenderStem *)nRootParent;
++ (CGContextRef)createMeasureContext CF_RETURNS_RETAINED;
++ (BOOL)shouldDrawRun: (CTRunRef)run;
+- (void)enumerateDrawElementsInContext: (CGContextRef)context
+                           stringBlock: (EQRenderStringBlock)stringBlock
+                             lineBlock: (EQRenderLineBlock)lineBlock;
 
 @end
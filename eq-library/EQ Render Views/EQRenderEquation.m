@@ -21,13 +21,30 @@
 #import "EQRenderData.h"
 #import "EQRenderStretchyBracers.h"
 #import "EQRenderFracStem.h"
+#import "EQRenderMatrixStem.h"
 #import "EQRenderFontDictionary.h"
 #import "EQRenderTypesetter.h"
+#import "EQRenderFrozenEquation.h"
+#import "EQRenderSpatialIndex.h"
 
 @interface EQRenderEquation()
 
 @property (strong, nonatomic) NSMutableArray *equationLayoutData;
 
+// Stores the measured frame, align offset and ink bounds of each equation line, keyed by the line array itself.
+// Lines keep their cached values when other lines are added, removed or edited.
+@property (strong, nonatomic) NSMapTable *lineMetricsCache;
+
+// Stores the TTF version of each renderData's draw string when using PDF mode.
+// These are built during layout so that drawing doesn't need to rewrite the strings.
+@property (strong, nonatomic) NSMapTable *pdfStringCache;
+
+// Stores the ink bounds until the next layout.
+@property (nonatomic) CGRect storedInkBounds;
+
+// Stores the hit testing index until the next layout.
+@property (strong, nonatomic) EQRenderSpatialIndex *storedSpatialIndex;
+
 @end
 
 @implementation EQRenderEquation
@@ -40,15 +57,24 @@
         self->_equationLines = [[NSMutableArray alloc] init];
         self->_equationStems = [[NSMutableArray alloc] init];
         self->_equationLayoutData = [[NSMutableArray alloc] init];
+        self->_lineMetricsCache = [EQRenderEquation newLineMetricsCache];
+        self->_pdfStringCache = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality)
+                                                      valueOptions:NSPointerFunctionsStrongMemory];
         self->_usePDFMode = NO;
         self->_pdfScale = 1.0;
         self->_drawSize = CGSizeZero;
+        self->_storedInkBounds = CGRectNull;
         self->_shouldFlipContext = NO;
     }
     return self;
 }
 
 - (id)initWithEquationLines: (NSArray *)equationLines andEquationStems: (NSArray *)equationStems
+{
+    return [self initWithEquationLines:equationLines andEquationStems:equationStems lineMetricsCache:nil];
+}
+
+- (id)initWithEquationLines: (NSArray *)equationLines andEquationStems: (NSArray *)equationStems lineMetricsCache: (NSMapTable *)lineMetricsCache
 {
     self = [super init];
     if (self)
@@ -72,14 +98,32 @@
         }
 
         self->_equationLayoutData = [[NSMutableArray alloc] init];
+        if (nil != lineMetricsCache)
+        {
+            self->_lineMetricsCache = lineMetricsCache;
+        }
+        else
+        {
+            self->_lineMetricsCache = [EQRenderEquation newLineMetricsCache];
+        }
+        self->_pdfStringCache = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality)
+                                                      valueOptions:NSPointerFunctionsStrongMemory];
         self->_usePDFMode = NO;
         self->_pdfScale = 1.0;
         self->_drawSize = CGSizeZero;
+        self->_storedInkBounds = CGRectNull;
     }
 
     return self;
 }
 
+// The line metrics don't depend on the scale or PDF mode, so they can be shared between equations.
++ (NSMapTable *)newLineMetricsCache
+{
+    return [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality)
+                                 valueOptions:NSPointerFunctionsStrongMemory];
+}
+
 // This method is not ideal, but it doesn't require calls to CTLine so is less resource intensive.
 - (CGSize)computeInlineSize
 {
@@ -101,28 +145,135 @@
     return trackSize;
 }
 
+- (EQRenderFrozenEquation *)frozenEquation
+{
+    return [[EQRenderFrozenEquation alloc] initWithRenderEquation:self];
+}
+
+- (EQRenderSpatialIndex *)spatialIndex
+{
+    if (CGSizeEqualToSize(self.drawSize, CGSizeZero))
+    {
+        [self layoutEquationLines];
+    }
+
+    if (nil == self.storedSpatialIndex)
+    {
+        self.storedSpatialIndex = [[EQRenderSpatialIndex alloc] initWithRenderEquation:self];
+    }
+    return self.storedSpatialIndex;
+}
+
+- (EQTextPosition *)closestPositionToPoint: (CGPoint)point inRect: (CGRect)useRect
+{
+    if (self.pdfScale <= 0.0)
+        return nil;
+
+    CGPoint indexPoint = CGPointMake((point.x - useRect.origin.x) / self.pdfScale, (point.y - useRect.origin.y) / self.pdfScale);
+    return [[self spatialIndex] closestPositionToPoint:indexPoint];
+}
+
+- (CGRect)caretRectForPosition: (EQTextPosition *)textPosition inRect: (CGRect)useRect
+{
+    CGRect caretRect = [[self spatialIndex] caretRectForPosition:textPosition];
+    if (CGRectIsNull(caretRect))
+        return CGRectNull;
+
+    caretRect = CGRectApplyAffineTransform(caretRect, CGAffineTransformMakeScale(self.pdfScale, self.pdfScale));
+    return CGRectOffset(caretRect, useRect.origin.x, useRect.origin.y);
+}
+
+- (CGRect)inkBounds
+{
+    if (CGSizeEqualToSize(self.drawSize, CGSizeZero))
+    {
+        [self layoutEquationLines];
+    }
+
+    if (!CGRectIsNull(self.storedInkBounds))
+        return self.storedInkBounds;
+
+    // The cached ink is relative to each line, so it only needs the line origins from this layout.
+    CGRect inkRect = CGRectNull;
+    NSUInteger inkIndex = (self.usePDFMode == YES) ? 3 : 2;
+    NSUInteger lineCount = MIN(self.equationLines.count, self.equationLayoutData.count);
+    for (NSUInteger i = 0; i < lineCount; i ++)
+    {
+        CGRect lineInkRect = [(NSValue *)[self metricsForEquationLine:self.equationLines[i]][inkIndex] CGRectValue];
+        if (CGRectIsNull(lineInkRect))
+            continue;
+
+        CGPoint lineOrigin = [self drawRectForLineAtIndex:i].origin;
+        inkRect = CGRectUnion(inkRect, CGRectOffset(lineInkRect, lineOrigin.x, lineOrigin.y));
+    }
+    self.storedInkBounds = inkRect;
+
+    return inkRect;
+}
 
 // Computes the rect needed to enclose all of the renderData.
 // The indirectly calls CTLine sizing methods and can be resource intensive if called repeatedly.
-- (CGRect)getBoundingFrameWithData: (NSArray *)dataArray
+// The same pass collects the ink of the glyphs, stretchy pieces and rules relative to the line origin.
+// Radical lines move slightly in PDF mode, so the ink is returned for both modes.
+- (CGRect)getBoundingFrameWithData: (NSArray *)dataArray inkBounds: (CGRect *)inkBounds pdfInkBounds: (CGRect *)pdfInkBounds
 {
+    *inkBounds = CGRectNull;
+    *pdfInkBounds = CGRectNull;
     if (nil == dataArray || dataArray.count == 0)
         return CGRectNull;
 
+    CGContextRef measureContext = [EQRenderEquation createMeasureContext];
     CGRect returnRect = CGRectMake(0.0, 0.0, 44.0, 10.0);
+    CGRect glyphInkRect = CGRectNull;
+    CGRect ruleInkRect = CGRectNull;
+    CGRect pdfRuleInkRect = CGRectNull;
+    NSMutableArray *fracArray = [[NSMutableArray alloc] init];
+    NSMutableArray *nRootArray = [[NSMutableArray alloc] init];
+
     for (EQRenderData *renderData in dataArray)
     {
         // Get the geometric data.
         CGPoint useOrigin = renderData.drawOrigin;
-        CGRect useBounds;
-        if (renderData.hasStretchyCharacterData)
+        CGRect glyphBounds = CGRectNull;
+        CGRect baselineBounds = [renderData baselineImageBoundsInContext:measureContext useStretchy:renderData.hasStretchyCharacterData
+                                                               inkBounds:&glyphBounds];
+        glyphInkRect = CGRectUnion(glyphInkRect, [EQRenderEquation inkRectForImageBounds:glyphBounds atPoint:useOrigin]);
+
+        for (NSArray *drawArray in [self stretchyDrawArrayForRenderData:renderData inContext:measureContext])
         {
-            useBounds = renderData.imageBoundsWithStretchyData;
+            CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)drawArray[0]);
+            CGRect imageBounds = CTLineGetImageBounds(line, measureContext);
+            CFRelease(line);
+            glyphInkRect = CGRectUnion(glyphInkRect, [EQRenderEquation inkRectForImageBounds:imageBounds
+                                                                                     atPoint:[(NSValue *)drawArray[1] CGPointValue]]);
         }
-        else
+
+        EQRenderFracStem *fracParent = (EQRenderFracStem *)[renderData getFractionBarParent];
+        if (nil != fracParent && fracParent.lineThickness > 0.0 && ![fracArray containsObject:fracParent])
         {
-            useBounds = renderData.imageBounds;
+            [fracArray addObject:fracParent];
+            CGFloat lineY = [self fractionBarYForStem:fracParent withData:renderData];
+            CGRect lineRect = [EQRenderEquation inkRectForLineFrom:CGPointMake(floor(fracParent.startLinePoint.x), lineY)
+                                                                to:CGPointMake(floor(fracParent.endLinePoint.x), lineY)
+                                                             width:fracParent.lineThickness];
+            ruleInkRect = CGRectUnion(ruleInkRect, lineRect);
+            pdfRuleInkRect = CGRectUnion(pdfRuleInkRect, lineRect);
+        }
+
+        EQRenderStem *nRootParent = (EQRenderStem *)[renderData getNRootParent];
+        if (nil != nRootParent && nRootParent.hasOverline && ![nRootArray containsObject:nRootParent])
+        {
+            [nRootArray addObject:nRootParent];
+            for (NSArray *lineArray in [self radicalLinesForStem:nRootParent usePDFMode:NO])
+            {
+                ruleInkRect = CGRectUnion(ruleInkRect, [EQRenderEquation inkRectForLineArray:lineArray]);
+            }
+            for (NSArray *lineArray in [self radicalLinesForStem:nRootParent usePDFMode:YES])
+            {
+                pdfRuleInkRect = CGRectUnion(pdfRuleInkRect, [EQRenderEquation inkRectForLineArray:lineArray]);
+            }
         }
+        CGRect useBounds = CGRectIsNull(baselineBounds) ? CGRectZero : baselineBounds;
         useBounds.origin = useOrigin;
 
         // Use the smallest amount as the enclosing origin.
@@ -145,9 +296,36 @@
             returnRect.size.height += maxY - (useOrigin.y + returnRect.size.height);
         }
     }
+    CGContextRelease(measureContext);
+
+    *inkBounds = CGRectUnion(glyphInkRect, ruleInkRect);
+    *pdfInkBounds = CGRectUnion(glyphInkRect, pdfRuleInkRect);
+
     return returnRect;
 }
 
+// Converts CTLine image bounds, which are y-up from the baseline, into a rect at the same floored point that drawing uses.
++ (CGRect)inkRectForImageBounds: (CGRect)imageBounds atPoint: (CGPoint)drawPoint
+{
+    if (CGRectIsNull(imageBounds) || CGRectIsEmpty(imageBounds))
+        return CGRectNull;
+
+    return CGRectMake(floor(drawPoint.x) + imageBounds.origin.x, floor(drawPoint.y) - CGRectGetMaxY(imageBounds),
+                      imageBounds.size.width, imageBounds.size.height);
+}
+
++ (CGRect)inkRectForLineFrom: (CGPoint)startPoint to: (CGPoint)endPoint width: (CGFloat)lineWidth
+{
+    CGRect lineRect = CGRectStandardize(CGRectMake(startPoint.x, startPoint.y, endPoint.x - startPoint.x, endPoint.y - startPoint.y));
+    return CGRectInset(lineRect, -0.5 * lineWidth, -0.5 * lineWidth);
+}
+
++ (CGRect)inkRectForLineArray: (NSArray *)lineArray
+{
+    return [EQRenderEquation inkRectForLineFrom:[(NSValue *)lineArray[0] CGPointValue] to:[(NSValue *)lineArray[1] CGPointValue]
+                                          width:[(NSNumber *)lineArray[2] floatValue]];
+}
+
 // This calls equation alignment methods in addition to normal layout of equations.
 // However, equation alignment does not happen unless all of the equation data is in the same data source.
 - (void)layoutEquationLines
@@ -158,19 +336,20 @@
 
     NSMutableArray *offsetArray = [[NSMutableArray alloc] init];
     NSMutableArray *leftArray = [[NSMutableArray alloc] init];
+    self.storedInkBounds = CGRectNull;
+    self.storedSpatialIndex = nil;
 
     for (NSArray *equationLine in self.equationLines)
     {
-        CGRect viewFrame = [self getBoundingFrameWithData:equationLine];
+        // Only lines that are new or have been invalidated are measured again.
+        NSArray *lineMetrics = [self metricsForEquationLine:equationLine];
+        CGRect viewFrame = [(NSValue *)lineMetrics[0] CGRectValue];
         CGFloat storedAlignOffset = 0.0;
         RenderViewAlign storedAlignment = viewAlignAuto;
 
         if (equationLineCounter < self.equationLayoutData.count)
         {
             NSArray *equationLayoutArray = self.equationLayoutData[equationLineCounter];
-            NSValue *equationLineFrame = equationLayoutArray[0];
-            viewFrame = equationLineFrame.CGRectValue;
-
             NSNumber *equationViewAlign = equationLayoutArray[2];
             storedAlignment = equationViewAlign.intValue;
         }
@@ -187,7 +366,7 @@
         }
 
         storedAlignOffset = 0.0;
-        CGFloat xOffset = [self findAlignOffsetForEquationLine:equationLine];
+        CGFloat xOffset = [(NSNumber *)lineMetrics[1] floatValue];
         if (storedAlignment == viewAlignAuto && xOffset != 0)
         {
             xOffset = floorf(xOffset);
@@ -216,6 +395,13 @@
         equationLineCounter ++;
     }
 
+    // Remove layout data left over from deleted lines.
+    if (self.equationLayoutData.count > self.equationLines.count)
+    {
+        NSRange removeRange = NSMakeRange(self.equationLines.count, self.equationLayoutData.count - self.equationLines.count);
+        [self.equationLayoutData removeObjectsInRange:removeRange];
+    }
+
     if (leftArray.count > 0)
     {
         [self setAlignmentLeftWithArray:leftArray];
@@ -226,6 +412,18 @@
         [self adjustAlignmentWithArray:offsetArray];
     }
 
+    // Resolve the PDF fonts once here instead of on every draw.
+    if (self.usePDFMode == YES)
+    {
+        for (NSArray *equationLine in self.equationLines)
+        {
+            for (EQRenderData *renderData in equationLine)
+            {
+                [self pdfStringForRenderData:renderData];
+            }
+        }
+    }
+
     trackSize.width = ceilf(trackSize.width);
     trackSize.height = ceilf(trackSize.height);
 
@@ -242,9 +440,94 @@
     self.drawSize = trackSize;
 }
 
+// Lays out the equation and returns the inline metrics.
+// The ink and baseline are collected while the lines are measured, so this is a single layout pass.
+- (EQInlineMetrics)layoutInlineEquation
+{
+    [self layoutEquationLines];
+    return self.inlineMetrics;
+}
+
+// The metrics come from inkBounds, so they include stretchy pieces, radical overlines and fraction rules.
+- (EQInlineMetrics)inlineMetrics
+{
+    EQInlineMetrics newMetrics = {0.0, 0.0, 0.0, CGPointZero};
+    CGRect inkRect = [self inkBounds];
+    NSUInteger lineCount = MIN(self.equationLines.count, self.equationLayoutData.count);
+
+    if (!CGRectIsNull(inkRect) && lineCount > 0)
+    {
+        // The root stem origin is the baseline of the first line.
+        CGFloat baselineY = [self drawRectForLineAtIndex:0].origin.y;
+        EQRenderStem *rootStem = self.equationStems.firstObject;
+        NSArray *firstLine = self.equationLines.firstObject;
+        if (nil != rootStem)
+        {
+            baselineY += rootStem.drawOrigin.y;
+        }
+        else if (firstLine.count > 0)
+        {
+            baselineY += [(EQRenderData *)firstLine[0] drawOrigin].y;
+        }
+
+        CGFloat useScale = self.pdfScale;
+        newMetrics.width = inkRect.size.width * useScale;
+        newMetrics.ascent = MAX(baselineY - CGRectGetMinY(inkRect), 0.0) * useScale;
+        newMetrics.descent = MAX(CGRectGetMaxY(inkRect) - baselineY, 0.0) * useScale;
+        newMetrics.baselineOrigin = CGPointMake(CGRectGetMinX(inkRect) * useScale, baselineY * useScale);
+    }
+
+    return newMetrics;
+}
+
+// Returns the cached frame, align offset and ink bounds for the equation line, measuring it first if needed.
+// Measuring calls CTLine sizing methods, so this is the expensive part of layoutEquationLines.
+- (NSArray *)metricsForEquationLine: (NSArray *)equationLine
+{
+    NSArray *lineMetrics = [self.lineMetricsCache objectForKey:equationLine];
+    if (nil == lineMetrics)
+    {
+        CGRect inkRect, pdfInkRect;
+        CGRect viewFrame = [self getBoundingFrameWithData:equationLine inkBounds:&inkRect pdfInkBounds:&pdfInkRect];
+        CGFloat xOffset = [self findAlignOffsetForEquationLine:equationLine];
+        lineMetrics = @[[NSValue valueWithCGRect:viewFrame], @(xOffset), [NSValue valueWithCGRect:inkRect], [NSValue valueWithCGRect:pdfInkRect]];
+        [self.lineMetricsCache setObject:lineMetrics forKey:equationLine];
+    }
+    return lineMetrics;
+}
+
+// Call this after changing the contents of an equation line.
+// The next layout will measure that line again and only update the offsets of the others.
+- (void)invalidateLayoutForEquationLine: (NSArray *)equationLine
+{
+    if (nil == equationLine)
+        return;
+
+    [self.lineMetricsCache removeObjectForKey:equationLine];
+    for (id renderData in equationLine)
+    {
+        [self.pdfStringCache removeObjectForKey:renderData];
+    }
+    self.drawSize = CGSizeZero;
+}
+
+- (void)invalidateAllLineLayouts
+{
+    [self.lineMetricsCache removeAllObjects];
+    [self.pdfStringCache removeAllObjects];
+    self.drawSize = CGSizeZero;
+}
+
 // This method requires an active graphics context to draw in.
 // You should already have called other methods to lay out the equations or required data will not have been created.
 - (void)drawEquationLinesInRect:(CGRect)useRect
+{
+    [self drawEquationLinesInRect:useRect visibleRect:CGRectNull];
+}
+
+// Same as above, but only draws the lines that intersect the visible (or dirty) rect.
+// The visible rect uses the same coordinates as useRect. Pass CGRectNull to draw every line.
+- (void)drawEquationLinesInRect: (CGRect)useRect visibleRect: (CGRect)visibleRect
 {
     CGContextRef context = UIGraphicsGetCurrentContext();
     // Return if unable to create the context for some reason.
@@ -258,40 +541,104 @@
         [self layoutEquationLines];
     }
 
+    NSRange lineRange = NSMakeRange(0, MIN(self.equationLines.count, self.equationLayoutData.count));
+    if (!CGRectIsNull(visibleRect))
+    {
+        lineRange = [self lineRangeIntersectingRect:visibleRect inRect:useRect];
+        if (lineRange.location == NSNotFound)
+            return;
+    }
+
     CGContextSetShouldAntialias(context, YES);
     CGContextSetShouldSmoothFonts(context, YES);
     CGContextSaveGState(context);
+
+    // Clipping also lets drawSingleLine skip the parts of a line that are not visible.
+    if (!CGRectIsNull(visibleRect))
+    {
+        CGContextClipToRect(context, visibleRect);
+    }
     CGContextTranslateCTM(context, useRect.origin.x, useRect.origin.y);
     CGContextScaleCTM(context, self.pdfScale, self.pdfScale);
 
-    int viewCounter = 0;
-    CGFloat heightDelta = -10.0;
-    CGFloat widthDelta = 30.0;
-
-    for (NSArray *equationLine in self.equationLines)
+    for (NSUInteger i = lineRange.location; i < NSMaxRange(lineRange); i ++)
     {
-        NSArray *equationLayoutArray = self.equationLayoutData[viewCounter];
-        if (nil == equationLayoutArray)
-            continue;
-
-        NSValue *equationLineFrame = equationLayoutArray[0];
-        CGRect viewFrame = equationLineFrame.CGRectValue;
-
-        CGRect curRect = viewFrame;
-        curRect.origin.y -= heightDelta;
-        curRect.origin.x += widthDelta;
-        curRect = CGRectIntegral(curRect);
+        NSArray *equationLine = self.equationLines[i];
+        CGRect curRect = [self drawRectForLineAtIndex:i];
         CGContextSaveGState(context);
         CGContextTranslateCTM(context, curRect.origin.x, curRect.origin.y);
 
         [self drawSingleLine:equationLine];
 
         CGContextRestoreGState(context);
-        viewCounter ++;
     }
     CGContextRestoreGState(context);
 }
 
+// Returns the stored line frame with the offsets used when drawing, before the pdfScale is applied.
+- (CGRect)drawRectForLineAtIndex: (NSUInteger)lineIndex
+{
+    NSArray *equationLayoutArray = self.equationLayoutData[lineIndex];
+    NSValue *equationLineFrame = equationLayoutArray[0];
+    CGRect curRect = equationLineFrame.CGRectValue;
+
+    CGFloat heightDelta = -10.0;
+    CGFloat widthDelta = 30.0;
+    curRect.origin.y -= heightDelta;
+    curRect.origin.x += widthDelta;
+    return CGRectIntegral(curRect);
+}
+
+// The stored line frames are stacked from top to bottom, so binary search for the first and last visible lines.
+// Returns a range with location NSNotFound if no lines are visible.
+- (NSRange)lineRangeIntersectingRect: (CGRect)visibleRect inRect: (CGRect)useRect
+{
+    NSUInteger lineCount = MIN(self.equationLines.count, self.equationLayoutData.count);
+    if (lineCount == 0 || CGRectIsNull(visibleRect) || self.pdfScale <= 0.0)
+        return NSMakeRange(NSNotFound, 0);
+
+    // Convert to unscaled line coordinates.
+    // Stretchy characters and radicals can reach a little outside of the stored frames, so add some padding.
+    CGFloat usePadding = kDEFAULT_FONT_SIZE;
+    CGFloat minY = (CGRectGetMinY(visibleRect) - useRect.origin.y) / self.pdfScale - usePadding;
+    CGFloat maxY = (CGRectGetMaxY(visibleRect) - useRect.origin.y) / self.pdfScale + usePadding;
+
+    NSUInteger lowIndex = 0;
+    NSUInteger highIndex = lineCount;
+    while (lowIndex < highIndex)
+    {
+        NSUInteger midIndex = lowIndex + (highIndex - lowIndex) / 2;
+        if (CGRectGetMaxY([self drawRectForLineAtIndex:midIndex]) < minY)
+        {
+            lowIndex = midIndex + 1;
+        }
+        else
+        {
+            highIndex = midIndex;
+        }
+    }
+    NSUInteger startIndex = lowIndex;
+
+    highIndex = lineCount;
+    while (lowIndex < highIndex)
+    {
+        NSUInteger midIndex = lowIndex + (highIndex - lowIndex) / 2;
+        if (CGRectGetMinY([self drawRectForLineAtIndex:midIndex]) <= maxY)
+        {
+            lowIndex = midIndex + 1;
+        }
+        else
+        {
+            highIndex = midIndex;
+        }
+    }
+
+    if (lowIndex <= startIndex)
+        return NSMakeRange(NSNotFound, 0);
+
+    return NSMakeRange(startIndex, lowIndex - startIndex);
+}
+
 // This method is called once for every equation.
 // It reads through each RenderData and handles things like fraction bars and radicals.
 // Actual text drawing is handled in a different method.
@@ -301,6 +648,9 @@
     CGContextRef context = UIGraphicsGetCurrentContext();
     CGContextSaveGState(context);
 
+    // Read the visible area before flipping so that it is in the same coordinates as the render data.
+    CGRect visibleRect = CGContextGetClipBoundingBox(context);
+
     CGFloat contextCoeff = 1.0;
     if (self.shouldFlipContext)
     {
@@ -313,8 +663,14 @@
     NSMutableArray *fracArray = [[NSMutableArray alloc] initWithCapacity:equationLine.count];
     NSMutableArray *nRootArray = [[NSMutableArray alloc] initWithCapacity:equationLine.count];
 
+    // Store the visible cells for each matrix so large matrices only draw the cells inside the clip rect.
+    NSMapTable *visibleCellMap = [NSMapTable strongToStrongObjectsMapTable];
+
     for (EQRenderData *viewRenderData in equationLine)
     {
+        if (![self matrixCellIsVisibleForData:viewRenderData inRect:visibleRect withCellMap:visibleCellMap])
+            continue;
+
         NSAttributedString *renderString = viewRenderData.renderString;
 
         if (nil != renderString && renderString.length > 0)
@@ -328,85 +684,32 @@
 
             // Check to see if any of the characters need to be replaced with stretchy equivalents.
             // May need to expand this for extender character data.
-            if (viewRenderData.hasStretchyCharacterData == YES)
+            if (self.usePDFMode == YES)
             {
-                renderString = [viewRenderData renderStringWithStretchyCharacters];
+                // Already converted to TTF fonts, so draw it directly.
+                renderString = [self pdfStringForRenderData:viewRenderData];
+                [self drawConvertedString:renderString atPoint:drawPoint inContext:context];
             }
-            [self drawRenderString:renderString atPoint:drawPoint inContext:context];
-            viewRenderData.needsRedrawn = NO;
-        }
-        if ([viewRenderData containsStretchyDescenders] == YES)
-        {
-            NSArray *stretchyDescenders = [viewRenderData getStretchyDescenders];
-            if (nil != stretchyDescenders && stretchyDescenders.count > 0)
+            else
             {
-                // It checks the type of the object and acts accordingly.
-                for (id stretchyDescenderObj in stretchyDescenders)
+                if (viewRenderData.hasStretchyCharacterData == YES)
                 {
-                    if ([stretchyDescenderObj isKindOfClass:[EQRenderData class]])
-                    {
-                        EQRenderData *stretchyDescenderData = (EQRenderData *)stretchyDescenderObj;
-                        NSAttributedString *stretchyStr = stretchyDescenderData.renderString;
-                        CGPoint stretchyDrawPoint = stretchyDescenderData.stretchyDescenderPoint;
-                        stretchyDrawPoint.x = stretchyDescenderData.drawOrigin.x;
-                        if (self.shouldFlipContext)
-                        {
-                            stretchyDrawPoint.y *= contextCoeff;
-                        }
-
-                        [self drawRenderString:stretchyStr atPoint:stretchyDrawPoint inContext:context];
-                    }
-                    else if ([stretchyDescenderObj isKindOfClass:[EQRenderStretchyBracers class]])
-                    {
-                        EQRenderStretchyBracers *stretchyBracerData = (EQRenderStretchyBracers *)stretchyDescenderObj;
-                        NSArray *stretchyDrawArray = [stretchyBracerData stretchyDrawArrayInContext:context];
-                        if (nil != stretchyDrawArray)
-                        {
-                            for (NSArray *drawArray in stretchyDrawArray)
-                            {
-                                NSAttributedString *stretchyStr = drawArray[0];
-                                CGPoint stretchyDrawPoint = [(NSValue *)drawArray[1] CGPointValue];
-                                if (self.shouldFlipContext)
-                                {
-                                    stretchyDrawPoint.y *= contextCoeff;
-                                }
-                                [self drawRenderString:stretchyStr atPoint:stretchyDrawPoint inContext:context];
-                            }
-                        }
-                    }
+                    renderString = [viewRenderData renderStringWithStretchyCharacters];
                 }
+                [self drawRenderString:renderString atPoint:drawPoint inContext:context];
             }
+            viewRenderData.needsRedrawn = NO;
         }
-        if (viewRenderData.usesStretchyExtenders == YES)
+        NSArray *stretchyDrawArray = [self stretchyDrawArrayForRenderData:viewRenderData inContext:context];
+        for (NSArray *drawArray in stretchyDrawArray)
         {
-            NSArray *stretchyExtenders = [viewRenderData getStretchyExtenders];
-            if (nil != stretchyExtenders && stretchyExtenders.count > 0)
+            NSAttributedString *stretchyStr = drawArray[0];
+            CGPoint stretchyDrawPoint = [(NSValue *)drawArray[1] CGPointValue];
+            if (self.shouldFlipContext)
             {
-                // It checks the type of the object and acts accordingly.
-                for (id stretchyDescenderObj in stretchyExtenders)
-                {
-                    // Don't bother checking for renderData as they should not be mixed here.
-                    if ([stretchyDescenderObj isKindOfClass:[EQRenderStretchyBracers class]])
-                    {
-                        EQRenderStretchyBracers *stretchyBracerData = (EQRenderStretchyBracers *)stretchyDescenderObj;
-                        NSArray *stretchyDrawArray = [stretchyBracerData stretchyDrawArrayInContext:context];
-                        if (nil != stretchyDrawArray)
-                        {
-                            for (NSArray *drawArray in stretchyDrawArray)
-                            {
-                                NSAttributedString *stretchyStr = drawArray[0];
-                                CGPoint stretchyDrawPoint = [(NSValue *)drawArray[1] CGPointValue];
-                                stretchyDrawPoint.y += viewRenderData.drawOrigin.y;
-                                if (self.shouldFlipContext)
-                                {
-                                    stretchyDrawPoint.y *= contextCoeff;
-                                }
-                                [self drawRenderString:stretchyStr atPoint:stretchyDrawPoint inContext:context];
-                            }
-                        }
-                    }
-                }
+                stretchyDrawPoint.y *= contextCoeff;
             }
+            [self drawRenderString:stretchyStr atPoint:stretchyDrawPoint inContext:context];
         }
         if (nil != [viewRenderData getFractionBarParent])
         {
@@ -414,20 +717,12 @@
             if (fracParent.lineThickness > 0.0 && ![fracArray containsObject:fracParent])
             {
                 [fracArray addObject:fracParent];
-
-                // Test for collision. An edge case caused by a resize adjustment in the first frac you add.
-                // Should only use first child.
-
-                CGPoint testPoint = fracParent.startLinePoint;
-                if ([viewRenderData isEqual:[fracParent getFirstChild]] && testPoint.y < viewRenderData.drawOrigin.y)
-                {
-                    testPoint.y = viewRenderData.drawOrigin.y + ABS(fracParent.drawOrigin.y - testPoint.y) + 4.0 * fracParent.lineThickness;
-                }
+                CGFloat lineY = [self fractionBarYForStem:fracParent withData:viewRenderData];
 
                 // Begin line draw.
                 CGContextBeginPath(context);
-                CGContextMoveToPoint(context, floor(fracParent.startLinePoint.x), contextCoeff * floor(testPoint.y));
-                CGContextAddLineToPoint(context, floor(fracParent.endLinePoint.x), contextCoeff * floor(testPoint.y));
+                CGContextMoveToPoint(context, floor(fracParent.startLinePoint.x), contextCoeff * lineY);
+                CGContextAddLineToPoint(context, floor(fracParent.endLinePoint.x), contextCoeff * lineY);
                 CGContextSetLineWidth(context, fracParent.lineThickness);
                 CGContextSetCMYKStrokeColor(context, 0.0, 0.0, 0.0, 1.0, 1.0);
                 CGContextStrokePath(context);
@@ -441,60 +736,305 @@
             {
                 [nRootArray addObject:nRootParent];
 
-                CGPoint suppleStart = nRootParent.supplementalLineStartPoint;
-                CGPoint suppleEnd = nRootParent.supplementalLineEndPoint;
-                CGPoint overLineStart = nRootParent.overlineStartPoint;
-                CGPoint overLineEnd = nRootParent.overlineEndPoint;
-
-                // May need to add another line to expand the radical symbol out a bit.
-                if (nRootParent.hasSupplementalLine == YES)
+                for (NSArray *lineArray in [self radicalLinesForStem:nRootParent])
                 {
-                    // These seem to be related to differences between the TTF and the OTF fonts.
-                    // The radical doesn't match in the same place, though it could be something else.
-                    if (self.usePDFMode == YES)
-                    {
-                        suppleStart.x -= 0.25;
-                        overLineStart.y += 0.5;
-                        overLineEnd.y += 0.5;
-                    }
-                    else
-                    {
-                        overLineStart.y = floorf(overLineStart.y);
-                        overLineEnd.y = floorf(overLineEnd.y);
-                    }
+                    CGPoint lineStart = [(NSValue *)lineArray[0] CGPointValue];
+                    CGPoint lineEnd = [(NSValue *)lineArray[1] CGPointValue];
+
                     // Begin line draw.
-                    CGContextMoveToPoint(context, suppleStart.x, contextCoeff * suppleStart.y);
-                    CGContextAddLineToPoint(context, suppleEnd.x, contextCoeff * suppleEnd.y);
-                    CGContextSetLineWidth(context, 1.25);
+                    CGContextBeginPath(context);
+                    CGContextMoveToPoint(context, lineStart.x, contextCoeff * lineStart.y);
+                    CGContextAddLineToPoint(context, lineEnd.x, contextCoeff * lineEnd.y);
+                    CGContextSetLineWidth(context, [(NSNumber *)lineArray[2] floatValue]);
                     CGContextSetCMYKStrokeColor(context, 0.0, 0.0, 0.0, 1.0, 1.0);
                     CGContextStrokePath(context);
                     // End line draw.
                 }
-
-                // Begin line draw.
-                CGContextBeginPath(context);
-                CGContextMoveToPoint(context, overLineStart.x, contextCoeff * overLineStart.y);
-                CGContextAddLineToPoint(context, overLineEnd.x, contextCoeff * overLineEnd.y);
-                CGContextSetLineWidth(context, 1.75);
-                CGContextStrokePath(context);
-                // End line draw.
             }
         }
     }
     CGContextRestoreGState(context);
 }
 
+// Collects the stretchy descender and extender pieces for the renderData.
+// Returns an array of @[attributedString, NSValue point] using the same unflipped coordinates as the renderData.
+// The context is only used to measure the glyphs.
+- (NSArray *)stretchyDrawArrayForRenderData: (EQRenderData *)viewRenderData inContext: (CGContextRef)context
+{
+    NSMutableArray *returnArray = [[NSMutableArray alloc] init];
+
+    if ([viewRenderData containsStretchyDescenders] == YES)
+    {
+        NSArray *stretchyDescenders = [viewRenderData getStretchyDescenders];
+        // It checks the type of the object and acts accordingly.
+        for (id stretchyDescenderObj in stretchyDescenders)
+        {
+            if ([stretchyDescenderObj isKindOfClass:[EQRenderData class]])
+            {
+                EQRenderData *stretchyDescenderData = (EQRenderData *)stretchyDescenderObj;
+                CGPoint stretchyDrawPoint = stretchyDescenderData.stretchyDescenderPoint;
+                stretchyDrawPoint.x = stretchyDescenderData.drawOrigin.x;
+                if (nil != stretchyDescenderData.renderString)
+                {
+                    [returnArray addObject:@[stretchyDescenderData.renderString, [NSValue valueWithCGPoint:stretchyDrawPoint]]];
+                }
+            }
+            else if ([stretchyDescenderObj isKindOfClass:[EQRenderStretchyBracers class]])
+            {
+                NSArray *stretchyDrawArray = [(EQRenderStretchyBracers *)stretchyDescenderObj stretchyDrawArrayInContext:context];
+                if (nil != stretchyDrawArray)
+                {
+                    [returnArray addObjectsFromArray:stretchyDrawArray];
+                }
+            }
+        }
+    }
+    if (viewRenderData.usesStretchyExtenders == YES)
+    {
+        NSArray *stretchyExtenders = [viewRenderData getStretchyExtenders];
+        for (id stretchyDescenderObj in stretchyExtenders)
+        {
+            // Don't bother checking for renderData as they should not be mixed here.
+            if ([stretchyDescenderObj isKindOfClass:[EQRenderStretchyBracers class]])
+            {
+                NSArray *stretchyDrawArray = [(EQRenderStretchyBracers *)stretchyDescenderObj stretchyDrawArrayInContext:context];
+                for (NSArray *drawArray in stretchyDrawArray)
+                {
+                    // Extender points are relative to the renderData.
+                    CGPoint stretchyDrawPoint = [(NSValue *)drawArray[1] CGPointValue];
+                    stretchyDrawPoint.y += viewRenderData.drawOrigin.y;
+                    [returnArray addObject:@[drawArray[0], [NSValue valueWithCGPoint:stretchyDrawPoint]]];
+                }
+            }
+        }
+    }
+
+    return returnArray;
+}
+
+// Returns the y position of the fraction bar.
+- (CGFloat)fractionBarYForStem: (EQRenderFracStem *)fracParent withData: (EQRenderData *)viewRenderData
+{
+    // Test for collision. An edge case caused by a resize adjustment in the first frac you add.
+    // Should only use first child.
+    CGPoint testPoint = fracParent.startLinePoint;
+    if ([viewRenderData isEqual:[fracParent getFirstChild]] && testPoint.y < viewRenderData.drawOrigin.y)
+    {
+        testPoint.y = viewRenderData.drawOrigin.y + ABS(fracParent.drawOrigin.y - testPoint.y) + 4.0 * fracParent.lineThickness;
+    }
+    return floor(testPoint.y);
+}
+
+// Returns the lines used to draw the radical as @[NSValue start, NSValue end, lineWidth].
+- (NSArray *)radicalLinesForStem: (EQRenderStem *)nRootParent
+{
+    return [self radicalLinesForStem:nRootParent usePDFMode:self.usePDFMode];
+}
+
+- (NSArray *)radicalLinesForStem: (EQRenderStem *)nRootParent usePDFMode: (BOOL)usePDFMode
+{
+    NSMutableArray *returnArray = [[NSMutableArray alloc] init];
+
+    CGPoint suppleStart = nRootParent.supplementalLineStartPoint;
+    CGPoint suppleEnd = nRootParent.supplementalLineEndPoint;
+    CGPoint overLineStart = nRootParent.overlineStartPoint;
+    CGPoint overLineEnd = nRootParent.overlineEndPoint;
+
+    // May need to add another line to expand the radical symbol out a bit.
+    if (nRootParent.hasSupplementalLine == YES)
+    {
+        // These seem to be related to differences between the TTF and the OTF fonts.
+        // The radical doesn't match in the same place, though it could be something else.
+        if (usePDFMode == YES)
+        {
+            suppleStart.x -= 0.25;
+            overLineStart.y += 0.5;
+            overLineEnd.y += 0.5;
+        }
+        else
+        {
+            overLineStart.y = floorf(overLineStart.y);
+            overLineEnd.y = floorf(overLineEnd.y);
+        }
+        [returnArray addObject:@[[NSValue valueWithCGPoint:suppleStart], [NSValue valueWithCGPoint:suppleEnd], @(1.25)]];
+    }
+    [returnArray addObject:@[[NSValue valueWithCGPoint:overLineStart], [NSValue valueWithCGPoint:overLineEnd], @(1.75)]];
+
+    return returnArray;
+}
+
+// Returns a 1x1 bitmap context that can be passed to the enumerate method when you are not drawing.
+// The caller is responsible for releasing it.
++ (CGContextRef)createMeasureContext
+{
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
+    CGContextRef measureContext = CGBitmapContextCreate(NULL, 1, 1, 8, 0, colorSpace, (CGBitmapInfo)kCGImageAlphaNone);
+    CGColorSpaceRelease(colorSpace);
+    return measureContext;
+}
+
+// Stretchy characters leave clear placeholder glyphs in the string so the spacing stays the same.
+// Exporters that don't use the foreground color should skip those runs.
++ (BOOL)shouldDrawRun: (CTRunRef)run
+{
+    NSDictionary *runAttributes = (__bridge NSDictionary *)CTRunGetAttributes(run);
+    id colorValue = runAttributes[NSForegroundColorAttributeName];
+    if (nil == colorValue)
+    {
+        colorValue = runAttributes[(NSString *)kCTForegroundColorAttributeName];
+    }
+
+    if (nil == colorValue)
+        return YES;
+
+    CGColorRef runColor = NULL;
+    if ([colorValue isKindOfClass:[UIColor class]])
+    {
+        runColor = [(UIColor *)colorValue CGColor];
+    }
+    else if (CFGetTypeID((__bridge CFTypeRef)colorValue) == CGColorGetTypeID())
+    {
+        runColor = (__bridge CGColorRef)colorValue;
+    }
+
+    return (NULL == runColor || CGColorGetAlpha(runColor) > 0.0);
+}
+
+// Walks every line in the same way as drawSingleLine: and passes each string and rule to the blocks.
+// The context is only used to measure stretchy glyphs and can be any bitmap context.
+- (void)enumerateDrawElementsInContext: (CGContextRef)context
+                           stringBlock: (EQRenderStringBlock)stringBlock
+                             lineBlock: (EQRenderLineBlock)lineBlock
+{
+    if (CGSizeEqualToSize(self.drawSize, CGSizeZero))
+    {
+        [self layoutEquationLines];
+    }
+
+    NSUInteger lineCount = MIN(self.equationLines.count, self.equationLayoutData.count);
+    for (NSUInteger i = 0; i < lineCount; i ++)
+    {
+        NSArray *equationLine = self.equationLines[i];
+        CGPoint lineOrigin = [self drawRectForLineAtIndex:i].origin;
+
+        NSMutableArray *fracArray = [[NSMutableArray alloc] initWithCapacity:equationLine.count];
+        NSMutableArray *nRootArray = [[NSMutableArray alloc] initWithCapacity:equationLine.count];
+
+        for (EQRenderData *renderData in equationLine)
+        {
+            NSAttributedString *renderString = renderData.renderString;
+            if (nil != stringBlock && nil != renderString && renderString.length > 0)
+            {
+                if (renderData.hasStretchyCharacterData == YES)
+                {
+                    renderString = [renderData renderStringWithStretchyCharacters];
+                }
+                CGPoint drawPoint = renderData.drawOrigin;
+                stringBlock(renderString, CGPointMake(lineOrigin.x + floor(drawPoint.x), lineOrigin.y + floor(drawPoint.y)));
+            }
+
+            if (nil != stringBlock)
+            {
+                for (NSArray *drawArray in [self stretchyDrawArrayForRenderData:renderData inContext:context])
+                {
+                    CGPoint drawPoint = [(NSValue *)drawArray[1] CGPointValue];
+                    stringBlock(drawArray[0], CGPointMake(lineOrigin.x + floor(drawPoint.x), lineOrigin.y + floor(drawPoint.y)));
+                }
+            }
+
+            if (nil == lineBlock)
+                continue;
+
+            EQRenderFracStem *fracParent = (EQRenderFracStem *)[renderData getFractionBarParent];
+            if (nil != fracParent && fracParent.lineThickness > 0.0 && ![fracArray containsObject:fracParent])
+            {
+                [fracArray addObject:fracParent];
+                CGFloat lineY = lineOrigin.y + [self fractionBarYForStem:fracParent withData:renderData];
+                lineBlock(CGPointMake(lineOrigin.x + floor(fracParent.startLinePoint.x), lineY),
+                          CGPointMake(lineOrigin.x + floor(fracParent.endLinePoint.x), lineY), fracParent.lineThickness);
+            }
+
+            EQRenderStem *nRootParent = (EQRenderStem *)[renderData getNRootParent];
+            if (nil != nRootParent && nRootParent.hasOverline && ![nRootArray containsObject:nRootParent])
+            {
+                [nRootArray addObject:nRootParent];
+                for (NSArray *lineArray in [self radicalLinesForStem:nRootParent])
+                {
+                    CGPoint lineStart = [(NSValue *)lineArray[0] CGPointValue];
+                    CGPoint lineEnd = [(NSValue *)lineArray[1] CGPointValue];
+                    lineBlock(CGPointMake(lineOrigin.x + lineStart.x, lineOrigin.y + lineStart.y),
+                              CGPointMake(lineOrigin.x + lineEnd.x, lineOrigin.y + lineEnd.y), [(NSNumber *)lineArray[2] floatValue]);
+                }
+            }
+        }
+    }
+}
+
+// Returns NO only when the data belongs to a matrix cell that lies completely outside of the visible rect.
+- (BOOL)matrixCellIsVisibleForData: (EQRenderData *)renderData inRect: (CGRect)visibleRect withCellMap: (NSMapTable *)visibleCellMap
+{
+    if (CGRectIsNull(visibleRect) || CGRectIsInfinite(visibleRect))
+        return YES;
+
+    EQRenderStem *cellStem = [renderData getMatrixCellParent];
+    if (nil == cellStem)
+        return YES;
+
+    EQRenderStem *matrixStem = cellStem.parentStem.parentStem;
+    if (nil == matrixStem || ![matrixStem isKindOfClass:[EQRenderMatrixStem class]])
+        return YES;
+
+    NSSet *visibleCells = [visibleCellMap objectForKey:matrixStem];
+    if (nil == visibleCells)
+    {
+        // The grid is only stored after layout, so draw everything if it is missing.
+        if (nil == [(EQRenderMatrixStem *)matrixStem rowFrames])
+            return YES;
+
+        visibleCells = [(EQRenderMatrixStem *)matrixStem cellStemsIntersectingRect:visibleRect];
+        [visibleCellMap setObject:visibleCells forKey:matrixStem];
+    }
+
+    return [visibleCells containsObject:cellStem];
+}
+
+// Returns the draw string for the renderData with TTF fonts, converting and caching it if needed.
+- (NSAttributedString *)pdfStringForRenderData: (EQRenderData *)renderData
+{
+    NSAttributedString *pdfString = [self.pdfStringCache objectForKey:renderData];
+    if (nil == pdfString)
+    {
+        NSAttributedString *renderString = renderData.renderString;
+        if (renderData.hasStretchyCharacterData == YES)
+        {
+            renderString = [renderData renderStringWithStretchyCharacters];
+        }
+        pdfString = [EQRenderFontDictionary convertAttributedStringForPDF:renderString];
+        if (nil != pdfString)
+        {
+            [self.pdfStringCache setObject:pdfString forKey:renderData];
+        }
+    }
+    return pdfString;
+}
+
 // This method creates a CTLine for each attributed string and draws it at the given point.
 // It also automatically swaps fonts if you need to use TTF instead of OTF fonts.
 - (void)drawRenderString:(NSAttributedString *)renderString atPoint: (CGPoint)drawPoint inContext: (CGContextRef)context
 {
-    if (nil != renderString && renderString.length > 0)
+    NSAttributedString *useRenderString = renderString;
+    if (self.usePDFMode == YES)
+    {
+        useRenderString = [EQRenderFontDictionary convertAttributedStringForPDF:useRenderString];
+    }
+    [self drawConvertedString:useRenderString atPoint:drawPoint inContext:context];
+}
+
+// Same as above, but assumes the fonts have already been converted if needed.
+- (void)drawConvertedString:(NSAttributedString *)useRenderString atPoint: (CGPoint)drawPoint inContext: (CGContextRef)context
+{
+    if (nil != useRenderString && useRenderString.length > 0)
     {
-        NSAttributedString *useRenderString = renderString;
-        if (self.usePDFMode == YES)
-        {
-            useRenderString = [EQRenderFontDictionary convertAttributedStringForPDF:useRenderString];
-        }
         // Create CTLine from attributed string.
         CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)useRenderString);
         CGContextSaveGState(context);
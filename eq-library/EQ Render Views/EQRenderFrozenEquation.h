@@ -0,0 +1,53 @@
+//
+//  EQRenderFrozenEquation.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <CoreText/CoreText.h>
+#import "EQRenderEquation.h"
+
+typedef void (^EQFrozenGlyphRunBlock)(CTFontRef runFont, const CGGlyph *glyphs, const CGPoint *positions, NSUInteger glyphCount);
+
+// A read-only copy of a laid out equation that keeps only what is needed to draw it.
+// The glyph runs, glyph positions and rules are stored in flat arrays inside a single buffer.
+// None of the editing state is kept, and nothing changes after init, so it can be used from any thread without locking.
+// Points use the same unscaled, top-down coordinates as enumerateDrawElementsInContext:.
+
+@interface EQRenderFrozenEquation : NSObject
+
+@property (readonly, nonatomic) float pdfScale;
+@property (readonly, nonatomic) CGSize drawSize;
+@property (readonly, nonatomic) CGRect inkBounds;
+@property (readonly, nonatomic) EQInlineMetrics inlineMetrics;
+@property (readonly, nonatomic) NSUInteger glyphRunCount;
+@property (readonly, nonatomic) NSUInteger glyphCount;
+@property (readonly, nonatomic) NSUInteger ruleCount;
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation;
+
+// Returns nil if the data is not a valid frozen equation or one of its fonts is not available.
+- (id)initWithData: (NSData *)frozenData;
+- (NSData *)dataRepresentation;
+
+// Draws in a top-down context, such as a UIKit context, using the same rect as drawEquationLinesInRect:.
+- (void)drawInContext: (CGContextRef)context drawRect: (CGRect)drawRect;
+
+- (void)enumerateGlyphRunsUsingBlock: (EQFrozenGlyphRunBlock)runBlock;
+- (void)enumerateRulesUsingBlock: (EQRenderLineBlock)lineBlock;
+
+@end
@@ -0,0 +1,385 @@
+//
+//  EQRenderFrozenEquation.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import "EQRenderFrozenEquation.h"
+
+// The buffer stores the runs and rules first, then the positions, then the glyphs, so every array stays aligned.
+// Floats are used instead of CGFloat so the serialized data is the same on 32 and 64 bit devices.
+typedef struct
+{
+    uint32_t fontIndex;
+    uint32_t glyphStart;
+    uint32_t glyphCount;
+} EQFrozenGlyphRun;
+
+typedef struct
+{
+    float startX;
+    float startY;
+    float endX;
+    float endY;
+    float lineWidth;
+} EQFrozenRule;
+
+// The serialized data starts with this header, followed by the font table and then the buffer.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    float pdfScale;
+    float drawSize[2];
+    float inkBounds[4];
+    float inlineMetrics[5];
+    uint32_t fontCount;
+    uint32_t runCount;
+    uint32_t glyphCount;
+    uint32_t ruleCount;
+} EQFrozenHeader;
+
+static const uint32_t kFROZEN_MAGIC = 0x5A465145;
+static const uint32_t kFROZEN_VERSION = 1;
+
+static size_t EQFrozenBufferLength(NSUInteger runCount, NSUInteger glyphCount, NSUInteger ruleCount)
+{
+    return runCount * sizeof(EQFrozenGlyphRun) + ruleCount * sizeof(EQFrozenRule)
+        + glyphCount * 2 * sizeof(float) + glyphCount * sizeof(CGGlyph);
+}
+
+@interface EQRenderFrozenEquation()
+{
+    NSData *_bufferData;
+    NSArray *_fonts;
+    const EQFrozenGlyphRun *_runs;
+    const EQFrozenRule *_rules;
+    const float *_positions;
+    const CGGlyph *_glyphs;
+}
+
+- (void)setBufferData: (NSData *)bufferData;
+- (void)strokeRulesInContext: (CGContextRef)context;
+- (void)fillGlyphsInContext: (CGContextRef)context;
+
+@end
+
+@implementation EQRenderFrozenEquation
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        self->_pdfScale = 1.0;
+        self->_drawSize = CGSizeZero;
+        self->_inkBounds = CGRectNull;
+        self->_fonts = @[];
+        [self setBufferData:[NSData data]];
+    }
+    return self;
+}
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation
+{
+    self = [super init];
+    if (self)
+    {
+        if (nil == renderEquation)
+            return nil;
+
+        // Measuring the ink also lays out the equation if needed.
+        self->_inkBounds = [renderEquation inkBounds];
+        self->_pdfScale = renderEquation.pdfScale;
+        self->_drawSize = renderEquation.drawSize;
+        self->_inlineMetrics = renderEquation.inlineMetrics;
+
+        // Collect each section separately, then copy them into the single buffer.
+        NSMutableArray *fonts = [[NSMutableArray alloc] init];
+        NSMutableDictionary *fontIndexes = [[NSMutableDictionary alloc] init];
+        NSMutableData *runData = [[NSMutableData alloc] init];
+        NSMutableData *ruleData = [[NSMutableData alloc] init];
+        NSMutableData *positionData = [[NSMutableData alloc] init];
+        NSMutableData *glyphData = [[NSMutableData alloc] init];
+        __block uint32_t glyphTotal = 0;
+
+        CGContextRef measureContext = [EQRenderEquation createMeasureContext];
+        [renderEquation enumerateDrawElementsInContext:measureContext stringBlock:^(NSAttributedString *renderString, CGPoint drawPoint)
+        {
+            CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)renderString);
+            CFArrayRef runArray = CTLineGetGlyphRuns(line);
+            for (CFIndex i = 0; i < CFArrayGetCount(runArray); i ++)
+            {
+                CTRunRef run = (CTRunRef)CFArrayGetValueAtIndex(runArray, i);
+                CTFontRef runFont = (CTFontRef)CFDictionaryGetValue(CTRunGetAttributes(run), kCTFontAttributeName);
+                CFIndex runGlyphCount = CTRunGetGlyphCount(run);
+                if (NULL == runFont || runGlyphCount == 0 || ![EQRenderEquation shouldDrawRun:run])
+                    continue;
+
+                NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(runFont));
+                NSString *fontKey = [NSString stringWithFormat:@"%@|%.3f", fontName, CTFontGetSize(runFont)];
+                NSNumber *fontIndex = fontIndexes[fontKey];
+                if (nil == fontIndex)
+                {
+                    fontIndex = @(fonts.count);
+                    fontIndexes[fontKey] = fontIndex;
+                    [fonts addObject:(__bridge id)runFont];
+                }
+
+                CGGlyph glyphs[runGlyphCount];
+                CGPoint positions[runGlyphCount];
+                CTRunGetGlyphs(run, CFRangeMake(0, 0), glyphs);
+                CTRunGetPositions(run, CFRangeMake(0, 0), positions);
+                for (CFIndex j = 0; j < runGlyphCount; j ++)
+                {
+                    float glyphPoint[2] = {(float)(drawPoint.x + positions[j].x), (float)(drawPoint.y - positions[j].y)};
+                    [positionData appendBytes:glyphPoint length:sizeof(glyphPoint)];
+                }
+                [glyphData appendBytes:glyphs length:runGlyphCount * sizeof(CGGlyph)];
+
+                EQFrozenGlyphRun frozenRun = {fontIndex.unsignedIntValue, glyphTotal, (uint32_t)runGlyphCount};
+                [runData appendBytes:&frozenRun length:sizeof(frozenRun)];
+                glyphTotal += (uint32_t)runGlyphCount;
+            }
+            CFRelease(line);
+        }
+        lineBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+        {
+            EQFrozenRule frozenRule = {(float)startPoint.x, (float)startPoint.y, (float)endPoint.x, (float)endPoint.y, (float)lineWidth};
+            [ruleData appendBytes:&frozenRule length:sizeof(frozenRule)];
+        }];
+        CGContextRelease(measureContext);
+
+        NSMutableData *bufferData = [[NSMutableData alloc] initWithCapacity:(runData.length + ruleData.length + positionData.length + glyphData.length)];
+        [bufferData appendData:runData];
+        [bufferData appendData:ruleData];
+        [bufferData appendData:positionData];
+        [bufferData appendData:glyphData];
+
+        self->_fonts = [fonts copy];
+        self->_glyphRunCount = runData.length / sizeof(EQFrozenGlyphRun);
+        self->_ruleCount = ruleData.length / sizeof(EQFrozenRule);
+        self->_glyphCount = glyphTotal;
+        [self setBufferData:[bufferData copy]];
+    }
+    return self;
+}
+
+- (id)initWithData: (NSData *)frozenData
+{
+    self = [super init];
+    if (self)
+    {
+        EQFrozenHeader header;
+        if (nil == frozenData || frozenData.length < sizeof(header))
+            return nil;
+
+        [frozenData getBytes:&header length:sizeof(header)];
+        if (header.magic != kFROZEN_MAGIC || header.version != kFROZEN_VERSION)
+            return nil;
+
+        // Read the font table. Each entry is the size, the name length and the UTF8 PostScript name.
+        const uint8_t *bytes = frozenData.bytes;
+        NSUInteger dataLength = frozenData.length;
+        NSUInteger readOffset = sizeof(header);
+        NSMutableArray *fonts = [[NSMutableArray alloc] initWithCapacity:header.fontCount];
+        for (uint32_t i = 0; i < header.fontCount; i ++)
+        {
+            float fontSize = 0.0;
+            uint32_t nameLength = 0;
+            if (dataLength - readOffset < sizeof(fontSize) + sizeof(nameLength))
+                return nil;
+
+            memcpy(&fontSize, bytes + readOffset, sizeof(fontSize));
+            memcpy(&nameLength, bytes + readOffset + sizeof(fontSize), sizeof(nameLength));
+            readOffset += sizeof(fontSize) + sizeof(nameLength);
+            if (dataLength - readOffset < nameLength)
+                return nil;
+
+            NSString *fontName = [[NSString alloc] initWithBytes:(bytes + readOffset) length:nameLength encoding:NSUTF8StringEncoding];
+            readOffset += nameLength;
+            if (nil == fontName || fontSize <= 0.0)
+                return nil;
+
+            CTFontRef font = CTFontCreateWithName((__bridge CFStringRef)fontName, fontSize, NULL);
+            if (NULL == font)
+                return nil;
+            [fonts addObject:CFBridgingRelease(font)];
+        }
+
+        size_t bufferLength = EQFrozenBufferLength(header.runCount, header.glyphCount, header.ruleCount);
+        if (dataLength - readOffset != bufferLength)
+            return nil;
+
+        // Copy the buffer out so that it is aligned.
+        NSData *bufferData = [frozenData subdataWithRange:NSMakeRange(readOffset, bufferLength)];
+        const EQFrozenGlyphRun *runs = bufferData.bytes;
+        for (uint32_t i = 0; i < header.runCount; i ++)
+        {
+            if (runs[i].fontIndex >= header.fontCount || runs[i].glyphStart > header.glyphCount
+                || runs[i].glyphCount > header.glyphCount - runs[i].glyphStart)
+                return nil;
+        }
+
+        self->_pdfScale = header.pdfScale;
+        self->_drawSize = CGSizeMake(header.drawSize[0], header.drawSize[1]);
+        self->_inkBounds = (header.inkBounds[2] < 0.0) ? CGRectNull
+            : CGRectMake(header.inkBounds[0], header.inkBounds[1], header.inkBounds[2], header.inkBounds[3]);
+        EQInlineMetrics inlineMetrics = {header.inlineMetrics[0], header.inlineMetrics[1], header.inlineMetrics[2],
+            CGPointMake(header.inlineMetrics[3], header.inlineMetrics[4])};
+        self->_inlineMetrics = inlineMetrics;
+        self->_fonts = [fonts copy];
+        self->_glyphRunCount = header.runCount;
+        self->_glyphCount = header.glyphCount;
+        self->_ruleCount = header.ruleCount;
+        [self setBufferData:bufferData];
+    }
+    return self;
+}
+
+- (NSData *)dataRepresentation
+{
+    // A null ink rect is stored with a negative width.
+    CGRect inkBounds = CGRectIsNull(self.inkBounds) ? CGRectMake(0.0, 0.0, -1.0, -1.0) : self.inkBounds;
+    EQFrozenHeader header = {kFROZEN_MAGIC, kFROZEN_VERSION, self.pdfScale,
+        {(float)self.drawSize.width, (float)self.drawSize.height},
+        {(float)inkBounds.origin.x, (float)inkBounds.origin.y, (float)inkBounds.size.width, (float)inkBounds.size.height},
+        {(float)self.inlineMetrics.width, (float)self.inlineMetrics.ascent, (float)self.inlineMetrics.descent,
+            (float)self.inlineMetrics.baselineOrigin.x, (float)self.inlineMetrics.baselineOrigin.y},
+        (uint32_t)_fonts.count, (uint32_t)self.glyphRunCount, (uint32_t)self.glyphCount, (uint32_t)self.ruleCount};
+
+    NSMutableData *returnData = [[NSMutableData alloc] initWithBytes:&header length:sizeof(header)];
+    for (id font in _fonts)
+    {
+        CTFontRef useFont = (__bridge CTFontRef)font;
+        NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(useFont));
+        NSData *nameData = [fontName dataUsingEncoding:NSUTF8StringEncoding];
+        float fontSize = (float)CTFontGetSize(useFont);
+        uint32_t nameLength = (uint32_t)nameData.length;
+        [returnData appendBytes:&fontSize length:sizeof(fontSize)];
+        [returnData appendBytes:&nameLength length:sizeof(nameLength)];
+        [returnData appendData:nameData];
+    }
+    [returnData appendData:_bufferData];
+
+    return returnData;
+}
+
+- (void)setBufferData: (NSData *)bufferData
+{
+    const uint8_t *bytes = bufferData.bytes;
+    self->_bufferData = bufferData;
+    self->_runs = (const EQFrozenGlyphRun *)bytes;
+    bytes += self->_glyphRunCount * sizeof(EQFrozenGlyphRun);
+    self->_rules = (const EQFrozenRule *)bytes;
+    bytes += self->_ruleCount * sizeof(EQFrozenRule);
+    self->_positions = (const float *)bytes;
+    bytes += self->_glyphCount * 2 * sizeof(float);
+    self->_glyphs = (const CGGlyph *)bytes;
+}
+
+/*********************************
+ Drawing methods.
+ *********************************/
+
+- (void)drawInContext: (CGContextRef)context drawRect: (CGRect)drawRect
+{
+    if (NULL == context)
+        return;
+
+    CGContextSaveGState(context);
+    CGContextTranslateCTM(context, drawRect.origin.x, drawRect.origin.y);
+    CGContextScaleCTM(context, self.pdfScale, self.pdfScale);
+    CGContextSetShouldAntialias(context, YES);
+    CGContextSetRGBFillColor(context, 0.0, 0.0, 0.0, 1.0);
+    CGContextSetRGBStrokeColor(context, 0.0, 0.0, 0.0, 1.0);
+
+    [self strokeRulesInContext:context];
+    [self fillGlyphsInContext:context];
+
+    CGContextRestoreGState(context);
+}
+
+- (void)strokeRulesInContext: (CGContextRef)context
+{
+    [self enumerateRulesUsingBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+    {
+        CGContextBeginPath(context);
+        CGContextMoveToPoint(context, startPoint.x, startPoint.y);
+        CGContextAddLineToPoint(context, endPoint.x, endPoint.y);
+        CGContextSetLineWidth(context, lineWidth);
+        CGContextStrokePath(context);
+    }];
+}
+
+// Glyphs are drawn bottom-up, so flip the context and the y positions.
+- (void)fillGlyphsInContext: (CGContextRef)context
+{
+    CGContextSaveGState(context);
+    CGContextScaleCTM(context, 1.0, -1.0);
+    CGContextSetTextMatrix(context, CGAffineTransformIdentity);
+
+    [self enumerateGlyphRunsUsingBlock:^(CTFontRef runFont, const CGGlyph *glyphs, const CGPoint *positions, NSUInteger glyphCount)
+    {
+        CGPoint flippedPositions[glyphCount];
+        for (NSUInteger i = 0; i < glyphCount; i ++)
+        {
+            flippedPositions[i] = CGPointMake(positions[i].x, -positions[i].y);
+        }
+        CTFontDrawGlyphs(runFont, glyphs, flippedPositions, glyphCount, context);
+    }];
+
+    CGContextRestoreGState(context);
+}
+
+/*********************************
+ Enumeration methods.
+ *********************************/
+
+// Positions are converted to CGPoints one run at a time.
+- (void)enumerateGlyphRunsUsingBlock: (EQFrozenGlyphRunBlock)runBlock
+{
+    if (nil == runBlock)
+        return;
+
+    for (NSUInteger i = 0; i < self.glyphRunCount; i ++)
+    {
+        EQFrozenGlyphRun frozenRun = _runs[i];
+        if (frozenRun.glyphCount == 0)
+            continue;
+
+        CGPoint positions[frozenRun.glyphCount];
+        const float *runPositions = _positions + 2 * frozenRun.glyphStart;
+        for (uint32_t j = 0; j < frozenRun.glyphCount; j ++)
+        {
+            positions[j] = CGPointMake(runPositions[2 * j], runPositions[2 * j + 1]);
+        }
+        runBlock((__bridge CTFontRef)_fonts[frozenRun.fontIndex], _glyphs + frozenRun.glyphStart, positions, frozenRun.glyphCount);
+    }
+}
+
+- (void)enumerateRulesUsingBlock: (EQRenderLineBlock)lineBlock
+{
+    if (nil == lineBlock)
+        return;
+
+    for (NSUInteger i = 0; i < self.ruleCount; i ++)
+    {
+        EQFrozenRule frozenRule = _rules[i];
+        lineBlock(CGPointMake(frozenRule.startX, frozenRule.startY), CGPointMake(frozenRule.endX, frozenRule.endY), frozenRule.lineWidth);
+    }
+}
+
+@end
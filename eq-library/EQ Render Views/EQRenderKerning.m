@@ -0,0 +1,321 @@
+//
+//  EQRenderKerning.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <UIKit/UIKit.h>
+#import "EQRenderKerning.h"
+#import "EQRenderTypesetter.h"
+#import "EQRenderFontDictionary.h"
+
+// Character classes used by the kerning rules.
+enum
+{
+    kKernClassNumeral = 1 << 0,
+    kKernClassWhitespace = 1 << 1,
+    kKernClassDecimal = 1 << 2,
+    kKernClassComma = 1 << 3,
+    kKernClassUnary = 1 << 4,
+    kKernClassLeftBracket = 1 << 5,
+    kKernClassRightBracket = 1 << 6,
+    kKernClassTrailing = 1 << 7,
+    kKernClassItalicF = 1 << 8,
+    kKernClassDerivative = 1 << 9,
+};
+
+// The classes of every BMP character, built once from the typesetter's character sets.
+static uint16_t sKernClassTable[65536];
+
+// The state carried from the character on the right.
+typedef struct
+{
+    BOOL previousWasDecimal;
+    BOOL previousWasNumeral;
+    BOOL previousWasWhitespace;
+    BOOL previousWasTrailingCharacter;
+    BOOL previousWasRightBracket;
+    BOOL previousWasDeriv;
+} EQKernState;
+
+// The attributes of a character that the rules depend on.
+typedef struct
+{
+    uint16_t kernClass;
+    BOOL usesPlainText;
+    BOOL usesDefaultFont;
+    CGFloat fontSize;
+    BOOL isLastCharacter;
+} EQKernInput;
+
+static const CGFloat kNO_KERN_VALUE = -1.0;
+
+// Runs one step of the kerning rules and returns the kern value, or kNO_KERN_VALUE if the kerning should be left alone.
+static CGFloat EQKernStep(EQKernState *state, EQKernInput input)
+{
+    uint16_t kernClass = input.kernClass;
+    BOOL currentIsNumeral = (kernClass & kKernClassNumeral) != 0;
+
+    // If you have a plain text string, then just reset everything and move on.
+    if (input.usesPlainText)
+    {
+        EQKernState emptyState = {NO, NO, NO, NO, NO, NO};
+        *state = emptyState;
+        return kNO_KERN_VALUE;
+    }
+
+    CGFloat kernValue = kNO_KERN_VALUE;
+    if (kernClass & kKernClassDecimal)
+    {
+        kernValue = state->previousWasNumeral ? 0.0 : 3.0;
+        state->previousWasDecimal = YES;
+        state->previousWasDeriv = NO;
+    }
+    else if ((kernClass & kKernClassComma) && !state->previousWasNumeral && !state->previousWasDecimal && !state->previousWasWhitespace)
+    {
+        kernValue = 4.0;
+        state->previousWasDecimal = NO;
+        state->previousWasDeriv = NO;
+    }
+    else if (kernClass & kKernClassUnary)
+    {
+        if (!state->previousWasWhitespace)
+            kernValue = 3.0;
+        state->previousWasDecimal = NO;
+        state->previousWasDeriv = NO;
+    }
+    else if (kernClass & kKernClassLeftBracket)
+    {
+        if (state->previousWasTrailingCharacter)
+            kernValue = 6.0;
+        else if (!state->previousWasWhitespace)
+            kernValue = 3.0;
+        state->previousWasDecimal = NO;
+        state->previousWasDeriv = NO;
+    }
+    else if (currentIsNumeral)
+    {
+        kernValue = 0.0;
+        if (state->previousWasDecimal)
+        {
+            kernValue = 2.0;
+        }
+        else if (!state->previousWasNumeral)
+        {
+            kernValue = input.isLastCharacter ? 1.5 : 3.0;
+        }
+        state->previousWasDecimal = NO;
+        state->previousWasDeriv = NO;
+    }
+    // Need to handle italic "f" differently.
+    else if ((kernClass & kKernClassItalicF) && !state->previousWasWhitespace)
+    {
+        kernValue = 3.0;
+        state->previousWasDecimal = NO;
+        state->previousWasDeriv = NO;
+    }
+    else if (state->previousWasDeriv)
+    {
+        kernValue = 6.0;
+        state->previousWasDecimal = NO;
+        state->previousWasDeriv = NO;
+    }
+    else
+    {
+        // Larger characters keep their size and kerning.
+        if (input.fontSize <= kDEFAULT_FONT_SIZE)
+        {
+            kernValue = 1.5;
+            // Check if your character is near a right bracket (and is not one itself).
+            if (state->previousWasRightBracket && !(kernClass & kKernClassRightBracket))
+            {
+                kernValue = 3.0;
+            }
+            state->previousWasDecimal = NO;
+        }
+        state->previousWasDeriv = (kernClass & kKernClassDerivative) && input.usesDefaultFont;
+    }
+
+    state->previousWasNumeral = currentIsNumeral;
+    state->previousWasWhitespace = (kernClass & kKernClassWhitespace) != 0;
+    state->previousWasTrailingCharacter = (kernClass & kKernClassTrailing) != 0;
+    state->previousWasRightBracket = (kernClass & kKernClassRightBracket) != 0;
+
+    return kernValue;
+}
+
+// Returns YES if the state after this character doesn't depend on the state before it.
+// Scanning can stop at these characters, as nothing to their left can be affected by an edit on their right.
+static BOOL EQKernInputResetsState(EQKernInput input)
+{
+    if (input.usesPlainText)
+        return YES;
+
+    uint16_t resetClasses = kKernClassDecimal | kKernClassUnary | kKernClassLeftBracket | kKernClassNumeral;
+    if (input.kernClass & resetClasses)
+        return YES;
+
+    // Larger characters pass the decimal state along and the derivative state depends on the branch taken.
+    BOOL isDerivative = (input.kernClass & kKernClassDerivative) && input.usesDefaultFont;
+    return (input.fontSize <= kDEFAULT_FONT_SIZE && !isDerivative);
+}
+
+@interface EQRenderKerning()
+
++ (void)buildKernClassTable;
++ (uint16_t)kernClassForString: (NSString *)string inRange: (NSRange)charRange;
+
+@end
+
+@implementation EQRenderKerning
+
++ (void)buildKernClassTable
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *numeralSet = [NSCharacterSet decimalDigitCharacterSet];
+        NSCharacterSet *whitespaceSet = [NSCharacterSet whitespaceCharacterSet];
+        for (NSUInteger i = 0; i < 65536; i ++)
+        {
+            uint16_t kernClass = 0;
+            if ([numeralSet characterIsMember:(unichar)i])
+                kernClass |= kKernClassNumeral;
+            if ([whitespaceSet characterIsMember:(unichar)i])
+                kernClass |= kKernClassWhitespace;
+            sKernClassTable[i] = kernClass;
+        }
+
+        // Only single characters can match the sets, so longer strings are ignored.
+        NSArray *classSets = @[[[EQRenderTypesetter getUnaryOperators] allKeys], [EQRenderTypesetter getLeftBracketCharacters],
+                               [EQRenderTypesetter getRightBracketCharacters], [EQRenderTypesetter getTrailingCharacters]];
+        uint16_t setClasses[] = {kKernClassUnary, kKernClassLeftBracket, kKernClassRightBracket, kKernClassTrailing};
+        for (NSUInteger i = 0; i < classSets.count; i ++)
+        {
+            for (NSString *testString in classSets[i])
+            {
+                if (testString.length == 1)
+                {
+                    sKernClassTable[[testString characterAtIndex:0]] |= setClasses[i];
+                }
+            }
+        }
+
+        sKernClassTable['.'] |= kKernClassDecimal;
+        sKernClassTable[','] |= kKernClassComma;
+        sKernClassTable['f'] |= kKernClassItalicF;
+        sKernClassTable['d'] |= kKernClassDerivative;
+        sKernClassTable[0x2202] |= kKernClassDerivative; // ∂
+    });
+}
+
+// Composed character sequences are almost always a single character, so those only need the table.
++ (uint16_t)kernClassForString: (NSString *)string inRange: (NSRange)charRange
+{
+    if (charRange.length == 1)
+        return sKernClassTable[[string characterAtIndex:charRange.location]];
+
+    NSString *subString = [string substringWithRange:charRange];
+    uint16_t kernClass = 0;
+    if ([subString rangeOfCharacterFromSet:[NSCharacterSet decimalDigitCharacterSet]].location != NSNotFound)
+        kernClass |= kKernClassNumeral;
+    if ([subString rangeOfCharacterFromSet:[NSCharacterSet whitespaceCharacterSet]].location != NSNotFound)
+        kernClass |= kKernClassWhitespace;
+    return kernClass;
+}
+
++ (void)kernMathInAttributedString: (NSMutableAttributedString *)inputString
+{
+    if (nil == inputString || inputString.length == 0)
+        return;
+
+    [self kernMathInAttributedString:inputString editedRange:NSMakeRange(0, inputString.length)];
+}
+
++ (void)kernMathInAttributedString: (NSMutableAttributedString *)inputString editedRange: (NSRange)editedRange
+{
+    if (nil == inputString || inputString.length == 0 || editedRange.location == NSNotFound)
+        return;
+
+    [self buildKernClassTable];
+
+    NSString *string = inputString.string;
+    NSUInteger stringLength = string.length;
+    NSUInteger startIndex = MIN(editedRange.location, stringLength);
+    NSUInteger endIndex = MIN(NSMaxRange(editedRange), stringLength);
+
+    // Attributes are read once per attribute run.
+    __block NSDictionary *runAttributes = nil;
+    __block NSRange runRange = NSMakeRange(NSNotFound, 0);
+    EQKernInput (^inputForRange)(NSRange) = ^EQKernInput(NSRange charRange)
+    {
+        if (runRange.location == NSNotFound || !NSLocationInRange(charRange.location, runRange))
+        {
+            runAttributes = [inputString attributesAtIndex:charRange.location effectiveRange:&runRange];
+        }
+        UIFont *testFont = runAttributes[NSFontAttributeName];
+        EQKernInput input;
+        input.kernClass = [self kernClassForString:string inRange:charRange];
+        input.usesPlainText = [(NSNumber *)runAttributes[kUSES_PLAIN_TEXT] boolValue];
+        input.usesDefaultFont = [testFont.fontName isEqualToString:kDEFAULT_FONT];
+        input.fontSize = testFont.pointSize;
+        input.isLastCharacter = (charRange.location >= stringLength - 1);
+        return input;
+    };
+
+    // Find the state coming in from the right of the edited range.
+    // Walk right to the nearest character that resets the state, then run the rules back without changing anything.
+    NSMutableArray *rightRanges = [[NSMutableArray alloc] init];
+    EQKernState kernState = {NO, NO, NO, NO, NO, NO};
+    NSUInteger scanIndex = endIndex;
+    while (scanIndex < stringLength)
+    {
+        NSRange charRange = [string rangeOfComposedCharacterSequenceAtIndex:scanIndex];
+        [rightRanges addObject:[NSValue valueWithRange:charRange]];
+        if (EQKernInputResetsState(inputForRange(charRange)))
+            break;
+        scanIndex = NSMaxRange(charRange);
+    }
+    for (NSValue *rangeValue in rightRanges.reverseObjectEnumerator)
+    {
+        EQKernStep(&kernState, inputForRange(rangeValue.rangeValue));
+    }
+
+    // Kern the edited range, then continue left until the state no longer depends on the edit.
+    NSUInteger curIndex = endIndex;
+    while (curIndex > 0)
+    {
+        NSRange charRange = [string rangeOfComposedCharacterSequenceAtIndex:(curIndex - 1)];
+        EQKernInput input = inputForRange(charRange);
+        CGFloat kernValue = EQKernStep(&kernState, input);
+        if (kernValue != kNO_KERN_VALUE)
+        {
+            NSNumber *storedKern = runAttributes[NSKernAttributeName];
+            if (nil == storedKern || storedKern.floatValue != (float)kernValue)
+            {
+                // Swap in the shared dictionary for the new style instead of adding to a private copy.
+                NSMutableDictionary *kernAttributes = [runAttributes mutableCopy];
+                kernAttributes[NSKernAttributeName] = @((float)kernValue);
+                [inputString setAttributes:[EQRenderFontDictionary sharedAttributes:kernAttributes] range:charRange];
+                runRange = NSMakeRange(NSNotFound, 0);
+            }
+        }
+        curIndex = charRange.location;
+
+        if (charRange.location < startIndex && EQKernInputResetsState(input))
+            break;
+    }
+}
+
+@end
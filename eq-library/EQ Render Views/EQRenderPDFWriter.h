@@ -0,0 +1,52 @@
+//
+//  EQRenderPDFWriter.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import "EQRenderEquation.h"
+
+// This class writes laid out equations straight into a PDF document without a CoreGraphics PDF context.
+// Fonts are collected across every equation in the document and written once when the data is requested,
+// so each font only embeds the glyphs that were used and all of the pages share the same font objects.
+// Fonts with TrueType outlines are embedded as subsetted CID fonts and other fonts are written as Type 3 glyph outlines.
+
+@interface EQRenderPDFWriter : NSObject
+
+// Swap the STIX OTF fonts for their TTF versions before writing, as usePDFMode does. Defaults to YES.
+@property (nonatomic) BOOL useTrueTypeFonts;
+
+// Compress the content and font streams. Defaults to YES.
+@property (nonatomic) BOOL compressStreams;
+
+@property (readonly) NSUInteger pageCount;
+
+// Page sizes and draw rects are in points with a top left origin.
+- (void)beginPageWithSize: (CGSize)pageSize;
+
+// Matches drawEquationLinesInRect:, so the equation is drawn at the rect origin and scaled by its pdfScale.
+// Starts a page the size of the rect if you haven't started one yet.
+- (void)addRenderEquation: (EQRenderEquation *)renderEquation inRect: (CGRect)drawRect;
+
+// Adds a page sized to fit the equation, with the same margins as the SVG exporter.
+- (void)addPageWithRenderEquation: (EQRenderEquation *)renderEquation;
+
+// Returns nil if there are no pages.
+- (NSData *)pdfData;
+
++ (NSData *)pdfDataWithRenderEquation: (EQRenderEquation *)renderEquation;
+
+@end
@@ -0,0 +1,767 @@
+//
+//  EQRenderPDFWriter.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <UIKit/UIKit.h>
+#import <CoreText/CoreText.h>
+#import <zlib.h>
+#import "EQRenderPDFWriter.h"
+#import "EQRenderFontDictionary.h"
+#import "EQTrueTypeSubsetter.h"
+
+// Type 3 fonts use single byte codes, so large subsets are split across several fonts.
+static const NSUInteger kPDF_TYPE3_CODE_COUNT = 256;
+
+// Glyph widths and outlines are written in 1/1000 of the font size.
+static const CGFloat kPDF_GLYPH_UNITS = 1000.0;
+
+// The catalog, page tree and shared resources always use the first three object numbers.
+static const NSUInteger kPDF_CATALOG_OBJECT = 1;
+static const NSUInteger kPDF_PAGES_OBJECT = 2;
+static const NSUInteger kPDF_RESOURCES_OBJECT = 3;
+
+// Stores the glyphs used from a single font, or from one 256 glyph part of a Type 3 font.
+@interface EQPDFFontRecord : NSObject
+{
+    CTFontRef unitFont;
+}
+
+@property (strong, nonatomic) NSString *fontName;
+@property (strong, nonatomic) NSString *resourceName;
+@property (nonatomic) BOOL isTrueType;
+@property (strong, nonatomic) NSMutableIndexSet *usedGlyphs;
+@property (strong, nonatomic) NSMutableDictionary *glyphWidths;
+@property (strong, nonatomic) NSMutableDictionary *codeUnicodes;
+@property (strong, nonatomic) NSMutableArray *type3Glyphs;
+@property (strong, nonatomic) NSMutableDictionary *type3Codes;
+
+- (id)initWithFont: (CTFontRef)font resourceName: (NSString *)resourceName isTrueType: (BOOL)isTrueType;
+- (CTFontRef)unitFont;
+- (CGFloat)widthForGlyph: (CGGlyph)glyph;
+
+// Returns NSNotFound when a Type 3 record has no codes left.
+- (NSUInteger)codeForGlyph: (CGGlyph)glyph unicode: (NSString *)unicode;
+
+@end
+
+@implementation EQPDFFontRecord
+
+- (id)initWithFont: (CTFontRef)font resourceName: (NSString *)resourceName isTrueType: (BOOL)isTrueType
+{
+    self = [super init];
+    if (self)
+    {
+        // Metrics and outlines are read at 1000 points so they are already in glyph units.
+        self->unitFont = CTFontCreateCopyWithAttributes(font, kPDF_GLYPH_UNITS, NULL, NULL);
+        self->_fontName = CFBridgingRelease(CTFontCopyPostScriptName(font));
+        self->_resourceName = resourceName;
+        self->_isTrueType = isTrueType;
+        self->_usedGlyphs = [[NSMutableIndexSet alloc] init];
+        self->_glyphWidths = [[NSMutableDictionary alloc] init];
+        self->_codeUnicodes = [[NSMutableDictionary alloc] init];
+        self->_type3Glyphs = [[NSMutableArray alloc] init];
+        self->_type3Codes = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (NULL != self->unitFont)
+    {
+        CFRelease(self->unitFont);
+    }
+}
+
+- (CTFontRef)unitFont
+{
+    return self->unitFont;
+}
+
+- (CGFloat)widthForGlyph: (CGGlyph)glyph
+{
+    NSNumber *storedWidth = self.glyphWidths[@(glyph)];
+    if (nil == storedWidth)
+    {
+        CGSize glyphAdvance = CGSizeZero;
+        CTFontGetAdvancesForGlyphs(self->unitFont, kCTFontOrientationHorizontal, &glyph, &glyphAdvance, 1);
+        storedWidth = @(round(glyphAdvance.width));
+        self.glyphWidths[@(glyph)] = storedWidth;
+    }
+    return storedWidth.floatValue;
+}
+
+- (NSUInteger)codeForGlyph: (CGGlyph)glyph unicode: (NSString *)unicode
+{
+    NSUInteger glyphCode = glyph;
+    if (self.isTrueType == NO)
+    {
+        NSNumber *storedCode = self.type3Codes[@(glyph)];
+        if (nil == storedCode)
+        {
+            if (self.type3Glyphs.count >= kPDF_TYPE3_CODE_COUNT)
+                return NSNotFound;
+
+            storedCode = @(self.type3Glyphs.count);
+            self.type3Codes[@(glyph)] = storedCode;
+            [self.type3Glyphs addObject:@(glyph)];
+        }
+        glyphCode = storedCode.unsignedIntegerValue;
+    }
+
+    [self.usedGlyphs addIndex:glyph];
+    if (nil != unicode && nil == self.codeUnicodes[@(glyphCode)])
+    {
+        self.codeUnicodes[@(glyphCode)] = unicode;
+    }
+
+    return glyphCode;
+}
+
+@end
+
+// Collects the PDF path operators for a glyph outline.
+// PDF has no quadratic curves, so those are raised to cubic curves.
+typedef struct
+{
+    __unsafe_unretained NSMutableString *pathString;
+    CGPoint currentPoint;
+    CGPoint startPoint;
+} EQPDFPathInfo;
+
+static void EQAppendPDFPathElement(void *info, const CGPathElement *element)
+{
+    EQPDFPathInfo *pathInfo = (EQPDFPathInfo *)info;
+    NSMutableString *pathString = pathInfo->pathString;
+    CGPoint *points = element->points;
+
+    switch (element->type)
+    {
+        case kCGPathElementMoveToPoint:
+            [pathString appendFormat:@"%.1f %.1f m\n", points[0].x, points[0].y];
+            pathInfo->currentPoint = points[0];
+            pathInfo->startPoint = points[0];
+            break;
+        case kCGPathElementAddLineToPoint:
+            [pathString appendFormat:@"%.1f %.1f l\n", points[0].x, points[0].y];
+            pathInfo->currentPoint = points[0];
+            break;
+        case kCGPathElementAddQuadCurveToPoint:
+        {
+            CGPoint startPoint = pathInfo->currentPoint;
+            CGPoint controlOne = CGPointMake(startPoint.x + 2.0 / 3.0 * (points[0].x - startPoint.x),
+                                             startPoint.y + 2.0 / 3.0 * (points[0].y - startPoint.y));
+            CGPoint controlTwo = CGPointMake(points[1].x + 2.0 / 3.0 * (points[0].x - points[1].x),
+                                             points[1].y + 2.0 / 3.0 * (points[0].y - points[1].y));
+            [pathString appendFormat:@"%.1f %.1f %.1f %.1f %.1f %.1f c\n", controlOne.x, controlOne.y,
+                                     controlTwo.x, controlTwo.y, points[1].x, points[1].y];
+            pathInfo->currentPoint = points[1];
+            break;
+        }
+        case kCGPathElementAddCurveToPoint:
+            [pathString appendFormat:@"%.1f %.1f %.1f %.1f %.1f %.1f c\n", points[0].x, points[0].y,
+                                     points[1].x, points[1].y, points[2].x, points[2].y];
+            pathInfo->currentPoint = points[2];
+            break;
+        case kCGPathElementCloseSubpath:
+            [pathString appendString:@"h\n"];
+            pathInfo->currentPoint = pathInfo->startPoint;
+            break;
+    }
+}
+
+// Escapes the characters that are not allowed in a PDF name.
+static NSString *EQPDFNameString(NSString *inputStr)
+{
+    NSMutableString *returnStr = [[NSMutableString alloc] init];
+    NSData *nameData = [inputStr dataUsingEncoding:NSUTF8StringEncoding];
+    const uint8_t *nameBytes = nameData.bytes;
+    for (NSUInteger i = 0; i < nameData.length; i++)
+    {
+        uint8_t nameByte = nameBytes[i];
+        if (nameByte < 0x21 || nameByte > 0x7E || strchr("#()<>[]{}/%", nameByte) != NULL)
+        {
+            [returnStr appendFormat:@"#%02X", nameByte];
+        }
+        else
+        {
+            [returnStr appendFormat:@"%c", nameByte];
+        }
+    }
+    return returnStr;
+}
+
+static NSData *EQDeflateData(NSData *inputData)
+{
+    uLongf compressedLength = compressBound((uLong)inputData.length);
+    NSMutableData *compressedData = [[NSMutableData alloc] initWithLength:compressedLength];
+    if (compress2(compressedData.mutableBytes, &compressedLength, inputData.bytes, (uLong)inputData.length, Z_BEST_COMPRESSION) != Z_OK)
+        return nil;
+
+    compressedData.length = compressedLength;
+    return compressedData;
+}
+
+@interface EQRenderPDFWriter()
+{
+    NSMutableArray *pageSizes;
+    NSMutableArray *pageContents;
+    NSMutableDictionary *fontRecords;
+    NSMutableArray *fontRecordOrder;
+    NSMutableDictionary *trueTypeFontNames;
+}
+
+- (void)appendString: (NSAttributedString *)renderString atPoint: (CGPoint)drawPoint toContent: (NSMutableString *)content;
+- (NSAttributedString *)trueTypeStringForString: (NSAttributedString *)renderString;
+- (BOOL)fontUsesTrueTypeOutlines: (CTFontRef)font;
+- (EQPDFFontRecord *)fontRecordForFont: (CTFontRef)font glyph: (CGGlyph)glyph unicode: (NSString *)unicode code: (NSUInteger *)glyphCode;
+
+- (NSUInteger)addObjectString: (NSString *)objectString toObjects: (NSMutableArray *)objects;
+- (NSUInteger)addStreamWithData: (NSData *)streamData dictionary: (NSString *)dictString toObjects: (NSMutableArray *)objects;
+- (NSUInteger)addTrueTypeFontForRecord: (EQPDFFontRecord *)fontRecord toObjects: (NSMutableArray *)objects;
+- (NSUInteger)addType3FontForRecord: (EQPDFFontRecord *)fontRecord toObjects: (NSMutableArray *)objects;
+- (NSString *)toUnicodeCMapForRecord: (EQPDFFontRecord *)fontRecord codeLength: (NSUInteger)codeLength;
+- (NSString *)subsetTagForRecord: (EQPDFFontRecord *)fontRecord;
+
+@end
+
+@implementation EQRenderPDFWriter
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        self->_useTrueTypeFonts = YES;
+        self->_compressStreams = YES;
+        self->pageSizes = [[NSMutableArray alloc] init];
+        self->pageContents = [[NSMutableArray alloc] init];
+        self->fontRecords = [[NSMutableDictionary alloc] init];
+        self->fontRecordOrder = [[NSMutableArray alloc] init];
+        self->trueTypeFontNames = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
++ (NSData *)pdfDataWithRenderEquation: (EQRenderEquation *)renderEquation
+{
+    EQRenderPDFWriter *pdfWriter = [[EQRenderPDFWriter alloc] init];
+    [pdfWriter addPageWithRenderEquation:renderEquation];
+    return [pdfWriter pdfData];
+}
+
+- (NSUInteger)pageCount
+{
+    return self->pageContents.count;
+}
+
+// The page content is flipped so that everything after it can use the same top down points as the layout.
+- (void)beginPageWithSize: (CGSize)pageSize
+{
+    [self->pageSizes addObject:[NSValue valueWithCGSize:pageSize]];
+    NSMutableString *content = [[NSMutableString alloc] init];
+    [content appendFormat:@"q\n1 0 0 -1 0 %.3f cm\n0 g\n0 G\n", pageSize.height];
+    [self->pageContents addObject:content];
+}
+
+- (void)addRenderEquation: (EQRenderEquation *)renderEquation inRect: (CGRect)drawRect
+{
+    if (nil == renderEquation || nil == renderEquation.equationLines || renderEquation.equationLines.count == 0)
+        return;
+
+    if (self->pageContents.count == 0)
+    {
+        [self beginPageWithSize:drawRect.size];
+    }
+
+    // Stretchy bracers measure their glyphs against a context, but nothing is drawn into it.
+    CGContextRef measureContext = [EQRenderEquation createMeasureContext];
+    if (NULL == measureContext)
+        return;
+
+    NSMutableString *content = self->pageContents.lastObject;
+    CGFloat useScale = renderEquation.pdfScale;
+    [content appendFormat:@"q\n%.4f 0 0 %.4f %.3f %.3f cm\n", useScale, useScale, drawRect.origin.x, drawRect.origin.y];
+
+    [renderEquation enumerateDrawElementsInContext:measureContext stringBlock:^(NSAttributedString *renderString, CGPoint drawPoint)
+    {
+        [self appendString:renderString atPoint:drawPoint toContent:content];
+    }
+    lineBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+    {
+        [content appendFormat:@"%.3f w %.3f %.3f m %.3f %.3f l S\n", lineWidth, startPoint.x, startPoint.y, endPoint.x, endPoint.y];
+    }];
+    CGContextRelease(measureContext);
+
+    [content appendString:@"Q\n"];
+}
+
+- (void)addPageWithRenderEquation: (EQRenderEquation *)renderEquation
+{
+    if (nil == renderEquation || nil == renderEquation.equationLines || renderEquation.equationLines.count == 0)
+        return;
+
+    if (CGSizeEqualToSize(renderEquation.drawSize, CGSizeZero))
+    {
+        [renderEquation layoutEquationLines];
+    }
+
+    // Leave the same margins as the draw offsets on each side.
+    CGFloat useScale = renderEquation.pdfScale;
+    CGSize pageSize = renderEquation.drawSize;
+    pageSize.width = ceil((pageSize.width + 60.0) * useScale);
+    pageSize.height = ceil((pageSize.height + 60.0) * useScale);
+
+    [self beginPageWithSize:pageSize];
+    [self addRenderEquation:renderEquation inRect:CGRectMake(0.0, 0.0, pageSize.width, pageSize.height)];
+}
+
+// Each run gets its own text object. The text matrix flips the glyphs back upright inside the flipped page,
+// and the TJ adjustments move each glyph from the font's advance to the position CoreText laid it out at.
+- (void)appendString: (NSAttributedString *)renderString atPoint: (CGPoint)drawPoint toContent: (NSMutableString *)content
+{
+    if (nil == renderString || renderString.length == 0)
+        return;
+
+    NSAttributedString *useString = self.useTrueTypeFonts ? [self trueTypeStringForString:renderString] : renderString;
+    CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)useString);
+    CFArrayRef runArray = CTLineGetGlyphRuns(line);
+
+    for (CFIndex i = 0; i < CFArrayGetCount(runArray); i ++)
+    {
+        CTRunRef run = (CTRunRef)CFArrayGetValueAtIndex(runArray, i);
+        CTFontRef runFont = (CTFontRef)CFDictionaryGetValue(CTRunGetAttributes(run), kCTFontAttributeName);
+        CFIndex glyphCount = CTRunGetGlyphCount(run);
+        if (NULL == runFont || glyphCount == 0 || ![EQRenderEquation shouldDrawRun:run])
+            continue;
+
+        CGGlyph glyphs[glyphCount];
+        CGPoint positions[glyphCount];
+        CFIndex stringIndices[glyphCount];
+        CTRunGetGlyphs(run, CFRangeMake(0, 0), glyphs);
+        CTRunGetPositions(run, CFRangeMake(0, 0), positions);
+        CTRunGetStringIndices(run, CFRangeMake(0, 0), stringIndices);
+
+        CGFloat fontSize = CTFontGetSize(runFont);
+        if (fontSize <= 0.0)
+            continue;
+
+        EQPDFFontRecord *currentRecord = nil;
+        BOOL isArrayOpen = NO;
+        CGFloat currentY = 0.0;
+        CGFloat expectedX = 0.0;
+
+        [content appendString:@"BT\n"];
+        for (CFIndex j = 0; j < glyphCount; j ++)
+        {
+            NSString *unicode = nil;
+            if (stringIndices[j] >= 0 && (NSUInteger)stringIndices[j] < useString.length)
+            {
+                NSRange charRange = [useString.string rangeOfComposedCharacterSequenceAtIndex:(NSUInteger)stringIndices[j]];
+                unicode = [useString.string substringWithRange:charRange];
+            }
+
+            NSUInteger glyphCode = 0;
+            EQPDFFontRecord *fontRecord = [self fontRecordForFont:runFont glyph:glyphs[j] unicode:unicode code:&glyphCode];
+            if (nil == fontRecord)
+                continue;
+
+            CGFloat glyphX = drawPoint.x + positions[j].x;
+            CGFloat glyphY = drawPoint.y - positions[j].y;
+            if (fontRecord != currentRecord || isArrayOpen == NO || ABS(glyphY - currentY) > 0.001)
+            {
+                if (isArrayOpen)
+                {
+                    [content appendString:@"] TJ\n"];
+                }
+                if (fontRecord != currentRecord)
+                {
+                    [content appendFormat:@"/%@ %.3f Tf\n", fontRecord.resourceName, fontSize];
+                }
+                [content appendFormat:@"1 0 0 -1 %.3f %.3f Tm\n[", glyphX, glyphY];
+                isArrayOpen = YES;
+                currentRecord = fontRecord;
+                currentY = glyphY;
+                expectedX = glyphX;
+            }
+
+            CGFloat adjustment = (expectedX - glyphX) * kPDF_GLYPH_UNITS / fontSize;
+            if (ABS(adjustment) > 0.05)
+            {
+                [content appendFormat:@" %.1f ", adjustment];
+            }
+
+            if (fontRecord.isTrueType)
+                [content appendFormat:@"<%04lX>", (unsigned long)glyphCode];
+            else
+                [content appendFormat:@"<%02lX>", (unsigned long)glyphCode];
+
+            expectedX = glyphX + [fontRecord widthForGlyph:glyphs[j]] * fontSize / kPDF_GLYPH_UNITS;
+        }
+
+        if (isArrayOpen)
+        {
+            [content appendString:@"] TJ\n"];
+        }
+        [content appendString:@"ET\n"];
+    }
+    CFRelease(line);
+}
+
+// Only swaps fonts that don't already have TrueType outlines and have a TTF version.
+- (NSAttributedString *)trueTypeStringForString: (NSAttributedString *)renderString
+{
+    __block NSMutableAttributedString *returnString = nil;
+    [renderString enumerateAttribute:NSFontAttributeName inRange:NSMakeRange(0, renderString.length) options:0
+                          usingBlock:^(id value, NSRange range, BOOL *stop)
+    {
+        UIFont *aFont = (UIFont *)value;
+        if (nil == aFont || [self fontUsesTrueTypeOutlines:(__bridge CTFontRef)aFont])
+            return;
+
+        UIFont *ttfFont = [EQRenderFontDictionary ttfFontForFont:aFont];
+        if (nil == ttfFont || ttfFont == aFont)
+            return;
+
+        if (nil == returnString)
+        {
+            returnString = renderString.mutableCopy;
+        }
+        [returnString addAttribute:NSFontAttributeName value:ttfFont range:range];
+    }];
+
+    return (nil != returnString) ? returnString : renderString;
+}
+
+- (BOOL)fontUsesTrueTypeOutlines: (CTFontRef)font
+{
+    NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(font));
+    if (nil == fontName)
+        return NO;
+
+    NSNumber *storedValue = self->trueTypeFontNames[fontName];
+    if (nil == storedValue)
+    {
+        storedValue = @([EQTrueTypeSubsetter fontHasTrueTypeOutlines:font]);
+        self->trueTypeFontNames[fontName] = storedValue;
+    }
+    return storedValue.boolValue;
+}
+
+// Records are keyed by PostScript name and part, so every size of a font shares them.
+// TrueType fonts use a single part with the glyph ids as codes. Type 3 fonts move on to a new part every kPDF_TYPE3_CODE_COUNT glyphs.
+- (EQPDFFontRecord *)fontRecordForFont: (CTFontRef)font glyph: (CGGlyph)glyph unicode: (NSString *)unicode code: (NSUInteger *)glyphCode
+{
+    NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(font));
+    if (nil == fontName)
+        return nil;
+
+    BOOL isTrueType = [self fontUsesTrueTypeOutlines:font];
+    for (NSUInteger partIndex = 0; ; partIndex++)
+    {
+        NSString *recordKey = [NSString stringWithFormat:@"%@|%lu", fontName, (unsigned long)partIndex];
+        EQPDFFontRecord *fontRecord = self->fontRecords[recordKey];
+        if (nil == fontRecord)
+        {
+            NSString *resourceName = [NSString stringWithFormat:@"F%lu", (unsigned long)(self->fontRecordOrder.count + 1)];
+            fontRecord = [[EQPDFFontRecord alloc] initWithFont:font resourceName:resourceName isTrueType:isTrueType];
+            self->fontRecords[recordKey] = fontRecord;
+            [self->fontRecordOrder addObject:fontRecord];
+        }
+
+        NSUInteger foundCode = [fontRecord codeForGlyph:glyph unicode:unicode];
+        if (foundCode != NSNotFound)
+        {
+            *glyphCode = foundCode;
+            return fontRecord;
+        }
+    }
+}
+
+/*****************************
+ * Begin document generation *
+ *****************************/
+
+- (NSData *)pdfData
+{
+    if (self->pageContents.count == 0)
+        return nil;
+
+    // Reserve the fixed objects, they are filled in once the other object numbers are known.
+    NSMutableArray *objects = [[NSMutableArray alloc] initWithArray:@[[NSNull null], [NSNull null], [NSNull null]]];
+
+    NSMutableString *fontResources = [[NSMutableString alloc] init];
+    for (EQPDFFontRecord *fontRecord in self->fontRecordOrder)
+    {
+        NSUInteger fontObject = fontRecord.isTrueType ? [self addTrueTypeFontForRecord:fontRecord toObjects:objects]
+                                                      : [self addType3FontForRecord:fontRecord toObjects:objects];
+        if (fontObject != 0)
+        {
+            [fontResources appendFormat:@"/%@ %lu 0 R ", fontRecord.resourceName, (unsigned long)fontObject];
+        }
+    }
+    objects[kPDF_RESOURCES_OBJECT - 1] = [NSString stringWithFormat:@"<< /Font << %@>> /ProcSet [/PDF /Text] >>", fontResources];
+
+    NSMutableString *pageKids = [[NSMutableString alloc] init];
+    for (NSUInteger i = 0; i < self->pageContents.count; i++)
+    {
+        NSMutableString *content = [self->pageContents[i] mutableCopy];
+        [content appendString:@"Q\n"];
+        NSUInteger contentObject = [self addStreamWithData:[content dataUsingEncoding:NSASCIIStringEncoding] dictionary:@"" toObjects:objects];
+
+        CGSize pageSize = [(NSValue *)self->pageSizes[i] CGSizeValue];
+        NSString *pageString = [NSString stringWithFormat:@"<< /Type /Page /Parent %lu 0 R /MediaBox [0 0 %.3f %.3f] /Resources %lu 0 R /Contents %lu 0 R >>",
+                                (unsigned long)kPDF_PAGES_OBJECT, pageSize.width, pageSize.height,
+                                (unsigned long)kPDF_RESOURCES_OBJECT, (unsigned long)contentObject];
+        NSUInteger pageObject = [self addObjectString:pageString toObjects:objects];
+        [pageKids appendFormat:@"%lu 0 R ", (unsigned long)pageObject];
+    }
+    objects[kPDF_PAGES_OBJECT - 1] = [NSString stringWithFormat:@"<< /Type /Pages /Kids [%@] /Count %lu >>",
+                                      pageKids, (unsigned long)self->pageContents.count];
+    objects[kPDF_CATALOG_OBJECT - 1] = [NSString stringWithFormat:@"<< /Type /Catalog /Pages %lu 0 R >>", (unsigned long)kPDF_PAGES_OBJECT];
+
+    // Write the objects and remember where each one starts for the cross reference table.
+    NSMutableData *pdfData = [[NSMutableData alloc] init];
+    const char *headerBytes = "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+    [pdfData appendBytes:headerBytes length:strlen(headerBytes)];
+
+    NSMutableArray *objectOffsets = [[NSMutableArray alloc] initWithCapacity:objects.count];
+    for (NSUInteger i = 0; i < objects.count; i++)
+    {
+        [objectOffsets addObject:@(pdfData.length)];
+        [pdfData appendData:[[NSString stringWithFormat:@"%lu 0 obj\n", (unsigned long)(i + 1)] dataUsingEncoding:NSASCIIStringEncoding]];
+
+        id objectBody = objects[i];
+        if ([objectBody isKindOfClass:[NSData class]])
+            [pdfData appendData:objectBody];
+        else
+            [pdfData appendData:[(NSString *)objectBody dataUsingEncoding:NSASCIIStringEncoding]];
+
+        [pdfData appendData:[@"\nendobj\n" dataUsingEncoding:NSASCIIStringEncoding]];
+    }
+
+    NSUInteger xrefOffset = pdfData.length;
+    NSMutableString *trailerString = [[NSMutableString alloc] init];
+    [trailerString appendFormat:@"xref\n0 %lu\n0000000000 65535 f \n", (unsigned long)(objects.count + 1)];
+    for (NSNumber *objectOffset in objectOffsets)
+    {
+        [trailerString appendFormat:@"%010lu 00000 n \n", objectOffset.unsignedLongValue];
+    }
+    [trailerString appendFormat:@"trailer\n<< /Size %lu /Root %lu 0 R >>\nstartxref\n%lu\n%%%%EOF\n",
+                                (unsigned long)(objects.count + 1), (unsigned long)kPDF_CATALOG_OBJECT, (unsigned long)xrefOffset];
+    [pdfData appendData:[trailerString dataUsingEncoding:NSASCIIStringEncoding]];
+
+    return pdfData;
+}
+
+- (NSUInteger)addObjectString: (NSString *)objectString toObjects: (NSMutableArray *)objects
+{
+    [objects addObject:objectString];
+    return objects.count;
+}
+
+- (NSUInteger)addStreamWithData: (NSData *)streamData dictionary: (NSString *)dictString toObjects: (NSMutableArray *)objects
+{
+    NSData *useData = streamData;
+    NSString *filterString = @"";
+    if (self.compressStreams == YES)
+    {
+        NSData *compressedData = EQDeflateData(streamData);
+        if (nil != compressedData)
+        {
+            useData = compressedData;
+            filterString = @" /Filter /FlateDecode";
+        }
+    }
+
+    NSMutableData *streamObject = [[NSMutableData alloc] init];
+    NSString *headerString = [NSString stringWithFormat:@"<< %@ /Length %lu%@ >>\nstream\n", dictString, (unsigned long)useData.length, filterString];
+    [streamObject appendData:[headerString dataUsingEncoding:NSASCIIStringEncoding]];
+    [streamObject appendData:useData];
+    [streamObject appendData:[@"\nendstream" dataUsingEncoding:NSASCIIStringEncoding]];
+
+    [objects addObject:streamObject];
+    return objects.count;
+}
+
+- (NSUInteger)addTrueTypeFontForRecord: (EQPDFFontRecord *)fontRecord toObjects: (NSMutableArray *)objects
+{
+    NSDictionary *fontTables = [EQTrueTypeSubsetter tablesForFont:[fontRecord unitFont]];
+    NSData *subsetData = [EQTrueTypeSubsetter subsetFontWithTables:fontTables glyphs:fontRecord.usedGlyphs];
+    if (nil == subsetData)
+        return 0;
+
+    NSString *baseFont = [NSString stringWithFormat:@"%@+%@", [self subsetTagForRecord:fontRecord], EQPDFNameString(fontRecord.fontName)];
+    NSUInteger fontFileObject = [self addStreamWithData:subsetData
+                                             dictionary:[NSString stringWithFormat:@"/Length1 %lu", (unsigned long)subsetData.length]
+                                              toObjects:objects];
+
+    CTFontRef unitFont = [fontRecord unitFont];
+    CGRect fontBox = CTFontGetBoundingBox(unitFont);
+    NSString *descriptorString = [NSString stringWithFormat:@"<< /Type /FontDescriptor /FontName /%@ /Flags 4 /FontBBox [%.0f %.0f %.0f %.0f] "
+                                  "/ItalicAngle %.1f /Ascent %.0f /Descent %.0f /CapHeight %.0f /StemV 80 /FontFile2 %lu 0 R >>",
+                                  baseFont, CGRectGetMinX(fontBox), CGRectGetMinY(fontBox), CGRectGetMaxX(fontBox), CGRectGetMaxY(fontBox),
+                                  CTFontGetSlantAngle(unitFont), CTFontGetAscent(unitFont), -CTFontGetDescent(unitFont),
+                                  CTFontGetCapHeight(unitFont), (unsigned long)fontFileObject];
+    NSUInteger descriptorObject = [self addObjectString:descriptorString toObjects:objects];
+
+    // Glyph ids are used directly as the character codes.
+    NSMutableString *widthString = [[NSMutableString alloc] init];
+    [fontRecord.usedGlyphs enumerateIndexesUsingBlock:^(NSUInteger glyph, BOOL *stop)
+    {
+        [widthString appendFormat:@"%lu [%.0f] ", (unsigned long)glyph, [fontRecord widthForGlyph:(CGGlyph)glyph]];
+    }];
+    NSString *cidFontString = [NSString stringWithFormat:@"<< /Type /Font /Subtype /CIDFontType2 /BaseFont /%@ "
+                               "/CIDSystemInfo << /Registry (Adobe) /Ordering (Identity) /Supplement 0 >> "
+                               "/FontDescriptor %lu 0 R /CIDToGIDMap /Identity /W [%@] >>",
+                               baseFont, (unsigned long)descriptorObject, widthString];
+    NSUInteger cidFontObject = [self addObjectString:cidFontString toObjects:objects];
+
+    NSString *cmapString = [self toUnicodeCMapForRecord:fontRecord codeLength:2];
+    NSUInteger cmapObject = [self addStreamWithData:[cmapString dataUsingEncoding:NSASCIIStringEncoding] dictionary:@"" toObjects:objects];
+
+    NSString *fontString = [NSString stringWithFormat:@"<< /Type /Font /Subtype /Type0 /BaseFont /%@ /Encoding /Identity-H "
+                            "/DescendantFonts [%lu 0 R] /ToUnicode %lu 0 R >>",
+                            baseFont, (unsigned long)cidFontObject, (unsigned long)cmapObject];
+    return [self addObjectString:fontString toObjects:objects];
+}
+
+- (NSUInteger)addType3FontForRecord: (EQPDFFontRecord *)fontRecord toObjects: (NSMutableArray *)objects
+{
+    if (fontRecord.type3Glyphs.count == 0)
+        return 0;
+
+    CTFontRef unitFont = [fontRecord unitFont];
+    NSMutableString *charProcString = [[NSMutableString alloc] init];
+    NSMutableString *differenceString = [[NSMutableString alloc] init];
+    NSMutableString *widthString = [[NSMutableString alloc] init];
+    CGRect fontBox = CGRectNull;
+
+    for (NSUInteger code = 0; code < fontRecord.type3Glyphs.count; code++)
+    {
+        CGGlyph glyph = [(NSNumber *)fontRecord.type3Glyphs[code] unsignedShortValue];
+        CGFloat glyphWidth = [fontRecord widthForGlyph:glyph];
+        CGRect glyphRect = CGRectZero;
+        CTFontGetBoundingRectsForGlyphs(unitFont, kCTFontOrientationHorizontal, &glyph, &glyphRect, 1);
+        if (!CGRectIsEmpty(glyphRect))
+        {
+            fontBox = CGRectUnion(fontBox, glyphRect);
+        }
+
+        NSMutableString *procString = [[NSMutableString alloc] init];
+        [procString appendFormat:@"%.0f 0 %.0f %.0f %.0f %.0f d1\n", glyphWidth, floor(CGRectGetMinX(glyphRect)), floor(CGRectGetMinY(glyphRect)),
+                                 ceil(CGRectGetMaxX(glyphRect)), ceil(CGRectGetMaxY(glyphRect))];
+
+        CGPathRef glyphPath = CTFontCreatePathForGlyph(unitFont, glyph, NULL);
+        if (NULL != glyphPath)
+        {
+            NSMutableString *pathString = [[NSMutableString alloc] init];
+            EQPDFPathInfo pathInfo = {pathString, CGPointZero, CGPointZero};
+            CGPathApply(glyphPath, &pathInfo, EQAppendPDFPathElement);
+            CGPathRelease(glyphPath);
+
+            if (pathString.length > 0)
+            {
+                [procString appendFormat:@"%@f\n", pathString];
+            }
+        }
+
+        NSUInteger procObject = [self addStreamWithData:[procString dataUsingEncoding:NSASCIIStringEncoding] dictionary:@"" toObjects:objects];
+        [charProcString appendFormat:@"/g%lu %lu 0 R ", (unsigned long)code, (unsigned long)procObject];
+        [differenceString appendFormat:@"/g%lu ", (unsigned long)code];
+        [widthString appendFormat:@"%.0f ", glyphWidth];
+    }
+
+    if (CGRectIsNull(fontBox))
+    {
+        fontBox = CGRectZero;
+    }
+
+    NSString *cmapString = [self toUnicodeCMapForRecord:fontRecord codeLength:1];
+    NSUInteger cmapObject = [self addStreamWithData:[cmapString dataUsingEncoding:NSASCIIStringEncoding] dictionary:@"" toObjects:objects];
+
+    NSString *fontString = [NSString stringWithFormat:@"<< /Type /Font /Subtype /Type3 /FontBBox [%.0f %.0f %.0f %.0f] "
+                            "/FontMatrix [0.001 0 0 0.001 0 0] /CharProcs << %@>> "
+                            "/Encoding << /Type /Encoding /Differences [0 %@] >> /FirstChar 0 /LastChar %lu /Widths [%@] "
+                            "/Resources << >> /ToUnicode %lu 0 R >>",
+                            floor(CGRectGetMinX(fontBox)), floor(CGRectGetMinY(fontBox)), ceil(CGRectGetMaxX(fontBox)), ceil(CGRectGetMaxY(fontBox)),
+                            charProcString, differenceString, (unsigned long)(fontRecord.type3Glyphs.count - 1),
+                            widthString, (unsigned long)cmapObject];
+    return [self addObjectString:fontString toObjects:objects];
+}
+
+// Maps the character codes back to the text so the PDF can be searched and copied from.
+- (NSString *)toUnicodeCMapForRecord: (EQPDFFontRecord *)fontRecord codeLength: (NSUInteger)codeLength
+{
+    NSArray *sortedCodes = [fontRecord.codeUnicodes.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    NSString *codeFormat = (codeLength == 1) ? @"<%02lX>" : @"<%04lX>";
+
+    NSMutableString *cmapString = [[NSMutableString alloc] init];
+    [cmapString appendString:@"/CIDInit /ProcSet findresource begin\n12 dict begin\nbegincmap\n"
+                              "/CIDSystemInfo << /Registry (Adobe) /Ordering (UCS) /Supplement 0 >> def\n"
+                              "/CMapName /Adobe-Identity-UCS def\n/CMapType 2 def\n1 begincodespacerange\n"];
+    [cmapString appendFormat:@"%@ %@\nendcodespacerange\n",
+                             [NSString stringWithFormat:codeFormat, 0UL],
+                             [NSString stringWithFormat:codeFormat, (codeLength == 1) ? 0xFFUL : 0xFFFFUL]];
+
+    // Each bfchar block is limited to 100 entries.
+    for (NSUInteger blockStart = 0; blockStart < sortedCodes.count; blockStart += 100)
+    {
+        NSUInteger blockCount = MIN((NSUInteger)100, sortedCodes.count - blockStart);
+        [cmapString appendFormat:@"%lu beginbfchar\n", (unsigned long)blockCount];
+        for (NSUInteger i = blockStart; i < blockStart + blockCount; i++)
+        {
+            NSNumber *code = sortedCodes[i];
+            NSString *unicode = fontRecord.codeUnicodes[code];
+            NSMutableString *unicodeHex = [[NSMutableString alloc] init];
+            for (NSUInteger j = 0; j < unicode.length; j++)
+            {
+                [unicodeHex appendFormat:@"%04X", [unicode characterAtIndex:j]];
+            }
+            [cmapString appendFormat:codeFormat, code.unsignedLongValue];
+            [cmapString appendFormat:@" <%@>\n", unicodeHex];
+        }
+        [cmapString appendString:@"endbfchar\n"];
+    }
+
+    [cmapString appendString:@"endcmap\nCMapName currentdict /CMap defineresource pop\nend\nend\n"];
+    return cmapString;
+}
+
+// Subset fonts are named with six capital letters that depend on the glyphs they hold.
+- (NSString *)subsetTagForRecord: (EQPDFFontRecord *)fontRecord
+{
+    __block uint32_t tagHash = 2166136261u;
+    for (NSUInteger i = 0; i < fontRecord.fontName.length; i++)
+    {
+        tagHash = (tagHash ^ [fontRecord.fontName characterAtIndex:i]) * 16777619u;
+    }
+    [fontRecord.usedGlyphs enumerateIndexesUsingBlock:^(NSUInteger glyph, BOOL *stop)
+    {
+        tagHash = (tagHash ^ (uint32_t)glyph) * 16777619u;
+    }];
+
+    NSMutableString *tagString = [[NSMutableString alloc] initWithCapacity:6];
+    for (NSUInteger i = 0; i < 6; i++)
+    {
+        [tagString appendFormat:@"%c", 'A' + (char)(tagHash % 26)];
+        tagHash /= 26;
+    }
+    return tagString;
+}
+
+@end
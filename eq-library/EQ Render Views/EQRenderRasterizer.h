@@ -0,0 +1,58 @@
+//
+//  EQRenderRasterizer.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import "EQRenderEquation.h"
+#import "EQGlyphAtlas.h"
+#import "EQRenderFrozenEquation.h"
+
+// This class draws a laid out EQRenderEquation into a bitmap without going through CoreText line drawing.
+// Each glyph is copied from the glyph atlas, so glyphs that are repeated within or across equations are only rasterized once.
+// Rules are stroked with anti-aliasing. It does not use UIKit.
+// A frozen equation can be drawn instead, which skips the CoreText line work when the same math is drawn more than once.
+
+@interface EQRenderRasterizer : NSObject
+
+@property (strong, nonatomic) EQRenderEquation *renderEquation;
+@property (strong, nonatomic) EQRenderFrozenEquation *frozenEquation;
+@property (strong, nonatomic) EQGlyphAtlas *glyphAtlas;
+
+// Pixels per point. The equation's pdfScale is applied on top of this.
+@property (nonatomic) CGFloat pixelScale;
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation;
+- (id)initWithFrozenEquation: (EQRenderFrozenEquation *)frozenEquation;
+
+// The image size is in points and the draw rect matches the rect passed to drawEquationLinesInRect:.
+// The caller is responsible for releasing the image.
+- (CGImageRef)createImageWithSize: (CGSize)imageSize drawRect: (CGRect)drawRect CF_RETURNS_RETAINED;
+
+// Draws into an 8-bit alpha-only bitmap context, which is a quarter of the size of an RGBA one.
+- (CGContextRef)createAlphaContextWithSize: (CGSize)imageSize drawRect: (CGRect)drawRect CF_RETURNS_RETAINED;
+
+// Encodes the alpha-only bitmap directly as a PNG, without creating a CGImage or UIImage first.
+// Compression levels use the zlib range of 0-9.
+- (NSData *)pngDataWithSize: (CGSize)imageSize drawRect: (CGRect)drawRect compressionLevel: (NSInteger)compressionLevel;
+- (BOOL)writePNGWithSize: (CGSize)imageSize
+                drawRect: (CGRect)drawRect
+        compressionLevel: (NSInteger)compressionLevel
+        toFileDescriptor: (int)fileDescriptor;
+- (void)drawInBitmapContext: (CGContextRef)context drawRect: (CGRect)drawRect;
+
+@end
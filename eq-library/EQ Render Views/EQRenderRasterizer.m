@@ -0,0 +1,284 @@
+//
+//  EQRenderRasterizer.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <CoreText/CoreText.h>
+#import "EQRenderRasterizer.h"
+#import "EQPNGWriter.h"
+
+@interface EQRenderRasterizer()
+
+- (void)drawString: (NSAttributedString *)renderString atPoint: (CGPoint)drawPoint
+         inContext: (CGContextRef)context drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight;
+- (void)drawGlyphs: (const CGGlyph *)glyphs atPoints: (const CGPoint *)glyphPoints count: (NSUInteger)glyphCount inFont: (CTFontRef)runFont
+         inContext: (CGContextRef)context drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight;
+- (void)drawRuleFrom: (CGPoint)startPoint to: (CGPoint)endPoint lineWidth: (CGFloat)lineWidth
+           inContext: (CGContextRef)context drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight;
+- (CGFloat)drawScale;
+- (CGPoint)pixelPointForPoint: (CGPoint)drawPoint drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight;
+- (CGContextRef)createContextWithSize: (CGSize)imageSize
+                             drawRect: (CGRect)drawRect
+                           colorSpace: (CGColorSpaceRef)colorSpace
+                           bitmapInfo: (CGBitmapInfo)bitmapInfo CF_RETURNS_RETAINED;
+
+@end
+
+@implementation EQRenderRasterizer
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        self->_renderEquation = nil;
+        self->_frozenEquation = nil;
+        self->_glyphAtlas = [EQGlyphAtlas sharedGlyphAtlas];
+        self->_pixelScale = 1.0;
+    }
+    return self;
+}
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation
+{
+    self = [super init];
+    if (self)
+    {
+        self->_renderEquation = renderEquation;
+        self->_frozenEquation = nil;
+        self->_glyphAtlas = [EQGlyphAtlas sharedGlyphAtlas];
+        self->_pixelScale = 1.0;
+    }
+    return self;
+}
+
+- (id)initWithFrozenEquation: (EQRenderFrozenEquation *)frozenEquation
+{
+    self = [super init];
+    if (self)
+    {
+        self->_renderEquation = nil;
+        self->_frozenEquation = frozenEquation;
+        self->_glyphAtlas = [EQGlyphAtlas sharedGlyphAtlas];
+        self->_pixelScale = 1.0;
+    }
+    return self;
+}
+
+- (CGImageRef)createImageWithSize: (CGSize)imageSize drawRect: (CGRect)drawRect
+{
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = [self createContextWithSize:imageSize drawRect:drawRect colorSpace:colorSpace
+                                            bitmapInfo:(CGBitmapInfo)kCGImageAlphaPremultipliedLast];
+    CGColorSpaceRelease(colorSpace);
+    if (NULL == context)
+        return NULL;
+
+    CGImageRef returnImage = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+
+    return returnImage;
+}
+
+- (CGContextRef)createAlphaContextWithSize: (CGSize)imageSize drawRect: (CGRect)drawRect
+{
+    return [self createContextWithSize:imageSize drawRect:drawRect colorSpace:NULL bitmapInfo:(CGBitmapInfo)kCGImageAlphaOnly];
+}
+
+- (NSData *)pngDataWithSize: (CGSize)imageSize drawRect: (CGRect)drawRect compressionLevel: (NSInteger)compressionLevel
+{
+    CGContextRef context = [self createAlphaContextWithSize:imageSize drawRect:drawRect];
+    if (NULL == context)
+        return nil;
+
+    NSData *pngData = [EQPNGWriter pngDataWithAlphaBuffer:CGBitmapContextGetData(context)
+                                                    width:CGBitmapContextGetWidth(context)
+                                                   height:CGBitmapContextGetHeight(context)
+                                              bytesPerRow:CGBitmapContextGetBytesPerRow(context)
+                                         compressionLevel:compressionLevel];
+    CGContextRelease(context);
+
+    return pngData;
+}
+
+- (BOOL)writePNGWithSize: (CGSize)imageSize
+                drawRect: (CGRect)drawRect
+        compressionLevel: (NSInteger)compressionLevel
+        toFileDescriptor: (int)fileDescriptor
+{
+    CGContextRef context = [self createAlphaContextWithSize:imageSize drawRect:drawRect];
+    if (NULL == context)
+        return NO;
+
+    BOOL success = [EQPNGWriter writeAlphaBuffer:CGBitmapContextGetData(context)
+                                           width:CGBitmapContextGetWidth(context)
+                                          height:CGBitmapContextGetHeight(context)
+                                     bytesPerRow:CGBitmapContextGetBytesPerRow(context)
+                                compressionLevel:compressionLevel
+                                toFileDescriptor:fileDescriptor];
+    CGContextRelease(context);
+
+    return success;
+}
+
+- (CGContextRef)createContextWithSize: (CGSize)imageSize
+                             drawRect: (CGRect)drawRect
+                           colorSpace: (CGColorSpaceRef)colorSpace
+                           bitmapInfo: (CGBitmapInfo)bitmapInfo
+{
+    size_t pixelWidth = (size_t)ceil(imageSize.width * self.pixelScale);
+    size_t pixelHeight = (size_t)ceil(imageSize.height * self.pixelScale);
+    if ((nil == self.renderEquation && nil == self.frozenEquation) || pixelWidth == 0 || pixelHeight == 0)
+        return NULL;
+
+    CGContextRef context = CGBitmapContextCreate(NULL, pixelWidth, pixelHeight, 8, 0, colorSpace, bitmapInfo);
+    if (NULL == context)
+        return NULL;
+
+    CGContextClearRect(context, CGRectMake(0, 0, pixelWidth, pixelHeight));
+    [self drawInBitmapContext:context drawRect:drawRect];
+
+    return context;
+}
+
+// Draws in device pixels, so the context should not have a transform applied.
+// The frozen equation is used when there is one, as its glyph runs have already been typeset.
+- (void)drawInBitmapContext: (CGContextRef)context drawRect: (CGRect)drawRect
+{
+    if (NULL == context || (nil == self.renderEquation && nil == self.frozenEquation))
+        return;
+
+    CGFloat pixelHeight = (CGFloat)CGBitmapContextGetHeight(context);
+
+    CGContextSaveGState(context);
+    CGContextSetShouldAntialias(context, YES);
+    CGContextSetRGBFillColor(context, 0.0, 0.0, 0.0, 1.0);
+    CGContextSetRGBStrokeColor(context, 0.0, 0.0, 0.0, 1.0);
+
+    if (nil != self.frozenEquation)
+    {
+        [self.frozenEquation enumerateGlyphRunsUsingBlock:^(CTFontRef runFont, const CGGlyph *glyphs, const CGPoint *positions, NSUInteger glyphCount)
+        {
+            [self drawGlyphs:glyphs atPoints:positions count:glyphCount inFont:runFont inContext:context drawRect:drawRect pixelHeight:pixelHeight];
+        }];
+        [self.frozenEquation enumerateRulesUsingBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+        {
+            [self drawRuleFrom:startPoint to:endPoint lineWidth:lineWidth inContext:context drawRect:drawRect pixelHeight:pixelHeight];
+        }];
+    }
+    else
+    {
+        [self.renderEquation enumerateDrawElementsInContext:context stringBlock:^(NSAttributedString *renderString, CGPoint drawPoint)
+        {
+            [self drawString:renderString atPoint:drawPoint inContext:context drawRect:drawRect pixelHeight:pixelHeight];
+        }
+        lineBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+        {
+            [self drawRuleFrom:startPoint to:endPoint lineWidth:lineWidth inContext:context drawRect:drawRect pixelHeight:pixelHeight];
+        }];
+    }
+
+    CGContextRestoreGState(context);
+}
+
+- (CGFloat)drawScale
+{
+    if (nil != self.frozenEquation)
+        return self.frozenEquation.pdfScale;
+
+    return self.renderEquation.pdfScale;
+}
+
+// Converts a top-down equation point to a bottom-up pixel point.
+- (CGPoint)pixelPointForPoint: (CGPoint)drawPoint drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight
+{
+    CGFloat useScale = [self drawScale];
+    CGFloat pixelX = (drawRect.origin.x + drawPoint.x * useScale) * self.pixelScale;
+    CGFloat pixelY = (drawRect.origin.y + drawPoint.y * useScale) * self.pixelScale;
+    return CGPointMake(pixelX, pixelHeight - pixelY);
+}
+
+- (void)drawRuleFrom: (CGPoint)startPoint to: (CGPoint)endPoint lineWidth: (CGFloat)lineWidth
+           inContext: (CGContextRef)context drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight
+{
+    CGPoint pixelStart = [self pixelPointForPoint:startPoint drawRect:drawRect pixelHeight:pixelHeight];
+    CGPoint pixelEnd = [self pixelPointForPoint:endPoint drawRect:drawRect pixelHeight:pixelHeight];
+    CGContextBeginPath(context);
+    CGContextMoveToPoint(context, pixelStart.x, pixelStart.y);
+    CGContextAddLineToPoint(context, pixelEnd.x, pixelEnd.y);
+    CGContextSetLineWidth(context, lineWidth * [self drawScale] * self.pixelScale);
+    CGContextStrokePath(context);
+}
+
+- (void)drawString: (NSAttributedString *)renderString atPoint: (CGPoint)drawPoint
+         inContext: (CGContextRef)context drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight
+{
+    if (nil == renderString || renderString.length == 0)
+        return;
+
+    CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)renderString);
+    CFArrayRef runArray = CTLineGetGlyphRuns(line);
+
+    for (CFIndex i = 0; i < CFArrayGetCount(runArray); i ++)
+    {
+        CTRunRef run = (CTRunRef)CFArrayGetValueAtIndex(runArray, i);
+        CTFontRef runFont = (CTFontRef)CFDictionaryGetValue(CTRunGetAttributes(run), kCTFontAttributeName);
+        CFIndex glyphCount = CTRunGetGlyphCount(run);
+        if (NULL == runFont || glyphCount == 0 || ![EQRenderEquation shouldDrawRun:run])
+            continue;
+
+        CGGlyph glyphs[glyphCount];
+        CGPoint positions[glyphCount];
+        CTRunGetGlyphs(run, CFRangeMake(0, 0), glyphs);
+        CTRunGetPositions(run, CFRangeMake(0, 0), positions);
+
+        // Run positions are y-up from the line origin.
+        for (CFIndex j = 0; j < glyphCount; j ++)
+        {
+            positions[j] = CGPointMake(drawPoint.x + positions[j].x, drawPoint.y - positions[j].y);
+        }
+        [self drawGlyphs:glyphs atPoints:positions count:glyphCount inFont:runFont inContext:context drawRect:drawRect pixelHeight:pixelHeight];
+    }
+    CFRelease(line);
+}
+
+// The glyph points are top-down equation points, like the frozen glyph positions.
+- (void)drawGlyphs: (const CGGlyph *)glyphs atPoints: (const CGPoint *)glyphPoints count: (NSUInteger)glyphCount inFont: (CTFontRef)runFont
+         inContext: (CGContextRef)context drawRect: (CGRect)drawRect pixelHeight: (CGFloat)pixelHeight
+{
+    CGFloat glyphScale = [self drawScale] * self.pixelScale;
+    for (NSUInteger j = 0; j < glyphCount; j ++)
+    {
+        CGPoint pixelPoint = [self pixelPointForPoint:glyphPoints[j] drawRect:drawRect pixelHeight:pixelHeight];
+
+        // Horizontal positions keep their subpixel offset, vertical positions snap to the pixel grid.
+        CGFloat pixelX = floor(pixelPoint.x);
+        CGFloat pixelY = round(pixelPoint.y);
+
+        CGPoint originOffset = CGPointZero;
+        CGImageRef maskImage = [self.glyphAtlas copyMaskForGlyph:glyphs[j] inFont:runFont pixelScale:glyphScale
+                                                  subpixelOffset:(pixelPoint.x - pixelX) originOffset:&originOffset];
+        if (NULL == maskImage)
+            continue;
+
+        CGRect maskRect = CGRectMake(pixelX - originOffset.x, pixelY - originOffset.y,
+                                     CGImageGetWidth(maskImage), CGImageGetHeight(maskImage));
+        CGContextDrawImage(context, maskRect, maskImage);
+        CGImageRelease(maskImage);
+    }
+}
+
+@end
@@ -0,0 +1,41 @@
+//
+//  EQRenderSVGExporter.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import "EQRenderEquation.h"
+
+// This class writes a laid out EQRenderEquation as an SVG document.
+// It reads the same layout data that EQRenderEquation draws, but doesn't need a graphics context to draw into.
+// Text is written as glyph outlines by default, so the SVG does not depend on the STIX fonts being installed.
+
+@interface EQRenderSVGExporter : NSObject
+
+@property (strong, nonatomic) EQRenderEquation *renderEquation;
+
+// Write glyph outlines (YES) or <text> elements that reference the font names (NO).
+@property (nonatomic) BOOL useGlyphPaths;
+
+// Store each glyph outline once in <defs> and reference it with <use>.
+@property (nonatomic) BOOL useSharedDefs;
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation;
+- (NSString *)svgString;
+
++ (NSString *)svgStringWithRenderEquation: (EQRenderEquation *)renderEquation;
+
+@end
@@ -0,0 +1,247 @@
+//
+//  EQRenderSVGExporter.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <CoreText/CoreText.h>
+#import "EQRenderSVGExporter.h"
+
+@interface EQRenderSVGExporter()
+{
+    NSMutableString *defsString;
+    NSMutableDictionary *glyphIdentifiers;
+}
+
+- (void)appendAttributedString: (NSAttributedString *)renderString atPoint: (CGPoint)drawPoint toString: (NSMutableString *)bodyString;
+- (void)appendLineFromPoint: (CGPoint)startPoint toPoint: (CGPoint)endPoint width: (CGFloat)lineWidth toString: (NSMutableString *)bodyString;
+- (NSString *)pathDataForGlyph: (CGGlyph)glyph inFont: (CTFontRef)font;
+
+@end
+
+// Builds an SVG path string from a CGPath.
+// Glyph outlines are y-up, so the y values are flipped here to match the SVG coordinates.
+static void EQAppendSVGPathElement(void *info, const CGPathElement *element)
+{
+    NSMutableString *pathString = (__bridge NSMutableString *)info;
+    CGPoint *points = element->points;
+
+    switch (element->type)
+    {
+        case kCGPathElementMoveToPoint:
+            [pathString appendFormat:@"M%.2f %.2f", points[0].x, -points[0].y];
+            break;
+        case kCGPathElementAddLineToPoint:
+            [pathString appendFormat:@"L%.2f %.2f", points[0].x, -points[0].y];
+            break;
+        case kCGPathElementAddQuadCurveToPoint:
+            [pathString appendFormat:@"Q%.2f %.2f %.2f %.2f", points[0].x, -points[0].y, points[1].x, -points[1].y];
+            break;
+        case kCGPathElementAddCurveToPoint:
+            [pathString appendFormat:@"C%.2f %.2f %.2f %.2f %.2f %.2f", points[0].x, -points[0].y,
+                                     points[1].x, -points[1].y, points[2].x, -points[2].y];
+            break;
+        case kCGPathElementCloseSubpath:
+            [pathString appendString:@"Z"];
+            break;
+    }
+}
+
+static NSString *EQEscapedXMLString(NSString *inputStr)
+{
+    NSMutableString *returnStr = [[NSMutableString alloc] initWithString:inputStr];
+    [returnStr replaceOccurrencesOfString:@"&" withString:@"&amp;" options:0 range:NSMakeRange(0, returnStr.length)];
+    [returnStr replaceOccurrencesOfString:@"<" withString:@"&lt;" options:0 range:NSMakeRange(0, returnStr.length)];
+    [returnStr replaceOccurrencesOfString:@">" withString:@"&gt;" options:0 range:NSMakeRange(0, returnStr.length)];
+    [returnStr replaceOccurrencesOfString:@"\"" withString:@"&quot;" options:0 range:NSMakeRange(0, returnStr.length)];
+    return returnStr;
+}
+
+@implementation EQRenderSVGExporter
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        self->_renderEquation = nil;
+        self->_useGlyphPaths = YES;
+        self->_useSharedDefs = YES;
+    }
+    return self;
+}
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation
+{
+    self = [super init];
+    if (self)
+    {
+        self->_renderEquation = renderEquation;
+        self->_useGlyphPaths = YES;
+        self->_useSharedDefs = YES;
+    }
+    return self;
+}
+
++ (NSString *)svgStringWithRenderEquation: (EQRenderEquation *)renderEquation
+{
+    EQRenderSVGExporter *exporter = [[EQRenderSVGExporter alloc] initWithRenderEquation:renderEquation];
+    return [exporter svgString];
+}
+
+// Uses the same line offsets and scale as drawEquationLinesInRect: with a zero origin.
+- (NSString *)svgString
+{
+    EQRenderEquation *renderEquation = self.renderEquation;
+    if (nil == renderEquation || nil == renderEquation.equationLines || renderEquation.equationLines.count == 0)
+        return nil;
+
+    if (CGSizeEqualToSize(renderEquation.drawSize, CGSizeZero))
+    {
+        [renderEquation layoutEquationLines];
+    }
+
+    self->defsString = [[NSMutableString alloc] init];
+    self->glyphIdentifiers = [[NSMutableDictionary alloc] init];
+
+    // Stretchy bracers measure their glyphs against a context, but nothing is drawn into it.
+    CGContextRef measureContext = [EQRenderEquation createMeasureContext];
+    if (NULL == measureContext)
+        return nil;
+
+    NSMutableString *bodyString = [[NSMutableString alloc] init];
+    [renderEquation enumerateDrawElementsInContext:measureContext stringBlock:^(NSAttributedString *renderString, CGPoint drawPoint)
+    {
+        [self appendAttributedString:renderString atPoint:drawPoint toString:bodyString];
+    }
+    lineBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+    {
+        [self appendLineFromPoint:startPoint toPoint:endPoint width:lineWidth toString:bodyString];
+    }];
+    CGContextRelease(measureContext);
+
+    // Leave the same margins as the draw offsets on each side.
+    CGFloat useScale = renderEquation.pdfScale;
+    CGSize canvasSize = renderEquation.drawSize;
+    canvasSize.width = ceil((canvasSize.width + 60.0) * useScale);
+    canvasSize.height = ceil((canvasSize.height + 60.0) * useScale);
+
+    NSMutableString *returnString = [[NSMutableString alloc] init];
+    [returnString appendFormat:@"<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" "
+                                "width=\"%.0f\" height=\"%.0f\" viewBox=\"0 0 %.0f %.0f\">\n",
+                                canvasSize.width, canvasSize.height, canvasSize.width, canvasSize.height];
+    if (self->defsString.length > 0)
+    {
+        [returnString appendFormat:@"<defs>\n%@</defs>\n", self->defsString];
+    }
+    [returnString appendFormat:@"<g transform=\"scale(%.4f)\" fill=\"black\" stroke=\"none\">\n%@</g>\n</svg>\n", useScale, bodyString];
+
+    self->defsString = nil;
+    self->glyphIdentifiers = nil;
+
+    return returnString;
+}
+
+- (void)appendAttributedString: (NSAttributedString *)renderString atPoint: (CGPoint)drawPoint toString: (NSMutableString *)bodyString
+{
+    if (nil == renderString || renderString.length == 0)
+        return;
+
+    CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)renderString);
+    CFArrayRef runArray = CTLineGetGlyphRuns(line);
+
+    for (CFIndex i = 0; i < CFArrayGetCount(runArray); i ++)
+    {
+        CTRunRef run = (CTRunRef)CFArrayGetValueAtIndex(runArray, i);
+        CTFontRef runFont = (CTFontRef)CFDictionaryGetValue(CTRunGetAttributes(run), kCTFontAttributeName);
+        CFIndex glyphCount = CTRunGetGlyphCount(run);
+        if (NULL == runFont || glyphCount == 0 || ![EQRenderEquation shouldDrawRun:run])
+            continue;
+
+        CGGlyph glyphs[glyphCount];
+        CGPoint positions[glyphCount];
+        CTRunGetGlyphs(run, CFRangeMake(0, 0), glyphs);
+        CTRunGetPositions(run, CFRangeMake(0, 0), positions);
+
+        if (self.useGlyphPaths == NO)
+        {
+            CFRange stringRange = CTRunGetStringRange(run);
+            NSString *runString = [renderString.string substringWithRange:NSMakeRange(stringRange.location, stringRange.length)];
+            NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(runFont));
+            [bodyString appendFormat:@"<text x=\"%.2f\" y=\"%.2f\" font-family=\"%@\" font-size=\"%.2f\">%@</text>\n",
+                                     drawPoint.x + positions[0].x, drawPoint.y - positions[0].y,
+                                     EQEscapedXMLString(fontName), CTFontGetSize(runFont), EQEscapedXMLString(runString)];
+            continue;
+        }
+
+        for (CFIndex j = 0; j < glyphCount; j ++)
+        {
+            CGFloat glyphX = drawPoint.x + positions[j].x;
+            CGFloat glyphY = drawPoint.y - positions[j].y;
+
+            if (self.useSharedDefs == YES)
+            {
+                NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(runFont));
+                NSString *glyphKey = [NSString stringWithFormat:@"%@-%.2f-%d", fontName, CTFontGetSize(runFont), glyphs[j]];
+                NSString *glyphIdentifier = self->glyphIdentifiers[glyphKey];
+                if (nil == glyphIdentifier)
+                {
+                    NSString *pathData = [self pathDataForGlyph:glyphs[j] inFont:runFont];
+                    if (nil == pathData)
+                        continue;
+
+                    glyphIdentifier = [NSString stringWithFormat:@"g%lu", (unsigned long)self->glyphIdentifiers.count];
+                    self->glyphIdentifiers[glyphKey] = glyphIdentifier;
+                    [self->defsString appendFormat:@"<path id=\"%@\" d=\"%@\"/>\n", glyphIdentifier, pathData];
+                }
+                [bodyString appendFormat:@"<use xlink:href=\"#%@\" x=\"%.2f\" y=\"%.2f\"/>\n", glyphIdentifier, glyphX, glyphY];
+            }
+            else
+            {
+                NSString *pathData = [self pathDataForGlyph:glyphs[j] inFont:runFont];
+                if (nil == pathData)
+                    continue;
+
+                [bodyString appendFormat:@"<path transform=\"translate(%.2f %.2f)\" d=\"%@\"/>\n", glyphX, glyphY, pathData];
+            }
+        }
+    }
+    CFRelease(line);
+}
+
+- (void)appendLineFromPoint: (CGPoint)startPoint toPoint: (CGPoint)endPoint width: (CGFloat)lineWidth toString: (NSMutableString *)bodyString
+{
+    [bodyString appendFormat:@"<line x1=\"%.2f\" y1=\"%.2f\" x2=\"%.2f\" y2=\"%.2f\" stroke=\"black\" stroke-width=\"%.2f\"/>\n",
+                             startPoint.x, startPoint.y, endPoint.x, endPoint.y, lineWidth];
+}
+
+// Returns nil for glyphs without an outline, such as spaces.
+- (NSString *)pathDataForGlyph: (CGGlyph)glyph inFont: (CTFontRef)font
+{
+    CGPathRef glyphPath = CTFontCreatePathForGlyph(font, glyph, NULL);
+    if (NULL == glyphPath)
+        return nil;
+
+    NSMutableString *pathString = [[NSMutableString alloc] init];
+    CGPathApply(glyphPath, (__bridge void *)pathString, EQAppendSVGPathElement);
+    CGPathRelease(glyphPath);
+
+    if (pathString.length == 0)
+        return nil;
+
+    return pathString;
+}
+
+@end
@@ -0,0 +1,43 @@
+//
+//  EQRenderSpatialIndex.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import "EQRenderEquation.h"
+#import "EQTextPosition.h"
+
+// Maps points to text positions and text positions to caret rects for a laid out EQRenderEquation.
+// Each render data is measured once when the index is built, and the caret offset of each character is stored.
+// Lines are found with a binary search and the render data in a line with a bounding box tree.
+// Points and rects use the same unscaled, top-down coordinates as enumerateDrawElementsInContext:.
+// The index is not updated when the equation changes, so build a new one after each layout.
+
+@interface EQRenderSpatialIndex : NSObject
+
+@property (readonly, nonatomic) NSUInteger lineCount;
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation;
+
+// Returns nil if the equation has no render data.
+- (EQTextPosition *)closestPositionToPoint: (CGPoint)point;
+
+// Returns CGRectNull if the position is not in the index.
+- (CGRect)caretRectForPosition: (EQTextPosition *)textPosition;
+- (CGRect)boundsForDataAtLocation: (NSUInteger)dataLoc equationLoc: (NSUInteger)equationLoc;
+
+@end
@@ -0,0 +1,455 @@
+//
+//  EQRenderSpatialIndex.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <CoreText/CoreText.h>
+#import "EQRenderSpatialIndex.h"
+#import "EQRenderData.h"
+
+// Leaves hold a few entries each, which is faster than splitting down to single entries.
+static const NSUInteger kMAX_LEAF_ENTRIES = 4;
+static const CGFloat kCARET_WIDTH = 3.0;
+static const CGFloat kEMPTY_DATA_HEIGHT = 10.0;
+
+typedef struct
+{
+    CGRect bounds;
+    CGPoint baselineOrigin;
+    CGFloat ascent;
+    CGFloat descent;
+    NSUInteger firstCaret;
+    NSUInteger caretCount;
+} EQSpatialEntry;
+
+// Carets are stored in string order, which is also left to right.
+typedef struct
+{
+    CGFloat offset;
+    NSUInteger stringIndex;
+} EQSpatialCaret;
+
+typedef struct
+{
+    CGRect bounds;
+    NSUInteger firstEntry;
+    NSUInteger entryCount;
+    NSInteger rootNode;
+} EQSpatialLine;
+
+// Leaf nodes have no children and list their entries in the entry order array.
+typedef struct
+{
+    CGRect bounds;
+    NSUInteger orderStart;
+    NSUInteger orderCount;
+    NSInteger leftNode;
+    NSInteger rightNode;
+} EQSpatialNode;
+
+typedef struct
+{
+    CGFloat sortKey;
+    NSUInteger entryIndex;
+} EQSpatialSortItem;
+
+static int EQSpatialCompareSortItems(const void *first, const void *second)
+{
+    CGFloat firstKey = ((const EQSpatialSortItem *)first)->sortKey;
+    CGFloat secondKey = ((const EQSpatialSortItem *)second)->sortKey;
+    return (firstKey < secondKey) ? -1 : ((firstKey > secondKey) ? 1 : 0);
+}
+
+// The squared distance from the point to the rect, which is zero inside the rect.
+static CGFloat EQSpatialDistanceToRect(CGRect testRect, CGPoint point)
+{
+    CGFloat dx = MAX(MAX(CGRectGetMinX(testRect) - point.x, point.x - CGRectGetMaxX(testRect)), 0.0);
+    CGFloat dy = MAX(MAX(CGRectGetMinY(testRect) - point.y, point.y - CGRectGetMaxY(testRect)), 0.0);
+    return dx * dx + dy * dy;
+}
+
+@interface EQRenderSpatialIndex()
+{
+    NSData *_lineData;
+    NSData *_entryData;
+    NSData *_caretData;
+    NSData *_nodeData;
+    NSData *_orderData;
+}
+
+- (void)addEntryForData: (EQRenderData *)renderData lineOrigin: (CGPoint)lineOrigin
+              entryData: (NSMutableData *)entryData caretData: (NSMutableData *)caretData;
+- (NSInteger)addNodeForOrder: (NSMutableData *)orderData start: (NSUInteger)orderStart count: (NSUInteger)orderCount
+                     entries: (const EQSpatialEntry *)entries nodeData: (NSMutableData *)nodeData;
+- (NSUInteger)lineIndexClosestToPoint: (CGPoint)point;
+- (NSUInteger)entryIndexClosestToPoint: (CGPoint)point inLine: (EQSpatialLine)spatialLine;
+- (NSUInteger)caretIndexClosestToOffset: (CGFloat)offset inEntry: (EQSpatialEntry)spatialEntry;
+
+@end
+
+@implementation EQRenderSpatialIndex
+
+- (id)init
+{
+    return [self initWithRenderEquation:nil];
+}
+
+- (id)initWithRenderEquation: (EQRenderEquation *)renderEquation
+{
+    self = [super init];
+    if (self)
+    {
+        NSMutableData *lineData = [[NSMutableData alloc] init];
+        NSMutableData *entryData = [[NSMutableData alloc] init];
+        NSMutableData *caretData = [[NSMutableData alloc] init];
+        NSMutableData *nodeData = [[NSMutableData alloc] init];
+        NSMutableData *orderData = [[NSMutableData alloc] init];
+
+        if (nil != renderEquation && CGSizeEqualToSize(renderEquation.drawSize, CGSizeZero))
+        {
+            [renderEquation layoutEquationLines];
+        }
+
+        NSArray *equationLines = renderEquation.equationLines;
+        for (NSUInteger i = 0; i < equationLines.count; i ++)
+        {
+            NSArray *equationLine = equationLines[i];
+            CGRect lineRect = [renderEquation drawRectForLineAtIndex:i];
+            EQSpatialLine spatialLine = {CGRectNull, entryData.length / sizeof(EQSpatialEntry), 0, -1};
+
+            for (EQRenderData *renderData in equationLine)
+            {
+                [self addEntryForData:renderData lineOrigin:lineRect.origin entryData:entryData caretData:caretData];
+                const EQSpatialEntry *entries = entryData.bytes;
+                spatialLine.bounds = CGRectUnion(spatialLine.bounds, entries[entryData.length / sizeof(EQSpatialEntry) - 1].bounds);
+                spatialLine.entryCount ++;
+            }
+
+            if (spatialLine.entryCount > 0)
+            {
+                NSUInteger orderStart = orderData.length / sizeof(NSUInteger);
+                for (NSUInteger j = 0; j < spatialLine.entryCount; j ++)
+                {
+                    NSUInteger entryIndex = spatialLine.firstEntry + j;
+                    [orderData appendBytes:&entryIndex length:sizeof(entryIndex)];
+                }
+                spatialLine.rootNode = [self addNodeForOrder:orderData start:orderStart count:spatialLine.entryCount
+                                                     entries:entryData.bytes nodeData:nodeData];
+            }
+            else
+            {
+                spatialLine.bounds = lineRect;
+            }
+            [lineData appendBytes:&spatialLine length:sizeof(spatialLine)];
+        }
+
+        self->_lineData = [lineData copy];
+        self->_entryData = [entryData copy];
+        self->_caretData = [caretData copy];
+        self->_nodeData = [nodeData copy];
+        self->_orderData = [orderData copy];
+        self->_lineCount = equationLines.count;
+    }
+    return self;
+}
+
+/*********************************
+ Building the index.
+ *********************************/
+
+// Measures the caret offset at each character boundary with a single CTLine.
+- (void)addEntryForData: (EQRenderData *)renderData lineOrigin: (CGPoint)lineOrigin
+              entryData: (NSMutableData *)entryData caretData: (NSMutableData *)caretData
+{
+    CGPoint drawOrigin = renderData.drawOrigin;
+    EQSpatialEntry spatialEntry;
+    spatialEntry.baselineOrigin = CGPointMake(lineOrigin.x + floor(drawOrigin.x), lineOrigin.y + floor(drawOrigin.y));
+    spatialEntry.firstCaret = caretData.length / sizeof(EQSpatialCaret);
+    spatialEntry.caretCount = 0;
+
+    NSAttributedString *renderString = renderData.renderString;
+    CGFloat minOffset = 0.0;
+    CGFloat maxOffset = 0.0;
+    if (nil == renderString || renderString.length == 0)
+    {
+        EQSpatialCaret spatialCaret = {0.0, 0};
+        [caretData appendBytes:&spatialCaret length:sizeof(spatialCaret)];
+        spatialEntry.caretCount = 1;
+        spatialEntry.ascent = kEMPTY_DATA_HEIGHT;
+        spatialEntry.descent = 0.0;
+    }
+    else
+    {
+        CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)renderString);
+        CGFloat ascent, descent;
+        CTLineGetTypographicBounds(line, &ascent, &descent, NULL);
+        spatialEntry.ascent = ascent;
+        spatialEntry.descent = descent;
+
+        NSString *baseString = renderString.string;
+        NSUInteger stringIndex = 0;
+        while (YES)
+        {
+            EQSpatialCaret spatialCaret = {CTLineGetOffsetForStringIndex(line, stringIndex, NULL), stringIndex};
+            [caretData appendBytes:&spatialCaret length:sizeof(spatialCaret)];
+            spatialEntry.caretCount ++;
+            minOffset = MIN(minOffset, spatialCaret.offset);
+            maxOffset = MAX(maxOffset, spatialCaret.offset);
+
+            if (stringIndex >= baseString.length)
+                break;
+            stringIndex = NSMaxRange([baseString rangeOfComposedCharacterSequenceAtIndex:stringIndex]);
+        }
+        CFRelease(line);
+    }
+
+    spatialEntry.bounds = CGRectMake(spatialEntry.baselineOrigin.x + minOffset, spatialEntry.baselineOrigin.y - spatialEntry.ascent,
+                                     MAX(maxOffset - minOffset, kCARET_WIDTH), spatialEntry.ascent + spatialEntry.descent);
+    [entryData appendBytes:&spatialEntry length:sizeof(spatialEntry)];
+}
+
+// Splits the entries at the median center along the longer side of their bounds.
+// Returns the index of the new node.
+- (NSInteger)addNodeForOrder: (NSMutableData *)orderData start: (NSUInteger)orderStart count: (NSUInteger)orderCount
+                     entries: (const EQSpatialEntry *)entries nodeData: (NSMutableData *)nodeData
+{
+    NSUInteger *order = (NSUInteger *)orderData.mutableBytes + orderStart;
+    EQSpatialNode spatialNode = {CGRectNull, orderStart, orderCount, -1, -1};
+    for (NSUInteger i = 0; i < orderCount; i ++)
+    {
+        spatialNode.bounds = CGRectUnion(spatialNode.bounds, entries[order[i]].bounds);
+    }
+
+    NSInteger nodeIndex = (NSInteger)(nodeData.length / sizeof(EQSpatialNode));
+    [nodeData appendBytes:&spatialNode length:sizeof(spatialNode)];
+    if (orderCount <= kMAX_LEAF_ENTRIES)
+        return nodeIndex;
+
+    BOOL splitOnX = (spatialNode.bounds.size.width >= spatialNode.bounds.size.height);
+    EQSpatialSortItem sortItems[orderCount];
+    for (NSUInteger i = 0; i < orderCount; i ++)
+    {
+        CGRect entryBounds = entries[order[i]].bounds;
+        sortItems[i].sortKey = splitOnX ? CGRectGetMidX(entryBounds) : CGRectGetMidY(entryBounds);
+        sortItems[i].entryIndex = order[i];
+    }
+    qsort(sortItems, orderCount, sizeof(EQSpatialSortItem), EQSpatialCompareSortItems);
+    for (NSUInteger i = 0; i < orderCount; i ++)
+    {
+        order[i] = sortItems[i].entryIndex;
+    }
+
+    NSUInteger leftCount = orderCount / 2;
+    NSInteger leftNode = [self addNodeForOrder:orderData start:orderStart count:leftCount entries:entries nodeData:nodeData];
+    NSInteger rightNode = [self addNodeForOrder:orderData start:(orderStart + leftCount) count:(orderCount - leftCount)
+                                        entries:entries nodeData:nodeData];
+
+    // The node data may have moved while adding the children.
+    EQSpatialNode *nodes = nodeData.mutableBytes;
+    nodes[nodeIndex].leftNode = leftNode;
+    nodes[nodeIndex].rightNode = rightNode;
+
+    return nodeIndex;
+}
+
+/*********************************
+ Queries.
+ *********************************/
+
+- (EQTextPosition *)closestPositionToPoint: (CGPoint)point
+{
+    if (self.lineCount == 0)
+        return nil;
+
+    NSUInteger lineIndex = [self lineIndexClosestToPoint:point];
+    EQSpatialLine spatialLine = ((const EQSpatialLine *)_lineData.bytes)[lineIndex];
+    if (spatialLine.entryCount == 0)
+        return [EQTextPosition textPositionWithIndex:0 andLocation:0 andEquationLoc:lineIndex];
+
+    NSUInteger entryIndex = [self entryIndexClosestToPoint:point inLine:spatialLine];
+    EQSpatialEntry spatialEntry = ((const EQSpatialEntry *)_entryData.bytes)[entryIndex];
+    NSUInteger caretIndex = [self caretIndexClosestToOffset:(point.x - spatialEntry.baselineOrigin.x) inEntry:spatialEntry];
+    EQSpatialCaret spatialCaret = ((const EQSpatialCaret *)_caretData.bytes)[caretIndex];
+
+    return [EQTextPosition textPositionWithIndex:spatialCaret.stringIndex andLocation:(entryIndex - spatialLine.firstEntry)
+                                  andEquationLoc:lineIndex];
+}
+
+- (CGRect)caretRectForPosition: (EQTextPosition *)textPosition
+{
+    if (nil == textPosition || textPosition.equationLoc >= self.lineCount)
+        return CGRectNull;
+
+    EQSpatialLine spatialLine = ((const EQSpatialLine *)_lineData.bytes)[textPosition.equationLoc];
+    if (textPosition.dataLoc >= spatialLine.entryCount)
+        return CGRectNull;
+
+    EQSpatialEntry spatialEntry = ((const EQSpatialEntry *)_entryData.bytes)[spatialLine.firstEntry + textPosition.dataLoc];
+    const EQSpatialCaret *carets = (const EQSpatialCaret *)_caretData.bytes + spatialEntry.firstCaret;
+
+    // Find the last caret at or before the string index.
+    NSUInteger lowIndex = 0;
+    NSUInteger highIndex = spatialEntry.caretCount;
+    while (highIndex - lowIndex > 1)
+    {
+        NSUInteger midIndex = (lowIndex + highIndex) / 2;
+        if (carets[midIndex].stringIndex <= textPosition.index)
+        {
+            lowIndex = midIndex;
+        }
+        else
+        {
+            highIndex = midIndex;
+        }
+    }
+
+    return CGRectMake(spatialEntry.baselineOrigin.x + carets[lowIndex].offset, spatialEntry.baselineOrigin.y - spatialEntry.ascent,
+                      kCARET_WIDTH, spatialEntry.ascent + spatialEntry.descent);
+}
+
+- (CGRect)boundsForDataAtLocation: (NSUInteger)dataLoc equationLoc: (NSUInteger)equationLoc
+{
+    if (equationLoc >= self.lineCount)
+        return CGRectNull;
+
+    EQSpatialLine spatialLine = ((const EQSpatialLine *)_lineData.bytes)[equationLoc];
+    if (dataLoc >= spatialLine.entryCount)
+        return CGRectNull;
+
+    return ((const EQSpatialEntry *)_entryData.bytes)[spatialLine.firstEntry + dataLoc].bounds;
+}
+
+// Lines are stacked from top to bottom, so find the first line that ends below the point.
+// The point may be in the gap above that line, so compare it with the line before.
+- (NSUInteger)lineIndexClosestToPoint: (CGPoint)point
+{
+    const EQSpatialLine *lines = _lineData.bytes;
+    NSUInteger lowIndex = 0;
+    NSUInteger highIndex = self.lineCount;
+    while (lowIndex < highIndex)
+    {
+        NSUInteger midIndex = (lowIndex + highIndex) / 2;
+        if (CGRectGetMaxY(lines[midIndex].bounds) < point.y)
+        {
+            lowIndex = midIndex + 1;
+        }
+        else
+        {
+            highIndex = midIndex;
+        }
+    }
+
+    if (lowIndex >= self.lineCount)
+        return self.lineCount - 1;
+
+    if (lowIndex > 0 && CGRectGetMinY(lines[lowIndex].bounds) > point.y)
+    {
+        CGFloat aboveDistance = point.y - CGRectGetMaxY(lines[lowIndex - 1].bounds);
+        CGFloat belowDistance = CGRectGetMinY(lines[lowIndex].bounds) - point.y;
+        if (aboveDistance < belowDistance)
+            return lowIndex - 1;
+    }
+    return lowIndex;
+}
+
+// Walks the tree nearest child first, and skips any node that is farther away than the best entry so far.
+// When the point is inside more than one entry, the smaller one is used so that nested scripts can be selected.
+- (NSUInteger)entryIndexClosestToPoint: (CGPoint)point inLine: (EQSpatialLine)spatialLine
+{
+    const EQSpatialEntry *entries = _entryData.bytes;
+    const EQSpatialNode *nodes = _nodeData.bytes;
+    const NSUInteger *order = _orderData.bytes;
+
+    NSUInteger bestEntry = spatialLine.firstEntry;
+    CGFloat bestDistance = CGFLOAT_MAX;
+    CGFloat bestArea = CGFLOAT_MAX;
+
+    NSInteger nodeStack[64];
+    NSUInteger stackCount = 0;
+    nodeStack[stackCount ++] = spatialLine.rootNode;
+    while (stackCount > 0)
+    {
+        EQSpatialNode spatialNode = nodes[nodeStack[-- stackCount]];
+        if (EQSpatialDistanceToRect(spatialNode.bounds, point) > bestDistance)
+            continue;
+
+        if (spatialNode.leftNode < 0)
+        {
+            for (NSUInteger i = 0; i < spatialNode.orderCount; i ++)
+            {
+                NSUInteger entryIndex = order[spatialNode.orderStart + i];
+                CGRect entryBounds = entries[entryIndex].bounds;
+                CGFloat entryDistance = EQSpatialDistanceToRect(entryBounds, point);
+                CGFloat entryArea = entryBounds.size.width * entryBounds.size.height;
+                if (entryDistance < bestDistance || (entryDistance == bestDistance && entryArea < bestArea))
+                {
+                    bestEntry = entryIndex;
+                    bestDistance = entryDistance;
+                    bestArea = entryArea;
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited first.
+        CGFloat leftDistance = EQSpatialDistanceToRect(nodes[spatialNode.leftNode].bounds, point);
+        CGFloat rightDistance = EQSpatialDistanceToRect(nodes[spatialNode.rightNode].bounds, point);
+        if (stackCount + 2 > sizeof(nodeStack) / sizeof(nodeStack[0]))
+            continue;
+
+        if (leftDistance <= rightDistance)
+        {
+            nodeStack[stackCount ++] = spatialNode.rightNode;
+            nodeStack[stackCount ++] = spatialNode.leftNode;
+        }
+        else
+        {
+            nodeStack[stackCount ++] = spatialNode.leftNode;
+            nodeStack[stackCount ++] = spatialNode.rightNode;
+        }
+    }
+
+    return bestEntry;
+}
+
+- (NSUInteger)caretIndexClosestToOffset: (CGFloat)offset inEntry: (EQSpatialEntry)spatialEntry
+{
+    const EQSpatialCaret *carets = (const EQSpatialCaret *)_caretData.bytes + spatialEntry.firstCaret;
+
+    // Find the first caret at or after the offset, then check the one before it.
+    NSUInteger lowIndex = 0;
+    NSUInteger highIndex = spatialEntry.caretCount - 1;
+    while (lowIndex < highIndex)
+    {
+        NSUInteger midIndex = (lowIndex + highIndex) / 2;
+        if (carets[midIndex].offset < offset)
+        {
+            lowIndex = midIndex + 1;
+        }
+        else
+        {
+            highIndex = midIndex;
+        }
+    }
+
+    if (lowIndex > 0 && (offset - carets[lowIndex - 1].offset) < (carets[lowIndex].offset - offset))
+    {
+        lowIndex --;
+    }
+    return spatialEntry.firstCaret + lowIndex;
+}
+
+@end
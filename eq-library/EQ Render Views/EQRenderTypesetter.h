@@ -58,6 +58,12 @@ extern NSString* const kRENDER_TYPESETTER_DID_CHANGE_TEXT_NOTIFICATION;
 @property (weak, nonatomic) id <EQTypesetterDelegate> typesetterDelegate;
 
 - (void) addData: (id)newData;
+
+// Inserts a run of tokens at the selection as one edit, for paste and programmatic input.
+// Each token is anything addData: accepts and is parsed in the same way, so the result matches adding them one at a time.
+// Runs of plain text are inserted at the selection once, then styled and kerned once per word.
+// Layout and the change notifications happen once at the end instead of after every token.
+- (void) addTokens: (NSArray *)tokens;
 - (void) replaceDataInRange: (EQTextRange *)textRange withData: (id)data;
 - (void) deleteBackward;
 
@@ -69,6 +75,7 @@ extern NSString* const kRENDER_TYPESETTER_DID_CHANGE_TEXT_NOTIFICATION;
 - (void)applyMathStyleToAttributedString: (NSMutableAttributedString *)inputString
                                  inRange: (NSRange)useRange useSmaller: (Boolean)useSmaller parentSmaller: (Boolean)parentSmaller;
 - (void)kernMathInAttributedString: (NSMutableAttributedString *)inputString;
+- (void)kernMathInAttributedString: (NSMutableAttributedString *)inputString editedRange: (NSRange)editedRange;
 
 // Used to handle layout and sizing of renderData.
 - (void)sizeRenderData: (NSArray *)renderData;
@@ -20,6 +20,7 @@
 #import "EQRenderFontDictionary.h"
 #import "EQRenderFracStem.h"
 #import "EQRenderMatrixStem.h"
+#import "EQRenderKerning.h"
 #import "EQInputData.h"
 #import "EQStyleConstants.h"
 #import "EQUserDefaultConstants.h"
@@ -32,6 +33,11 @@ NSString* const kRENDER_TYPESETTER_WILL_CHANGE_TEXT_NOTIFICATION = @"EQTypesette
 NSString* const kRENDER_TYPESETTER_DID_CHANGE_TEXT_NOTIFICATION = @"EQTypesetter did change text data.";
 
 @interface EQRenderTypesetter ()
+{
+    // Used by addTokens: to hold back layout and notifications until the whole run is inserted.
+    NSUInteger batchUpdateDepth;
+    BOOL batchNeedsFinishedUpdating;
+}
 
 // Used to manipulate renderStem data.
 - (NSArray *)updateRenderData: (EQRenderData *)renderData
@@ -92,6 +98,10 @@ withAttributedText: (NSAttributedString *)attributedText
                                       range: (EQTextRange *)selectedTextRange
                               andRenderData: (NSMutableArray *)renderData;
 
+// Used by addTokens: to insert consecutive plain text tokens as one run.
+- (BOOL)canAddTokenToTextRun: (id)token;
+- (NSUInteger)addTextRunFromTokens: (NSArray *)tokens atIndex: (NSUInteger)startIndex;
+
 // Send notifications using these methods.
 - (void)sendWillUpdateMarked;
 - (void)sendDidUpdateMarked;
@@ -103,6 +113,7 @@ withAttributedText: (NSAttributedString *)attributedText
 - (void)sendDidUpdateAll;
 
 - (void)sendUpdatesAndResetSelectedRange: (EQTextRange *)selectedTextRange;
+- (void)sendFinishedUpdating;
 
 @end
 
@@ -123,6 +134,8 @@ withAttributedText: (NSAttributedString *)attributedText
         self->binomialCharacterSet = [EQRenderTypesetter getBinomialOperatorSet];
         self->functionNames = [EQRenderTypesetter getFunctionNames];
         self->greekCharacterSet = [EQRenderTypesetter getGreekCharacterSet];
+        self->batchUpdateDepth = 0;
+        self->batchNeedsFinishedUpdating = NO;
     }
 
     return self;
@@ -246,6 +259,152 @@ withAttributedText: (NSAttributedString *)attributedText
     }
 }
 
+- (void) addTokens: (NSArray *)tokens
+{
+    NSAssert(nil != self.typesetterDelegate, @"Uninitialized Delegate.");
+
+    if (nil == tokens || tokens.count == 0)
+        return;
+
+    [self sendWillUpdateAll];
+    self->batchUpdateDepth ++;
+
+    // Runs of plain text are inserted at once. Everything else, including text that moves the selection, goes through addData:.
+    NSUInteger tokenIndex = 0;
+    while (tokenIndex < tokens.count)
+    {
+        id token = tokens[tokenIndex];
+
+        // A return can add an equation line, which needs the line bookkeeping done by a layout pass.
+        if ([token isKindOfClass:[NSString class]] && [token isEqualToString:@"\n"] && self->batchNeedsFinishedUpdating == YES)
+        {
+            self->batchNeedsFinishedUpdating = NO;
+            [self.typesetterDelegate sendFinishedUpdating];
+        }
+
+        NSUInteger runCount = [self addTextRunFromTokens:tokens atIndex:tokenIndex];
+        if (runCount > 0)
+        {
+            tokenIndex += runCount;
+            continue;
+        }
+        [self addData:token];
+        tokenIndex ++;
+    }
+
+    self->batchUpdateDepth --;
+    if (self->batchUpdateDepth == 0)
+    {
+        if (self->batchNeedsFinishedUpdating == YES)
+        {
+            self->batchNeedsFinishedUpdating = NO;
+            [self.typesetterDelegate sendFinishedUpdating];
+        }
+        [self sendDidUpdateAll];
+    }
+}
+
+// Plain text that addText: would insert at the selection without treating it as a command.
+- (BOOL)canAddTokenToTextRun: (id)token
+{
+    if (![token isKindOfClass:[NSString class]] || [(NSString *)token length] == 0)
+        return NO;
+
+    return !([token isEqualToString:@"\n"] || [token isEqualToString:@"^"] || [token isEqualToString:@"_"] || [token isEqualToString:@"\\"]);
+}
+
+// Inserts the plain text tokens starting at startIndex as one run and returns how many were used.
+// Returns 0 when the selection needs the extra handling in addText:, so the caller should use addData: instead.
+// Each token is parsed with the same helpers as addText:, against the text inserted so far.
+// The run is then inserted once, and each word in it is styled and kerned once.
+- (NSUInteger)addTextRunFromTokens: (NSArray *)tokens atIndex: (NSUInteger)startIndex
+{
+    if (![self canAddTokenToTextRun:tokens[startIndex]])
+        return 0;
+
+    NSMutableArray *renderData = [self.typesetterDelegate getRenderData];
+    if (renderData.count == 0)
+        return 0;
+
+    EQTextRange *markedTextRange = [self.typesetterDelegate getMarkedTextRange];
+    EQTextRange *selectedTextRange = [self.typesetterDelegate getSelectedTextRange];
+    EQRenderData *markedData = [self renderData:renderData dataContainingTextRange:markedTextRange];
+    EQRenderData *selectedData = [self renderData:renderData dataContainingTextRange:selectedTextRange];
+
+    // Marked text, selected ranges and the placeholder space are all replaced by addText:.
+    if (nil != markedData || nil == selectedData || selectedTextRange.range.length > 0
+        || [selectedData.renderString.string isEqualToString:@" "])
+        return 0;
+
+    // Large op and radical data move the selection before inserting.
+    EQRenderStem *selectedParent = selectedData.parentStem;
+    if (nil != selectedParent && ((selectedParent.isLargeOpStemType && [selectedParent.getFirstChild isEqual:selectedData])
+                                  || (selectedParent.hasSupplementaryData && [selectedParent.supplementaryData isEqual:selectedData])))
+        return 0;
+
+    Boolean useSmaller = selectedData.shouldUseSmaller;
+    Boolean parentSmaller = FALSE;
+    if (nil != selectedParent)
+    {
+        if (useSmaller == YES && selectedParent.stemType == stemTypeRow)
+        {
+            parentSmaller = selectedParent.shouldUseSmallest;
+        }
+        else
+        {
+            parentSmaller = selectedParent.shouldUseSmaller;
+        }
+    }
+
+    // Operator and function name checks look at the text before the selection, so parse against a copy that has the run so far.
+    NSUInteger runLoc = selectedTextRange.range.location;
+    NSUInteger selectionLoc = runLoc;
+    NSMutableAttributedString *parseString = [[NSMutableAttributedString alloc] initWithString:selectedData.renderString.string];
+    NSUInteger tokenIndex = startIndex;
+    while (tokenIndex < tokens.count && [self canAddTokenToTextRun:tokens[tokenIndex]])
+    {
+        NSString *text = [self parseTextForOperation:tokens[tokenIndex] atSelectionLoc:NSMakeRange(selectionLoc, 0)
+                                  inAttributedString:parseString useSmaller:useSmaller withData:selectedData];
+
+        // The same check as addText: to avoid adding a duplicate space.
+        if (text.length > 1 && [text hasPrefix:@" "] && selectionLoc > 0 && [parseString.string characterAtIndex:(selectionLoc - 1)] == ' ')
+        {
+            text = [text substringFromIndex:1];
+        }
+        [parseString replaceCharactersInRange:NSMakeRange(selectionLoc, 0) withString:text];
+        selectionLoc += text.length;
+        tokenIndex ++;
+    }
+
+    NSString *runText = [parseString.string substringWithRange:NSMakeRange(runLoc, selectionLoc - runLoc)];
+    [selectedData insertText:runText atPosition:selectedTextRange.textPosition];
+
+    selectedTextRange = [EQTextRange textRangeWithRange:NSMakeRange(selectionLoc, 0) andLocation:selectedTextRange.dataLoc
+                                         andEquationLoc:selectedTextRange.equationLoc];
+    [self.typesetterDelegate sendUpdateSelectedTextRange:selectedTextRange];
+
+    // Style one word at a time, as the function name and derivative checks only look at the last word in their range.
+    // Earlier text was already styled and kerned, so start from the word the run was inserted into.
+    NSString *renderStr = selectedData.renderString.string;
+    NSCharacterSet *spaceSet = [NSCharacterSet whitespaceCharacterSet];
+    NSRange spaceRange = [renderStr rangeOfCharacterFromSet:spaceSet options:NSBackwardsSearch range:NSMakeRange(0, runLoc)];
+    NSUInteger wordLoc = (spaceRange.location == NSNotFound) ? 0 : spaceRange.location;
+    NSUInteger segmentLoc = wordLoc;
+    while (segmentLoc < selectionLoc)
+    {
+        NSRange nextSpaceRange = [renderStr rangeOfCharacterFromSet:spaceSet options:0
+                                                              range:NSMakeRange(segmentLoc + 1, selectionLoc - segmentLoc - 1)];
+        NSUInteger segmentEnd = (nextSpaceRange.location == NSNotFound) ? selectionLoc : nextSpaceRange.location;
+        [self applyMathStyleToAttributedString:selectedData.renderString inRange:NSMakeRange(segmentLoc, segmentEnd - segmentLoc)
+                                    useSmaller:useSmaller parentSmaller:parentSmaller];
+        segmentLoc = segmentEnd;
+    }
+    [self kernMathInAttributedString:selectedData.renderString editedRange:NSMakeRange(wordLoc, selectionLoc - wordLoc)];
+
+    [self sendFinishedUpdating];
+    return tokenIndex - startIndex;
+}
+
 // Another possible entry point, though not likely to be used outside of a UITextInput context.
 - (void)replaceDataInRange:(EQTextRange *)textRange withData:(id)data
 {
@@ -523,7 +682,7 @@ withAttributedText: (NSAttributedString *)attributedText
     [self.typesetterDelegate sendUpdateMarkedTextRange:markedTextRange];
     selectedTextRange = [EQTextRange textRangeWithRange:selectedNSRange andLocation:selectedLoc andEquationLoc:selectedEqLoc];
     [self.typesetterDelegate sendUpdateSelectedTextRange:selectedTextRange];
-    [self.typesetterDelegate sendFinishedUpdating];
+    [self sendFinishedUpdating];
     [self sendDidUpdateAll];
 }
 
@@ -597,7 +756,7 @@ withAttributedText: (NSAttributedString *)attributedText
             UIFont *testFont = [inputString attribute:NSFontAttributeName atIndex:substringRange.location effectiveRange:nil];
             if (testFont.pointSize <= kDEFAULT_FONT_SIZE)
             {
-                [inputString addAttributes:attribDictRegular range:substringRange];
+                [EQRenderFontDictionary addAttributes:attribDictRegular toAttributedString:inputString range:substringRange];
             }
         }
     }];
@@ -624,7 +783,7 @@ withAttributedText: (NSAttributedString *)attributedText
                     kernValue = @(2.0);
                 }
                 NSDictionary *attribDictAlt = [EQRenderFontDictionary fontDictWithName:kALT_GLYPH_FONT size:testFont.pointSize kernValue:kernValue.floatValue];
-                [inputString addAttributes:attribDictAlt range:substringRange];
+                [EQRenderFontDictionary addAttributes:attribDictAlt toAttributedString:inputString range:substringRange];
             }
         }
     }];
@@ -656,7 +815,7 @@ withAttributedText: (NSAttributedString *)attributedText
         if (userDefinedCheck.boolValue == YES || plainTextCheck.boolValue == YES)
             return;
 
-        [inputString addAttributes:attribDictRegular range:lastWordRange];
+        [EQRenderFontDictionary addAttributes:attribDictRegular toAttributedString:inputString range:lastWordRange];
         return;
     }
 
@@ -709,12 +868,12 @@ withAttributedText: (NSAttributedString *)attributedText
          if (substringRange.length > 1)
          {
              // We should automatically assume that multi-character composed sequences are non-italic.
-             [inputString addAttributes:attribDictRegular range:substringRange];
+             [EQRenderFontDictionary addAttributes:attribDictRegular toAttributedString:inputString range:substringRange];
              prevWasVariable = NO;
          }
          else if (greekCharRange.location != NSNotFound && useItalicGreeksNum.boolValue == NO)
          {
-             [inputString addAttributes:attribDictRegular range:substringRange];
+             [EQRenderFontDictionary addAttributes:attribDictRegular toAttributedString:inputString range:substringRange];
              prevWasVariable = YES;
          }
          else
@@ -732,7 +891,7 @@ withAttributedText: (NSAttributedString *)attributedText
                  // This can be a preference as well.
                  if ([subString isEqualToString:@"d"] && (prevWasVariable == YES || prevWasLeftBracket) && useRomanDerivsNum.boolValue == YES)
                  {
-                     [inputString addAttributes:attribDictRegular range:substringRange];
+                     [EQRenderFontDictionary addAttributes:attribDictRegular toAttributedString:inputString range:substringRange];
                      prevWasVariable = NO;
                  }
                  else if (curIsLeftBracket)
@@ -741,7 +900,7 @@ withAttributedText: (NSAttributedString *)attributedText
                  }
                  else
                  {
-                     [inputString addAttributes:attribDictItalic range:substringRange];
+                     [EQRenderFontDictionary addAttributes:attribDictItalic toAttributedString:inputString range:substringRange];
                      if ([subString isEqualToString:@" "])
                      {
                          prevWasVariable = NO;
@@ -1018,143 +1177,20 @@ withAttributedText: (NSAttributedString *)attributedText
     NSDictionary *fontAttributes = [selectedData.renderString attributesAtIndex:selectedTextRange.range.location effectiveRange:nil];
 
     NSDictionary *newAttributes = [self applySelectionStyle:applyStyle toAttributes:fontAttributes];
-    [selectedData.renderString addAttributes:newAttributes range:selectedTextRange.range];
+    [EQRenderFontDictionary addAttributes:newAttributes toAttributedString:selectedData.renderString range:selectedTextRange.range];
     [self sendUpdatesAndResetSelectedRange:selectedTextRange];
 }
 
 // This method goes through the entire string and performs kerning depending upon whether it is a number, decimal, etc.
 - (void)kernMathInAttributedString: (NSMutableAttributedString *)inputString
 {
-    if (nil == inputString || inputString.length == 0)
-        return;
-
-    __block BOOL previousWasDecimal = NO;
-    __block BOOL previousWasNumeral = NO;
-    __block BOOL previousWasWhitespace = NO;
-    __block BOOL previousWasTrailingCharacter = NO;
-    __block BOOL previousWasRightBracket = NO;
-    __block BOOL previousWasDeriv = NO;
-    [inputString.string enumerateSubstringsInRange:NSMakeRange(0, inputString.length)
-                                           options:(NSStringEnumerationByComposedCharacterSequences | NSStringEnumerationReverse)
-     usingBlock: ^(NSString *subString, NSRange subStringRange, NSRange enclosingRange, BOOL *stop)
-     {
-         BOOL currentIsNumeral = [subString rangeOfCharacterFromSet:[NSCharacterSet decimalDigitCharacterSet]].location != NSNotFound;
-
-         // If you have a plain text string, then just reset everything and move on.
-         NSNumber *plainTextCheck = [inputString attribute:kUSES_PLAIN_TEXT atIndex:subStringRange.location effectiveRange:nil];
-         plainTextCheck == nil ? plainTextCheck = @(NO) : plainTextCheck;
-         if (plainTextCheck.boolValue == YES)
-         {
-             previousWasDecimal = NO;
-             previousWasNumeral = NO;
-             previousWasWhitespace = NO;
-             previousWasTrailingCharacter = NO;
-             previousWasRightBracket = NO;
-             previousWasDeriv = NO;
-             return;
-         }
-         if ([subString isEqualToString:@"."])
-         {
-             NSNumber *kernValue = [NSNumber numberWithFloat:3.0f];
-             if (previousWasNumeral)
-                 kernValue = [NSNumber numberWithFloat:0.0f];
-             [inputString addAttribute:NSKernAttributeName value:kernValue range:subStringRange];
-             previousWasDecimal = YES;
-             previousWasDeriv = NO;
-         }
-         else if ([subString isEqualToString:@","] && !previousWasNumeral && !previousWasDecimal && !previousWasWhitespace)
-         {
-             NSNumber *kernValue = [NSNumber numberWithFloat:4.0f];
-             [inputString addAttribute:NSKernAttributeName value:kernValue range:subStringRange];
-             previousWasDecimal = NO;
-             previousWasDeriv = NO;
-         }
-         else if ([self->unaryOperations objectForKey:subString] != nil)
-         {
-             if (!previousWasWhitespace)
-                 [inputString addAttribute:NSKernAttributeName value:@(3.0f) range:subStringRange];
-             previousWasDecimal = NO;
-             previousWasDeriv = NO;
-         }
-         else if ([self->leftBracketCharacters containsObject:subString])
-         {
-             if (previousWasTrailingCharacter)
-                 [inputString addAttribute:NSKernAttributeName value:@(6.0f) range:subStringRange];
-             else if (!previousWasWhitespace)
-                 [inputString addAttribute:NSKernAttributeName value:@(3.0f) range:subStringRange];
+    [EQRenderKerning kernMathInAttributedString:inputString];
+}
 
-             previousWasDecimal = NO;
-             previousWasDeriv = NO;
-         }
-         else if (currentIsNumeral)
-         {
-             NSNumber *kernValue = @(0.0f);
-             if (previousWasDecimal)
-             {
-                 kernValue = @(2.0f);
-             }
-             else if (!previousWasNumeral)
-             {
-                 if (subStringRange.location >= (inputString.length - 1))
-                 {
-                     kernValue = @(1.5f);
-                 }
-                 else
-                 {
-                     kernValue = @(3.0f);
-                 }
-             }
-             [inputString addAttribute:NSKernAttributeName value:kernValue range:subStringRange];
-             previousWasDecimal = NO;
-             previousWasDeriv = NO;
-         }
-         // Need to handle italic "f" differently.
-         // May need to check that it *is* italic later on.
-         else if ([subString isEqualToString:@"f"] && !previousWasWhitespace)
-         {
-             NSNumber *kernValue = [NSNumber numberWithFloat:3.0f];
-             [inputString addAttribute:NSKernAttributeName value:kernValue range:subStringRange];
-             previousWasDecimal = NO;
-             previousWasDeriv = NO;
-         }
-         // May also do a preference check here.
-         else if (previousWasDeriv)
-         {
-             NSNumber *kernValue = [NSNumber numberWithFloat:6.0f];
-             [inputString addAttribute:NSKernAttributeName value:kernValue range:subStringRange];
-             previousWasDecimal = NO;
-             previousWasDeriv = NO;
-         }
-         else
-         {
-             // Should test that you aren't altering a previously established size or other attributes.
-             // May need to expand this further later on.
-             UIFont *testFont = [inputString attribute:NSFontAttributeName atIndex:subStringRange.location effectiveRange:nil];
-             if (testFont.pointSize <= kDEFAULT_FONT_SIZE)
-             {
-                 NSNumber *kernValue = @(1.5f);
-                 // Check if your character is near a right bracket (and is not one itself).
-                 if (previousWasRightBracket && ![rightBracketCharacters containsObject:subString])
-                 {
-                     kernValue = @(3.0f);
-                 }
-                 [inputString addAttribute:NSKernAttributeName value:kernValue range:subStringRange];
-                 previousWasDecimal = NO;
-             }
-             if (([subString isEqualToString:@"d"] || [subString isEqualToString:@"∂"]) && [testFont.fontName isEqualToString:kDEFAULT_FONT])
-             {
-                 previousWasDeriv = YES;
-             }
-             else
-             {
-                 previousWasDeriv = NO;
-             }
-         }
-         previousWasNumeral = currentIsNumeral;
-         previousWasWhitespace = [subString rangeOfCharacterFromSet:[NSCharacterSet whitespaceCharacterSet]].location != NSNotFound;
-         previousWasTrailingCharacter = [self->trailingCharacterSet containsObject:subString];
-         previousWasRightBracket = [self->rightBracketCharacters containsObject:subString];
-     }];
+// Only kerns the edited range and the characters next to it that depend on it.
+- (void)kernMathInAttributedString: (NSMutableAttributedString *)inputString editedRange: (NSRange)editedRange
+{
+    [EQRenderKerning kernMathInAttributedString:inputString editedRange:editedRange];
 }
 
 // Currently doesn't do any processing, just compares the text against a dictionary and does a substitution.
@@ -1545,7 +1581,7 @@ withAttributedText: (NSAttributedString *)attributedText
              ^(UIFont *useFont, NSRange range, BOOL *stop)
             {
                 useFont = [UIFont fontWithName:useFont.fontName size:kDEFAULT_FONT_SIZE_SMALL];
-                [editStr addAttribute:NSFontAttributeName value:useFont range:range];
+                [EQRenderFontDictionary addAttributes:@{NSFontAttributeName: useFont} toAttributedString:editStr range:range];
             }];
             attributedText = editStr.copy;
         }
@@ -1719,15 +1755,28 @@ withAttributedText: (NSAttributedString *)attributedText
     // Ignore for custom text strings.
     if (nil == customTextStr)
     {
-        if (selectedNSRange.location != NSNotFound)
+        if (selectedNSRange.location != NSNotFound && selectedNSRange.location <= selectedData.renderString.length)
         {
-            [self applyMathStyleToAttributedString:selectedData.renderString inRange:NSMakeRange(0, selectedNSRange.location) useSmaller:useSmaller
+            // Earlier text was already styled and kerned when it was typed, so only restyle from the start of the current word.
+            // That still covers the function name and derivative checks, which only look at the last word.
+            NSUInteger insertLoc = (selectedNSRange.location > text.length) ? selectedNSRange.location - text.length : 0;
+            NSRange spaceRange = [selectedData.renderString.string rangeOfCharacterFromSet:[NSCharacterSet whitespaceCharacterSet]
+                                                                                   options:NSBackwardsSearch
+                                                                                     range:NSMakeRange(0, insertLoc)];
+            NSUInteger wordLoc = (spaceRange.location == NSNotFound) ? 0 : spaceRange.location;
+            NSRange editedRange = NSMakeRange(wordLoc, selectedNSRange.location - wordLoc);
+
+            [self applyMathStyleToAttributedString:selectedData.renderString inRange:editedRange useSmaller:useSmaller
              parentSmaller:parentSmaller];
+            [self kernMathInAttributedString:selectedData.renderString editedRange:editedRange];
+        }
+        else
+        {
+            [self kernMathInAttributedString:selectedData.renderString];
         }
-        [self kernMathInAttributedString:selectedData.renderString];
     }
 
-    [self.typesetterDelegate sendFinishedUpdating];
+    [self sendFinishedUpdating];
     [self sendDidUpdateAll];
     return;
 }
@@ -1894,10 +1943,7 @@ withAttributedText: (NSAttributedString *)attributedText
 - (void)clearTrailingKernInAttributedString: (NSMutableAttributedString *)renderString
 {
     NSRange updateRange = NSMakeRange((renderString.length -1), 1);
-    NSDictionary *oldDict = [renderString attributesAtIndex:updateRange.location effectiveRange:NULL];
-    NSMutableDictionary *newDict = oldDict.mutableCopy;
-    newDict[NSKernAttributeName] = @0.0;
-    [renderString setAttributes:newDict range:updateRange];
+    [EQRenderFontDictionary addAttributes:@{NSKernAttributeName: @0.0} toAttributedString:renderString range:updateRange];
 }
 
 - (NSRange)findRootRangeForRange: (NSRange)useRange RenderData: (EQRenderData *)renderData withStemType: (EQRenderStemType)stemType
@@ -3439,100 +3485,149 @@ withAttributedText: (NSAttributedString *)attributedText
 
 /*
     Internal methods used to build the dictionaries to parse some of the strings.
-    This could be used in an initialize method, but for now, we're going ahead and
-    putting it in the class init method instead.
+    Each one is only built once and then shared, as they are called throughout layout.
 */
 
 // Only used to parse characters that need converted from qwerty keyboard values.
 + (NSDictionary *)getBinomialOperators
 {
-    NSDictionary *returnDict = @{
-                                  @"-" : @" − ",
-                                  @"*" : @" ⋅ ",
-                                  @"/" : @"∕",
-                                  @"∕" : @"∕",
-                                  @"|" : @" ∣ ",
-                                };
-    return returnDict;
+    static NSDictionary *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSDictionary *returnDict = @{
+                                      @"-" : @" − ",
+                                      @"*" : @" ⋅ ",
+                                      @"/" : @"∕",
+                                      @"∕" : @"∕",
+                                      @"|" : @" ∣ ",
+                                    };
+        storedValue = returnDict;
+    });
+    return storedValue;
 }
 
 + (NSDictionary *)getUnaryOperators
 {
-    NSDictionary *returnDict = @{
-                                 @"+" : @"+",
-                                 @"-" : @"−",
-                                 @"−" : @"−", // in case the hyphen was already turned to minus sign.
-                                };
-    return returnDict;
+    static NSDictionary *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSDictionary *returnDict = @{
+                                     @"+" : @"+",
+                                     @"-" : @"−",
+                                     @"−" : @"−", // in case the hyphen was already turned to minus sign.
+                                    };
+        storedValue = returnDict;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getLeftBracketCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:
-                        @"(",
-                        @"[",
-                        @"⌈",
-                        @"⌊",
-                        @"{",
-                        @"⟨", //left angle bracers
-                        @"⟪", //double left angle bracers
-                        nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:
+                            @"(",
+                            @"[",
+                            @"⌈",
+                            @"⌊",
+                            @"{",
+                            @"⟨", //left angle bracers
+                            @"⟪", //double left angle bracers
+                            nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getRightBracketCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:
-                        @")",
-                        @"]",
-                        @"⌉",
-                        @"⌋",
-                        @"}",
-                        @"⟩", //angle bracers
-                        @"⟫", //right angle bracers
-                        nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:
+                            @")",
+                            @"]",
+                            @"⌉",
+                            @"⌋",
+                            @"}",
+                            @"⟩", //angle bracers
+                            @"⟫", //right angle bracers
+                            nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getDescenderCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:@"f", @"g", @"j", @"p", @"q", @"y", nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:@"f", @"g", @"j", @"p", @"q", @"y", nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 // Used to indicate characters that extend too far left when italic.
 // May also need to check if it *is* italic later.
 + (NSSet *)getTrailingCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects: @"f", @"j", @"y", nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects: @"f", @"j", @"y", nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getItalicAdjustCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects: @"C", @"E", @"F", @"G", @"I", @"J", @"M", @"S", @"T", @"U", @"V", @"W", @"Y", nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects: @"C", @"E", @"F", @"G", @"I", @"J", @"M", @"S", @"T", @"U", @"V", @"W", @"Y", nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getLeftTrailingCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects: @"a", @"b", @"d", @"f", @"g", @"i", @"j", @"p", @"r", @"x", @"y", nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects: @"a", @"b", @"d", @"f", @"g", @"i", @"j", @"p", @"r", @"x", @"y", nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 // For string searching, you may need a character set instead of just a set of individual characters.
 + (NSCharacterSet *)getDescenderCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"fgjpqy"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"fgjpqy"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getCapAndNumberCharacterSet
 {
-    NSMutableCharacterSet *capAndNumCharacterSet = [[NSMutableCharacterSet alloc] init];
-    [capAndNumCharacterSet formUnionWithCharacterSet:[NSCharacterSet uppercaseLetterCharacterSet]];
-    [capAndNumCharacterSet formUnionWithCharacterSet:[NSCharacterSet decimalDigitCharacterSet]];
-    return [capAndNumCharacterSet copy];
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableCharacterSet *capAndNumCharacterSet = [[NSMutableCharacterSet alloc] init];
+        [capAndNumCharacterSet formUnionWithCharacterSet:[NSCharacterSet uppercaseLetterCharacterSet]];
+        [capAndNumCharacterSet formUnionWithCharacterSet:[NSCharacterSet decimalDigitCharacterSet]];
+        storedValue = [capAndNumCharacterSet copy];
+    });
+    return storedValue;
 }
 
 // For stretchy bracers, it will have separate character sets in case you want to identify bracers that are left/right but not stretchy.
@@ -3540,258 +3635,393 @@ withAttributedText: (NSAttributedString *)attributedText
 
 + (NSSet *)getStretchyBracerCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:
-                        @"(",
-                        @")",
-                        @"[",
-                        @"]",
-                        @"⌈",
-                        @"⌉",
-                        @"⌊",
-                        @"⌋",
-                        @"{",
-                        @"}",
-                        @"⟨", //left and right angle bracers
-                        @"⟩",
-                        @"⟪", //double left and right angle bracers
-                        @"⟫",
-                        @"|", // ascii vertical bar
-                        @"‖", // double vertical bar
-                        nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:
+                            @"(",
+                            @")",
+                            @"[",
+                            @"]",
+                            @"⌈",
+                            @"⌉",
+                            @"⌊",
+                            @"⌋",
+                            @"{",
+                            @"}",
+                            @"⟨", //left and right angle bracers
+                            @"⟩",
+                            @"⟪", //double left and right angle bracers
+                            @"⟫",
+                            @"|", // ascii vertical bar
+                            @"‖", // double vertical bar
+                            nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getLeftStretchyBracerCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:
-                        @"(",
-                        @"[",
-                        @"⌈",
-                        @"⌊",
-                        @"{",
-                        @"⟨", //left angle bracers
-                        @"⟪", //double left angle bracers
-                        nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:
+                            @"(",
+                            @"[",
+                            @"⌈",
+                            @"⌊",
+                            @"{",
+                            @"⟨", //left angle bracers
+                            @"⟪", //double left angle bracers
+                            nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getRightStretchyBracerCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:
-                        @")",
-                        @"]",
-                        @"⌉",
-                        @"⌋",
-                        @"}",
-                        @"⟩", //angle bracers
-                        @"⟫", //right angle bracers
-                        nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:
+                            @")",
+                            @"]",
+                            @"⌉",
+                            @"⌋",
+                            @"}",
+                            @"⟩", //angle bracers
+                            @"⟫", //right angle bracers
+                            nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getVerticalStretchyBracerCharacters
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:
-                        @"|", // ascii vertical bar
-                        @"‖", // double vertical bar
-                        nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:
+                            @"|", // ascii vertical bar
+                            @"‖", // double vertical bar
+                            nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSSet *)getFunctionNames
 {
-    NSSet *returnSet = [[NSSet alloc] initWithObjects:
-                        @"sin", @"cos", @"tan",
-                        @"sec", @"csc", @"cot",
-                        @"arcsin", @"arccos", @"arctan",
-                        @"arcsec", @"arccsc", @"arccot",
-                        @"sinh", @"cosh", @"tanh",
-                        @"sech", @"csch", @"coth",
-                        @"arcsinh", @"arccosh", @"arctanh",
-                        @"arcsech", @"arccsch", @"arccoth",
-                        @"ln", @"lg", @"lb", @"log",
-                        @"ker", @"lim", @"dim", @"det",
-                        nil];
-    return returnSet;
+    static NSSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSSet *returnSet = [[NSSet alloc] initWithObjects:
+                            @"sin", @"cos", @"tan",
+                            @"sec", @"csc", @"cot",
+                            @"arcsin", @"arccos", @"arctan",
+                            @"arcsec", @"arccsc", @"arccot",
+                            @"sinh", @"cosh", @"tanh",
+                            @"sech", @"csch", @"coth",
+                            @"arcsinh", @"arccosh", @"arctanh",
+                            @"arcsech", @"arccsch", @"arccoth",
+                            @"ln", @"lg", @"lb", @"log",
+                            @"ker", @"lim", @"dim", @"det",
+                            nil];
+        storedValue = returnSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getOperatorCharacterSet
 {
-    NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
-    NSCharacterSet *standardOps = [NSCharacterSet characterSetWithCharactersInString:@"+−−⋅⋅∕∕=><∣"];
-    [returnCharacterSet formUnionWithCharacterSet:standardOps];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getLargeOpCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getBracerCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getMiscOperatorCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getEqualityCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getUncommonOperatorCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getSetTheoryCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getArrowCharacters]];
-
-    return returnCharacterSet.copy;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
+        NSCharacterSet *standardOps = [NSCharacterSet characterSetWithCharactersInString:@"+−−⋅⋅∕∕=><∣"];
+        [returnCharacterSet formUnionWithCharacterSet:standardOps];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getLargeOpCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getBracerCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getMiscOperatorCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getEqualityCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getUncommonOperatorCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getSetTheoryCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getArrowCharacters]];
+
+        storedValue = returnCharacterSet.copy;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getLargeOpCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∫∬∭⨌∮∯∰∱⨑∲∳∑∏∐⅀⨊⨒⨓⨔⨕⨍⨎⨏⨐⨖⨗⨋⨘⨙⨚⨛⨜⨉⋀⨇⋁⨈⋂⋃⨀⨁⨂⨃⨄⨅⨆"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∫∬∭⨌∮∯∰∱⨑∲∳∑∏∐⅀⨊⨒⨓⨔⨕⨍⨎⨏⨐⨖⨗⨋⨘⨙⨚⨛⨜⨉⋀⨇⋁⨈⋂⋃⨀⨁⨂⨃⨄⨅⨆"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getSumOpCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∑∏∐⅀⨊⨉⋀⨇⋁⨈⋂⋃⨀⨁⨂⨃⨄⨅⨆"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∑∏∐⅀⨊⨉⋀⨇⋁⨈⋂⋃⨀⨁⨂⨃⨄⨅⨆"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getBinomialOperatorSet
 {
-    NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
-
-    // Add existing sets that are all infix operators.
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getEqualityCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getUncommonOperatorCharacterSet]];
-    [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getArrowCharacters]];
-
-    // Set theory infix set.
-    NSCharacterSet *addSet = [NSCharacterSet characterSetWithCharactersInString:@"∁∧∨⊻⊼∩∪∖∴∵∝∎∶∷∈∉∋∌⊂⊃⊄⊅⊆⊇⊈⊉⊊⊋≺≻⊀⊁≼≽≾≿⋞⋟⋠⋡⋨⋩⊏⊐⊑⊒⋢⋣⋤⋥⋐⋑⋒⋓⋔⋎⋏⊓⊔"];
-    [returnCharacterSet formUnionWithCharacterSet:addSet];
-
-    // Misc operator infix set.
-    addSet = [NSCharacterSet characterSetWithCharactersInString:@"+-−⋅×/∕÷±∓∆⋄∙∘∗∣∖∤∶∷⦂∝∹∺⨥∔⨢∸∻∼∽∾∿≀⨤⨦≂≁⨧⧺⧻⋇⋈⋉⋊⋋⋌"];
-    [returnCharacterSet formUnionWithCharacterSet:addSet];
-
-    // Geometry operator infix set.
-    addSet = [NSCharacterSet characterSetWithCharactersInString:@"∟⦦∣∤∥∦⊿⦢⦣⦧⦡⦛⦠⊾⦜⦝⊥⊢⊣⊤"];
-    [returnCharacterSet formUnionWithCharacterSet:addSet];
-
-    return returnCharacterSet.copy;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
+
+        // Add existing sets that are all infix operators.
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getEqualityCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getUncommonOperatorCharacterSet]];
+        [returnCharacterSet formUnionWithCharacterSet:[EQRenderTypesetter getArrowCharacters]];
+
+        // Set theory infix set.
+        NSCharacterSet *addSet = [NSCharacterSet characterSetWithCharactersInString:@"∁∧∨⊻⊼∩∪∖∴∵∝∎∶∷∈∉∋∌⊂⊃⊄⊅⊆⊇⊈⊉⊊⊋≺≻⊀⊁≼≽≾≿⋞⋟⋠⋡⋨⋩⊏⊐⊑⊒⋢⋣⋤⋥⋐⋑⋒⋓⋔⋎⋏⊓⊔"];
+        [returnCharacterSet formUnionWithCharacterSet:addSet];
+
+        // Misc operator infix set.
+        addSet = [NSCharacterSet characterSetWithCharactersInString:@"+-−⋅×/∕÷±∓∆⋄∙∘∗∣∖∤∶∷⦂∝∹∺⨥∔⨢∸∻∼∽∾∿≀⨤⨦≂≁⨧⧺⧻⋇⋈⋉⋊⋋⋌"];
+        [returnCharacterSet formUnionWithCharacterSet:addSet];
+
+        // Geometry operator infix set.
+        addSet = [NSCharacterSet characterSetWithCharactersInString:@"∟⦦∣∤∥∦⊿⦢⦣⦧⦡⦛⦠⊾⦜⦝⊥⊢⊣⊤"];
+        [returnCharacterSet formUnionWithCharacterSet:addSet];
+
+        storedValue = returnCharacterSet.copy;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getNumberCharacterSet
 {
-    NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
-    [returnCharacterSet formUnionWithCharacterSet:[NSCharacterSet decimalDigitCharacterSet]];
-    [returnCharacterSet addCharactersInString:@".,%"];
-    return returnCharacterSet.copy;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
+        [returnCharacterSet formUnionWithCharacterSet:[NSCharacterSet decimalDigitCharacterSet]];
+        [returnCharacterSet addCharactersInString:@".,%"];
+        storedValue = returnCharacterSet.copy;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getStretchyBracerSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"()[]⌈⌉⌊⌋{}⟨⟩⟪⟫|‖"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"()[]⌈⌉⌊⌋{}⟨⟩⟪⟫|‖"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getBracerCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"(){}[]⌈⌉⌊⌋⟨⟩⟪⟫⧼⧽⦉⦊⦑⦒⦗⦘⟬⟭⟮⟯⟦⟧⦃⦄⦋⦌⦍⦎⦏⦐⦅⦆⦇⦈|‖"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"(){}[]⌈⌉⌊⌋⟨⟩⟪⟫⧼⧽⦉⦊⦑⦒⦗⦘⟬⟭⟮⟯⟦⟧⦃⦄⦋⦌⦍⦎⦏⦐⦅⦆⦇⦈|‖"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getGreekCapCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"ΑΒΓΔΕΖΗΘΙΚΛΜΝΞΟΠΡΣΤΥΦΧΨΩϚϴ"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"ΑΒΓΔΕΖΗΘΙΚΛΜΝΞΟΠΡΣΤΥΦΧΨΩϚϴ"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getGreekLowerCaseCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"αβγδεζηθικλμνξοπρστυϕχψωφϑϵ"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"αβγδεζηθικλμνξοπρστυϕχψωφϑϵ"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getGreekCharacterSet
 {
-    NSMutableCharacterSet *returnSet = [[NSMutableCharacterSet alloc] init];
-    [returnSet formUnionWithCharacterSet:[EQRenderTypesetter getGreekCapCharacterSet]];
-    [returnSet formUnionWithCharacterSet:[EQRenderTypesetter getGreekLowerCaseCharacterSet]];
-    return returnSet.copy;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableCharacterSet *returnSet = [[NSMutableCharacterSet alloc] init];
+        [returnSet formUnionWithCharacterSet:[EQRenderTypesetter getGreekCapCharacterSet]];
+        [returnSet formUnionWithCharacterSet:[EQRenderTypesetter getGreekLowerCaseCharacterSet]];
+        storedValue = returnSet.copy;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getMiscIdentifierCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∞Ɛℇℎℏ℘ℵℶℷℸ"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∞Ɛℇℎℏ℘ℵℶℷℸ"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getMiscNumericCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"Ω℧µ°%‰‱"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"Ω℧µ°%‰‱"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getMiscOperatorCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"+−⋅×∕÷±∓⟌∂∆∇⋄∙∘∗∣∖∤…∶∷∝∹∺⨥∔⨢∸∻∼∽∾∿≀⨤⨦≂≁⨧⧺⧻⋇⋈⋉⋊⋋⋌ƒ′″‴⁗!‼–—"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"+−⋅×∕÷±∓⟌∂∆∇⋄∙∘∗∣∖∤…∶∷∝∹∺⨥∔⨢∸∻∼∽∾∿≀⨤⨦≂≁⨧⧺⧻⋇⋈⋉⋊⋋⋌ƒ′″‴⁗!‼–—"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getEqualityCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"=≠≟<>≤≥≈≉≮≯≰≱≪≫≦≧≨≩≡≢≃≄≅≌≆≇≊≋≲≳≴≵≶≷≸≹≣≬≍≭≎≏≐≑≒≓≔≕≖≗≘≙≚≛≜≝≞⋘⋙⋚⋛⋜⋝⋖⋗"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"=≠≟<>≤≥≈≉≮≯≰≱≪≫≦≧≨≩≡≢≃≄≅≌≆≇≊≋≲≳≴≵≶≷≸≹≣≬≍≭≎≏≐≑≒≓≔≕≖≗≘≙≚≛≜≝≞⋘⋙⋚⋛⋜⋝⋖⋗"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getSetTheoryCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∀∁∃∄∅∧∨⊻⊼∩∪¬∖∴∵∝∎∶∷∈∉∋∌⊂⊃⊄⊅⊆⊇⊈⊉⊊⊋≺≻⊀⊁≼≽≾≿⋞⋟⋠⋡⋨⋩⊏⊐⊑⊒⋢⋣⋤⋥⋐⋑⋒⋓⋔⋎⋏⊓⊔"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∀∁∃∄∅∧∨⊻⊼∩∪¬∖∴∵∝∎∶∷∈∉∋∌⊂⊃⊄⊅⊆⊇⊈⊉⊊⊋≺≻⊀⊁≼≽≾≿⋞⋟⋠⋡⋨⋩⊏⊐⊑⊒⋢⋣⋤⋥⋐⋑⋒⋓⋔⋎⋏⊓⊔"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getUncommonOperatorCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"⊦⊧⊨⊩⊪⊫⊬⊭⊮⊯⊰⊱⊲⊳⊴⊵⋪⋫⋬⋭⊶⊷⊸⋮⋯⋰⋱⋲⋳⋵⋶⋸⋹⋺⋻⋽⋿⊕⊗⊖⊘⊙⊚⊛⊜⊝⊞⊟⊠⊡"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"⊦⊧⊨⊩⊪⊫⊬⊭⊮⊯⊰⊱⊲⊳⊴⊵⋪⋫⋬⋭⊶⊷⊸⋮⋯⋰⋱⋲⋳⋵⋶⋸⋹⋺⋻⋽⋿⊕⊗⊖⊘⊙⊚⊛⊜⊝⊞⊟⊠⊡"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getGeometryCharacterSet
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∟∠⦟⦦∣∤∥∦⌓⊿⏥○⦢⦣⦧⦡⦛∡∢⦠⊾⦜⦝⊥⊢⊣⊤"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"∟∠⦟⦦∣∤∥∦⌓⊿⏥○⦢⦣⦧⦡⦛∡∢⦠⊾⦜⦝⊥⊢⊣⊤"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getArrowCharacters
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"←→⇐⇒↔⇔⇄⇆↤↦⤆⤇↩↪↜↝⇜⇝⬳⟿↭↑↓⇑⇓↕⇕↖↗↘↙↼↽⇀⇁⇋⇌↿↾⇃⇂—"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"←→⇐⇒↔⇔⇄⇆↤↦⤆⤇↩↪↜↝⇜⇝⬳⟿↭↑↓⇑⇓↕⇕↖↗↘↙↼↽⇀⇁⇋⇌↿↾⇃⇂—"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getScriptCharacters
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"𝒜ℬ𝒞𝒟ℰℱ𝒢ℋℐ𝒥𝒦ℒℳ𝒩𝒪𝒫𝒬ℛ𝒮𝒯𝒰𝒱𝒲𝒳𝒴𝒵𝒶𝒷𝒸𝒹ℯ𝒻ℊ𝒽𝒾𝒿𝓀𝓁𝓂𝓃ℴ𝓅𝓆𝓇𝓈𝓉𝓊𝓋𝓌𝓍𝓎𝓏"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"𝒜ℬ𝒞𝒟ℰℱ𝒢ℋℐ𝒥𝒦ℒℳ𝒩𝒪𝒫𝒬ℛ𝒮𝒯𝒰𝒱𝒲𝒳𝒴𝒵𝒶𝒷𝒸𝒹ℯ𝒻ℊ𝒽𝒾𝒿𝓀𝓁𝓂𝓃ℴ𝓅𝓆𝓇𝓈𝓉𝓊𝓋𝓌𝓍𝓎𝓏"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getFrakturCharacters
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"𝔄𝔅ℭ𝔇𝔈𝔉𝔊ℌℑ𝔍𝔎𝔏𝔐𝔑𝔒𝔓𝔔ℜ𝔖𝔗𝔘𝔙𝔚𝔛𝔜ℨ𝔞𝔟𝔠𝔡𝔢𝔣𝔤𝔥𝔦𝔧𝔨𝔩𝔪𝔫𝔬𝔭𝔮𝔯𝔰𝔱𝔲𝔳𝔴𝔵𝔶𝔷"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"𝔄𝔅ℭ𝔇𝔈𝔉𝔊ℌℑ𝔍𝔎𝔏𝔐𝔑𝔒𝔓𝔔ℜ𝔖𝔗𝔘𝔙𝔚𝔛𝔜ℨ𝔞𝔟𝔠𝔡𝔢𝔣𝔤𝔥𝔦𝔧𝔨𝔩𝔪𝔫𝔬𝔭𝔮𝔯𝔰𝔱𝔲𝔳𝔴𝔵𝔶𝔷"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getBlackboardCharacters
 {
-    NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"𝔸𝔹ℂ𝔻𝔼𝔽𝔾ℍ𝕀𝕁𝕂𝕃𝕄ℕ𝕆ℙℚℝ𝕊𝕋𝕌𝕍𝕎𝕏𝕐ℤℼℽℾℿ𝕒𝕓𝕔𝕕𝕖𝕗𝕘𝕙𝕚𝕛𝕜𝕝𝕞𝕟𝕠𝕡𝕢𝕣𝕤𝕥𝕦𝕧𝕨𝕩𝕪𝕫𝟘𝟙𝟚𝟛𝟜𝟝𝟞𝟟𝟠𝟡⦂⦃⦄⦅⦆"];
-    return returnCharacterSet;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSCharacterSet *returnCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"𝔸𝔹ℂ𝔻𝔼𝔽𝔾ℍ𝕀𝕁𝕂𝕃𝕄ℕ𝕆ℙℚℝ𝕊𝕋𝕌𝕍𝕎𝕏𝕐ℤℼℽℾℿ𝕒𝕓𝕔𝕕𝕖𝕗𝕘𝕙𝕚𝕛𝕜𝕝𝕞𝕟𝕠𝕡𝕢𝕣𝕤𝕥𝕦𝕧𝕨𝕩𝕪𝕫𝟘𝟙𝟚𝟛𝟜𝟝𝟞𝟟𝟠𝟡⦂⦃⦄⦅⦆"];
+        storedValue = returnCharacterSet;
+    });
+    return storedValue;
 }
 
 + (NSCharacterSet *)getAccentOpCharacters
 {
-    NSMutableString *overBracerStr = [[NSMutableString alloc] init];
-    [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DE]]; //top curly bracer
-    [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DF]]; //bottom curly bracer
-    [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DC]]; //top paren
-    [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DD]]; //bottom paren
-    [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23B4]]; //top square bracer
-    [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23B5]]; //bottom square bracer
-    [overBracerStr appendString:@"–"]; // en dash, used for short overline
-    [overBracerStr appendString:@"—"]; // em dash, used for long overline
-
-    NSCharacterSet *overBracers = [NSCharacterSet characterSetWithCharactersInString:overBracerStr];
-
-    NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
-    [returnCharacterSet formUnionWithCharacterSet:overBracers];
-    [returnCharacterSet formUnionWithCharacterSet:[self getArrowCharacters]];
-
-    return returnCharacterSet.copy;
+    static NSCharacterSet *storedValue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableString *overBracerStr = [[NSMutableString alloc] init];
+        [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DE]]; //top curly bracer
+        [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DF]]; //bottom curly bracer
+        [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DC]]; //top paren
+        [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23DD]]; //bottom paren
+        [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23B4]]; //top square bracer
+        [overBracerStr appendString:[NSString stringWithFormat:@"%C",0x23B5]]; //bottom square bracer
+        [overBracerStr appendString:@"–"]; // en dash, used for short overline
+        [overBracerStr appendString:@"—"]; // em dash, used for long overline
+
+        NSCharacterSet *overBracers = [NSCharacterSet characterSetWithCharactersInString:overBracerStr];
+
+        NSMutableCharacterSet *returnCharacterSet = [[NSMutableCharacterSet alloc] init];
+        [returnCharacterSet formUnionWithCharacterSet:overBracers];
+        [returnCharacterSet formUnionWithCharacterSet:[self getArrowCharacters]];
+
+        storedValue = returnCharacterSet.copy;
+    });
+    return storedValue;
 }
 
 /*
@@ -3799,33 +4029,46 @@ withAttributedText: (NSAttributedString *)attributedText
     No point in testing them as you don't care what happens most of the time.
 */
 
+// Notifications are not sent while addTokens: is inserting a run. It sends one pair for the whole run.
 - (void)sendWillUpdateMarked
 {
+    if (self->batchUpdateDepth > 0)
+        return;
     [[NSNotificationCenter defaultCenter] postNotificationName:kRENDER_TYPESETTER_WILL_CHANGE_MARKED_NOTIFICATION object:nil];
 }
 
 - (void)sendDidUpdateMarked
 {
+    if (self->batchUpdateDepth > 0)
+        return;
     [[NSNotificationCenter defaultCenter] postNotificationName:kRENDER_TYPESETTER_DID_CHANGE_MARKED_NOTIFICATION object:nil];
 }
 
 - (void)sendWillUpdateSelected
 {
+    if (self->batchUpdateDepth > 0)
+        return;
     [[NSNotificationCenter defaultCenter] postNotificationName:kRENDER_TYPESETTER_WILL_CHANGE_SELECTED_NOTIFICATION object:nil];
 }
 
 - (void)sendDidUpdateSelected
 {
+    if (self->batchUpdateDepth > 0)
+        return;
     [[NSNotificationCenter defaultCenter] postNotificationName:kRENDER_TYPESETTER_DID_CHANGE_SELECTED_NOTIFICATION object:nil];
 }
 
 - (void)sendWillUpdateText
 {
+    if (self->batchUpdateDepth > 0)
+        return;
     [[NSNotificationCenter defaultCenter] postNotificationName:kRENDER_TYPESETTER_WILL_CHANGE_TEXT_NOTIFICATION object:nil];
 }
 
 - (void)sendDidUpdateText
 {
+    if (self->batchUpdateDepth > 0)
+        return;
     [[NSNotificationCenter defaultCenter] postNotificationName:kRENDER_TYPESETTER_DID_CHANGE_TEXT_NOTIFICATION object:nil];
 }
 
@@ -3843,12 +4086,23 @@ withAttributedText: (NSAttributedString *)attributedText
     [self sendDidUpdateText];
 }
 
+// Held back until the end of addTokens: when inserting a run.
+- (void)sendFinishedUpdating
+{
+    if (self->batchUpdateDepth > 0)
+    {
+        self->batchNeedsFinishedUpdating = YES;
+        return;
+    }
+    [self.typesetterDelegate sendFinishedUpdating];
+}
+
 - (void)sendUpdatesAndResetSelectedRange: (EQTextRange *)selectedTextRange
 {
     [self sendWillUpdateAll];
     [self.typesetterDelegate unmarkText];
     [self.typesetterDelegate sendUpdateSelectedTextRange:selectedTextRange];
-    [self.typesetterDelegate sendFinishedUpdating];
+    [self sendFinishedUpdating];
     [self sendDidUpdateAll];
 }
 
@@ -42,6 +42,7 @@
     NSMutableArray *equationStems;
     NSUInteger activeEquationLine;
     NSMutableArray *renderData;
+    NSMapTable *storedLineMetrics;
 }
 
 @property (strong, nonatomic) EQRenderTypesetter *typesetter;
@@ -35,8 +35,13 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
 @property (nonatomic) BOOL useBoldText;
 @property (nonatomic) BOOL useItalicText;
 
+// Stores the line index of each root stem, so the typesetter can find a stem's render data without searching.
+// Entries are checked before use and the table is rebuilt when lines have been added or removed.
+@property (strong, nonatomic) NSMapTable *rootStemLocations;
+
 - (void)sendViewUpdate;
 - (void)sendUpdateAllViews;
+- (void)sendUpdateViewsForEquationLoc: (NSUInteger)equationLoc;
 - (EQRenderData *)dataContainingTextPosition: (EQTextPosition *)textPosition;
 - (EQRenderData *)dataContainingTextRange: (EQTextRange *)textRange;
 - (void)changeActiveEquationToLine: (NSUInteger)newEquationLine;
@@ -62,10 +67,13 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
         self->rootRenderStem.drawOrigin = CGPointMake(40.0f, 40.0f);
         self->equationStems = [[NSMutableArray alloc] init];
         [equationStems addObject:rootRenderStem];
+        self->storedLineMetrics = [EQRenderEquation newLineMetricsCache];
         self->_typesetter = nil;
         self->_selectedStyle = displayMathStyle;
         self->_useBoldText = NO;
         self->_useItalicText = NO;
+        self->_rootStemLocations = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality)
+                                                         valueOptions:NSPointerFunctionsStrongMemory];
     }
 
     return self;
@@ -94,6 +102,7 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
     // Copy the current renderData back into the equation line.
     equationLines[activeEquationLine] = renderData;
     equationStems[activeEquationLine] = rootRenderStem;
+    [self->storedLineMetrics removeObjectForKey:renderData];
 }
 
 // Tell the typesetter to layout all equation lines again.
@@ -116,9 +125,25 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
 
         [self.typesetter sizeRenderData:renderArray];
         [self.typesetter layoutRenderStemsFromRoot:rootStem];
+        [self->storedLineMetrics removeObjectForKey:renderArray];
     }
 }
 
+// Lays out a single equation line after it has been edited.
+// Other lines keep their layout and their cached frames in the stored render equation.
+- (void)sendUpdateViewsForEquationLoc: (NSUInteger)equationLoc
+{
+    if (nil == self.typesetter || equationLoc >= self->equationStems.count || equationLoc >= self->equationLines.count)
+        return;
+
+    EQRenderStem *rootStem = [self->equationStems objectAtIndex:equationLoc];
+    NSArray *renderArray = [self->equationLines objectAtIndex:equationLoc];
+
+    [self.typesetter sizeRenderData:renderArray];
+    [self.typesetter layoutRenderStemsFromRoot:rootStem];
+    [self->storedLineMetrics removeObjectForKey:renderArray];
+}
+
 
 - (EQRenderData *)dataContainingTextPosition: (EQTextPosition *)textPosition
 {
@@ -680,7 +705,22 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
     if (nil == rootStem)
         return nil;
 
-    NSUInteger rootLoc = [self->equationStems indexOfObject:rootStem];
+    NSNumber *storedLoc = [self.rootStemLocations objectForKey:rootStem];
+    NSUInteger rootLoc = (nil == storedLoc) ? NSNotFound : storedLoc.unsignedIntegerValue;
+    if (rootLoc >= equationStems.count || equationStems[rootLoc] != rootStem)
+    {
+        [self.rootStemLocations removeAllObjects];
+        for (NSUInteger i = 0; i < equationStems.count; i ++)
+        {
+            if (nil == [self.rootStemLocations objectForKey:equationStems[i]])
+            {
+                [self.rootStemLocations setObject:@(i) forKey:equationStems[i]];
+            }
+        }
+        storedLoc = [self.rootStemLocations objectForKey:rootStem];
+        rootLoc = (nil == storedLoc) ? NSNotFound : storedLoc.unsignedIntegerValue;
+    }
+
     if (rootLoc != NSNotFound && rootLoc < equationLines.count)
     {
         return [equationLines objectAtIndex:rootLoc];
@@ -758,7 +798,9 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
     EQDataSourceState *newState = [EQDataSourceState dataSourceStateWithEquationLoc:newEquationLoc
                                                                      rootRenderStem:newRenderStem renderData:newRenderArray];
     [self addDataWithState:newState];
-    [self sendUpdateViewsAfterLocation:newEquationLoc];
+
+    // Each line is laid out from its own root, so the lines after it don't need to be laid out again.
+    [self sendUpdateViewsForEquationLoc:newEquationLoc];
 }
 
 // Called internally to prevent code repetition.
@@ -835,6 +877,8 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
             self->rootRenderStem = [aDecoder decodeObjectForKey:@"rootRenderStem"];
             self->renderData = [aDecoder decodeObjectForKey:@"renderData"];
         }
+        self->_rootStemLocations = [NSMapTable mapTableWithKeyOptions:(NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality)
+                                                         valueOptions:NSPointerFunctionsStrongMemory];
     }
 
     return self;
@@ -1114,7 +1158,7 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
         selectedTextRange = [EQTextRange textRangeWithPosition:newCursorPos];
     }
 
-    [self sendUpdateAllViews];
+    [self sendUpdateViewsForEquationLoc:equLoc];
 }
 
 - (void)deleteStem: (EQRenderStem *)oldStem fromParent: (EQRenderStem *)parentStem forEquationLoc: (NSUInteger)equLoc
@@ -1170,7 +1214,7 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
         selectedTextRange = [EQTextRange textRangeWithPosition:newCursorPos];
     }
 
-    [self sendUpdateAllViews];
+    [self sendUpdateViewsForEquationLoc:equLoc];
 }
 
 // Used for undo/redo when you add new data to the end of a row, generally by using the return key.
@@ -1201,7 +1245,7 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
             selectedTextRange = [EQTextRange textRangeWithPosition:newCursorPos];
         }
 
-        [self sendUpdateAllViews];
+        [self sendUpdateViewsForEquationLoc:equationLoc];
     }
 }
 
@@ -1232,7 +1276,7 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
     EQTextPosition *newCursorPos = [EQTextPosition textPositionWithIndex:newIndex andLocation:newDataLoc andEquationLoc:equationLoc];
     selectedTextRange = [EQTextRange textRangeWithPosition:newCursorPos];
 
-    [self sendUpdateAllViews];
+    [self sendUpdateViewsForEquationLoc:equationLoc];
 }
 
 
@@ -1247,9 +1291,8 @@ CGFloat const kDEFAULT_LABEL_SIZE = 24.0;
     if (nil == self->equationLines || nil == self->equationStems || equationLines.count == 0 || equationStems.count == 0)
         return nil;
 
-    EQRenderEquation *returnEquation = [[EQRenderEquation alloc] initWithEquationLines:equationLines andEquationStems:equationStems];
-
-    return returnEquation;
+    // Each call returns a new equation, but unchanged lines keep their cached frames.
+    return [[EQRenderEquation alloc] initWithEquationLines:equationLines andEquationStems:equationStems lineMetricsCache:self->storedLineMetrics];
 }
 
 
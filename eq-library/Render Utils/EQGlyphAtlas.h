@@ -0,0 +1,53 @@
+//
+//  EQGlyphAtlas.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <CoreText/CoreText.h>
+
+// Number of horizontal subpixel positions stored for each glyph.
+extern NSUInteger const kGLYPH_ATLAS_SUBPIXEL_STEPS;
+
+// Default limit on the mask bytes the atlas keeps before it evicts the least recently used masks.
+extern NSUInteger const kGLYPH_ATLAS_DEFAULT_MAX_BYTES;
+
+// This class stores anti-aliased coverage masks for glyphs so that each glyph is only rasterized once
+// for a given font, pixel size and horizontal subpixel offset.
+// It only uses CoreText and CoreGraphics, so it can be used off the main thread and without UIKit.
+
+@interface EQGlyphAtlas : NSObject
+
+@property (readonly) NSUInteger maskCount;
+@property (readonly) NSUInteger maskByteCount;
+
+// Masks are evicted least recently used first once their total size goes over this limit.
+@property (nonatomic) NSUInteger maxMaskBytes;
+
++ (EQGlyphAtlas *)sharedGlyphAtlas;
+
+// Returns a retained mask image, which the caller must release, and the offset from the mask's bottom left corner
+// to the glyph origin in pixels. The font size is multiplied by the pixel scale before rasterizing.
+- (CGImageRef)copyMaskForGlyph: (CGGlyph)glyph
+                        inFont: (CTFontRef)font
+                    pixelScale: (CGFloat)pixelScale
+                subpixelOffset: (CGFloat)subpixelOffset
+                  originOffset: (CGPoint *)originOffset CF_RETURNS_RETAINED;
+
+- (void)removeAllMasks;
+
+@end
@@ -0,0 +1,334 @@
+//
+//  EQGlyphAtlas.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import "EQGlyphAtlas.h"
+
+NSUInteger const kGLYPH_ATLAS_SUBPIXEL_STEPS = 4;
+NSUInteger const kGLYPH_ATLAS_DEFAULT_MAX_BYTES = 4 * 1024 * 1024;
+
+// Scaled fonts are cheap to recreate, so the font table is just cleared when it gets this large.
+static NSUInteger const kGLYPH_ATLAS_MAX_FONTS = 64;
+
+// Stores a single rasterized glyph.
+// The masks also form a doubly linked list in use order, with the most recently used mask at the head.
+@interface EQGlyphMask : NSObject
+{
+    CGImageRef maskImage;
+}
+
+@property (nonatomic) CGPoint originOffset;
+@property (strong, nonatomic) NSString *maskKey;
+@property (nonatomic) NSUInteger byteCount;
+@property (strong, nonatomic) EQGlyphMask *nextMask;
+@property (weak, nonatomic) EQGlyphMask *previousMask;
+
+- (id)initWithMaskImage: (CGImageRef)newMaskImage originOffset: (CGPoint)originOffset;
+- (CGImageRef)maskImage;
+
+@end
+
+@implementation EQGlyphMask
+
+- (id)initWithMaskImage: (CGImageRef)newMaskImage originOffset: (CGPoint)originOffset
+{
+    self = [super init];
+    if (self)
+    {
+        self->maskImage = CGImageRetain(newMaskImage);
+        self->_originOffset = originOffset;
+        self->_byteCount = CGImageGetBytesPerRow(newMaskImage) * CGImageGetHeight(newMaskImage);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    CGImageRelease(self->maskImage);
+}
+
+- (CGImageRef)maskImage
+{
+    return self->maskImage;
+}
+
+@end
+
+@interface EQGlyphAtlas()
+{
+    NSMutableDictionary *storedMasks;
+    NSMutableDictionary *storedFonts;
+    EQGlyphMask *newestMask;
+    EQGlyphMask *oldestMask;
+    NSUInteger storedByteCount;
+}
+
+- (EQGlyphMask *)createMaskForGlyph: (CGGlyph)glyph inFont: (CTFontRef)scaledFont subpixelOffset: (CGFloat)subpixelOffset;
+- (CTFontRef)scaledFontForFont: (CTFontRef)font withSize: (CGFloat)pixelSize;
+- (void)unlinkMask: (EQGlyphMask *)glyphMask;
+- (void)linkNewestMask: (EQGlyphMask *)glyphMask;
+- (void)evictMasksToFitLimit;
+
+@end
+
+@implementation EQGlyphAtlas
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        self->storedMasks = [[NSMutableDictionary alloc] init];
+        self->storedFonts = [[NSMutableDictionary alloc] init];
+        self->newestMask = nil;
+        self->oldestMask = nil;
+        self->storedByteCount = 0;
+        self->_maxMaskBytes = kGLYPH_ATLAS_DEFAULT_MAX_BYTES;
+    }
+    return self;
+}
+
++ (EQGlyphAtlas *)sharedGlyphAtlas
+{
+    static EQGlyphAtlas *sharedGlyphAtlas = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedGlyphAtlas = [[EQGlyphAtlas alloc] init];
+    });
+    return sharedGlyphAtlas;
+}
+
+- (NSUInteger)maskCount
+{
+    @synchronized(self)
+    {
+        return self->storedMasks.count;
+    }
+}
+
+- (NSUInteger)maskByteCount
+{
+    @synchronized(self)
+    {
+        return self->storedByteCount;
+    }
+}
+
+- (NSUInteger)maxMaskBytes
+{
+    @synchronized(self)
+    {
+        return self->_maxMaskBytes;
+    }
+}
+
+- (void)setMaxMaskBytes: (NSUInteger)maxMaskBytes
+{
+    @synchronized(self)
+    {
+        self->_maxMaskBytes = maxMaskBytes;
+        [self evictMasksToFitLimit];
+    }
+}
+
+- (void)removeAllMasks
+{
+    @synchronized(self)
+    {
+        // Break the list links so the masks are released with the dictionary.
+        EQGlyphMask *glyphMask = self->newestMask;
+        while (nil != glyphMask)
+        {
+            EQGlyphMask *nextMask = glyphMask.nextMask;
+            glyphMask.nextMask = nil;
+            glyphMask = nextMask;
+        }
+        self->newestMask = nil;
+        self->oldestMask = nil;
+        self->storedByteCount = 0;
+        [self->storedMasks removeAllObjects];
+        [self->storedFonts removeAllObjects];
+    }
+}
+
+- (CGImageRef)copyMaskForGlyph: (CGGlyph)glyph
+                        inFont: (CTFontRef)font
+                    pixelScale: (CGFloat)pixelScale
+                subpixelOffset: (CGFloat)subpixelOffset
+                  originOffset: (CGPoint *)originOffset
+{
+    if (NULL == font || pixelScale <= 0.0)
+        return NULL;
+
+    // Round the offset down to the nearest stored subpixel position.
+    NSUInteger subpixelStep = (NSUInteger)floor(subpixelOffset * kGLYPH_ATLAS_SUBPIXEL_STEPS);
+    subpixelStep = MIN(subpixelStep, kGLYPH_ATLAS_SUBPIXEL_STEPS - 1);
+
+    CGFloat pixelSize = CTFontGetSize(font) * pixelScale;
+    NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(font));
+    NSString *maskKey = [NSString stringWithFormat:@"%@-%.2f-%d-%lu", fontName, pixelSize, glyph, (unsigned long)subpixelStep];
+
+    @synchronized(self)
+    {
+        EQGlyphMask *glyphMask = self->storedMasks[maskKey];
+        if (nil == glyphMask)
+        {
+            CTFontRef scaledFont = [self scaledFontForFont:font withSize:pixelSize];
+            CGFloat useOffset = (CGFloat)subpixelStep / (CGFloat)kGLYPH_ATLAS_SUBPIXEL_STEPS;
+            glyphMask = [self createMaskForGlyph:glyph inFont:scaledFont subpixelOffset:useOffset];
+            if (nil == glyphMask)
+                return NULL;
+
+            glyphMask.maskKey = maskKey;
+            self->storedMasks[maskKey] = glyphMask;
+            self->storedByteCount += glyphMask.byteCount;
+        }
+        else
+        {
+            [self unlinkMask:glyphMask];
+        }
+        [self linkNewestMask:glyphMask];
+
+        if (NULL != originOffset)
+        {
+            *originOffset = glyphMask.originOffset;
+        }
+
+        // Retain before evicting, in case the limit is smaller than this mask.
+        CGImageRef maskImage = CGImageRetain(glyphMask.maskImage);
+        [self evictMasksToFitLimit];
+        return maskImage;
+    }
+}
+
+// The list methods are only called from inside @synchronized(self).
+- (void)unlinkMask: (EQGlyphMask *)glyphMask
+{
+    EQGlyphMask *previousMask = glyphMask.previousMask;
+    EQGlyphMask *nextMask = glyphMask.nextMask;
+    if (nil == previousMask)
+    {
+        self->newestMask = nextMask;
+    }
+    else
+    {
+        previousMask.nextMask = nextMask;
+    }
+
+    if (nil == nextMask)
+    {
+        self->oldestMask = previousMask;
+    }
+    else
+    {
+        nextMask.previousMask = previousMask;
+    }
+    glyphMask.previousMask = nil;
+    glyphMask.nextMask = nil;
+}
+
+- (void)linkNewestMask: (EQGlyphMask *)glyphMask
+{
+    glyphMask.previousMask = nil;
+    glyphMask.nextMask = self->newestMask;
+    if (nil != self->newestMask)
+    {
+        self->newestMask.previousMask = glyphMask;
+    }
+    self->newestMask = glyphMask;
+    if (nil == self->oldestMask)
+    {
+        self->oldestMask = glyphMask;
+    }
+}
+
+- (void)evictMasksToFitLimit
+{
+    while (self->storedByteCount > self->_maxMaskBytes && nil != self->oldestMask)
+    {
+        EQGlyphMask *glyphMask = self->oldestMask;
+        [self unlinkMask:glyphMask];
+        self->storedByteCount -= glyphMask.byteCount;
+        [self->storedMasks removeObjectForKey:glyphMask.maskKey];
+    }
+}
+
+// Copies of the font at each pixel size are stored so they are only created once.
+- (CTFontRef)scaledFontForFont: (CTFontRef)font withSize: (CGFloat)pixelSize
+{
+    NSString *fontName = CFBridgingRelease(CTFontCopyPostScriptName(font));
+    NSString *fontKey = [NSString stringWithFormat:@"%@-%.2f", fontName, pixelSize];
+    id scaledFont = self->storedFonts[fontKey];
+    if (nil == scaledFont)
+    {
+        if (self->storedFonts.count >= kGLYPH_ATLAS_MAX_FONTS)
+        {
+            [self->storedFonts removeAllObjects];
+        }
+        scaledFont = CFBridgingRelease(CTFontCreateCopyWithAttributes(font, pixelSize, NULL, NULL));
+        self->storedFonts[fontKey] = scaledFont;
+    }
+    return (__bridge CTFontRef)scaledFont;
+}
+
+// Draws the glyph in black on white into a gray bitmap and turns it into an image mask.
+// Image masks paint where the samples are zero, so black is full coverage.
+- (EQGlyphMask *)createMaskForGlyph: (CGGlyph)glyph inFont: (CTFontRef)scaledFont subpixelOffset: (CGFloat)subpixelOffset
+{
+    CGRect glyphBounds = CTFontGetBoundingRectsForGlyphs(scaledFont, kCTFontOrientationDefault, &glyph, NULL, 1);
+    if (CGRectIsEmpty(glyphBounds))
+        return nil;
+
+    // Leave a pixel of padding for the anti-aliasing.
+    CGFloat originX = -floor(CGRectGetMinX(glyphBounds)) + 1.0;
+    CGFloat originY = -floor(CGRectGetMinY(glyphBounds)) + 1.0;
+    size_t maskWidth = (size_t)ceil(CGRectGetMaxX(glyphBounds) + subpixelOffset + originX) + 1;
+    size_t maskHeight = (size_t)ceil(CGRectGetMaxY(glyphBounds) + originY) + 1;
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
+    CGContextRef maskContext = CGBitmapContextCreate(NULL, maskWidth, maskHeight, 8, 0, colorSpace, (CGBitmapInfo)kCGImageAlphaNone);
+    CGColorSpaceRelease(colorSpace);
+    if (NULL == maskContext)
+        return nil;
+
+    CGContextSetGrayFillColor(maskContext, 1.0, 1.0);
+    CGContextFillRect(maskContext, CGRectMake(0, 0, maskWidth, maskHeight));
+    CGContextSetGrayFillColor(maskContext, 0.0, 1.0);
+    CGContextSetShouldAntialias(maskContext, YES);
+    CGContextSetShouldSmoothFonts(maskContext, NO);
+
+    CGPoint glyphPosition = CGPointMake(originX + subpixelOffset, originY);
+    CTFontDrawGlyphs(scaledFont, &glyph, &glyphPosition, 1, maskContext);
+
+    size_t bytesPerRow = CGBitmapContextGetBytesPerRow(maskContext);
+    CFDataRef maskData = CFDataCreate(NULL, CGBitmapContextGetData(maskContext), bytesPerRow * maskHeight);
+    CGContextRelease(maskContext);
+
+    CGDataProviderRef dataProvider = CGDataProviderCreateWithCFData(maskData);
+    CFRelease(maskData);
+    CGImageRef maskImage = CGImageMaskCreate(maskWidth, maskHeight, 8, 8, bytesPerRow, dataProvider, NULL, true);
+    CGDataProviderRelease(dataProvider);
+    if (NULL == maskImage)
+        return nil;
+
+    EQGlyphMask *glyphMask = [[EQGlyphMask alloc] initWithMaskImage:maskImage originOffset:CGPointMake(originX, originY)];
+    CGImageRelease(maskImage);
+
+    return glyphMask;
+}
+
+@end
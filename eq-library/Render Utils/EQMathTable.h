@@ -0,0 +1,134 @@
+//
+//  EQMathTable.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <CoreText/CoreText.h>
+
+// Indexes into the MathConstants table, in the order they are stored in the font.
+typedef enum
+{
+    mathConstantScriptPercentScaleDown,
+    mathConstantScriptScriptPercentScaleDown,
+    mathConstantDelimitedSubFormulaMinHeight,
+    mathConstantDisplayOperatorMinHeight,
+    mathConstantMathLeading,
+    mathConstantAxisHeight,
+    mathConstantAccentBaseHeight,
+    mathConstantFlattenedAccentBaseHeight,
+    mathConstantSubscriptShiftDown,
+    mathConstantSubscriptTopMax,
+    mathConstantSubscriptBaselineDropMin,
+    mathConstantSuperscriptShiftUp,
+    mathConstantSuperscriptShiftUpCramped,
+    mathConstantSuperscriptBottomMin,
+    mathConstantSuperscriptBaselineDropMax,
+    mathConstantSubSuperscriptGapMin,
+    mathConstantSuperscriptBottomMaxWithSubscript,
+    mathConstantSpaceAfterScript,
+    mathConstantUpperLimitGapMin,
+    mathConstantUpperLimitBaselineRiseMin,
+    mathConstantLowerLimitGapMin,
+    mathConstantLowerLimitBaselineDropMin,
+    mathConstantStackTopShiftUp,
+    mathConstantStackTopDisplayStyleShiftUp,
+    mathConstantStackBottomShiftDown,
+    mathConstantStackBottomDisplayStyleShiftDown,
+    mathConstantStackGapMin,
+    mathConstantStackDisplayStyleGapMin,
+    mathConstantStretchStackTopShiftUp,
+    mathConstantStretchStackBottomShiftDown,
+    mathConstantStretchStackGapAboveMin,
+    mathConstantStretchStackGapBelowMin,
+    mathConstantFractionNumeratorShiftUp,
+    mathConstantFractionNumeratorDisplayStyleShiftUp,
+    mathConstantFractionDenominatorShiftDown,
+    mathConstantFractionDenominatorDisplayStyleShiftDown,
+    mathConstantFractionNumeratorGapMin,
+    mathConstantFractionNumDisplayStyleGapMin,
+    mathConstantFractionRuleThickness,
+    mathConstantFractionDenominatorGapMin,
+    mathConstantFractionDenomDisplayStyleGapMin,
+    mathConstantSkewedFractionHorizontalGap,
+    mathConstantSkewedFractionVerticalGap,
+    mathConstantOverbarVerticalGap,
+    mathConstantOverbarRuleThickness,
+    mathConstantOverbarExtraAscender,
+    mathConstantUnderbarVerticalGap,
+    mathConstantUnderbarRuleThickness,
+    mathConstantUnderbarExtraDescender,
+    mathConstantRadicalVerticalGap,
+    mathConstantRadicalDisplayStyleVerticalGap,
+    mathConstantRadicalRuleThickness,
+    mathConstantRadicalExtraAscender,
+    mathConstantRadicalKernBeforeDegree,
+    mathConstantRadicalKernAfterDegree,
+    mathConstantRadicalDegreeBottomRaisePercent,
+    mathConstantCount,
+} EQMathConstant;
+
+// This class holds the MathConstants and MathVariants data from an OpenType MATH table.
+// The table is parsed once per font into flat arrays, so variant and assembly lookups
+// are done without creating any CoreText lines.
+// Assemblies are returned as arrays of @[glyph number, offset number] tuples ordered from the
+// bottom (or left) part, where the offset is measured from the start of the assembly in points.
+
+@interface EQMathTable : NSObject
+
+@property (strong, nonatomic, readonly) NSString *fontName;
+@property (nonatomic, readonly) CGFloat unitsPerEm;
+
+// Returns nil if the font does not have a MATH table.
+// Tables are cached by font name, so this is cheap to call during layout.
++ (EQMathTable *)mathTableForFont: (CTFontRef)font;
+
+// Uses kDEFAULT_MATH_FONT, and returns nil unless its font file is bundled with the library.
+// A copy that only happens to be installed on the host is ignored, so layout doesn't depend on the host's fonts.
++ (EQMathTable *)defaultMathTable;
+
+- (id)initWithData: (NSData *)mathData fontName: (NSString *)fontName unitsPerEm: (CGFloat)unitsPerEm;
+
+// Both of these need a font name, so they return 0 or nil for tables built directly from data without one.
+- (CGGlyph)glyphForCharacter: (NSString *)character;
+- (NSAttributedString *)attributedStringForGlyph: (CGGlyph)glyph
+                                      baseString: (NSString *)baseString
+                                        fontSize: (CGFloat)fontSize
+                                       kernValue: (CGFloat)kernValue;
+
+- (CGFloat)valueForConstant: (EQMathConstant)constant fontSize: (CGFloat)fontSize;
+- (CGFloat)minConnectorOverlapForFontSize: (CGFloat)fontSize;
+
+- (BOOL)hasConstructionForGlyph: (CGGlyph)glyph vertical: (BOOL)vertical;
+- (BOOL)hasAssemblyForGlyph: (CGGlyph)glyph vertical: (BOOL)vertical;
+
+// Returns the smallest pre-sized variant that covers minAdvance, or NO if the glyph needs an assembly.
+- (BOOL)variantForGlyph: (CGGlyph)glyph
+             minAdvance: (CGFloat)minAdvance
+               fontSize: (CGFloat)fontSize
+               vertical: (BOOL)vertical
+           variantGlyph: (CGGlyph *)variantGlyph
+         variantAdvance: (CGFloat *)variantAdvance;
+
+// Returns nil if the glyph does not have an assembly.
+- (NSArray *)assemblyForGlyph: (CGGlyph)glyph
+                   minAdvance: (CGFloat)minAdvance
+                     fontSize: (CGFloat)fontSize
+                     vertical: (BOOL)vertical
+                 totalAdvance: (CGFloat *)totalAdvance;
+
+@end
@@ -0,0 +1,638 @@
+//
+//  EQMathTable.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import "EQMathTable.h"
+#import "EQRenderFontDictionary.h"
+
+// The first four constants are plain int16 values and the last is an int16 percentage.
+// Everything in between is a MathValueRecord with a device table offset that is ignored.
+static const NSUInteger kMATH_CONSTANT_SCALAR_COUNT = 4;
+static const uint16_t kMATH_PART_EXTENDER_FLAG = 0x0001;
+
+typedef struct
+{
+    CGGlyph glyph;
+    NSUInteger variantStart;
+    NSUInteger variantCount;
+    NSUInteger partStart;
+    NSUInteger partCount;
+} EQMathConstruction;
+
+typedef struct
+{
+    CGGlyph glyph;
+    CGFloat advance;
+} EQMathVariantRecord;
+
+typedef struct
+{
+    CGGlyph glyph;
+    CGFloat startConnector;
+    CGFloat endConnector;
+    CGFloat fullAdvance;
+    BOOL isExtender;
+} EQMathGlyphPart;
+
+static BOOL EQMathReadUInt16(const uint8_t *bytes, NSUInteger length, NSUInteger offset, uint16_t *value)
+{
+    if (offset + 2 > length)
+        return NO;
+
+    *value = (uint16_t)((bytes[offset] << 8) | bytes[offset + 1]);
+    return YES;
+}
+
+static BOOL EQMathReadInt16(const uint8_t *bytes, NSUInteger length, NSUInteger offset, CGFloat *value)
+{
+    uint16_t rawValue = 0;
+    if (!EQMathReadUInt16(bytes, length, offset, &rawValue))
+        return NO;
+
+    *value = (CGFloat)(int16_t)rawValue;
+    return YES;
+}
+
+static int EQMathCompareConstructions(const void *first, const void *second)
+{
+    CGGlyph firstGlyph = ((const EQMathConstruction *)first)->glyph;
+    CGGlyph secondGlyph = ((const EQMathConstruction *)second)->glyph;
+    return (firstGlyph > secondGlyph) - (firstGlyph < secondGlyph);
+}
+
+@interface EQMathTable()
+{
+    CGFloat storedConstants[mathConstantCount];
+    CGFloat storedMinConnectorOverlap;
+    NSMutableData *verticalConstructions;
+    NSMutableData *horizontalConstructions;
+    NSMutableData *variantRecords;
+    NSMutableData *glyphParts;
+    NSMutableDictionary *storedCharacterGlyphs;
+}
+
+- (BOOL)parseConstantsInBytes: (const uint8_t *)bytes length: (NSUInteger)length offset: (NSUInteger)offset;
+- (BOOL)parseVariantsInBytes: (const uint8_t *)bytes length: (NSUInteger)length offset: (NSUInteger)offset;
+- (BOOL)parseConstructionsInBytes: (const uint8_t *)bytes
+                           length: (NSUInteger)length
+                    variantOffset: (NSUInteger)variantOffset
+                   coverageOffset: (NSUInteger)coverageOffset
+                     offsetsStart: (NSUInteger)offsetsStart
+                            count: (NSUInteger)count
+                         intoData: (NSMutableData *)constructionData;
+- (const EQMathConstruction *)constructionForGlyph: (CGGlyph)glyph vertical: (BOOL)vertical;
+
+@end
+
+@implementation EQMathTable
+
+- (id)initWithData: (NSData *)mathData fontName: (NSString *)fontName unitsPerEm: (CGFloat)unitsPerEm
+{
+    if (nil == mathData || unitsPerEm <= 0.0)
+        return nil;
+
+    self = [super init];
+    if (self)
+    {
+        self->_fontName = fontName;
+        self->_unitsPerEm = unitsPerEm;
+        self->verticalConstructions = [[NSMutableData alloc] init];
+        self->horizontalConstructions = [[NSMutableData alloc] init];
+        self->variantRecords = [[NSMutableData alloc] init];
+        self->glyphParts = [[NSMutableData alloc] init];
+        self->storedCharacterGlyphs = [[NSMutableDictionary alloc] init];
+
+        const uint8_t *bytes = mathData.bytes;
+        NSUInteger length = mathData.length;
+
+        // MATH header: version, then offsets to MathConstants, MathGlyphInfo and MathVariants.
+        uint16_t majorVersion = 0;
+        uint16_t constantsOffset = 0;
+        uint16_t variantsOffset = 0;
+        if (!EQMathReadUInt16(bytes, length, 0, &majorVersion) || majorVersion != 1
+            || !EQMathReadUInt16(bytes, length, 4, &constantsOffset)
+            || !EQMathReadUInt16(bytes, length, 8, &variantsOffset))
+        {
+            return nil;
+        }
+
+        if (constantsOffset != 0 && ![self parseConstantsInBytes:bytes length:length offset:constantsOffset])
+        {
+            return nil;
+        }
+
+        if (variantsOffset != 0 && ![self parseVariantsInBytes:bytes length:length offset:variantsOffset])
+        {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+- (BOOL)parseConstantsInBytes: (const uint8_t *)bytes length: (NSUInteger)length offset: (NSUInteger)offset
+{
+    NSUInteger readOffset = offset;
+    for (NSUInteger i = 0; i < mathConstantCount; i++)
+    {
+        if (!EQMathReadInt16(bytes, length, readOffset, &self->storedConstants[i]))
+            return NO;
+
+        BOOL isValueRecord = (i >= kMATH_CONSTANT_SCALAR_COUNT && i != mathConstantRadicalDegreeBottomRaisePercent);
+        readOffset += isValueRecord ? 4 : 2;
+    }
+
+    // These two are stored unsigned.
+    self->storedConstants[mathConstantDelimitedSubFormulaMinHeight] = (uint16_t)(int16_t)self->storedConstants[mathConstantDelimitedSubFormulaMinHeight];
+    self->storedConstants[mathConstantDisplayOperatorMinHeight] = (uint16_t)(int16_t)self->storedConstants[mathConstantDisplayOperatorMinHeight];
+
+    return YES;
+}
+
+- (BOOL)parseVariantsInBytes: (const uint8_t *)bytes length: (NSUInteger)length offset: (NSUInteger)offset
+{
+    uint16_t minOverlap = 0;
+    uint16_t vertCoverage = 0;
+    uint16_t horizCoverage = 0;
+    uint16_t vertCount = 0;
+    uint16_t horizCount = 0;
+    if (!EQMathReadUInt16(bytes, length, offset, &minOverlap)
+        || !EQMathReadUInt16(bytes, length, offset + 2, &vertCoverage)
+        || !EQMathReadUInt16(bytes, length, offset + 4, &horizCoverage)
+        || !EQMathReadUInt16(bytes, length, offset + 6, &vertCount)
+        || !EQMathReadUInt16(bytes, length, offset + 8, &horizCount))
+    {
+        return NO;
+    }
+
+    self->storedMinConnectorOverlap = minOverlap;
+
+    NSUInteger vertOffsetsStart = offset + 10;
+    NSUInteger horizOffsetsStart = vertOffsetsStart + 2 * vertCount;
+
+    if (vertCount > 0 && ![self parseConstructionsInBytes:bytes length:length variantOffset:offset coverageOffset:vertCoverage
+                                             offsetsStart:vertOffsetsStart count:vertCount intoData:self->verticalConstructions])
+    {
+        return NO;
+    }
+
+    if (horizCount > 0 && ![self parseConstructionsInBytes:bytes length:length variantOffset:offset coverageOffset:horizCoverage
+                                              offsetsStart:horizOffsetsStart count:horizCount intoData:self->horizontalConstructions])
+    {
+        return NO;
+    }
+
+    return YES;
+}
+
+- (BOOL)parseConstructionsInBytes: (const uint8_t *)bytes
+                           length: (NSUInteger)length
+                    variantOffset: (NSUInteger)variantOffset
+                   coverageOffset: (NSUInteger)coverageOffset
+                     offsetsStart: (NSUInteger)offsetsStart
+                            count: (NSUInteger)count
+                         intoData: (NSMutableData *)constructionData
+{
+    if (coverageOffset == 0)
+        return NO;
+
+    // Expand the coverage table so that each construction index maps to its glyph.
+    NSUInteger coverageStart = variantOffset + coverageOffset;
+    NSMutableData *coverageGlyphData = [[NSMutableData alloc] initWithLength:count * sizeof(CGGlyph)];
+    CGGlyph *coverageGlyphs = coverageGlyphData.mutableBytes;
+    NSMutableData *coverageFoundData = [[NSMutableData alloc] initWithLength:count];
+    BOOL *coverageFound = coverageFoundData.mutableBytes;
+
+    uint16_t coverageFormat = 0;
+    uint16_t coverageCount = 0;
+    if (!EQMathReadUInt16(bytes, length, coverageStart, &coverageFormat)
+        || !EQMathReadUInt16(bytes, length, coverageStart + 2, &coverageCount))
+    {
+        return NO;
+    }
+
+    if (coverageFormat == 1)
+    {
+        for (NSUInteger i = 0; i < coverageCount && i < count; i++)
+        {
+            uint16_t glyph = 0;
+            if (!EQMathReadUInt16(bytes, length, coverageStart + 4 + 2 * i, &glyph))
+                return NO;
+
+            coverageGlyphs[i] = glyph;
+            coverageFound[i] = YES;
+        }
+    }
+    else if (coverageFormat == 2)
+    {
+        for (NSUInteger i = 0; i < coverageCount; i++)
+        {
+            NSUInteger rangeStart = coverageStart + 4 + 6 * i;
+            uint16_t startGlyph = 0;
+            uint16_t endGlyph = 0;
+            uint16_t startIndex = 0;
+            if (!EQMathReadUInt16(bytes, length, rangeStart, &startGlyph)
+                || !EQMathReadUInt16(bytes, length, rangeStart + 2, &endGlyph)
+                || !EQMathReadUInt16(bytes, length, rangeStart + 4, &startIndex))
+            {
+                return NO;
+            }
+
+            for (NSUInteger glyph = startGlyph; glyph <= endGlyph; glyph++)
+            {
+                NSUInteger coverageIndex = startIndex + (glyph - startGlyph);
+                if (coverageIndex < count)
+                {
+                    coverageGlyphs[coverageIndex] = (CGGlyph)glyph;
+                    coverageFound[coverageIndex] = YES;
+                }
+            }
+        }
+    }
+    else
+    {
+        return NO;
+    }
+
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        uint16_t constructionOffset = 0;
+        if (!EQMathReadUInt16(bytes, length, offsetsStart + 2 * i, &constructionOffset))
+            return NO;
+
+        if (!coverageFound[i] || constructionOffset == 0)
+            continue;
+
+        NSUInteger constructionStart = variantOffset + constructionOffset;
+        uint16_t assemblyOffset = 0;
+        uint16_t variantCount = 0;
+        if (!EQMathReadUInt16(bytes, length, constructionStart, &assemblyOffset)
+            || !EQMathReadUInt16(bytes, length, constructionStart + 2, &variantCount))
+        {
+            return NO;
+        }
+
+        EQMathConstruction construction;
+        construction.glyph = coverageGlyphs[i];
+        construction.variantStart = self->variantRecords.length / sizeof(EQMathVariantRecord);
+        construction.variantCount = variantCount;
+        construction.partStart = self->glyphParts.length / sizeof(EQMathGlyphPart);
+        construction.partCount = 0;
+
+        for (NSUInteger j = 0; j < variantCount; j++)
+        {
+            NSUInteger recordStart = constructionStart + 4 + 4 * j;
+            uint16_t variantGlyph = 0;
+            uint16_t advance = 0;
+            if (!EQMathReadUInt16(bytes, length, recordStart, &variantGlyph)
+                || !EQMathReadUInt16(bytes, length, recordStart + 2, &advance))
+            {
+                return NO;
+            }
+
+            EQMathVariantRecord record = {variantGlyph, advance};
+            [self->variantRecords appendBytes:&record length:sizeof(EQMathVariantRecord)];
+        }
+
+        if (assemblyOffset != 0)
+        {
+            // GlyphAssembly: italics correction value record, part count, then the parts.
+            NSUInteger assemblyStart = constructionStart + assemblyOffset;
+            uint16_t partCount = 0;
+            if (!EQMathReadUInt16(bytes, length, assemblyStart + 4, &partCount))
+                return NO;
+
+            for (NSUInteger j = 0; j < partCount; j++)
+            {
+                NSUInteger partStart = assemblyStart + 6 + 10 * j;
+                uint16_t partGlyph = 0;
+                uint16_t startConnector = 0;
+                uint16_t endConnector = 0;
+                uint16_t fullAdvance = 0;
+                uint16_t partFlags = 0;
+                if (!EQMathReadUInt16(bytes, length, partStart, &partGlyph)
+                    || !EQMathReadUInt16(bytes, length, partStart + 2, &startConnector)
+                    || !EQMathReadUInt16(bytes, length, partStart + 4, &endConnector)
+                    || !EQMathReadUInt16(bytes, length, partStart + 6, &fullAdvance)
+                    || !EQMathReadUInt16(bytes, length, partStart + 8, &partFlags))
+                {
+                    return NO;
+                }
+
+                EQMathGlyphPart part = {partGlyph, startConnector, endConnector, fullAdvance,
+                                        (partFlags & kMATH_PART_EXTENDER_FLAG) != 0};
+                [self->glyphParts appendBytes:&part length:sizeof(EQMathGlyphPart)];
+            }
+            construction.partCount = partCount;
+        }
+
+        [constructionData appendBytes:&construction length:sizeof(EQMathConstruction)];
+    }
+
+    // Sort by glyph so lookups can use a binary search.
+    qsort(constructionData.mutableBytes, constructionData.length / sizeof(EQMathConstruction),
+          sizeof(EQMathConstruction), EQMathCompareConstructions);
+
+    return YES;
+}
+
+- (const EQMathConstruction *)constructionForGlyph: (CGGlyph)glyph vertical: (BOOL)vertical
+{
+    NSData *constructionData = vertical ? self->verticalConstructions : self->horizontalConstructions;
+    EQMathConstruction key;
+    key.glyph = glyph;
+
+    return bsearch(&key, constructionData.bytes, constructionData.length / sizeof(EQMathConstruction),
+                   sizeof(EQMathConstruction), EQMathCompareConstructions);
+}
+
+- (CGGlyph)glyphForCharacter: (NSString *)character
+{
+    if (nil == self.fontName || character.length == 0 || character.length > 2)
+        return 0;
+
+    @synchronized(self->storedCharacterGlyphs)
+    {
+        NSNumber *storedGlyph = self->storedCharacterGlyphs[character];
+        if (nil == storedGlyph)
+        {
+            CGGlyph glyphs[2] = {0, 0};
+            unichar characters[2] = {0, 0};
+            [character getCharacters:characters range:NSMakeRange(0, character.length)];
+
+            CTFontRef mathFont = CTFontCreateWithName((__bridge CFStringRef)self.fontName, kDEFAULT_FONT_SIZE, NULL);
+            if (NULL != mathFont)
+            {
+                CTFontGetGlyphsForCharacters(mathFont, characters, glyphs, (CFIndex)character.length);
+                CFRelease(mathFont);
+            }
+            storedGlyph = @(glyphs[0]);
+            self->storedCharacterGlyphs[character] = storedGlyph;
+        }
+
+        return (CGGlyph)storedGlyph.unsignedShortValue;
+    }
+}
+
+// Variant and assembly glyphs usually have no code point, so they are attached to the base string with glyph info.
+- (NSAttributedString *)attributedStringForGlyph: (CGGlyph)glyph
+                                      baseString: (NSString *)baseString
+                                        fontSize: (CGFloat)fontSize
+                                       kernValue: (CGFloat)kernValue
+{
+    if (nil == self.fontName || baseString.length == 0)
+        return nil;
+
+    NSMutableDictionary *glyphAttributes = [EQRenderFontDictionary fontDictWithName:self.fontName size:fontSize kernValue:kernValue].mutableCopy;
+    CTFontRef glyphFont = (__bridge CTFontRef)glyphAttributes[NSFontAttributeName];
+    if (NULL == glyphFont)
+        return nil;
+
+    CTGlyphInfoRef glyphInfo = CTGlyphInfoCreateWithGlyph(glyph, glyphFont, (__bridge CFStringRef)baseString);
+    if (NULL != glyphInfo)
+    {
+        glyphAttributes[(NSString *)kCTGlyphInfoAttributeName] = (__bridge_transfer id)glyphInfo;
+    }
+
+    return [[NSAttributedString alloc] initWithString:baseString attributes:glyphAttributes];
+}
+
+- (CGFloat)valueForConstant: (EQMathConstant)constant fontSize: (CGFloat)fontSize
+{
+    if (constant >= mathConstantCount)
+        return 0.0;
+
+    CGFloat value = self->storedConstants[constant];
+
+    // Percentages are returned unscaled.
+    if (constant == mathConstantScriptPercentScaleDown || constant == mathConstantScriptScriptPercentScaleDown
+        || constant == mathConstantRadicalDegreeBottomRaisePercent)
+    {
+        return value;
+    }
+
+    return value * fontSize / self.unitsPerEm;
+}
+
+- (CGFloat)minConnectorOverlapForFontSize: (CGFloat)fontSize
+{
+    return self->storedMinConnectorOverlap * fontSize / self.unitsPerEm;
+}
+
+- (BOOL)hasConstructionForGlyph: (CGGlyph)glyph vertical: (BOOL)vertical
+{
+    return NULL != [self constructionForGlyph:glyph vertical:vertical];
+}
+
+- (BOOL)hasAssemblyForGlyph: (CGGlyph)glyph vertical: (BOOL)vertical
+{
+    const EQMathConstruction *construction = [self constructionForGlyph:glyph vertical:vertical];
+    return (NULL != construction && construction->partCount > 0);
+}
+
+- (BOOL)variantForGlyph: (CGGlyph)glyph
+             minAdvance: (CGFloat)minAdvance
+               fontSize: (CGFloat)fontSize
+               vertical: (BOOL)vertical
+           variantGlyph: (CGGlyph *)variantGlyph
+         variantAdvance: (CGFloat *)variantAdvance
+{
+    const EQMathConstruction *construction = [self constructionForGlyph:glyph vertical:vertical];
+    if (NULL == construction)
+        return NO;
+
+    // Variants are stored from smallest to largest.
+    CGFloat scale = fontSize / self.unitsPerEm;
+    const EQMathVariantRecord *records = self->variantRecords.bytes;
+    for (NSUInteger i = 0; i < construction->variantCount; i++)
+    {
+        EQMathVariantRecord record = records[construction->variantStart + i];
+        if (record.advance * scale >= minAdvance)
+        {
+            if (NULL != variantGlyph)
+                *variantGlyph = record.glyph;
+            if (NULL != variantAdvance)
+                *variantAdvance = record.advance * scale;
+
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+// Follows the assembly rules in the OpenType spec: repeat the extenders the fewest times that reach
+// minAdvance with the minimum overlap, then spread the remaining overlap evenly across the connectors.
+- (NSArray *)assemblyForGlyph: (CGGlyph)glyph
+                   minAdvance: (CGFloat)minAdvance
+                     fontSize: (CGFloat)fontSize
+                     vertical: (BOOL)vertical
+                 totalAdvance: (CGFloat *)totalAdvance
+{
+    const EQMathConstruction *construction = [self constructionForGlyph:glyph vertical:vertical];
+    if (NULL == construction || construction->partCount == 0)
+        return nil;
+
+    const EQMathGlyphPart *parts = (const EQMathGlyphPart *)self->glyphParts.bytes + construction->partStart;
+    CGFloat scale = fontSize / self.unitsPerEm;
+    CGFloat minOverlap = self->storedMinConnectorOverlap * scale;
+
+    CGFloat fixedAdvance = 0.0;
+    CGFloat extenderAdvance = 0.0;
+    NSUInteger fixedCount = 0;
+    NSUInteger extenderCount = 0;
+    for (NSUInteger i = 0; i < construction->partCount; i++)
+    {
+        if (parts[i].isExtender)
+        {
+            extenderAdvance += parts[i].fullAdvance * scale;
+            extenderCount++;
+        }
+        else
+        {
+            fixedAdvance += parts[i].fullAdvance * scale;
+            fixedCount++;
+        }
+    }
+
+    NSUInteger repeatCount = (extenderCount > 0) ? 1 : 0;
+    if (extenderCount > 0 && extenderAdvance - extenderCount * minOverlap > 0.0)
+    {
+        CGFloat baseAdvance = fixedAdvance + extenderAdvance - (fixedCount + extenderCount - 1) * minOverlap;
+        if (baseAdvance < minAdvance)
+        {
+            repeatCount += (NSUInteger)ceil((minAdvance - baseAdvance) / (extenderAdvance - extenderCount * minOverlap));
+        }
+    }
+
+    NSUInteger useCount = fixedCount + repeatCount * extenderCount;
+    NSMutableData *usePartData = [[NSMutableData alloc] initWithCapacity:useCount * sizeof(EQMathGlyphPart)];
+    for (NSUInteger i = 0; i < construction->partCount; i++)
+    {
+        NSUInteger copies = parts[i].isExtender ? repeatCount : 1;
+        for (NSUInteger j = 0; j < copies; j++)
+        {
+            [usePartData appendBytes:&parts[i] length:sizeof(EQMathGlyphPart)];
+        }
+    }
+
+    const EQMathGlyphPart *useParts = usePartData.bytes;
+    useCount = usePartData.length / sizeof(EQMathGlyphPart);
+    if (useCount == 0)
+        return nil;
+
+    CGFloat fullAdvance = 0.0;
+    for (NSUInteger i = 0; i < useCount; i++)
+    {
+        fullAdvance += useParts[i].fullAdvance * scale;
+    }
+
+    CGFloat evenOverlap = minOverlap;
+    if (useCount > 1)
+    {
+        evenOverlap = MAX(minOverlap, (fullAdvance - minAdvance) / (useCount - 1));
+    }
+
+    NSMutableArray *returnArray = [[NSMutableArray alloc] initWithCapacity:useCount];
+    CGFloat offset = 0.0;
+    for (NSUInteger i = 0; i < useCount; i++)
+    {
+        [returnArray addObject:@[@(useParts[i].glyph), @(offset)]];
+        offset += useParts[i].fullAdvance * scale;
+
+        if (i + 1 < useCount)
+        {
+            CGFloat maxOverlap = MIN(useParts[i].endConnector, useParts[i + 1].startConnector) * scale;
+            offset -= MIN(evenOverlap, MAX(maxOverlap, minOverlap));
+        }
+    }
+
+    if (NULL != totalAdvance)
+        *totalAdvance = offset;
+
+    return returnArray;
+}
+
+/***********************
+ * Begin Class methods *
+ ***********************/
+
++ (EQMathTable *)mathTableForFont: (CTFontRef)font
+{
+    if (NULL == font)
+        return nil;
+
+    static NSMutableDictionary *storedTables = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        storedTables = [[NSMutableDictionary alloc] init];
+    });
+
+    NSString *fontName = (__bridge_transfer NSString *)CTFontCopyPostScriptName(font);
+    if (nil == fontName)
+        return nil;
+
+    @synchronized(storedTables)
+    {
+        id storedTable = storedTables[fontName];
+        if (nil == storedTable)
+        {
+            EQMathTable *newTable = nil;
+            CFDataRef mathTableRef = CTFontCopyTable(font, kCTFontTableMATH, kCTFontTableOptionNoOptions);
+            if (NULL != mathTableRef)
+            {
+                NSData *mathData = (__bridge_transfer NSData *)mathTableRef;
+                newTable = [[EQMathTable alloc] initWithData:mathData fontName:fontName unitsPerEm:CTFontGetUnitsPerEm(font)];
+            }
+
+            // Store a placeholder for fonts without a table so they are only checked once.
+            storedTable = (nil != newTable) ? newTable : [NSNull null];
+            storedTables[fontName] = storedTable;
+        }
+
+        return [storedTable isKindOfClass:[EQMathTable class]] ? storedTable : nil;
+    }
+}
+
++ (EQMathTable *)defaultMathTable
+{
+    static EQMathTable *defaultTable = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSURL *fontURL = [[NSBundle bundleForClass:[EQMathTable class]] URLForResource:kDEFAULT_MATH_FONT withExtension:@"otf"];
+        if (nil == fontURL)
+            return;
+
+        // Registering fails harmlessly if the font is already registered, so the result isn't checked.
+        CTFontManagerRegisterFontsForURL((__bridge CFURLRef)fontURL, kCTFontManagerScopeProcess, NULL);
+        CTFontRef mathFont = CTFontCreateWithName((__bridge CFStringRef)kDEFAULT_MATH_FONT, kDEFAULT_FONT_SIZE, NULL);
+        if (NULL == mathFont)
+            return;
+
+        // CoreText substitutes another font if the math font is missing, so check the name before using it.
+        NSString *foundName = (__bridge_transfer NSString *)CTFontCopyPostScriptName(mathFont);
+        if ([foundName isEqualToString:kDEFAULT_MATH_FONT])
+        {
+            defaultTable = [EQMathTable mathTableForFont:mathFont];
+        }
+        CFRelease(mathFont);
+    });
+
+    return defaultTable;
+}
+
+@end
@@ -0,0 +1,52 @@
+//
+//  EQPNGWriter.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+
+// This class encodes an 8-bit alpha buffer as a palette PNG.
+// Every palette entry is black and the transparency chunk holds the alpha ramp,
+// so the output is one byte per pixel instead of the four used by an RGBA image.
+// The rows are filtered and compressed one at a time, so the encoded data can be streamed.
+
+typedef BOOL (^EQPNGWriteBlock)(const void *bytes, size_t length);
+
+@interface EQPNGWriter : NSObject
+
+// Compression levels use the zlib range of 0-9. Pass -1 for the zlib default.
++ (NSData *)pngDataWithAlphaBuffer: (const uint8_t *)alphaBuffer
+                             width: (size_t)width
+                            height: (size_t)height
+                       bytesPerRow: (size_t)bytesPerRow
+                  compressionLevel: (NSInteger)compressionLevel;
+
++ (BOOL)writeAlphaBuffer: (const uint8_t *)alphaBuffer
+                   width: (size_t)width
+                  height: (size_t)height
+             bytesPerRow: (size_t)bytesPerRow
+        compressionLevel: (NSInteger)compressionLevel
+        toFileDescriptor: (int)fileDescriptor;
+
+// Returns NO if the write block returns NO or if compression fails.
++ (BOOL)writeAlphaBuffer: (const uint8_t *)alphaBuffer
+                   width: (size_t)width
+                  height: (size_t)height
+             bytesPerRow: (size_t)bytesPerRow
+        compressionLevel: (NSInteger)compressionLevel
+          withWriteBlock: (EQPNGWriteBlock)writeBlock;
+
+@end
@@ -0,0 +1,256 @@
+//
+//  EQPNGWriter.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <zlib.h>
+#import <unistd.h>
+#import <errno.h>
+#import "EQPNGWriter.h"
+
+// Size of each compressed IDAT chunk.
+static const size_t kPNG_CHUNK_SIZE = 65536;
+
+// Row filter types from the PNG spec.
+enum
+{
+    EQPNGFilterNone = 0,
+    EQPNGFilterSub = 1,
+    EQPNGFilterUp = 2,
+};
+
+static void EQStoreBigEndian(uint8_t *outBytes, uint32_t value)
+{
+    outBytes[0] = (uint8_t)(value >> 24);
+    outBytes[1] = (uint8_t)(value >> 16);
+    outBytes[2] = (uint8_t)(value >> 8);
+    outBytes[3] = (uint8_t)value;
+}
+
+static BOOL EQWritePNGChunk(EQPNGWriteBlock writeBlock, const char *chunkType, const uint8_t *chunkData, uint32_t chunkLength)
+{
+    uint8_t chunkHeader[8];
+    EQStoreBigEndian(chunkHeader, chunkLength);
+    memcpy(chunkHeader + 4, chunkType, 4);
+
+    uLong chunkCRC = crc32(0L, Z_NULL, 0);
+    chunkCRC = crc32(chunkCRC, chunkHeader + 4, 4);
+    if (chunkLength > 0)
+    {
+        chunkCRC = crc32(chunkCRC, chunkData, chunkLength);
+    }
+    uint8_t chunkFooter[4];
+    EQStoreBigEndian(chunkFooter, (uint32_t)chunkCRC);
+
+    if (!writeBlock(chunkHeader, 8))
+        return NO;
+    if (chunkLength > 0 && !writeBlock(chunkData, chunkLength))
+        return NO;
+    return writeBlock(chunkFooter, 4);
+}
+
+// Picks the filter with the smallest sum of absolute differences, which is the usual heuristic.
+// Mostly empty rows stay unfiltered, and anti-aliased edges usually do better with Sub or Up.
+static void EQFilterPNGRow(const uint8_t *curRow, const uint8_t *prevRow, size_t width, uint8_t *filterRows[3], uint8_t **outRow)
+{
+    unsigned long sums[3] = {0, 0, 0};
+    for (size_t i = 0; i < width; i ++)
+    {
+        uint8_t left = (i > 0) ? curRow[i - 1] : 0;
+        uint8_t up = (NULL != prevRow) ? prevRow[i] : 0;
+
+        uint8_t noneValue = curRow[i];
+        uint8_t subValue = (uint8_t)(curRow[i] - left);
+        uint8_t upValue = (uint8_t)(curRow[i] - up);
+        filterRows[EQPNGFilterNone][i + 1] = noneValue;
+        filterRows[EQPNGFilterSub][i + 1] = subValue;
+        filterRows[EQPNGFilterUp][i + 1] = upValue;
+
+        // Treat the bytes as signed when summing.
+        sums[EQPNGFilterNone] += (noneValue < 128) ? noneValue : 256 - noneValue;
+        sums[EQPNGFilterSub] += (subValue < 128) ? subValue : 256 - subValue;
+        sums[EQPNGFilterUp] += (upValue < 128) ? upValue : 256 - upValue;
+    }
+
+    int bestFilter = EQPNGFilterNone;
+    if (sums[EQPNGFilterSub] < sums[bestFilter])
+        bestFilter = EQPNGFilterSub;
+    if (NULL != prevRow && sums[EQPNGFilterUp] < sums[bestFilter])
+        bestFilter = EQPNGFilterUp;
+
+    filterRows[bestFilter][0] = (uint8_t)bestFilter;
+    *outRow = filterRows[bestFilter];
+}
+
+@implementation EQPNGWriter
+
++ (NSData *)pngDataWithAlphaBuffer: (const uint8_t *)alphaBuffer
+                             width: (size_t)width
+                            height: (size_t)height
+                       bytesPerRow: (size_t)bytesPerRow
+                  compressionLevel: (NSInteger)compressionLevel
+{
+    NSMutableData *pngData = [[NSMutableData alloc] init];
+    BOOL success = [self writeAlphaBuffer:alphaBuffer width:width height:height bytesPerRow:bytesPerRow
+                         compressionLevel:compressionLevel withWriteBlock:^BOOL(const void *bytes, size_t length)
+    {
+        [pngData appendBytes:bytes length:length];
+        return YES;
+    }];
+
+    return success ? pngData : nil;
+}
+
++ (BOOL)writeAlphaBuffer: (const uint8_t *)alphaBuffer
+                   width: (size_t)width
+                  height: (size_t)height
+             bytesPerRow: (size_t)bytesPerRow
+        compressionLevel: (NSInteger)compressionLevel
+        toFileDescriptor: (int)fileDescriptor
+{
+    if (fileDescriptor < 0)
+        return NO;
+
+    return [self writeAlphaBuffer:alphaBuffer width:width height:height bytesPerRow:bytesPerRow
+                 compressionLevel:compressionLevel withWriteBlock:^BOOL(const void *bytes, size_t length)
+    {
+        // write() can stop early or be interrupted by a signal, so keep going until every byte is out.
+        const uint8_t *curBytes = bytes;
+        while (length > 0)
+        {
+            ssize_t written = write(fileDescriptor, curBytes, length);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return NO;
+            curBytes += written;
+            length -= (size_t)written;
+        }
+        return YES;
+    }];
+}
+
++ (BOOL)writeAlphaBuffer: (const uint8_t *)alphaBuffer
+                   width: (size_t)width
+                  height: (size_t)height
+             bytesPerRow: (size_t)bytesPerRow
+        compressionLevel: (NSInteger)compressionLevel
+          withWriteBlock: (EQPNGWriteBlock)writeBlock
+{
+    if (NULL == alphaBuffer || nil == writeBlock || width == 0 || height == 0 || bytesPerRow < width)
+        return NO;
+    if (width > UINT32_MAX || height > UINT32_MAX)
+        return NO;
+
+    int useLevel = (int)MAX(MIN(compressionLevel, 9), -1);
+
+    static const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (!writeBlock(pngSignature, 8))
+        return NO;
+
+    // 8-bit palette image, default compression and filter methods, no interlacing.
+    uint8_t headerData[13];
+    EQStoreBigEndian(headerData, (uint32_t)width);
+    EQStoreBigEndian(headerData + 4, (uint32_t)height);
+    headerData[8] = 8;
+    headerData[9] = 3;
+    headerData[10] = 0;
+    headerData[11] = 0;
+    headerData[12] = 0;
+    if (!EQWritePNGChunk(writeBlock, "IHDR", headerData, 13))
+        return NO;
+
+    // The palette index is the alpha value.
+    uint8_t paletteData[256 * 3];
+    uint8_t transparencyData[256];
+    memset(paletteData, 0, sizeof(paletteData));
+    for (int i = 0; i < 256; i ++)
+    {
+        transparencyData[i] = (uint8_t)i;
+    }
+    if (!EQWritePNGChunk(writeBlock, "PLTE", paletteData, sizeof(paletteData)))
+        return NO;
+    if (!EQWritePNGChunk(writeBlock, "tRNS", transparencyData, sizeof(transparencyData)))
+        return NO;
+
+    z_stream zStream;
+    memset(&zStream, 0, sizeof(zStream));
+    if (deflateInit(&zStream, useLevel) != Z_OK)
+        return NO;
+
+    NSMutableData *filterData = [[NSMutableData alloc] initWithLength:(width + 1) * 3];
+    uint8_t *filterRows[3];
+    filterRows[0] = filterData.mutableBytes;
+    filterRows[1] = filterRows[0] + width + 1;
+    filterRows[2] = filterRows[1] + width + 1;
+
+    NSMutableData *chunkData = [[NSMutableData alloc] initWithLength:kPNG_CHUNK_SIZE];
+    uint8_t *chunkBytes = chunkData.mutableBytes;
+    zStream.next_out = chunkBytes;
+    zStream.avail_out = (uInt)kPNG_CHUNK_SIZE;
+
+    BOOL success = YES;
+    int deflateResult = Z_OK;
+    for (size_t row = 0; row <= height && success; row ++)
+    {
+        // One extra pass after the last row to flush the stream.
+        int flushMode = Z_NO_FLUSH;
+        if (row < height)
+        {
+            const uint8_t *curRow = alphaBuffer + row * bytesPerRow;
+            const uint8_t *prevRow = (row > 0) ? curRow - bytesPerRow : NULL;
+            uint8_t *filteredRow = NULL;
+            EQFilterPNGRow(curRow, prevRow, width, filterRows, &filteredRow);
+            zStream.next_in = filteredRow;
+            zStream.avail_in = (uInt)(width + 1);
+        }
+        else
+        {
+            flushMode = Z_FINISH;
+        }
+
+        do
+        {
+            deflateResult = deflate(&zStream, flushMode);
+            if (deflateResult == Z_STREAM_ERROR)
+            {
+                success = NO;
+                break;
+            }
+            if (zStream.avail_out == 0)
+            {
+                success = EQWritePNGChunk(writeBlock, "IDAT", chunkBytes, (uint32_t)kPNG_CHUNK_SIZE);
+                zStream.next_out = chunkBytes;
+                zStream.avail_out = (uInt)kPNG_CHUNK_SIZE;
+            }
+        } while (success && (zStream.avail_in > 0 || (flushMode == Z_FINISH && deflateResult != Z_STREAM_END)));
+    }
+
+    size_t remainingLength = kPNG_CHUNK_SIZE - zStream.avail_out;
+    if (success && remainingLength > 0)
+    {
+        success = EQWritePNGChunk(writeBlock, "IDAT", chunkBytes, (uint32_t)remainingLength);
+    }
+    deflateEnd(&zStream);
+
+    if (success)
+    {
+        success = EQWritePNGChunk(writeBlock, "IEND", NULL, 0);
+    }
+    return success;
+}
+
+@end
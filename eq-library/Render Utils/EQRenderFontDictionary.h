@@ -18,6 +18,8 @@
 
 #import <Foundation/Foundation.h>
 
+@class UIFont;
+
 // Default font name constants.
 extern NSString* const kDEFAULT_FONT;
 extern NSString* const kDEFAULT_BOLD_FONT;
@@ -29,6 +31,7 @@ extern NSString* const kDEFAULT_SYMBOL_THREE_FONT;
 extern NSString* const kDEFAULT_SYMBOL_FOUR_FONT;
 extern NSString* const kDEFAULT_SYMBOL_ONE_FONT_EXT;
 extern NSString* const kALT_GLYPH_FONT;
+extern NSString* const kDEFAULT_MATH_FONT;
 
 // Default font size constants.
 extern CGFloat const kDEFAULT_FONT_SIZE;
@@ -65,6 +68,11 @@ typedef struct EQfontMetrics
 + (NSDictionary *)userStyledFontDictWithName: (NSString *)fontName size: (CGFloat)useSize kernValue: (CGFloat)kernValue;
 + (NSDictionary *)plainTextFontDictWithName: (NSString *)fontName size: (CGFloat)useSize kernValue: (CGFloat)kernValue;
 
+// The font dictionaries above are shared, so each combination of font, size, kern and flags only exists once.
+// These return or store the shared copy for dictionaries built elsewhere. Other attributes are not shared.
++ (NSDictionary *)sharedAttributes: (NSDictionary *)attributes;
++ (void)addAttributes: (NSDictionary *)attributes toAttributedString: (NSMutableAttributedString *)attributedString range: (NSRange)range;
+
 + (NSDictionary *)preferredFontBodyDictionaryWithSize: (CGFloat)useSize;
 + (NSDictionary *)preferredFontBodyItalicDictionaryWithSize: (CGFloat)useSize;
 + (NSDictionary *)defaultFontDictionaryWithSize: (CGFloat)useSize;
@@ -76,7 +84,16 @@ typedef struct EQfontMetrics
 + (CGFloat)defaultFontXHeightValueWithSize: (CGFloat)useSize;
 + (EQfontMetrics)defaultFontEQMetricsWithSize: (CGFloat)useSize;
 
++ (NSString *)ttfFontNameForFontName: (NSString *)fontName;
++ (UIFont *)ttfFontForFont: (UIFont *)otfFont;
 + (NSAttributedString *)convertAttributedStringForPDF: (NSAttributedString *)convertString;
 + (NSDictionary *)getCharDictionaryWithKey: (NSString *)dictKey;
 
+// The bundled STIX fonts and the alt glyph font, without their TTF versions.
++ (NSArray *)defaultFontNames;
+
+// Loads every default font and its TTF version at each default size and keeps them loaded for the life of the process.
+// Returns the number of fonts that are pinned.
++ (NSUInteger)pinDefaultFonts;
+
 @end
@@ -31,6 +31,8 @@ NSString* const kDEFAULT_SYMBOL_THREE_FONT = @"STIXSizeThreeSym-Regular";
 NSString* const kDEFAULT_SYMBOL_FOUR_FONT = @"STIXSizeFourSym-Regular";
 NSString* const kDEFAULT_SYMBOL_ONE_FONT_EXT = @"STIXSizeOneSymExtended";
 NSString* const kALT_GLYPH_FONT = @"Georgia";
+// Optional OpenType math font, only used when its font file is bundled with the library.
+NSString* const kDEFAULT_MATH_FONT = @"STIXTwoMath-Regular";
 
 // TTF font name constants.
 
@@ -67,40 +69,149 @@ NSString* const kDOUBLE_STR_CHAR_DICTIONARY_KEY = @"kMacroDoubleStrCharDictionar
 
 + (NSDictionary *)fontDictWithName: (NSString *)fontName size: (CGFloat)useSize kernValue: (CGFloat)kernValue
 {
-    NSAssert( (nil != fontName && useSize > 0), @"Invalid parameters for font dictionary.");
-    UIFont *font = [UIFont fontWithName:fontName size:useSize];
-    NSDictionary *attributes = @{NSFontAttributeName: font, NSKernAttributeName: @(kernValue)};
-    
-    return attributes;
+    return [self sharedFontDictWithName:fontName size:useSize kernValue:kernValue flagKey:nil];
 }
 
 + (NSDictionary *)sumOpFontDictWithName: (NSString *)fontName size: (CGFloat)useSize kernValue: (CGFloat)kernValue
 {
-    NSAssert( (nil != fontName && useSize > 0), @"Invalid parameters for font dictionary.");
-    UIFont *font = [UIFont fontWithName:fontName size:useSize];
-    NSDictionary *attributes = @{NSFontAttributeName: font, NSKernAttributeName: @(kernValue), kSUM_OP_CHARACTER: @(TRUE)};
-
-    return attributes;
+    return [self sharedFontDictWithName:fontName size:useSize kernValue:kernValue flagKey:kSUM_OP_CHARACTER];
 }
 
 + (NSDictionary *)userStyledFontDictWithName: (NSString *)fontName size: (CGFloat)useSize kernValue: (CGFloat)kernValue
 {
-    NSAssert( (nil != fontName && useSize > 0), @"Invalid parameters for font dictionary.");
-    UIFont *font = [UIFont fontWithName:fontName size:useSize];
-    NSDictionary *attributes = @{NSFontAttributeName: font, NSKernAttributeName: @(kernValue), kUSER_STYLED_TEXT: @(TRUE)};
-
-    return attributes;
+    return [self sharedFontDictWithName:fontName size:useSize kernValue:kernValue flagKey:kUSER_STYLED_TEXT];
 }
 
 + (NSDictionary *)plainTextFontDictWithName: (NSString *)fontName size: (CGFloat)useSize kernValue: (CGFloat)kernValue
+{
+    return [self sharedFontDictWithName:fontName size:useSize kernValue:kernValue flagKey:kUSES_PLAIN_TEXT];
+}
+
+/*********************************
+ Shared attribute dictionaries.
+ *********************************/
+
+// Every distinct combination of font, kern and flags is stored once.
+// The render strings share these dictionaries, so equal styles can be compared by pointer.
++ (NSMutableDictionary *)sharedAttributeRegistry
+{
+    static NSMutableDictionary *sharedAttributeRegistry = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedAttributeRegistry = [[NSMutableDictionary alloc] init];
+    });
+    return sharedAttributeRegistry;
+}
+
++ (NSString *)registryKeyWithFontName: (NSString *)fontName size: (CGFloat)useSize kernValue: (NSNumber *)kernValue
+                              sumOpValue: (NSNumber *)sumOpValue userStyledValue: (NSNumber *)userStyledValue
+                          plainTextValue: (NSNumber *)plainTextValue
+{
+    // Missing flags are kept separate from NO so that the shared dictionary has exactly the same keys.
+    NSString *(^flagCode)(NSNumber *) = ^NSString *(NSNumber *flagValue)
+    {
+        if (nil == flagValue)
+            return @"-";
+        return flagValue.boolValue ? @"1" : @"0";
+    };
+
+    NSString *kernCode = (nil == kernValue) ? @"-" : [NSString stringWithFormat:@"%.3f", kernValue.doubleValue];
+    return [NSString stringWithFormat:@"%@|%.3f|%@|%@%@%@", (nil == fontName) ? @"-" : fontName, useSize, kernCode,
+            flagCode(sumOpValue), flagCode(userStyledValue), flagCode(plainTextValue)];
+}
+
++ (NSDictionary *)sharedFontDictWithName: (NSString *)fontName size: (CGFloat)useSize kernValue: (CGFloat)kernValue flagKey: (NSString *)flagKey
 {
     NSAssert( (nil != fontName && useSize > 0), @"Invalid parameters for font dictionary.");
+
+    NSNumber *flagValue = @(TRUE);
+    NSString *registryKey = [self registryKeyWithFontName:fontName size:useSize kernValue:@(kernValue)
+                                               sumOpValue:([flagKey isEqualToString:kSUM_OP_CHARACTER] ? flagValue : nil)
+                                          userStyledValue:([flagKey isEqualToString:kUSER_STYLED_TEXT] ? flagValue : nil)
+                                           plainTextValue:([flagKey isEqualToString:kUSES_PLAIN_TEXT] ? flagValue : nil)];
+
+    NSMutableDictionary *registry = [self sharedAttributeRegistry];
+    @synchronized(registry)
+    {
+        NSDictionary *attributes = registry[registryKey];
+        if (nil != attributes)
+            return attributes;
+    }
+
     UIFont *font = [UIFont fontWithName:fontName size:useSize];
-    NSDictionary *attributes = @{NSFontAttributeName: font, NSKernAttributeName: @(kernValue), kUSES_PLAIN_TEXT: @(TRUE)};
+    NSDictionary *attributes = nil;
+    if (nil == flagKey)
+    {
+        attributes = @{NSFontAttributeName: font, NSKernAttributeName: @(kernValue)};
+    }
+    else
+    {
+        attributes = @{NSFontAttributeName: font, NSKernAttributeName: @(kernValue), flagKey: flagValue};
+    }
 
+    // The font may report a different name than the one requested, so store it under both keys.
+    attributes = [self sharedAttributes:attributes];
+    @synchronized(registry)
+    {
+        registry[registryKey] = attributes;
+    }
     return attributes;
 }
 
++ (NSDictionary *)sharedAttributes: (NSDictionary *)attributes
+{
+    if (nil == attributes)
+        return nil;
+
+    // Only the style attributes used by the typesetter are shared.
+    static NSSet *sharedKeys = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedKeys = [NSSet setWithObjects:NSFontAttributeName, NSKernAttributeName, kSUM_OP_CHARACTER, kUSER_STYLED_TEXT, kUSES_PLAIN_TEXT, nil];
+    });
+    for (NSString *attributeKey in attributes)
+    {
+        if (![sharedKeys containsObject:attributeKey])
+            return attributes;
+    }
+
+    UIFont *font = attributes[NSFontAttributeName];
+    if (nil != font && ![font isKindOfClass:[UIFont class]])
+        return attributes;
+
+    NSString *registryKey = [self registryKeyWithFontName:font.fontName size:font.pointSize kernValue:attributes[NSKernAttributeName]
+                                               sumOpValue:attributes[kSUM_OP_CHARACTER]
+                                          userStyledValue:attributes[kUSER_STYLED_TEXT]
+                                           plainTextValue:attributes[kUSES_PLAIN_TEXT]];
+
+    NSMutableDictionary *registry = [self sharedAttributeRegistry];
+    @synchronized(registry)
+    {
+        NSDictionary *sharedAttributes = registry[registryKey];
+        if (nil == sharedAttributes)
+        {
+            sharedAttributes = [attributes copy];
+            registry[registryKey] = sharedAttributes;
+        }
+        return sharedAttributes;
+    }
+}
+
++ (void)addAttributes: (NSDictionary *)attributes toAttributedString: (NSMutableAttributedString *)attributedString range: (NSRange)range
+{
+    if (nil == attributes || nil == attributedString || range.location == NSNotFound || NSMaxRange(range) > attributedString.length)
+        return;
+
+    // Merge into each existing run, then replace the run with the shared copy of the result.
+    [attributedString enumerateAttributesInRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                                      usingBlock:^(NSDictionary *runAttributes, NSRange runRange, BOOL *stop)
+    {
+        NSMutableDictionary *mergedAttributes = [runAttributes mutableCopy];
+        [mergedAttributes addEntriesFromDictionary:attributes];
+        [attributedString setAttributes:[self sharedAttributes:mergedAttributes] range:runRange];
+    }];
+}
+
 
 + (NSDictionary *)preferredFontBodyDictionaryWithSize: (CGFloat)useSize
 {
@@ -170,68 +281,82 @@ NSString* const kDOUBLE_STR_CHAR_DICTIONARY_KEY = @"kMacroDoubleStrCharDictionar
     return returnMetrics;
 }
 
+// Maps each OTF font name to the TTF font used in PDF mode.
+// The alt glyph font maps to itself as it is a system font.
++ (NSString *)ttfFontNameForFontName: (NSString *)fontName
+{
+    static NSDictionary *ttfFontNameMap = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        ttfFontNameMap = @{kDEFAULT_FONT: kDEFAULT_FONT_TTF,
+                           kDEFAULT_ITALIC_FONT: kDEFAULT_ITALIC_FONT_TTF,
+                           kDEFAULT_BOLD_FONT: kDEFAULT_BOLD_FONT_TTF,
+                           kDEFAULT_BOLD_ITALIC_FONT: kDEFAULT_BOLD_ITALIC_FONT_TTF,
+                           kDEFAULT_SYMBOL_ONE_FONT: kDEFAULT_SYMBOL_ONE_FONT_TTF,
+                           kDEFAULT_SYMBOL_TWO_FONT: kDEFAULT_SYMBOL_TWO_FONT_TTF,
+                           kDEFAULT_SYMBOL_THREE_FONT: kDEFAULT_SYMBOL_THREE_FONT_TTF,
+                           kDEFAULT_SYMBOL_FOUR_FONT: kDEFAULT_SYMBOL_FOUR_FONT_TTF,
+                           kALT_GLYPH_FONT: kALT_GLYPH_FONT};
+    });
+
+    if (nil == fontName)
+        return nil;
+
+    return ttfFontNameMap[fontName];
+}
+
+// Returns the TTF twin of the font at the same size, or nil if there isn't one.
+// Fonts are cached by name and size so repeated conversions don't have to look them up again.
++ (UIFont *)ttfFontForFont: (UIFont *)otfFont
+{
+    static NSCache *ttfFontCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        ttfFontCache = [[NSCache alloc] init];
+    });
+
+    if (nil == otfFont)
+        return nil;
+
+    NSString *ttfFontName = [EQRenderFontDictionary ttfFontNameForFontName:otfFont.fontName];
+    if (nil == ttfFontName)
+        return nil;
+
+    if ([ttfFontName isEqualToString:otfFont.fontName])
+        return otfFont;
+
+    NSString *cacheKey = [NSString stringWithFormat:@"%@-%.2f", ttfFontName, otfFont.pointSize];
+    UIFont *ttfFont = [ttfFontCache objectForKey:cacheKey];
+    if (nil == ttfFont)
+    {
+        ttfFont = [UIFont fontWithName:ttfFontName size:otfFont.pointSize];
+        if (nil != ttfFont)
+        {
+            [ttfFontCache setObject:ttfFont forKey:cacheKey];
+        }
+    }
+    return ttfFont;
+}
+
 + (NSAttributedString *)convertAttributedStringForPDF: (NSAttributedString *)convertString
 {
     if (nil == convertString || convertString.length == 0)
         return convertString;
 
     NSMutableAttributedString *returnString = convertString.mutableCopy;
-    [returnString enumerateAttributesInRange:NSMakeRange(0, returnString.length) options:0
-                                  usingBlock:^(NSDictionary *attrs, NSRange range, BOOL *stop)
+    [returnString enumerateAttribute:NSFontAttributeName inRange:NSMakeRange(0, returnString.length) options:0
+                          usingBlock:^(id value, NSRange range, BOOL *stop)
     {
-        UIFont *aFont = attrs[NSFontAttributeName];
-        NSString *fontName = aFont.fontName;
-        CGFloat fontSize = aFont.pointSize;
-        NSMutableDictionary *newDict = attrs.mutableCopy;
-        UIFont *ttfFont = nil;
-        if ([fontName isEqualToString:kDEFAULT_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kDEFAULT_ITALIC_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_ITALIC_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kDEFAULT_BOLD_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_BOLD_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kDEFAULT_BOLD_ITALIC_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_BOLD_ITALIC_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kDEFAULT_SYMBOL_ONE_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_SYMBOL_ONE_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kDEFAULT_SYMBOL_TWO_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_SYMBOL_TWO_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kDEFAULT_SYMBOL_THREE_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_SYMBOL_THREE_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kDEFAULT_SYMBOL_FOUR_FONT])
-        {
-            ttfFont = [UIFont fontWithName:kDEFAULT_SYMBOL_FOUR_FONT_TTF size:fontSize];
-        }
-        else if ([fontName isEqualToString:kALT_GLYPH_FONT])
-        {
-            ttfFont = aFont;
-        }
-        else
+        UIFont *aFont = (UIFont *)value;
+        UIFont *ttfFont = [EQRenderFontDictionary ttfFontForFont:aFont];
+        if (nil == ttfFont)
         {
             // Need this for now, but there shouldn't be any fonts that are unaccounted for at this point.
-            NSLog(@"Error: Missing PDF conversion for font named: %@", fontName);
+            NSLog(@"Error: Missing PDF conversion for font named: %@", aFont.fontName);
         }
-        if (nil != ttfFont)
+        else if (ttfFont != aFont)
         {
-            NSNumber *kernValue = newDict[NSKernAttributeName];
-            [newDict setValue:ttfFont forKey:NSFontAttributeName];
-            [newDict setValue:kernValue forKey:NSKernAttributeName];
-            NSDictionary *useDict = [[NSDictionary alloc] initWithDictionary:newDict];
-            [returnString setAttributes:useDict range:range];
+            [returnString addAttribute:NSFontAttributeName value:ttfFont range:range];
         }
     }];
 
@@ -243,8 +368,13 @@ NSString* const kDOUBLE_STR_CHAR_DICTIONARY_KEY = @"kMacroDoubleStrCharDictionar
     if (nil == dictKey || dictKey.length == 0)
         return nil;
 
-    NSString *dictPath = [[NSBundle mainBundle] pathForResource:kCHAR_LOOKUP_FILE_NAME ofType:@"plist"];
-    NSDictionary *lookupDict = [[NSDictionary alloc] initWithContentsOfFile:dictPath];
+    // The lookup file is only read once.
+    static NSDictionary *lookupDict = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *dictPath = [[NSBundle mainBundle] pathForResource:kCHAR_LOOKUP_FILE_NAME ofType:@"plist"];
+        lookupDict = [[NSDictionary alloc] initWithContentsOfFile:dictPath];
+    });
 
     NSDictionary *charDict = lookupDict[dictKey];
     if (nil == charDict || charDict.count == 0)
@@ -253,6 +383,42 @@ NSString* const kDOUBLE_STR_CHAR_DICTIONARY_KEY = @"kMacroDoubleStrCharDictionar
     return charDict;
 }
 
++ (NSArray *)defaultFontNames
+{
+    return @[kDEFAULT_FONT, kDEFAULT_BOLD_FONT, kDEFAULT_ITALIC_FONT, kDEFAULT_BOLD_ITALIC_FONT,
+             kDEFAULT_SYMBOL_ONE_FONT, kDEFAULT_SYMBOL_TWO_FONT, kDEFAULT_SYMBOL_THREE_FONT, kDEFAULT_SYMBOL_FOUR_FONT,
+             kALT_GLYPH_FONT];
+}
+
++ (NSUInteger)pinDefaultFonts
+{
+    static NSMutableArray *pinnedFonts = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pinnedFonts = [[NSMutableArray alloc] init];
+        NSArray *fontSizes = @[@(kDEFAULT_FONT_SIZE), @(kDEFAULT_FONT_SIZE_SMALL), @(kDEFAULT_FONT_SIZE_SMALLER),
+                               @(kDEFAULT_FONT_SIZE_LARGE), @(kDEFAULT_FONT_SIZE_LARGE_INTEGRAL)];
+        for (NSString *fontName in [EQRenderFontDictionary defaultFontNames])
+        {
+            for (NSNumber *fontSize in fontSizes)
+            {
+                UIFont *font = [UIFont fontWithName:fontName size:fontSize.floatValue];
+                if (nil == font)
+                    continue;
+
+                [pinnedFonts addObject:font];
+                UIFont *ttfFont = [EQRenderFontDictionary ttfFontForFont:font];
+                if (nil != ttfFont && ttfFont != font)
+                {
+                    [pinnedFonts addObject:ttfFont];
+                }
+            }
+        }
+    });
+
+    return pinnedFonts.count;
+}
+
 
 
 @end
@@ -0,0 +1,41 @@
+//
+//  EQRenderPrewarm.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+
+// Step names used in the prewarm timings.
+extern NSString* const kPREWARM_FONTS_STEP;
+extern NSString* const kPREWARM_TABLES_STEP;
+extern NSString* const kPREWARM_CORETEXT_STEP;
+extern NSString* const kPREWARM_LAYOUT_STEP;
+
+// The first equation in a process is much slower than the rest, as it loads the fonts and builds the shared tables.
+// Call prewarm at startup, ideally with prewarmInBackgroundWithCompletion:, so that cost is paid before any math is shown.
+
+@interface EQRenderPrewarm : NSObject
+
+// Runs every step on the calling thread, which can be any thread. Only the first call does any work.
+// Returns @[stepName, @(milliseconds)] tuples in the order the steps ran.
++ (NSArray *)prewarm;
+
+// Runs every step on a background queue and calls the completion block on the main queue.
++ (void)prewarmInBackgroundWithCompletion: (void (^)(NSArray *stepTimings))completion;
+
++ (BOOL)hasPrewarmed;
+
+@end
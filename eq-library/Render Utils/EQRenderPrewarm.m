@@ -0,0 +1,205 @@
+//
+//  EQRenderPrewarm.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <UIKit/UIKit.h>
+#import <CoreText/CoreText.h>
+#import <QuartzCore/QuartzCore.h>
+#import "EQRenderPrewarm.h"
+#import "EQRenderFontDictionary.h"
+#import "EQRenderTypesetter.h"
+#import "EQRenderStretchyBracers.h"
+#import "EQMathTable.h"
+#import "EQRenderEquation.h"
+#import "EQXMLImporter.h"
+#import "EquationViewDataSource.h"
+
+NSString* const kPREWARM_FONTS_STEP = @"fonts";
+NSString* const kPREWARM_TABLES_STEP = @"tables";
+NSString* const kPREWARM_CORETEXT_STEP = @"coretext";
+NSString* const kPREWARM_LAYOUT_STEP = @"layout";
+
+// Uses a fraction, a radical, scripts, a large operator and stretchy bracers so each layout path runs once.
+static NSString * const kPREWARM_MATHML = @"<math><mrow><munderover><mo largeop=\"true\">&#x2211;</mo><mrow><mi>i</mi><mo>=</mo><mn>1</mn></mrow><mi>n</mi></munderover>"
+                                           "<mo stretchy=\"true\">(</mo><mfrac><mrow><msup><mi>x</mi><mn>2</mn></msup><mo>+</mo><mn>1</mn></mrow>"
+                                           "<msqrt><msub><mi>y</mi><mi>i</mi></msub></msqrt></mfrac><mo stretchy=\"true\">)</mo></mrow></math>";
+
+static BOOL sHasPrewarmed = NO;
+
+@interface EQRenderPrewarm()
+
++ (NSArray *)runSteps: (NSArray *)stepNames;
++ (NSArray *)prewarmResources;
++ (NSArray *)prewarmLayoutStep;
++ (void)prewarmFonts;
++ (void)prewarmTables;
++ (void)prewarmCoreText;
++ (void)prewarmLayout;
+
+@end
+
+@implementation EQRenderPrewarm
+
++ (NSArray *)prewarm
+{
+    return [[EQRenderPrewarm prewarmResources] arrayByAddingObjectsFromArray:[EQRenderPrewarm prewarmLayoutStep]];
+}
+
+// The shared layout caches are locked or built once, the same as ConvertMathQueue relies on,
+// and the sample equation has its own data source, so every step can run off the main thread.
++ (void)prewarmInBackgroundWithCompletion: (void (^)(NSArray *stepTimings))completion
+{
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        NSArray *stepTimings = [EQRenderPrewarm prewarm];
+        if (nil != completion)
+        {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(stepTimings);
+            });
+        }
+    });
+}
+
++ (NSArray *)runSteps: (NSArray *)stepNames
+{
+    NSMutableArray *timings = [[NSMutableArray alloc] init];
+    for (NSString *stepName in stepNames)
+    {
+        CFTimeInterval startTime = CACurrentMediaTime();
+        @autoreleasepool
+        {
+            if ([stepName isEqualToString:kPREWARM_FONTS_STEP])
+                [EQRenderPrewarm prewarmFonts];
+            else if ([stepName isEqualToString:kPREWARM_TABLES_STEP])
+                [EQRenderPrewarm prewarmTables];
+            else if ([stepName isEqualToString:kPREWARM_CORETEXT_STEP])
+                [EQRenderPrewarm prewarmCoreText];
+            else
+                [EQRenderPrewarm prewarmLayout];
+        }
+        [timings addObject:@[stepName, @((CACurrentMediaTime() - startTime) * 1000.0)]];
+    }
+    return timings.copy;
+}
+
++ (NSArray *)prewarmResources
+{
+    static NSArray *resourceTimings = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        resourceTimings = [EQRenderPrewarm runSteps:@[kPREWARM_FONTS_STEP, kPREWARM_TABLES_STEP, kPREWARM_CORETEXT_STEP]];
+    });
+    return resourceTimings;
+}
+
++ (NSArray *)prewarmLayoutStep
+{
+    static NSArray *layoutTimings = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        layoutTimings = [EQRenderPrewarm runSteps:@[kPREWARM_LAYOUT_STEP]];
+        sHasPrewarmed = YES;
+    });
+    return layoutTimings;
+}
+
++ (BOOL)hasPrewarmed
+{
+    return sHasPrewarmed;
+}
+
+// Loads and pins the fonts, then builds the shared attribute dictionaries for the common sizes.
++ (void)prewarmFonts
+{
+    [EQRenderFontDictionary pinDefaultFonts];
+
+    NSArray *fontSizes = @[@(kDEFAULT_FONT_SIZE), @(kDEFAULT_FONT_SIZE_SMALL), @(kDEFAULT_FONT_SIZE_SMALLER)];
+    for (NSNumber *fontSize in fontSizes)
+    {
+        [EQRenderFontDictionary defaultFontDictionaryWithSize:fontSize.floatValue];
+        [EQRenderFontDictionary defaultItalicFontDictionaryWithSize:fontSize.floatValue];
+        [EQRenderFontDictionary symOneFontDictionaryWithSize:fontSize.floatValue];
+    }
+    [EQRenderFontDictionary defaultFontEQMetricsWithSize:kDEFAULT_FONT_SIZE];
+}
+
+// Creating a typesetter builds the tables it keeps, the rest are only used by the layout classes.
++ (void)prewarmTables
+{
+    (void)[[EQRenderTypesetter alloc] init];
+    [EQRenderTypesetter getDescenderCharacters];
+    [EQRenderTypesetter getItalicAdjustCharacters];
+    [EQRenderTypesetter getLeftTrailingCharacters];
+    [EQRenderTypesetter getDescenderCharacterSet];
+    [EQRenderTypesetter getCapAndNumberCharacterSet];
+    [EQRenderTypesetter getStretchyBracerCharacters];
+    [EQRenderTypesetter getLeftStretchyBracerCharacters];
+    [EQRenderTypesetter getRightStretchyBracerCharacters];
+    [EQRenderTypesetter getVerticalStretchyBracerCharacters];
+    [EQRenderTypesetter getOperatorCharacterSet];
+    [EQRenderTypesetter getSumOpCharacterSet];
+    [EQRenderTypesetter getNumberCharacterSet];
+    [EQRenderTypesetter getStretchyBracerSet];
+    [EQRenderTypesetter getMiscIdentifierCharacterSet];
+    [EQRenderTypesetter getMiscNumericCharacterSet];
+    [EQRenderTypesetter getGeometryCharacterSet];
+    [EQRenderTypesetter getScriptCharacters];
+    [EQRenderTypesetter getFrakturCharacters];
+    [EQRenderTypesetter getBlackboardCharacters];
+    [EQRenderTypesetter getAccentOpCharacters];
+
+    [EQRenderStretchyBracers getStretchyBracerMetrics];
+    [EQRenderFontDictionary getCharDictionaryWithKey:kSCRIPT_CHAR_DICTIONARY_KEY];
+    [EQMathTable defaultMathTable];
+}
+
+// Shapes some text in each font so CoreText has its glyph and metric caches filled.
++ (void)prewarmCoreText
+{
+    CGContextRef measureContext = [EQRenderEquation createMeasureContext];
+    NSString *sampleString = @"xyz0123456789+−=()[]{}∑∫√αβγ";
+    for (NSString *fontName in [EQRenderFontDictionary defaultFontNames])
+    {
+        UIFont *font = [UIFont fontWithName:fontName size:kDEFAULT_FONT_SIZE];
+        if (nil == font)
+            continue;
+
+        NSAttributedString *sampleText = [[NSAttributedString alloc] initWithString:sampleString attributes:@{NSFontAttributeName: font}];
+        CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)sampleText);
+        CTLineGetTypographicBounds(line, NULL, NULL, NULL);
+        if (NULL != measureContext)
+        {
+            CTLineGetImageBounds(line, measureContext);
+        }
+        CFRelease(line);
+    }
+
+    if (NULL != measureContext)
+    {
+        CGContextRelease(measureContext);
+    }
+}
+
++ (void)prewarmLayout
+{
+    EquationViewDataSource *prewarmDataSource = [EQXMLImporter populateDataSourceWithXMLString:kPREWARM_MATHML];
+    EQRenderEquation *prewarmEquation = [prewarmDataSource buildRenderEquation];
+    [prewarmEquation layoutEquationLines];
+    [prewarmEquation inkBounds];
+}
+
+@end
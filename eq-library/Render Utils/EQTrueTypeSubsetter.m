@@ -0,0 +1,361 @@
+//
+//  EQTrueTypeSubsetter.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import "EQTrueTypeSubsetter.h"
+
+// Composite glyph component flags.
+static const uint16_t kTT_ARG_1_AND_2_ARE_WORDS = 0x0001;
+static const uint16_t kTT_WE_HAVE_A_SCALE = 0x0008;
+static const uint16_t kTT_MORE_COMPONENTS = 0x0020;
+static const uint16_t kTT_WE_HAVE_AN_X_AND_Y_SCALE = 0x0040;
+static const uint16_t kTT_WE_HAVE_A_TWO_BY_TWO = 0x0080;
+
+static const uint32_t kTT_CHECKSUM_MAGIC = 0xB1B0AFBA;
+
+static NSArray *EQTrueTypeRequiredTags(void)
+{
+    return @[@"head", @"hhea", @"hmtx", @"loca", @"glyf", @"maxp"];
+}
+
+// Hinting tables are kept when the font has them.
+static NSArray *EQTrueTypeOptionalTags(void)
+{
+    return @[@"cvt ", @"fpgm", @"prep"];
+}
+
+static CTFontTableTag EQTrueTypeTagFromString(NSString *tagString)
+{
+    CTFontTableTag tableTag = 0;
+    for (NSUInteger i = 0; i < 4 && i < tagString.length; i++)
+    {
+        tableTag = (tableTag << 8) | ([tagString characterAtIndex:i] & 0xFF);
+    }
+    return tableTag;
+}
+
+static uint16_t EQReadUInt16(const uint8_t *bytes)
+{
+    return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+static uint32_t EQReadUInt32(const uint8_t *bytes)
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+static void EQWriteUInt16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)(value >> 8);
+    bytes[1] = (uint8_t)(value & 0xFF);
+}
+
+static void EQWriteUInt32(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = (uint8_t)(value >> 24);
+    bytes[1] = (uint8_t)((value >> 16) & 0xFF);
+    bytes[2] = (uint8_t)((value >> 8) & 0xFF);
+    bytes[3] = (uint8_t)(value & 0xFF);
+}
+
+static void EQAppendUInt16(NSMutableData *data, uint16_t value)
+{
+    uint8_t bytes[2];
+    EQWriteUInt16(bytes, value);
+    [data appendBytes:bytes length:2];
+}
+
+static void EQAppendUInt32(NSMutableData *data, uint32_t value)
+{
+    uint8_t bytes[4];
+    EQWriteUInt32(bytes, value);
+    [data appendBytes:bytes length:4];
+}
+
+// Sums the data as big-endian longs, padding the last one with zeros.
+static uint32_t EQTrueTypeChecksum(const uint8_t *bytes, NSUInteger length)
+{
+    uint32_t checksum = 0;
+    NSUInteger fullLength = length & ~(NSUInteger)3;
+    for (NSUInteger i = 0; i < fullLength; i += 4)
+    {
+        checksum += EQReadUInt32(bytes + i);
+    }
+
+    if (fullLength < length)
+    {
+        uint8_t lastBytes[4] = {0, 0, 0, 0};
+        memcpy(lastBytes, bytes + fullLength, length - fullLength);
+        checksum += EQReadUInt32(lastBytes);
+    }
+
+    return checksum;
+}
+
+static void EQPadToLong(NSMutableData *data)
+{
+    NSUInteger padLength = (4 - (data.length & 3)) & 3;
+    if (padLength > 0)
+    {
+        uint8_t padBytes[3] = {0, 0, 0};
+        [data appendBytes:padBytes length:padLength];
+    }
+}
+
+@implementation EQTrueTypeSubsetter
+
++ (BOOL)fontHasTrueTypeOutlines: (CTFontRef)font
+{
+    if (NULL == font)
+        return NO;
+
+    BOOL hasOutlines = NO;
+    CFArrayRef tableTags = CTFontCopyAvailableTables(font, kCTFontTableOptionNoOptions);
+    if (NULL != tableTags)
+    {
+        CFIndex tagCount = CFArrayGetCount(tableTags);
+        BOOL hasGlyf = NO;
+        BOOL hasLoca = NO;
+        for (CFIndex i = 0; i < tagCount; i++)
+        {
+            // The array holds the tags directly rather than as objects.
+            CTFontTableTag tableTag = (CTFontTableTag)(uintptr_t)CFArrayGetValueAtIndex(tableTags, i);
+            hasGlyf = hasGlyf || (tableTag == kCTFontTableGlyf);
+            hasLoca = hasLoca || (tableTag == kCTFontTableLoca);
+        }
+        CFRelease(tableTags);
+        hasOutlines = (hasGlyf && hasLoca);
+    }
+
+    return hasOutlines;
+}
+
++ (NSDictionary *)tablesForFont: (CTFontRef)font
+{
+    if (NULL == font)
+        return nil;
+
+    NSMutableDictionary *returnTables = [[NSMutableDictionary alloc] init];
+    NSArray *allTags = [EQTrueTypeRequiredTags() arrayByAddingObjectsFromArray:EQTrueTypeOptionalTags()];
+    for (NSString *tagString in allTags)
+    {
+        CFDataRef tableData = CTFontCopyTable(font, EQTrueTypeTagFromString(tagString), kCTFontTableOptionNoOptions);
+        if (NULL != tableData)
+        {
+            returnTables[tagString] = (__bridge_transfer NSData *)tableData;
+        }
+    }
+
+    return returnTables;
+}
+
++ (NSData *)subsetFontWithTables: (NSDictionary *)fontTables glyphs: (NSIndexSet *)glyphs
+{
+    for (NSString *tagString in EQTrueTypeRequiredTags())
+    {
+        if (nil == fontTables[tagString])
+            return nil;
+    }
+
+    NSData *headData = fontTables[@"head"];
+    NSData *maxpData = fontTables[@"maxp"];
+    NSData *locaData = fontTables[@"loca"];
+    NSData *glyfData = fontTables[@"glyf"];
+    if (headData.length < 54 || maxpData.length < 6)
+        return nil;
+
+    const uint8_t *headBytes = headData.bytes;
+    BOOL useLongOffsets = (EQReadUInt16(headBytes + 50) != 0);
+    NSUInteger glyphCount = EQReadUInt16((const uint8_t *)maxpData.bytes + 4);
+
+    // Read the glyph offsets.
+    NSUInteger offsetSize = useLongOffsets ? 4 : 2;
+    if (locaData.length < (glyphCount + 1) * offsetSize)
+        return nil;
+
+    const uint8_t *locaBytes = locaData.bytes;
+    NSMutableData *offsetData = [[NSMutableData alloc] initWithLength:(glyphCount + 1) * sizeof(uint32_t)];
+    uint32_t *glyphOffsets = offsetData.mutableBytes;
+    for (NSUInteger i = 0; i <= glyphCount; i++)
+    {
+        glyphOffsets[i] = useLongOffsets ? EQReadUInt32(locaBytes + 4 * i) : 2 * (uint32_t)EQReadUInt16(locaBytes + 2 * i);
+        if (glyphOffsets[i] > glyfData.length || (i > 0 && glyphOffsets[i] < glyphOffsets[i - 1]))
+            return nil;
+    }
+
+    // Add the components of composite glyphs until nothing new is found.
+    const uint8_t *glyfBytes = glyfData.bytes;
+    NSMutableIndexSet *keepGlyphs = [[NSMutableIndexSet alloc] initWithIndex:0];
+    NSMutableArray *pendingGlyphs = [[NSMutableArray alloc] init];
+    [glyphs enumerateIndexesUsingBlock:^(NSUInteger glyph, BOOL *stop)
+    {
+        if (glyph < glyphCount && ![keepGlyphs containsIndex:glyph])
+        {
+            [keepGlyphs addIndex:glyph];
+            [pendingGlyphs addObject:@(glyph)];
+        }
+    }];
+
+    while (pendingGlyphs.count > 0)
+    {
+        NSUInteger glyph = [(NSNumber *)pendingGlyphs.lastObject unsignedIntegerValue];
+        [pendingGlyphs removeLastObject];
+
+        uint32_t glyphStart = glyphOffsets[glyph];
+        uint32_t glyphEnd = glyphOffsets[glyph + 1];
+        if (glyphEnd - glyphStart < 10 || (int16_t)EQReadUInt16(glyfBytes + glyphStart) >= 0)
+            continue;
+
+        // Composite glyphs store their components after the 10 byte glyph header.
+        uint32_t readOffset = glyphStart + 10;
+        uint16_t componentFlags = kTT_MORE_COMPONENTS;
+        while ((componentFlags & kTT_MORE_COMPONENTS) && readOffset + 4 <= glyphEnd)
+        {
+            componentFlags = EQReadUInt16(glyfBytes + readOffset);
+            NSUInteger componentGlyph = EQReadUInt16(glyfBytes + readOffset + 2);
+            readOffset += 4;
+            readOffset += (componentFlags & kTT_ARG_1_AND_2_ARE_WORDS) ? 4 : 2;
+            if (componentFlags & kTT_WE_HAVE_A_SCALE)
+                readOffset += 2;
+            else if (componentFlags & kTT_WE_HAVE_AN_X_AND_Y_SCALE)
+                readOffset += 4;
+            else if (componentFlags & kTT_WE_HAVE_A_TWO_BY_TWO)
+                readOffset += 8;
+
+            if (componentGlyph < glyphCount && ![keepGlyphs containsIndex:componentGlyph])
+            {
+                [keepGlyphs addIndex:componentGlyph];
+                [pendingGlyphs addObject:@(componentGlyph)];
+            }
+        }
+    }
+
+    // Copy the kept outlines and write long offsets for every glyph.
+    NSMutableData *newGlyfData = [[NSMutableData alloc] init];
+    NSMutableData *newLocaData = [[NSMutableData alloc] initWithCapacity:(glyphCount + 1) * 4];
+    for (NSUInteger i = 0; i < glyphCount; i++)
+    {
+        EQAppendUInt32(newLocaData, (uint32_t)newGlyfData.length);
+        if ([keepGlyphs containsIndex:i] && glyphOffsets[i + 1] > glyphOffsets[i])
+        {
+            [newGlyfData appendBytes:glyfBytes + glyphOffsets[i] length:glyphOffsets[i + 1] - glyphOffsets[i]];
+            EQPadToLong(newGlyfData);
+        }
+    }
+    EQAppendUInt32(newLocaData, (uint32_t)newGlyfData.length);
+
+    // Keep the metrics of the kept glyphs and zero the rest. Only the long metrics up to the last kept glyph are written.
+    // The last long metric always keeps its advance, since every glyph after it shares that advance.
+    NSData *hheaData = fontTables[@"hhea"];
+    NSData *hmtxData = fontTables[@"hmtx"];
+    NSMutableData *newHheaData = nil;
+    NSMutableData *newHmtxData = nil;
+    NSUInteger longMetricCount = (hheaData.length >= 36) ? EQReadUInt16((const uint8_t *)hheaData.bytes + 34) : 0;
+    if (longMetricCount > 0 && longMetricCount <= glyphCount && hmtxData.length >= 2 * (longMetricCount + glyphCount))
+    {
+        const uint8_t *hmtxBytes = hmtxData.bytes;
+        NSUInteger newLongMetricCount = MIN(keepGlyphs.lastIndex + 1, longMetricCount);
+        newHmtxData = [[NSMutableData alloc] initWithCapacity:2 * (newLongMetricCount + glyphCount)];
+        for (NSUInteger i = 0; i < newLongMetricCount; i++)
+        {
+            BOOL keepMetric = [keepGlyphs containsIndex:i] || (i == newLongMetricCount - 1);
+            EQAppendUInt32(newHmtxData, keepMetric ? EQReadUInt32(hmtxBytes + 4 * i) : 0);
+        }
+        for (NSUInteger i = newLongMetricCount; i < glyphCount; i++)
+        {
+            uint16_t sideBearing = 0;
+            if ([keepGlyphs containsIndex:i])
+            {
+                sideBearing = (i < longMetricCount) ? EQReadUInt16(hmtxBytes + 4 * i + 2) : EQReadUInt16(hmtxBytes + 4 * longMetricCount + 2 * (i - longMetricCount));
+            }
+            EQAppendUInt16(newHmtxData, sideBearing);
+        }
+
+        newHheaData = hheaData.mutableCopy;
+        EQWriteUInt16((uint8_t *)newHheaData.mutableBytes + 34, (uint16_t)newLongMetricCount);
+    }
+
+    NSMutableData *newHeadData = headData.mutableCopy;
+    uint8_t *newHeadBytes = newHeadData.mutableBytes;
+    EQWriteUInt32(newHeadBytes + 8, 0);
+    EQWriteUInt16(newHeadBytes + 50, 1);
+
+    NSMutableDictionary *writeTables = [[NSMutableDictionary alloc] init];
+    for (NSString *tagString in [EQTrueTypeRequiredTags() arrayByAddingObjectsFromArray:EQTrueTypeOptionalTags()])
+    {
+        if (nil != fontTables[tagString])
+        {
+            writeTables[tagString] = fontTables[tagString];
+        }
+    }
+    writeTables[@"head"] = newHeadData;
+    writeTables[@"loca"] = newLocaData;
+    writeTables[@"glyf"] = newGlyfData;
+    if (nil != newHmtxData)
+    {
+        writeTables[@"hhea"] = newHheaData;
+        writeTables[@"hmtx"] = newHmtxData;
+    }
+
+    // Offset table, followed by the table records in tag order.
+    NSArray *sortedTags = [writeTables.allKeys sortedArrayUsingSelector:@selector(compare:)];
+    uint16_t tableCount = (uint16_t)sortedTags.count;
+    uint16_t entrySelector = 0;
+    while ((1 << (entrySelector + 1)) <= tableCount)
+    {
+        entrySelector++;
+    }
+    uint16_t searchRange = (uint16_t)((1 << entrySelector) * 16);
+
+    NSMutableData *fontData = [[NSMutableData alloc] init];
+    EQAppendUInt32(fontData, 0x00010000);
+    EQAppendUInt16(fontData, tableCount);
+    EQAppendUInt16(fontData, searchRange);
+    EQAppendUInt16(fontData, entrySelector);
+    EQAppendUInt16(fontData, (uint16_t)(tableCount * 16 - searchRange));
+
+    NSUInteger tableOffset = 12 + 16 * tableCount;
+    NSUInteger headOffset = 0;
+    for (NSString *tagString in sortedTags)
+    {
+        NSData *tableData = writeTables[tagString];
+        EQAppendUInt32(fontData, EQTrueTypeTagFromString(tagString));
+        EQAppendUInt32(fontData, EQTrueTypeChecksum(tableData.bytes, tableData.length));
+        EQAppendUInt32(fontData, (uint32_t)tableOffset);
+        EQAppendUInt32(fontData, (uint32_t)tableData.length);
+
+        if ([tagString isEqualToString:@"head"])
+        {
+            headOffset = tableOffset;
+        }
+        tableOffset += (tableData.length + 3) & ~(NSUInteger)3;
+    }
+
+    for (NSString *tagString in sortedTags)
+    {
+        [fontData appendData:writeTables[tagString]];
+        EQPadToLong(fontData);
+    }
+
+    // The head checksum adjustment makes the whole font sum to the magic number.
+    uint32_t fontChecksum = EQTrueTypeChecksum(fontData.bytes, fontData.length);
+    EQWriteUInt32((uint8_t *)fontData.mutableBytes + headOffset + 8, kTT_CHECKSUM_MAGIC - fontChecksum);
+
+    return fontData;
+}
+
+@end
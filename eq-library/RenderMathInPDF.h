@@ -25,4 +25,8 @@
 // See the comments in the example code for more information about some of the settings.
 + (void)drawTeXStr: (NSString *)texStr isInline: (BOOL)isInline atPoint: (CGPoint)drawOrigin;
 
+// Returns a one page PDF sized to the equation. Uses EQRenderPDFWriter, so no PDF context is needed.
++ (NSData *)pdfDataForTeXStr: (NSString *)texStr isInline: (BOOL)isInline;
++ (NSData *)pdfDataForMathMLStr: (NSString *)mathMLStr isInline: (BOOL)isInline;
+
 @end
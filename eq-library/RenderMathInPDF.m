@@ -20,6 +20,7 @@
 #import "EQRenderEquation.h"
 #import "ConvertBlahtex.h"
 #import "EQXMLImporter.h"
+#import "EQRenderPDFWriter.h"
 
 @implementation RenderMathInPDF
 
@@ -52,34 +53,55 @@
     // This tells the class to size and layout the stored math.
     // This has a small amount of overhead but is necessary if you want to find out how big your equation is beforehand.
     // Math is rendered by the library as display equation by default.
-    [newEquationData layoutEquationLines];
-
-    // You need to multiply the computed size by any scale factor as the math is not actually scaled until it is draw in the context.
-    CGSize scaledSize;
+    CGRect drawFrame;
     if (isInline)
     {
-        // Uses a different method to compute the size, may not be as accurate.
-        // Inline math is "best guess" scaled down version.
-        // You can just toss this and use your own code if you like it better.
-        CGSize scaledSize = [newEquationData computeInlineSize];
-        scaledSize.width *= 0.7;
-        scaledSize.height *= 0.7;
+        // Inline math is a scaled down version of the display layout.
+        // The inline metrics are measured during layout, so you can line the baseline up with the surrounding text
+        // without measuring the equation a second time. Here the top left of the math is placed at the draw origin.
+        newEquationData.pdfScale = 0.7;
+        EQInlineMetrics inlineMetrics = [newEquationData layoutInlineEquation];
+        CGFloat inlineTop = inlineMetrics.baselineOrigin.y - inlineMetrics.ascent;
+        drawFrame = CGRectMake(drawOrigin.x - inlineMetrics.baselineOrigin.x, drawOrigin.y - inlineTop,
+                               inlineMetrics.width, inlineMetrics.ascent + inlineMetrics.descent);
     }
     else
     {
+        [newEquationData layoutEquationLines];
+
         // This is more tested as code base was originally designed to draw display equations.
-        // You need to take the scaled size and multiply it
-        scaledSize = newEquationData.drawSize;
+        // You need to multiply the computed size by any scale factor as the math is not actually scaled until it is draw in the context.
+        CGSize scaledSize = newEquationData.drawSize;
         scaledSize.width *= newEquationData.pdfScale;
         scaledSize.height *= newEquationData.pdfScale;
-    }
 
-    // Resulting frame with the given origin and the computed size.
-    CGRect drawFrame = CGRectMake(drawOrigin.x, drawOrigin.y, scaledSize.width, scaledSize.height);
+        // Resulting frame with the given origin and the computed size.
+        drawFrame = CGRectMake(drawOrigin.x, drawOrigin.y, scaledSize.width, scaledSize.height);
+    }
 
     // This is where the drawing actually occurs.
     // a core graphics context of some sort is *required* at this point.
     [newEquationData drawEquationLinesInRect:drawFrame];
 }
 
++ (NSData *)pdfDataForTeXStr: (NSString *)texStr isInline: (BOOL)isInline
+{
+    NSString *mathMLStr = [ConvertBlahtex convertTexToMML:texStr isInline:isInline];
+    if (mathMLStr.length == 0)
+        return nil;
+
+    return [self pdfDataForMathMLStr:mathMLStr isInline:isInline];
+}
+
+// The writer embeds its own font subsets, so usePDFMode and shouldFlipContext don't apply here.
++ (NSData *)pdfDataForMathMLStr: (NSString *)mathMLStr isInline: (BOOL)isInline
+{
+    EquationViewDataSource *newDataSource = [EQXMLImporter populateDataSourceWithXMLString:mathMLStr];
+    EQRenderEquation *newEquationData = [newDataSource buildRenderEquation];
+    newEquationData.pdfScale = isInline ? 0.7 : 1.0;
+    [newEquationData layoutEquationLines];
+
+    return [EQRenderPDFWriter pdfDataWithRenderEquation:newEquationData];
+}
+
 @end
@@ -0,0 +1,64 @@
+//
+//  RenderMathWorker.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#include <stdio.h>
+
+// Runs the library as a long lived render process for batch pipelines.
+// Start the app binary with --render-worker (for example through "xcrun simctl spawn") and it reads requests
+// on stdin instead of showing any UI. Fonts, glyph atlases and typesetter tables stay loaded between requests.
+
+// Each request is a JSON object:
+//   {"id": "eq1", "math": "<math>...</math>", "format": "png", "output": "/tmp/eq1.png"}
+// "format" is png, pdf or svg and defaults to png. TeX input is converted through blahtex, or set "input" to "tex" or "mathml".
+// A line that isn't JSON is treated as the math itself with the default settings.
+// Without an "output" path the result bytes are written to stdout straight after the response.
+
+// Each response is a JSON object with the id, status, byte length, the file path if there is one and the timings in milliseconds.
+
+typedef enum
+{
+    // One request per line, and one response per line followed by any result bytes.
+    workerFramingLines,
+    // A 4 byte big endian length before every request, response and result.
+    workerFramingLengthPrefixed,
+} RenderMathWorkerFraming;
+
+@interface RenderMathWorker : NSObject
+
+@property (nonatomic) RenderMathWorkerFraming framing;
+@property (nonatomic) NSInteger compressionLevel;
+
+- (id)initWithInputFile: (FILE *)inputFile outputFile: (FILE *)outputFile;
+
+// Runs EQRenderPrewarm and renders a small equation so the first request doesn't pay for loading fonts and tables.
+// Returns the time taken in milliseconds.
+- (double)prewarm;
+
+// Renders a single request and returns the response. The result bytes are returned if there is no output path.
+- (NSDictionary *)handleRequest: (NSDictionary *)request resultData: (NSData **)resultData;
+
+// Reads requests until the input is closed. Returns the process exit status.
+// A request that can't be read gets an error response. If the length prefixes can't be followed any more,
+// the worker stops after that response and returns 1.
+- (int)run;
+
++ (BOOL)shouldRunWithArgc: (int)argc argv: (char *[])argv;
++ (int)runWithArgc: (int)argc argv: (char *[])argv;
+
+@end
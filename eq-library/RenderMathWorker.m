@@ -0,0 +1,351 @@
+//
+//  RenderMathWorker.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <QuartzCore/QuartzCore.h>
+#import "RenderMathWorker.h"
+#import "ConvertMathToImage.h"
+#import "ConvertBlahtex.h"
+#import "RenderMathInPDF.h"
+#import "EQRenderPrewarm.h"
+
+static NSString * const kWORKER_ARGUMENT = @"--render-worker";
+static NSString * const kWORKER_LENGTH_ARGUMENT = @"--length-prefixed";
+
+// Requests larger than this are refused rather than read into memory.
+static const uint32_t kWORKER_MAX_REQUEST_LENGTH = 16 * 1024 * 1024;
+
+@interface RenderMathWorker()
+{
+    FILE *inputFile;
+    FILE *outputFile;
+}
+
+- (NSData *)readNextRequestWithError: (NSString **)framingError;
+- (NSDictionary *)requestForData: (NSData *)requestData;
+- (NSData *)renderMath: (NSString *)mathStr format: (NSString *)format isTeX: (BOOL)isTeX timings: (NSMutableDictionary *)timings;
+- (BOOL)writeResponse: (NSDictionary *)response resultData: (NSData *)resultData;
+- (BOOL)writeFramedData: (NSData *)writeData;
+
+@end
+
+@implementation RenderMathWorker
+
+- (id)initWithInputFile: (FILE *)inputFile outputFile: (FILE *)outputFile
+{
+    self = [super init];
+    if (self)
+    {
+        self->inputFile = inputFile;
+        self->outputFile = outputFile;
+        self->_framing = workerFramingLines;
+        self->_compressionLevel = 6;
+    }
+    return self;
+}
+
+/*** Begin Class methods ***/
+
++ (BOOL)shouldRunWithArgc: (int)argc argv: (char *[])argv
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if ([kWORKER_ARGUMENT isEqualToString:@(argv[i])])
+            return YES;
+    }
+    return NO;
+}
+
++ (int)runWithArgc: (int)argc argv: (char *[])argv
+{
+    RenderMathWorker *worker = [[RenderMathWorker alloc] initWithInputFile:stdin outputFile:stdout];
+    for (int i = 1; i < argc; i++)
+    {
+        if ([kWORKER_LENGTH_ARGUMENT isEqualToString:@(argv[i])])
+        {
+            worker.framing = workerFramingLengthPrefixed;
+        }
+    }
+
+    double warmTime = [worker prewarm];
+    fprintf(stderr, "render worker ready in %.3f ms\n", warmTime);
+    return [worker run];
+}
+
+/*** End Class methods ***/
+
+- (double)prewarm
+{
+    CFTimeInterval startTime = CACurrentMediaTime();
+    for (NSArray *stepTiming in [EQRenderPrewarm prewarm])
+    {
+        fprintf(stderr, "prewarm %s: %.3f ms\n", [stepTiming[0] UTF8String], [stepTiming[1] doubleValue]);
+    }
+
+    // Also runs the PNG encoder once, as it is the default output.
+    @autoreleasepool
+    {
+        NSString *warmStr = @"<math><mrow><mfrac><mi>x</mi><mn>2</mn></mfrac><mo>+</mo><msqrt><mi>y</mi></msqrt></mrow></math>";
+        [ConvertMathToImage convertMathMLToPNGData:warmStr compressionLevel:self.compressionLevel];
+    }
+    return (CACurrentMediaTime() - startTime) * 1000.0;
+}
+
+- (int)run
+{
+    while (YES)
+    {
+        @autoreleasepool
+        {
+            NSString *framingError = nil;
+            NSData *requestData = [self readNextRequestWithError:&framingError];
+            if (nil != framingError)
+            {
+                // The rest of the input can't be split into requests any more, so report it and stop.
+                [self writeResponse:@{@"status": @"error", @"error": framingError} resultData:nil];
+                return 1;
+            }
+            if (nil == requestData)
+                break;
+
+            NSData *resultData = nil;
+            NSDictionary *response = nil;
+            NSDictionary *request = [self requestForData:requestData];
+            if (nil == request)
+            {
+                response = @{@"status": @"error", @"error": @"Request is neither JSON nor UTF-8 text."};
+            }
+            else
+            {
+                response = [self handleRequest:request resultData:&resultData];
+            }
+            if (![self writeResponse:response resultData:resultData])
+                return 1;
+        }
+    }
+    return 0;
+}
+
+- (NSDictionary *)handleRequest: (NSDictionary *)request resultData: (NSData **)resultData
+{
+    CFTimeInterval startTime = CACurrentMediaTime();
+    NSMutableDictionary *response = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary *timings = [[NSMutableDictionary alloc] init];
+    if (nil != request[@"id"])
+    {
+        response[@"id"] = request[@"id"];
+    }
+
+    NSString *mathStr = request[@"math"];
+    NSString *format = ([request[@"format"] isKindOfClass:[NSString class]]) ? [request[@"format"] lowercaseString] : @"png";
+    NSString *outputPath = ([request[@"output"] isKindOfClass:[NSString class]]) ? request[@"output"] : nil;
+    if (![mathStr isKindOfClass:[NSString class]] || [ConvertMathToImage mathIsEmpty:mathStr])
+    {
+        response[@"status"] = @"error";
+        response[@"error"] = @"Empty math.";
+        return response;
+    }
+
+    BOOL isTeX = ![ConvertMathToImage isMathML:mathStr];
+    if ([request[@"input"] isKindOfClass:[NSString class]])
+    {
+        isTeX = [request[@"input"] isEqualToString:@"tex"];
+    }
+
+    NSData *renderData = [self renderMath:mathStr format:format isTeX:isTeX timings:timings];
+    if (nil == renderData)
+    {
+        response[@"status"] = @"error";
+        response[@"error"] = [NSString stringWithFormat:@"Unable to render %@.", format];
+    }
+    else if (nil != outputPath)
+    {
+        CFTimeInterval writeStart = CACurrentMediaTime();
+        NSError *writeError = nil;
+        if ([renderData writeToFile:outputPath options:NSDataWritingAtomic error:&writeError])
+        {
+            response[@"status"] = @"ok";
+            response[@"output"] = outputPath;
+            response[@"length"] = @(renderData.length);
+        }
+        else
+        {
+            response[@"status"] = @"error";
+            response[@"error"] = writeError.localizedDescription ?: @"Unable to write output.";
+        }
+        timings[@"write"] = @((CACurrentMediaTime() - writeStart) * 1000.0);
+    }
+    else
+    {
+        response[@"status"] = @"ok";
+        response[@"length"] = @(renderData.length);
+        if (NULL != resultData)
+        {
+            *resultData = renderData;
+        }
+    }
+
+    timings[@"total"] = @((CACurrentMediaTime() - startTime) * 1000.0);
+    response[@"timings"] = timings;
+    return response;
+}
+
+- (NSData *)renderMath: (NSString *)mathStr format: (NSString *)format isTeX: (BOOL)isTeX timings: (NSMutableDictionary *)timings
+{
+    NSString *mathMLStr = mathStr;
+    BOOL isInline = NO;
+    if (isTeX)
+    {
+        CFTimeInterval convertStart = CACurrentMediaTime();
+        isInline = [ConvertMathToImage isInlineMath:mathStr];
+        mathMLStr = [ConvertBlahtex convertTexToMML:mathStr isInline:isInline];
+        timings[@"convert"] = @((CACurrentMediaTime() - convertStart) * 1000.0);
+        if (mathMLStr.length == 0)
+            return nil;
+    }
+    else
+    {
+        isInline = [ConvertMathToImage isInlineMathML:mathMLStr];
+    }
+
+    CFTimeInterval renderStart = CACurrentMediaTime();
+    NSData *renderData = nil;
+    if ([format isEqualToString:@"png"])
+    {
+        renderData = [ConvertMathToImage convertMathMLToPNGData:mathMLStr compressionLevel:self.compressionLevel];
+    }
+    else if ([format isEqualToString:@"pdf"])
+    {
+        renderData = [RenderMathInPDF pdfDataForMathMLStr:mathMLStr isInline:isInline];
+    }
+    else if ([format isEqualToString:@"svg"])
+    {
+        renderData = [[ConvertMathToImage convertMathMLToSVG:mathMLStr] dataUsingEncoding:NSUTF8StringEncoding];
+    }
+    timings[@"render"] = @((CACurrentMediaTime() - renderStart) * 1000.0);
+
+    return renderData;
+}
+
+/*****************************
+ * Begin request framing     *
+ *****************************/
+
+// Returns nil at the end of the input. If the input ends in the middle of a request or the length is too large,
+// it also returns nil and sets the framing error, as the next request can't be found.
+- (NSData *)readNextRequestWithError: (NSString **)framingError
+{
+    if (self.framing == workerFramingLengthPrefixed)
+    {
+        uint8_t lengthBytes[4];
+        size_t lengthRead = fread(lengthBytes, 1, 4, self->inputFile);
+        if (lengthRead == 0)
+            return nil;
+
+        if (lengthRead != 4)
+        {
+            *framingError = @"Input ended inside a request length.";
+            return nil;
+        }
+
+        uint32_t requestLength = ((uint32_t)lengthBytes[0] << 24) | ((uint32_t)lengthBytes[1] << 16) | ((uint32_t)lengthBytes[2] << 8) | lengthBytes[3];
+        if (requestLength > kWORKER_MAX_REQUEST_LENGTH)
+        {
+            *framingError = [NSString stringWithFormat:@"Request length %u is larger than the limit of %u bytes.", requestLength, kWORKER_MAX_REQUEST_LENGTH];
+            return nil;
+        }
+
+        NSMutableData *requestData = [[NSMutableData alloc] initWithLength:requestLength];
+        if (requestLength > 0 && fread(requestData.mutableBytes, 1, requestLength, self->inputFile) != requestLength)
+        {
+            *framingError = @"Input ended inside a request.";
+            return nil;
+        }
+
+        return requestData;
+    }
+
+    // Skips blank lines so a trailing newline doesn't count as a request.
+    char *lineBuffer = NULL;
+    size_t bufferSize = 0;
+    ssize_t lineLength = 0;
+    NSData *requestData = nil;
+    while ((lineLength = getline(&lineBuffer, &bufferSize, self->inputFile)) >= 0)
+    {
+        while (lineLength > 0 && (lineBuffer[lineLength - 1] == '\n' || lineBuffer[lineLength - 1] == '\r'))
+        {
+            lineLength--;
+        }
+        if (lineLength > 0)
+        {
+            requestData = [NSData dataWithBytes:lineBuffer length:(NSUInteger)lineLength];
+            break;
+        }
+    }
+    free(lineBuffer);
+
+    return requestData;
+}
+
+- (NSDictionary *)requestForData: (NSData *)requestData
+{
+    id requestObject = [NSJSONSerialization JSONObjectWithData:requestData options:0 error:nil];
+    if ([requestObject isKindOfClass:[NSDictionary class]])
+        return requestObject;
+
+    NSString *mathStr = [[NSString alloc] initWithData:requestData encoding:NSUTF8StringEncoding];
+    if (nil == mathStr)
+        return nil;
+
+    return @{@"math": mathStr};
+}
+
+- (BOOL)writeResponse: (NSDictionary *)response resultData: (NSData *)resultData
+{
+    NSData *responseData = [NSJSONSerialization dataWithJSONObject:response options:0 error:nil];
+    if (nil == responseData)
+        return NO;
+
+    if (self.framing == workerFramingLengthPrefixed)
+    {
+        if (![self writeFramedData:responseData])
+            return NO;
+        if (nil != resultData && ![self writeFramedData:resultData])
+            return NO;
+    }
+    else
+    {
+        if (fwrite(responseData.bytes, 1, responseData.length, self->outputFile) != responseData.length || fputc('\n', self->outputFile) == EOF)
+            return NO;
+        if (nil != resultData && fwrite(resultData.bytes, 1, resultData.length, self->outputFile) != resultData.length)
+            return NO;
+    }
+
+    return (fflush(self->outputFile) == 0);
+}
+
+- (BOOL)writeFramedData: (NSData *)writeData
+{
+    uint32_t writeLength = (uint32_t)writeData.length;
+    uint8_t lengthBytes[4] = {(uint8_t)(writeLength >> 24), (uint8_t)(writeLength >> 16), (uint8_t)(writeLength >> 8), (uint8_t)writeLength};
+    if (fwrite(lengthBytes, 1, 4, self->outputFile) != 4)
+        return NO;
+
+    return (fwrite(writeData.bytes, 1, writeData.length, self->outputFile) == writeData.length);
+}
+
+@end
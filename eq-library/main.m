@@ -8,9 +8,14 @@
 
 #import <UIKit/UIKit.h>
 #import "AppDelegate.h"
+#import "RenderMathWorker.h"
 
 int main(int argc, char * argv[]) {
     @autoreleasepool {
+        // Batch rendering runs without any UI.
+        if ([RenderMathWorker shouldRunWithArgc:argc argv:argv])
+            return [RenderMathWorker runWithArgc:argc argv:argv];
+
         return UIApplicationMain(argc, argv, nil, NSStringFromClass([AppDelegate class]));
     }
 }
@@ -0,0 +1,133 @@
+//
+//  ConvertMathQueueTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "ConvertMathQueue.h"
+
+@interface ConvertMathQueueTest : XCTestCase
+{
+    ConvertMathQueue *testQueue;
+    NSString *testMathML;
+}
+
+@end
+
+@implementation ConvertMathQueueTest
+
+- (void)setUp
+{
+    [super setUp];
+    testQueue = [[ConvertMathQueue alloc] init];
+    testQueue.pixelScale = 1.0;
+    testMathML = @"<math><mrow><mi>x</mi><mo>+</mo><mn>1</mn></mrow></math>";
+}
+
+- (void)tearDown
+{
+    [testQueue cancelAllRequests];
+    [super tearDown];
+}
+
+- (void)testConvertMathToImage
+{
+    XCTestExpectation *imageExpectation = [self expectationWithDescription:@"image"];
+    dispatch_queue_t completionQueue = dispatch_queue_create("ConvertMathQueueTest", DISPATCH_QUEUE_SERIAL);
+    ConvertMathRequest *request = [testQueue convertMathToImage:testMathML priority:convertPriorityNormal completionQueue:completionQueue
+                                                      completion:^(UIImage *image)
+    {
+        XCTAssertFalse([NSThread isMainThread], @"Should complete on the given queue.");
+        XCTAssertNotNil(image, @"Should convert the math.");
+        [imageExpectation fulfill];
+    }];
+
+    XCTAssertEqualObjects(request.mathStr, testMathML, @"Should keep the math.");
+    XCTAssertFalse(request.isCancelled, @"Should not start cancelled.");
+    [self waitForExpectationsWithTimeout:30.0 handler:nil];
+    XCTAssertEqual([testQueue pendingConversionCount], (NSUInteger)0, @"Should be empty once the conversion is done.");
+}
+
+- (void)testDuplicateRequestsAreCoalesced
+{
+    XCTestExpectation *firstExpectation = [self expectationWithDescription:@"first"];
+    XCTestExpectation *secondExpectation = [self expectationWithDescription:@"second"];
+    __block NSData *firstData = nil;
+
+    [testQueue convertMathToPNGData:testMathML priority:convertPriorityLow completionQueue:NULL completion:^(NSData *pngData)
+    {
+        firstData = pngData;
+        [firstExpectation fulfill];
+    }];
+    [testQueue convertMathToPNGData:testMathML priority:convertPriorityHigh completionQueue:NULL completion:^(NSData *pngData)
+    {
+        XCTAssertTrue(pngData == firstData, @"Should share the result of one conversion.");
+        [secondExpectation fulfill];
+    }];
+
+    XCTAssertTrue([testQueue pendingConversionCount] <= 1, @"Should only run one conversion for both requests.");
+    [self waitForExpectationsWithTimeout:30.0 handler:nil];
+    XCTAssertNotNil(firstData, @"Should return PNG data.");
+}
+
+- (void)testCancelledRequestIsNotCompleted
+{
+    XCTestExpectation *otherExpectation = [self expectationWithDescription:@"other"];
+    __block BOOL cancelledCompleted = NO;
+
+    ConvertMathRequest *request = [testQueue convertMathToImage:@"<math><mi>y</mi></math>" priority:convertPriorityLow completionQueue:NULL
+                                                      completion:^(UIImage *image)
+    {
+        cancelledCompleted = YES;
+    }];
+    [request cancel];
+    XCTAssertTrue(request.isCancelled, @"Should be cancelled.");
+
+    // Completions run on the main queue in order, so this one finishing means the cancelled one would have too.
+    [testQueue convertMathToImage:testMathML priority:convertPriorityLow completionQueue:NULL completion:^(UIImage *image)
+    {
+        [otherExpectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:30.0 handler:nil];
+    XCTAssertFalse(cancelledCompleted, @"Should not call the completion of a cancelled request.");
+}
+
+- (void)testFinishedJobIsReleased
+{
+    XCTestExpectation *imageExpectation = [self expectationWithDescription:@"image"];
+    __weak id weakJob = nil;
+    @autoreleasepool
+    {
+        ConvertMathRequest *request = [testQueue convertMathToImage:testMathML priority:convertPriorityNormal completionQueue:NULL
+                                                          completion:^(UIImage *image)
+        {
+            [imageExpectation fulfill];
+        }];
+        weakJob = [request valueForKey:@"job"];
+        XCTAssertNotNil(weakJob, @"Should have a job while converting.");
+    }
+    [self waitForExpectationsWithTimeout:30.0 handler:nil];
+
+    // The worker thread can still be returning from the job when the completion runs.
+    NSDate *giveUpDate = [NSDate dateWithTimeIntervalSinceNow:5.0];
+    while (nil != weakJob && [giveUpDate timeIntervalSinceNow] > 0.0)
+    {
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    }
+    XCTAssertNil(weakJob, @"Should release the job once it has finished.");
+}
+
+@end
@@ -0,0 +1,122 @@
+//
+//  ConvertMathToImageTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import <UIKit/UIKit.h>
+#import "ConvertMathToImage.h"
+#import "EQRenderEquation.h"
+#import "EQXMLImporter.h"
+#import "EquationViewDataSource.h"
+
+static NSString * const kTEST_MATHML = @"<math><mfrac><mrow><mi>a</mi><mo>+</mo><mi>b</mi></mrow><msqrt><mi>c</mi></msqrt></mfrac></math>";
+
+@interface ConvertMathToImageTest : XCTestCase
+
+@end
+
+@implementation ConvertMathToImageTest
+
+- (void)setUp
+{
+    [super setUp];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+- (void)testPNGsForScalesAndSizes
+{
+    NSArray *testTargets = @[@1.0, @2.0, @3.0, [NSValue valueWithCGSize:CGSizeMake(32.0, 32.0)]];
+    NSArray *testImages = [ConvertMathToImage convertMathMLToPNGs:kTEST_MATHML forTargets:testTargets];
+    XCTAssertEqual(testImages.count, testTargets.count, @"Should return an image for each target.");
+    if (testImages.count != testTargets.count)
+        return;
+
+    for (id testImage in testImages)
+    {
+        XCTAssertTrue([testImage isKindOfClass:[UIImage class]], @"Should draw every target.");
+    }
+
+    UIImage *oneXImage = testImages[0];
+    UIImage *threeXImage = testImages[2];
+    XCTAssertEqualWithAccuracy(oneXImage.size.width, threeXImage.size.width, 0.5, @"Scales should share the same point size.");
+    XCTAssertEqualWithAccuracy(CGImageGetWidth(threeXImage.CGImage), 3.0 * CGImageGetWidth(oneXImage.CGImage), 3.0, @"Should have three times the pixels.");
+
+    CGImageRef thumbnailImage = [(UIImage *)testImages[3] CGImage];
+    XCTAssertTrue(CGImageGetWidth(thumbnailImage) <= 33 && CGImageGetHeight(thumbnailImage) <= 33, @"Should fit the thumbnail size.");
+    XCTAssertTrue(CGImageGetWidth(thumbnailImage) >= 31 || CGImageGetHeight(thumbnailImage) >= 31, @"Should fill one side of the thumbnail.");
+}
+
+- (void)testPNGDataForLaidOutEquation
+{
+    CGRect drawRect;
+    EQRenderEquation *testEquation = [ConvertMathToImage importMathML:kTEST_MATHML];
+    CGSize imageSize = [ConvertMathToImage layoutRenderEquation:testEquation isInline:NO margin:kDEFAULT_IMAGE_MARGIN drawRect:&drawRect];
+    XCTAssertTrue(imageSize.width > 0.0 && imageSize.height > 0.0, @"Should lay out the math.");
+
+    NSArray *testData = [ConvertMathToImage convertRenderEquation:testEquation toPNGDataForTargets:@[@1.0, @2.0, @0.0]
+                                                           margin:kDEFAULT_IMAGE_MARGIN compressionLevel:6];
+    XCTAssertEqual(testData.count, (NSUInteger)3, @"Should return an entry for each target.");
+    XCTAssertTrue([testData[0] isKindOfClass:[NSData class]], @"Should encode the 1x PNG.");
+    XCTAssertTrue([testData[1] isKindOfClass:[NSData class]], @"Should encode the 2x PNG.");
+    XCTAssertEqualObjects(testData[2], [NSNull null], @"Should skip a zero scale.");
+
+    UIImage *decodedImage = [UIImage imageWithData:testData[1]];
+    XCTAssertEqual(CGImageGetWidth(decodedImage.CGImage), (size_t)ceil(imageSize.width * 2.0), @"Should size the 2x PNG in pixels.");
+}
+
+- (void)testPNGDataUsesGivenPixelScaleOffMainThread
+{
+    XCTestExpectation *dataExpectation = [self expectationWithDescription:@"data"];
+    __block NSData *oneXData = nil;
+    __block NSData *twoXData = nil;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        oneXData = [ConvertMathToImage convertMathMLToPNGData:kTEST_MATHML compressionLevel:6];
+        twoXData = [ConvertMathToImage convertMathMLToPNGData:kTEST_MATHML pixelScale:2.0 compressionLevel:6];
+        [dataExpectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:30.0 handler:nil];
+
+    CGImageRef oneXImage = [UIImage imageWithData:oneXData].CGImage;
+    CGImageRef twoXImage = [UIImage imageWithData:twoXData].CGImage;
+    XCTAssertTrue(NULL != oneXImage && NULL != twoXImage, @"Should encode both PNGs.");
+    XCTAssertEqualWithAccuracy(CGImageGetWidth(twoXImage), 2.0 * CGImageGetWidth(oneXImage), 2.0, @"Should default to 1.0 and use the given scale.");
+}
+
+- (void)testBuildRenderEquationReturnsSeparateEquations
+{
+    EquationViewDataSource *testDataSource = [EQXMLImporter populateDataSourceWithXMLString:kTEST_MATHML];
+    EQRenderEquation *firstEquation = [testDataSource buildRenderEquation];
+    [firstEquation layoutEquationLines];
+    CGSize firstSize = firstEquation.drawSize;
+
+    EQRenderEquation *secondEquation = [testDataSource buildRenderEquation];
+    XCTAssertTrue(firstEquation != secondEquation, @"Should build a new equation each time.");
+
+    secondEquation.pdfScale = 3.0;
+    secondEquation.usePDFMode = YES;
+    [secondEquation layoutEquationLines];
+    XCTAssertEqualWithAccuracy(firstEquation.pdfScale, 1.0, 0.001, @"Should not share the scale.");
+    XCTAssertFalse(firstEquation.usePDFMode, @"Should not share the PDF mode.");
+    XCTAssertTrue(CGSizeEqualToSize(firstEquation.drawSize, firstSize), @"Should keep the first layout.");
+    XCTAssertTrue(CGSizeEqualToSize(secondEquation.drawSize, firstSize), @"Should reuse the cached line frames.");
+}
+
+@end
@@ -0,0 +1,179 @@
+//
+//  EQMathTableTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "EQMathTable.h"
+
+@interface EQMathTableTest : XCTestCase
+{
+    NSData *testTableData;
+}
+
+- (NSData *)buildTestTableData;
+
+@end
+
+static void EQAppendUInt16(NSMutableData *data, uint16_t value)
+{
+    uint8_t bytes[2] = {(uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+    [data appendBytes:bytes length:2];
+}
+
+@implementation EQMathTableTest
+
+- (void)setUp
+{
+    [super setUp];
+    // Put setup code here; it will be run once, before the first test case.
+    testTableData = [self buildTestTableData];
+}
+
+- (void)tearDown
+{
+    // Put teardown code here; it will be run once, after the last test case.
+    [super tearDown];
+}
+
+// Builds a small MATH table with one vertical construction for glyph 5.
+// It has three variants and a bottom, extender, top assembly.
+- (NSData *)buildTestTableData
+{
+    NSMutableData *tableData = [[NSMutableData alloc] init];
+
+    // Header, with the constants right after it and the variants after those.
+    EQAppendUInt16(tableData, 1);
+    EQAppendUInt16(tableData, 0);
+    EQAppendUInt16(tableData, 10);
+    EQAppendUInt16(tableData, 0);
+    EQAppendUInt16(tableData, 224);
+
+    // MathConstants.
+    for (NSUInteger i = 0; i < mathConstantCount; i++)
+    {
+        uint16_t value = 0;
+        if (i == mathConstantScriptPercentScaleDown)
+            value = 70;
+        else if (i == mathConstantAxisHeight)
+            value = 250;
+        else if (i == mathConstantFractionRuleThickness)
+            value = 66;
+
+        EQAppendUInt16(tableData, value);
+        if (i >= 4 && i != mathConstantRadicalDegreeBottomRaisePercent)
+        {
+            EQAppendUInt16(tableData, 0);
+        }
+    }
+    XCTAssertEqual(tableData.length, (NSUInteger)224, @"The 10 byte header and 214 bytes of constants should end at byte 224.");
+
+    // MathVariants header.
+    EQAppendUInt16(tableData, 20);
+    EQAppendUInt16(tableData, 12);
+    EQAppendUInt16(tableData, 0);
+    EQAppendUInt16(tableData, 1);
+    EQAppendUInt16(tableData, 0);
+    EQAppendUInt16(tableData, 18);
+
+    // Coverage.
+    EQAppendUInt16(tableData, 1);
+    EQAppendUInt16(tableData, 1);
+    EQAppendUInt16(tableData, 5);
+
+    // Construction with three variants.
+    EQAppendUInt16(tableData, 16);
+    EQAppendUInt16(tableData, 3);
+    EQAppendUInt16(tableData, 5);
+    EQAppendUInt16(tableData, 1000);
+    EQAppendUInt16(tableData, 6);
+    EQAppendUInt16(tableData, 1500);
+    EQAppendUInt16(tableData, 7);
+    EQAppendUInt16(tableData, 2000);
+
+    // Assembly: italics correction, part count, then the parts.
+    EQAppendUInt16(tableData, 0);
+    EQAppendUInt16(tableData, 0);
+    EQAppendUInt16(tableData, 3);
+    uint16_t parts[3][5] = {{10, 0, 100, 500, 0}, {11, 100, 100, 300, 1}, {12, 100, 0, 500, 0}};
+    for (NSUInteger i = 0; i < 3; i++)
+    {
+        for (NSUInteger j = 0; j < 5; j++)
+        {
+            EQAppendUInt16(tableData, parts[i][j]);
+        }
+    }
+
+    return tableData;
+}
+
+- (void)testMathConstants
+{
+    EQMathTable *mathTable = [[EQMathTable alloc] initWithData:testTableData fontName:nil unitsPerEm:1000.0];
+    XCTAssertNotNil(mathTable, @"Test table should parse.");
+
+    XCTAssertEqualWithAccuracy([mathTable valueForConstant:mathConstantAxisHeight fontSize:10.0], 2.5, 0.001, @"Axis height should scale with the font size.");
+    XCTAssertEqualWithAccuracy([mathTable valueForConstant:mathConstantFractionRuleThickness fontSize:10.0], 0.66, 0.001, @"Rule thickness should scale with the font size.");
+    XCTAssertEqualWithAccuracy([mathTable valueForConstant:mathConstantScriptPercentScaleDown fontSize:10.0], 70.0, 0.001, @"Percentages should not scale.");
+    XCTAssertEqualWithAccuracy([mathTable minConnectorOverlapForFontSize:10.0], 0.2, 0.001, @"Overlap should scale with the font size.");
+}
+
+- (void)testVariantLookup
+{
+    EQMathTable *mathTable = [[EQMathTable alloc] initWithData:testTableData fontName:nil unitsPerEm:1000.0];
+    XCTAssertTrue([mathTable hasConstructionForGlyph:5 vertical:YES], @"Glyph 5 should have a vertical construction.");
+    XCTAssertFalse([mathTable hasConstructionForGlyph:5 vertical:NO], @"Glyph 5 should not have a horizontal construction.");
+    XCTAssertFalse([mathTable hasConstructionForGlyph:6 vertical:YES], @"Variants should not have their own construction.");
+
+    CGGlyph variantGlyph = 0;
+    CGFloat variantAdvance = 0.0;
+    BOOL foundVariant = [mathTable variantForGlyph:5 minAdvance:12.0 fontSize:10.0 vertical:YES variantGlyph:&variantGlyph variantAdvance:&variantAdvance];
+    XCTAssertTrue(foundVariant, @"Should find a variant.");
+    XCTAssertEqual(variantGlyph, (CGGlyph)6, @"Should use the smallest variant that covers the height.");
+    XCTAssertEqualWithAccuracy(variantAdvance, 15.0, 0.001, @"Variant advance should scale with the font size.");
+
+    foundVariant = [mathTable variantForGlyph:5 minAdvance:25.0 fontSize:10.0 vertical:YES variantGlyph:&variantGlyph variantAdvance:&variantAdvance];
+    XCTAssertFalse(foundVariant, @"Heights past the largest variant need an assembly.");
+}
+
+- (void)testAssemblyLayout
+{
+    EQMathTable *mathTable = [[EQMathTable alloc] initWithData:testTableData fontName:nil unitsPerEm:1000.0];
+    XCTAssertTrue([mathTable hasAssemblyForGlyph:5 vertical:YES], @"Glyph 5 should have an assembly.");
+
+    CGFloat totalAdvance = 0.0;
+    NSArray *assembly = [mathTable assemblyForGlyph:5 minAdvance:30.0 fontSize:10.0 vertical:YES totalAdvance:&totalAdvance];
+    XCTAssertEqual(assembly.count, (NSUInteger)10, @"Should repeat the extender eight times.");
+    XCTAssertEqualObjects(assembly.firstObject[0], @10, @"Assembly should start with the bottom part.");
+    XCTAssertEqualObjects(assembly[1][0], @11, @"Extenders should follow the bottom part.");
+    XCTAssertEqualObjects(assembly.lastObject[0], @12, @"Assembly should end with the top part.");
+    XCTAssertEqualWithAccuracy(totalAdvance, 30.0, 0.001, @"Overlap should be spread to reach the exact height.");
+    XCTAssertEqualWithAccuracy([assembly[1][1] floatValue], 5.0 - 4.0 / 9.0, 0.001, @"Overlap should be spread evenly.");
+
+    // Short assemblies are limited by the connector lengths.
+    assembly = [mathTable assemblyForGlyph:5 minAdvance:5.0 fontSize:10.0 vertical:YES totalAdvance:&totalAdvance];
+    XCTAssertEqual(assembly.count, (NSUInteger)3, @"Should use the extender once.");
+    XCTAssertEqualWithAccuracy(totalAdvance, 11.0, 0.001, @"Overlap should not exceed the connectors.");
+}
+
+- (void)testRejectsTruncatedTable
+{
+    NSData *truncatedData = [testTableData subdataWithRange:NSMakeRange(0, 240)];
+    EQMathTable *mathTable = [[EQMathTable alloc] initWithData:truncatedData fontName:nil unitsPerEm:1000.0];
+    XCTAssertNil(mathTable, @"Truncated tables should not parse.");
+}
+
+@end
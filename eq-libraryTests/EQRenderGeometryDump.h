@@ -0,0 +1,37 @@
+//
+//  EQRenderGeometryDump.h
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <Foundation/Foundation.h>
+#import "EQRenderEquation.h"
+
+// Test helper that turns a laid out equation into plain dictionaries and arrays,
+// so the layout can be written to a golden file and compared later.
+// Every stem lists its type, origin, size and bounds, every render data lists its text and bounds,
+// and fraction bars, overlines and supplemental lines list their end points.
+
+@interface EQRenderGeometryDump : NSObject
+
++ (NSDictionary *)geometryForRenderEquation: (EQRenderEquation *)renderEquation;
+
+// JSON with sorted keys and fixed precision so the same layout always writes the same bytes.
++ (NSData *)canonicalJSONForGeometry: (id)geometry;
+
+// Returns a description of each value that differs by more than the tolerance. Empty if they match.
++ (NSArray *)differencesFromGeometry: (id)geometry toGeometry: (id)goldenGeometry tolerance: (CGFloat)tolerance;
+
+@end
@@ -0,0 +1,252 @@
+//
+//  EQRenderGeometryDump.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import "EQRenderGeometryDump.h"
+#import "EQRenderStem.h"
+#import "EQRenderFracStem.h"
+#import "EQRenderData.h"
+
+@interface EQRenderGeometryDump()
+
++ (NSDictionary *)geometryForStem: (EQRenderStem *)renderStem;
++ (NSDictionary *)geometryForRenderData: (EQRenderData *)renderData;
++ (void)appendJSONForValue: (id)value toString: (NSMutableString *)jsonString indent: (NSUInteger)indent;
++ (void)appendDifferencesFromValue: (id)value toValue: (id)goldenValue atPath: (NSString *)keyPath
+                         tolerance: (CGFloat)tolerance toArray: (NSMutableArray *)differences;
+
+@end
+
+@implementation EQRenderGeometryDump
+
++ (NSDictionary *)geometryForRenderEquation: (EQRenderEquation *)renderEquation
+{
+    NSMutableArray *stemArray = [[NSMutableArray alloc] init];
+    for (EQRenderStem *renderStem in renderEquation.equationStems)
+    {
+        [stemArray addObject:[EQRenderGeometryDump geometryForStem:renderStem]];
+    }
+
+    return @{@"drawSize": @[@(renderEquation.drawSize.width), @(renderEquation.drawSize.height)],
+             @"stems": stemArray};
+}
+
++ (NSDictionary *)geometryForStem: (EQRenderStem *)renderStem
+{
+    NSMutableDictionary *stemGeometry = [[NSMutableDictionary alloc] init];
+    stemGeometry[@"type"] = @(renderStem.stemType);
+    stemGeometry[@"origin"] = @[@(renderStem.drawOrigin.x), @(renderStem.drawOrigin.y)];
+    stemGeometry[@"size"] = @[@(renderStem.drawSize.width), @(renderStem.drawSize.height)];
+    stemGeometry[@"bounds"] = @[@(renderStem.drawBounds.origin.x), @(renderStem.drawBounds.origin.y),
+                                @(renderStem.drawBounds.size.width), @(renderStem.drawBounds.size.height)];
+
+    if (renderStem.hasOverline)
+    {
+        stemGeometry[@"overline"] = @[@(renderStem.overlineStartPoint.x), @(renderStem.overlineStartPoint.y),
+                                      @(renderStem.overlineEndPoint.x), @(renderStem.overlineEndPoint.y)];
+    }
+    if (renderStem.hasSupplementalLine)
+    {
+        stemGeometry[@"supplementalLine"] = @[@(renderStem.supplementalLineStartPoint.x), @(renderStem.supplementalLineStartPoint.y),
+                                              @(renderStem.supplementalLineEndPoint.x), @(renderStem.supplementalLineEndPoint.y)];
+    }
+    if ([renderStem isKindOfClass:[EQRenderFracStem class]])
+    {
+        EQRenderFracStem *fracStem = (EQRenderFracStem *)renderStem;
+        stemGeometry[@"bar"] = @[@(fracStem.startLinePoint.x), @(fracStem.startLinePoint.y),
+                                 @(fracStem.endLinePoint.x), @(fracStem.endLinePoint.y), @(fracStem.lineThickness)];
+    }
+
+    NSMutableArray *childArray = [[NSMutableArray alloc] init];
+    for (id child in renderStem.renderArray)
+    {
+        if ([child isKindOfClass:[EQRenderStem class]])
+        {
+            [childArray addObject:[EQRenderGeometryDump geometryForStem:child]];
+        }
+        else if ([child isKindOfClass:[EQRenderData class]])
+        {
+            [childArray addObject:[EQRenderGeometryDump geometryForRenderData:child]];
+        }
+    }
+    stemGeometry[@"children"] = childArray;
+
+    return stemGeometry;
+}
+
++ (NSDictionary *)geometryForRenderData: (EQRenderData *)renderData
+{
+    CGRect typographicBounds = renderData.boundingRectTypographic;
+    CGRect imageBounds = renderData.boundingRectImage;
+    NSString *renderText = (nil != renderData.renderString) ? renderData.renderString.string : @"";
+
+    return @{@"text": renderText,
+             @"origin": @[@(renderData.drawOrigin.x), @(renderData.drawOrigin.y)],
+             @"size": @[@(renderData.drawSize.width), @(renderData.drawSize.height)],
+             @"typographic": @[@(typographicBounds.origin.x), @(typographicBounds.origin.y),
+                               @(typographicBounds.size.width), @(typographicBounds.size.height)],
+             @"image": @[@(imageBounds.origin.x), @(imageBounds.origin.y), @(imageBounds.size.width), @(imageBounds.size.height)]};
+}
+
+/*************************
+ * Begin canonical JSON *
+ *************************/
+
++ (NSData *)canonicalJSONForGeometry: (id)geometry
+{
+    NSMutableString *jsonString = [[NSMutableString alloc] init];
+    [EQRenderGeometryDump appendJSONForValue:geometry toString:jsonString indent:0];
+    [jsonString appendString:@"\n"];
+    return [jsonString dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+// NSJSONSerialization can't sort keys before iOS 11, so the JSON is written here instead.
++ (void)appendJSONForValue: (id)value toString: (NSMutableString *)jsonString indent: (NSUInteger)indent
+{
+    NSString *childIndent = [@"" stringByPaddingToLength:(indent + 1) * 2 withString:@" " startingAtIndex:0];
+    NSString *closeIndent = [@"" stringByPaddingToLength:indent * 2 withString:@" " startingAtIndex:0];
+
+    if ([value isKindOfClass:[NSDictionary class]])
+    {
+        NSDictionary *valueDict = (NSDictionary *)value;
+        NSArray *sortedKeys = [valueDict.allKeys sortedArrayUsingSelector:@selector(compare:)];
+        [jsonString appendString:@"{\n"];
+        for (NSUInteger i = 0; i < sortedKeys.count; i++)
+        {
+            [jsonString appendFormat:@"%@\"%@\": ", childIndent, sortedKeys[i]];
+            [EQRenderGeometryDump appendJSONForValue:valueDict[sortedKeys[i]] toString:jsonString indent:indent + 1];
+            [jsonString appendString:(i + 1 < sortedKeys.count) ? @",\n" : @"\n"];
+        }
+        [jsonString appendFormat:@"%@}", closeIndent];
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        NSArray *valueArray = (NSArray *)value;
+
+        // Keep arrays of numbers on one line so points and rects stay readable.
+        BOOL onlyNumbers = YES;
+        for (id arrayValue in valueArray)
+        {
+            if (![arrayValue isKindOfClass:[NSNumber class]])
+            {
+                onlyNumbers = NO;
+                break;
+            }
+        }
+
+        if (onlyNumbers)
+        {
+            [jsonString appendString:@"["];
+            for (NSUInteger i = 0; i < valueArray.count; i++)
+            {
+                [EQRenderGeometryDump appendJSONForValue:valueArray[i] toString:jsonString indent:indent];
+                if (i + 1 < valueArray.count)
+                    [jsonString appendString:@", "];
+            }
+            [jsonString appendString:@"]"];
+        }
+        else
+        {
+            [jsonString appendString:@"[\n"];
+            for (NSUInteger i = 0; i < valueArray.count; i++)
+            {
+                [jsonString appendString:childIndent];
+                [EQRenderGeometryDump appendJSONForValue:valueArray[i] toString:jsonString indent:indent + 1];
+                [jsonString appendString:(i + 1 < valueArray.count) ? @",\n" : @"\n"];
+            }
+            [jsonString appendFormat:@"%@]", closeIndent];
+        }
+    }
+    else if ([value isKindOfClass:[NSString class]])
+    {
+        NSData *stringData = [NSJSONSerialization dataWithJSONObject:@[value] options:0 error:nil];
+        NSString *arrayString = [[NSString alloc] initWithData:stringData encoding:NSUTF8StringEncoding];
+        [jsonString appendString:[arrayString substringWithRange:NSMakeRange(1, arrayString.length - 2)]];
+    }
+    else if ([value isKindOfClass:[NSNumber class]])
+    {
+        // Round to a thousandth of a point and avoid writing -0.
+        double roundedValue = round([(NSNumber *)value doubleValue] * 1000.0) / 1000.0;
+        if (roundedValue == 0.0)
+            roundedValue = 0.0;
+        [jsonString appendFormat:@"%.3f", roundedValue];
+    }
+    else
+    {
+        [jsonString appendString:@"null"];
+    }
+}
+
+/*************************
+ * Begin golden compare *
+ *************************/
+
++ (NSArray *)differencesFromGeometry: (id)geometry toGeometry: (id)goldenGeometry tolerance: (CGFloat)tolerance
+{
+    NSMutableArray *differences = [[NSMutableArray alloc] init];
+    [EQRenderGeometryDump appendDifferencesFromValue:geometry toValue:goldenGeometry atPath:@"" tolerance:tolerance toArray:differences];
+    return differences;
+}
+
++ (void)appendDifferencesFromValue: (id)value toValue: (id)goldenValue atPath: (NSString *)keyPath
+                         tolerance: (CGFloat)tolerance toArray: (NSMutableArray *)differences
+{
+    if ([value isKindOfClass:[NSNumber class]] && [goldenValue isKindOfClass:[NSNumber class]])
+    {
+        double difference = [(NSNumber *)value doubleValue] - [(NSNumber *)goldenValue doubleValue];
+        if (fabs(difference) > tolerance)
+        {
+            [differences addObject:[NSString stringWithFormat:@"%@: %.3f != %.3f", keyPath, [(NSNumber *)value doubleValue],
+                                    [(NSNumber *)goldenValue doubleValue]]];
+        }
+    }
+    else if ([value isKindOfClass:[NSDictionary class]] && [goldenValue isKindOfClass:[NSDictionary class]])
+    {
+        NSMutableSet *allKeys = [NSMutableSet setWithArray:[(NSDictionary *)value allKeys]];
+        [allKeys addObjectsFromArray:[(NSDictionary *)goldenValue allKeys]];
+        for (NSString *key in [allKeys.allObjects sortedArrayUsingSelector:@selector(compare:)])
+        {
+            [EQRenderGeometryDump appendDifferencesFromValue:value[key] toValue:goldenValue[key]
+                                                      atPath:[NSString stringWithFormat:@"%@/%@", keyPath, key]
+                                                   tolerance:tolerance toArray:differences];
+        }
+    }
+    else if ([value isKindOfClass:[NSArray class]] && [goldenValue isKindOfClass:[NSArray class]])
+    {
+        NSArray *valueArray = (NSArray *)value;
+        NSArray *goldenArray = (NSArray *)goldenValue;
+        if (valueArray.count != goldenArray.count)
+        {
+            [differences addObject:[NSString stringWithFormat:@"%@: %lu items != %lu items", keyPath,
+                                    (unsigned long)valueArray.count, (unsigned long)goldenArray.count]];
+            return;
+        }
+
+        for (NSUInteger i = 0; i < valueArray.count; i++)
+        {
+            [EQRenderGeometryDump appendDifferencesFromValue:valueArray[i] toValue:goldenArray[i]
+                                                      atPath:[NSString stringWithFormat:@"%@/%lu", keyPath, (unsigned long)i]
+                                                   tolerance:tolerance toArray:differences];
+        }
+    }
+    else if (![value isEqual:goldenValue])
+    {
+        [differences addObject:[NSString stringWithFormat:@"%@: %@ != %@", keyPath, value, goldenValue]];
+    }
+}
+
+@end
@@ -0,0 +1,202 @@
+//
+//  EQRenderGeometryGoldenTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import <QuartzCore/QuartzCore.h>
+#import "EQRenderGeometryDump.h"
+#import "EQXMLImporter.h"
+#import "EquationViewDataSource.h"
+
+// Lays out each equation in the corpus and compares every stem and render data position with the golden files in Goldens/.
+// A missing golden is a failure. Set EQ_RECORD_GEOMETRY_GOLDENS in the scheme to write all of them,
+// either for a new case or after a change that is meant to move the layout, and check the new files in with it.
+// The layout timings for each case are written to EQGeometryTimings.json in the temporary directory.
+
+static const CGFloat kGOLDEN_TOLERANCE = 0.01;
+static const NSUInteger kTIMING_ITERATIONS = 20;
+
+@interface EQRenderGeometryGoldenTest : XCTestCase
+
+- (NSArray *)geometryCorpus;
+- (NSString *)goldenDirectory;
+- (EQRenderEquation *)renderEquationForMathML: (NSString *)mathMLStr;
+
+@end
+
+@implementation EQRenderGeometryGoldenTest
+
+- (void)setUp
+{
+    [super setUp];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+// Each case is a file name and the MathML to lay out.
+- (NSArray *)geometryCorpus
+{
+    return @[@[@"row", @"<math><mrow><mi>x</mi><mo>+</mo><mn>1</mn></mrow></math>"],
+             @[@"sup_sub", @"<math><mrow><msubsup><mi>x</mi><mi>i</mi><mn>2</mn></msubsup><mo>+</mo><msup><mi>e</mi><mrow><mi>i</mi><mi>&#x3C0;</mi></mrow></msup></mrow></math>"],
+             @[@"fraction", @"<math><mfrac><mrow><mi>a</mi><mo>+</mo><mi>b</mi></mrow><mrow><mi>c</mi><mo>&#x2212;</mo><mi>d</mi></mrow></mfrac></math>"],
+             @[@"nested_fraction", @"<math><mfrac><mn>1</mn><mrow><mn>1</mn><mo>+</mo><mfrac><mn>1</mn><mi>x</mi></mfrac></mrow></mfrac></math>"],
+             @[@"sqrt", @"<math><msqrt><mrow><msup><mi>b</mi><mn>2</mn></msup><mo>&#x2212;</mo><mn>4</mn><mi>a</mi><mi>c</mi></mrow></msqrt></math>"],
+             @[@"nroot", @"<math><mroot><mrow><mi>x</mi><mo>+</mo><mn>1</mn></mrow><mn>3</mn></mroot></math>"],
+             @[@"stretchy", @"<math><mrow><mo stretchy=\"true\">(</mo><mfrac><mi>a</mi><mi>b</mi></mfrac><mo stretchy=\"true\">)</mo></mrow></math>"],
+             @[@"large_op", @"<math><mrow><munderover><mo largeop=\"true\">&#x2211;</mo><mrow><mi>i</mi><mo>=</mo><mn>1</mn></mrow><mi>n</mi></munderover><msup><mi>i</mi><mn>2</mn></msup></mrow></math>"],
+             @[@"over", @"<math><mover><mi>x</mi><mo>&#xAF;</mo></mover></math>"],
+             @[@"matrix", @"<math><mrow><mo>[</mo><mtable><mtr><mtd><mi>a</mi></mtd><mtd><mi>b</mi></mtd></mtr><mtr><mtd><mi>c</mi></mtd><mtd><mi>d</mi></mtd></mtr></mtable><mo>]</mo></mrow></math>"]];
+}
+
+- (NSString *)goldenDirectory
+{
+    NSString *environmentDirectory = [NSProcessInfo processInfo].environment[@"EQ_GEOMETRY_GOLDEN_DIR"];
+    if (nil != environmentDirectory)
+        return environmentDirectory;
+
+    // The goldens live next to this file in the source tree.
+    return [[@(__FILE__) stringByDeletingLastPathComponent] stringByAppendingPathComponent:@"Goldens"];
+}
+
+- (EQRenderEquation *)renderEquationForMathML: (NSString *)mathMLStr
+{
+    EquationViewDataSource *testDataSource = [EQXMLImporter populateDataSourceWithXMLString:mathMLStr];
+    EQRenderEquation *renderEquation = [testDataSource buildRenderEquation];
+    [renderEquation layoutEquationLines];
+    return renderEquation;
+}
+
+- (void)testGeometryMatchesGoldens
+{
+    NSString *goldenDirectory = [self goldenDirectory];
+    BOOL shouldRecord = (nil != [NSProcessInfo processInfo].environment[@"EQ_RECORD_GEOMETRY_GOLDENS"]);
+    if (shouldRecord)
+    {
+        [[NSFileManager defaultManager] createDirectoryAtPath:goldenDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+    }
+
+    for (NSArray *corpusCase in [self geometryCorpus])
+    {
+        NSString *caseName = corpusCase[0];
+        EQRenderEquation *renderEquation = [self renderEquationForMathML:corpusCase[1]];
+        XCTAssertNotNil(renderEquation, @"Should build an equation for %@.", caseName);
+        if (nil == renderEquation)
+            continue;
+
+        NSDictionary *geometry = [EQRenderGeometryDump geometryForRenderEquation:renderEquation];
+        NSData *geometryData = [EQRenderGeometryDump canonicalJSONForGeometry:geometry];
+        NSString *goldenPath = [goldenDirectory stringByAppendingPathComponent:[caseName stringByAppendingPathExtension:@"json"]];
+        NSData *goldenData = [NSData dataWithContentsOfFile:goldenPath];
+
+        if (shouldRecord)
+        {
+            XCTAssertTrue([geometryData writeToFile:goldenPath atomically:YES], @"Should record the golden for %@.", caseName);
+            NSLog(@"Recorded geometry golden for %@ at %@", caseName, goldenPath);
+            continue;
+        }
+
+        XCTAssertNotNil(goldenData, @"Missing geometry golden for %@ at %@. Record it with EQ_RECORD_GEOMETRY_GOLDENS set.", caseName, goldenPath);
+        if (nil == goldenData)
+            continue;
+
+        id goldenGeometry = [NSJSONSerialization JSONObjectWithData:goldenData options:0 error:nil];
+        XCTAssertNotNil(goldenGeometry, @"Should read the golden for %@.", caseName);
+
+        NSArray *differences = [EQRenderGeometryDump differencesFromGeometry:geometry toGeometry:goldenGeometry tolerance:kGOLDEN_TOLERANCE];
+        XCTAssertEqual(differences.count, (NSUInteger)0, @"Layout of %@ has moved:\n%@", caseName, [differences componentsJoinedByString:@"\n"]);
+    }
+}
+
+- (void)testGeometryIsStable
+{
+    for (NSArray *corpusCase in [self geometryCorpus])
+    {
+        NSDictionary *firstGeometry = [EQRenderGeometryDump geometryForRenderEquation:[self renderEquationForMathML:corpusCase[1]]];
+        NSDictionary *secondGeometry = [EQRenderGeometryDump geometryForRenderEquation:[self renderEquationForMathML:corpusCase[1]]];
+        XCTAssertEqualObjects([EQRenderGeometryDump canonicalJSONForGeometry:firstGeometry],
+                              [EQRenderGeometryDump canonicalJSONForGeometry:secondGeometry],
+                              @"Laying out %@ twice should give the same geometry.", corpusCase[0]);
+    }
+}
+
+- (void)testGeometryDifferences
+{
+    NSDictionary *testGeometry = @{@"origin": @[@(10.0), @(20.0)], @"text": @"x"};
+    XCTAssertEqual([EQRenderGeometryDump differencesFromGeometry:testGeometry toGeometry:testGeometry tolerance:0.0].count, (NSUInteger)0,
+                   @"Should match itself.");
+
+    NSDictionary *nearGeometry = @{@"origin": @[@(10.005), @(20.0)], @"text": @"x"};
+    XCTAssertEqual([EQRenderGeometryDump differencesFromGeometry:nearGeometry toGeometry:testGeometry tolerance:kGOLDEN_TOLERANCE].count, (NSUInteger)0,
+                   @"Should ignore differences inside the tolerance.");
+
+    NSDictionary *movedGeometry = @{@"origin": @[@(12.0), @(20.0)], @"text": @"y"};
+    NSArray *differences = [EQRenderGeometryDump differencesFromGeometry:movedGeometry toGeometry:testGeometry tolerance:kGOLDEN_TOLERANCE];
+    XCTAssertEqual(differences.count, (NSUInteger)2, @"Should report the moved origin and the changed text.");
+    XCTAssertTrue([differences[0] hasPrefix:@"/origin/0"], @"Should report the path to the moved value.");
+
+    NSDictionary *shortGeometry = @{@"origin": @[@(10.0)], @"text": @"x"};
+    XCTAssertEqual([EQRenderGeometryDump differencesFromGeometry:shortGeometry toGeometry:testGeometry tolerance:kGOLDEN_TOLERANCE].count, (NSUInteger)1,
+                   @"Should report a missing value.");
+}
+
+- (void)testCanonicalJSON
+{
+    NSDictionary *testGeometry = @{@"b": @[@(-0.0001), @(1.23456)], @"a": @"x"};
+    NSString *jsonString = [[NSString alloc] initWithData:[EQRenderGeometryDump canonicalJSONForGeometry:testGeometry] encoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects(jsonString, @"{\n  \"a\": \"x\",\n  \"b\": [0.000, 1.235]\n}\n", @"Should sort keys and round values.");
+    XCTAssertNotNil([NSJSONSerialization JSONObjectWithData:[jsonString dataUsingEncoding:NSUTF8StringEncoding] options:0 error:nil],
+                    @"Should write valid JSON.");
+}
+
+// Times the layout of each case and writes the results so runs before and after a change can be compared.
+- (void)testLayoutTimings
+{
+    NSMutableDictionary *timings = [[NSMutableDictionary alloc] init];
+    for (NSArray *corpusCase in [self geometryCorpus])
+    {
+        // Build once first so font loading isn't counted.
+        [self renderEquationForMathML:corpusCase[1]];
+
+        CFTimeInterval startTime = CACurrentMediaTime();
+        for (NSUInteger i = 0; i < kTIMING_ITERATIONS; i++)
+        {
+            [self renderEquationForMathML:corpusCase[1]];
+        }
+        CFTimeInterval averageTime = (CACurrentMediaTime() - startTime) / (CFTimeInterval)kTIMING_ITERATIONS;
+        timings[corpusCase[0]] = @(averageTime * 1000.0);
+        NSLog(@"Layout of %@ took %.3f ms", corpusCase[0], averageTime * 1000.0);
+    }
+
+    NSString *timingPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"EQGeometryTimings.json"];
+    XCTAssertTrue([[EQRenderGeometryDump canonicalJSONForGeometry:timings] writeToFile:timingPath atomically:YES], @"Should write the timings.");
+}
+
+- (void)testLayoutPerformance
+{
+    NSArray *corpus = [self geometryCorpus];
+    [self measureBlock:^{
+        for (NSArray *corpusCase in corpus)
+        {
+            [self renderEquationForMathML:corpusCase[1]];
+        }
+    }];
+}
+
+@end
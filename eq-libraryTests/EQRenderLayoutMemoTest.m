@@ -0,0 +1,159 @@
+//
+//  EQRenderLayoutMemoTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "EQRenderLayoutMemo.h"
+#import "EQRenderGeometryDump.h"
+#import "EQRenderStem.h"
+#import "EQRenderFracStem.h"
+#import "EQXMLImporter.h"
+#import "EquationViewDataSource.h"
+
+static NSString * const kREPEATED_FRACTION_MATHML = @"<math><mrow><mfrac><mrow><mi>a</mi><mo>+</mo><mi>b</mi></mrow><mi>c</mi></mfrac><mo>+</mo>"
+                                                     "<mfrac><mrow><mi>a</mi><mo>+</mo><mi>b</mi></mrow><mi>c</mi></mfrac><mo>=</mo>"
+                                                     "<mfrac><mrow><mi>a</mi><mo>+</mo><mi>b</mi></mrow><mi>d</mi></mfrac></mrow></math>";
+
+@interface EQRenderLayoutMemoTest : XCTestCase
+
+- (EQRenderEquation *)renderEquationForMathML: (NSString *)mathMLStr;
+- (void)addFractionsInStem: (EQRenderStem *)renderStem toArray: (NSMutableArray *)fractionStems;
+
+@end
+
+@implementation EQRenderLayoutMemoTest
+
+- (void)setUp
+{
+    [super setUp];
+    [EQRenderLayoutMemo clearLayoutMemo];
+}
+
+- (void)tearDown
+{
+    [EQRenderLayoutMemo setUsesLayoutMemo:NO];
+    [super tearDown];
+}
+
+- (EQRenderEquation *)renderEquationForMathML: (NSString *)mathMLStr
+{
+    EquationViewDataSource *testDataSource = [EQXMLImporter populateDataSourceWithXMLString:mathMLStr];
+    EQRenderEquation *renderEquation = [testDataSource buildRenderEquation];
+    [renderEquation layoutEquationLines];
+    return renderEquation;
+}
+
+- (void)addFractionsInStem: (EQRenderStem *)renderStem toArray: (NSMutableArray *)fractionStems
+{
+    if ([renderStem isKindOfClass:[EQRenderFracStem class]])
+    {
+        [fractionStems addObject:renderStem];
+    }
+    for (id renderObj in renderStem.renderArray)
+    {
+        if ([renderObj isKindOfClass:[EQRenderStem class]])
+        {
+            [self addFractionsInStem:renderObj toArray:fractionStems];
+        }
+    }
+}
+
+- (void)testStructuralKeys
+{
+    EquationViewDataSource *testDataSource = [EQXMLImporter populateDataSourceWithXMLString:kREPEATED_FRACTION_MATHML];
+    EQRenderEquation *renderEquation = [testDataSource buildRenderEquation];
+    NSMutableArray *fractionStems = [[NSMutableArray alloc] init];
+    for (EQRenderStem *renderStem in renderEquation.equationStems)
+    {
+        [self addFractionsInStem:renderStem toArray:fractionStems];
+    }
+    XCTAssertEqual(fractionStems.count, (NSUInteger)3, @"Should find each fraction.");
+    if (fractionStems.count != 3)
+        return;
+
+    NSString *firstKey = [EQRenderLayoutMemo structuralKeyForStem:fractionStems[0]];
+    XCTAssertNotNil(firstKey, @"Should be able to reuse a plain fraction.");
+    XCTAssertEqualObjects([EQRenderLayoutMemo structuralKeyForStem:fractionStems[1]], firstKey, @"Matching fractions should share a key.");
+    XCTAssertNotEqualObjects([EQRenderLayoutMemo structuralKeyForStem:fractionStems[2]], firstKey, @"A different denominator should change the key.");
+
+    EquationViewDataSource *stretchyDataSource = [EQXMLImporter populateDataSourceWithXMLString:@"<math><mrow><mo stretchy=\"true\">(</mo><mfrac><mi>a</mi><mi>b</mi></mfrac><mo stretchy=\"true\">)</mo></mrow></math>"];
+    EQRenderEquation *stretchyEquation = [stretchyDataSource buildRenderEquation];
+    XCTAssertNil([EQRenderLayoutMemo structuralKeyForStem:stretchyEquation.equationStems.firstObject], @"Should not reuse a row with stretchy bracers.");
+}
+
+- (void)testStructuralKeysReusedDuringLayoutPass
+{
+    EquationViewDataSource *testDataSource = [EQXMLImporter populateDataSourceWithXMLString:kREPEATED_FRACTION_MATHML];
+    EQRenderEquation *renderEquation = [testDataSource buildRenderEquation];
+    NSMutableArray *fractionStems = [[NSMutableArray alloc] init];
+    for (EQRenderStem *renderStem in renderEquation.equationStems)
+    {
+        [self addFractionsInStem:renderStem toArray:fractionStems];
+    }
+    if (fractionStems.count == 0)
+        return;
+
+    NSMutableArray *expectedKeys = [[NSMutableArray alloc] init];
+    for (EQRenderStem *fractionStem in fractionStems)
+    {
+        [expectedKeys addObject:[EQRenderLayoutMemo structuralKeyForStem:fractionStem]];
+    }
+
+    // The keys built for the root are stored for its children, and should match the ones built on their own.
+    [EQRenderLayoutMemo beginLayoutPass];
+    XCTAssertNotNil([EQRenderLayoutMemo structuralKeyForStem:[fractionStems[0] parentStem]], @"Should be able to reuse the parent row.");
+    for (NSUInteger i = 0; i < fractionStems.count; i++)
+    {
+        XCTAssertEqualObjects([EQRenderLayoutMemo structuralKeyForStem:fractionStems[i]], expectedKeys[i], @"Stored keys should match rebuilt keys.");
+    }
+    [EQRenderLayoutMemo endLayoutPass];
+}
+
+- (void)testMemoizedLayoutMatchesFullLayout
+{
+    NSArray *testCorpus = @[kREPEATED_FRACTION_MATHML,
+                            @"<math><mrow><msup><mi>x</mi><mn>2</mn></msup><mo>+</mo><msup><mi>x</mi><mn>2</mn></msup><mo>+</mo><msqrt><msup><mi>x</mi><mn>2</mn></msup></msqrt></mrow></math>",
+                            @"<math><mfrac><mfrac><mn>1</mn><mi>x</mi></mfrac><mrow><mn>1</mn><mo>+</mo><mfrac><mn>1</mn><mi>x</mi></mfrac></mrow></mfrac></math>",
+                            @"<math><mrow><munderover><mo largeop=\"true\">&#x2211;</mo><mrow><mi>i</mi><mo>=</mo><mn>1</mn></mrow><mi>n</mi></munderover><msub><mi>x</mi><mi>i</mi></msub><mo>+</mo><msub><mi>x</mi><mi>i</mi></msub></mrow></math>"];
+
+    for (NSString *mathMLStr in testCorpus)
+    {
+        [EQRenderLayoutMemo setUsesLayoutMemo:NO];
+        NSDictionary *fullGeometry = [EQRenderGeometryDump geometryForRenderEquation:[self renderEquationForMathML:mathMLStr]];
+
+        [EQRenderLayoutMemo setUsesLayoutMemo:YES];
+        NSDictionary *memoGeometry = [EQRenderGeometryDump geometryForRenderEquation:[self renderEquationForMathML:mathMLStr]];
+        NSDictionary *repeatGeometry = [EQRenderGeometryDump geometryForRenderEquation:[self renderEquationForMathML:mathMLStr]];
+
+        NSArray *differences = [EQRenderGeometryDump differencesFromGeometry:memoGeometry toGeometry:fullGeometry tolerance:0.001];
+        XCTAssertEqual(differences.count, (NSUInteger)0, @"Memoized layout moved:\n%@", [differences componentsJoinedByString:@"\n"]);
+        differences = [EQRenderGeometryDump differencesFromGeometry:repeatGeometry toGeometry:fullGeometry tolerance:0.001];
+        XCTAssertEqual(differences.count, (NSUInteger)0, @"Restored layout moved:\n%@", [differences componentsJoinedByString:@"\n"]);
+    }
+
+    XCTAssertTrue([EQRenderLayoutMemo layoutMemoHitCount] > 0, @"Should reuse the repeated subexpressions.");
+}
+
+- (void)testMemoIsOffByDefault
+{
+    [EQRenderLayoutMemo setUsesLayoutMemo:NO];
+    [self renderEquationForMathML:kREPEATED_FRACTION_MATHML];
+    [self renderEquationForMathML:kREPEATED_FRACTION_MATHML];
+    XCTAssertEqual([EQRenderLayoutMemo layoutMemoHitCount], (NSUInteger)0, @"Should not reuse layouts unless it is turned on.");
+}
+
+@end
@@ -18,7 +18,7 @@
  */
 
 #import <XCTest/XCTest.h>
-#import "EQRenderMatrixStem.h"
+#import "EQRenderMatrixStem+Testing.h"
 #import "EQRenderStem.h"
 #import "EQRenderData.h"
 
@@ -80,4 +80,78 @@
     XCTAssertTrue([testObj isKindOfClass:[EQRenderData class]], @"Should have returned an initialized renderData object.");
 }
 
+- (void)testCellGridGeometry
+{
+    XCTAssertTrue([testStem respondsToSelector:@selector(cellStemsIntersectingRect:)], @"Should respond to method call.");
+    XCTAssertNil([testStem rowFrames], @"Should not have grid data before layout.");
+    XCTAssertTrue([testStem rowRangeIntersectingRect:CGRectMake(0, 0, 100, 100)].location == NSNotFound, @"Should not find rows before layout.");
+
+    testStem = [[EQRenderMatrixStem alloc] initWithStoredCharacterData:@"3x4"];
+    XCTAssertNoThrow([testStem layoutChildren], @"Should not throw when laying out the matrix.");
+    XCTAssertTrue([testStem rowFrames].count == 3, @"Should store one frame per row.");
+    XCTAssertTrue([testStem columnFrames].count == 4, @"Should store one frame per column.");
+
+    NSSet *visibleCells = [testStem cellStemsIntersectingRect:CGRectMake(-1000, -1000, 3000, 3000)];
+    XCTAssertTrue(visibleCells.count == 12, @"Should return every cell for a large rect.");
+
+    visibleCells = [testStem cellStemsIntersectingRect:CGRectMake(10000, 10000, 10, 10)];
+    XCTAssertTrue(visibleCells.count == 0, @"Should not return cells outside of the rect.");
+
+    NSRange rowRange = [testStem rowRangeIntersectingRect:CGRectMake(-1000, -1000, 3000, 3000)];
+    NSRange colRange = [testStem columnRangeIntersectingRect:CGRectMake(-1000, -1000, 3000, 3000)];
+    XCTAssertTrue(NSEqualRanges(rowRange, NSMakeRange(0, 3)), @"Should return every row for a large rect.");
+    XCTAssertTrue(NSEqualRanges(colRange, NSMakeRange(0, 4)), @"Should return every column for a large rect.");
+
+    // Ends just before the padded first column, then just inside it.
+    CGFloat cellPadding = [testStem cellPadding];
+    CGRect firstColumn = [(NSValue *)[testStem columnFrames][0] CGRectValue];
+    CGRect secondColumn = [(NSValue *)[testStem columnFrames][1] CGRectValue];
+    colRange = [testStem columnRangeIntersectingRect:CGRectMake(CGRectGetMinX(firstColumn) - cellPadding - 1010, 0, 1000, 10)];
+    XCTAssertTrue(colRange.location == NSNotFound, @"Should not find columns left of the matrix.");
+    CGFloat testMaxX = MIN(CGRectGetMinX(firstColumn) - cellPadding + 1.0, CGRectGetMinX(secondColumn) - cellPadding - 1.0);
+    colRange = [testStem columnRangeIntersectingRect:CGRectMake(testMaxX - 1000, 0, 1000, 10)];
+    XCTAssertTrue(NSEqualRanges(colRange, NSMakeRange(0, 1)), @"Should only find the first column.");
+
+    // Every cell center should find exactly the rows and columns that reach it once padded.
+    for (NSUInteger rowLoc = 0; rowLoc < 3; rowLoc ++)
+    {
+        for (NSUInteger colLoc = 0; colLoc < 4; colLoc ++)
+        {
+            CGRect rowFrame = [(NSValue *)[testStem rowFrames][rowLoc] CGRectValue];
+            CGRect colFrame = [(NSValue *)[testStem columnFrames][colLoc] CGRectValue];
+            CGRect testRect = CGRectMake(CGRectGetMidX(colFrame), CGRectGetMidY(rowFrame), 1.0, 1.0);
+            NSRange expectedRows = [self expectedRangeOfFrames:[testStem rowFrames] min:CGRectGetMinY(testRect) - cellPadding
+                                                           max:CGRectGetMaxY(testRect) + cellPadding useVertical:YES];
+            NSRange expectedCols = [self expectedRangeOfFrames:[testStem columnFrames] min:CGRectGetMinX(testRect) - cellPadding
+                                                           max:CGRectGetMaxX(testRect) + cellPadding useVertical:NO];
+            XCTAssertTrue(NSLocationInRange(rowLoc, expectedRows) && NSLocationInRange(colLoc, expectedCols), @"Should include the cell itself.");
+            XCTAssertTrue(NSEqualRanges([testStem rowRangeIntersectingRect:testRect], expectedRows), @"Should find the rows for cell %lu, %lu.",
+                          (unsigned long)rowLoc, (unsigned long)colLoc);
+            XCTAssertTrue(NSEqualRanges([testStem columnRangeIntersectingRect:testRect], expectedCols), @"Should find the columns for cell %lu, %lu.",
+                          (unsigned long)rowLoc, (unsigned long)colLoc);
+        }
+    }
+}
+
+// Checks every frame instead of searching, to compare against the binary search.
+- (NSRange)expectedRangeOfFrames: (NSArray *)frameArray min: (CGFloat)testMin max: (CGFloat)testMax useVertical: (BOOL)useVertical
+{
+    NSRange expectedRange = NSMakeRange(NSNotFound, 0);
+    for (NSUInteger i = 0; i < frameArray.count; i ++)
+    {
+        CGRect frameRect = [(NSValue *)frameArray[i] CGRectValue];
+        CGFloat frameMin = useVertical ? CGRectGetMinY(frameRect) : CGRectGetMinX(frameRect);
+        CGFloat frameMax = useVertical ? CGRectGetMaxY(frameRect) : CGRectGetMaxX(frameRect);
+        if (frameMax < testMin || frameMin > testMax)
+            continue;
+
+        if (expectedRange.location == NSNotFound)
+        {
+            expectedRange = NSMakeRange(i, 0);
+        }
+        expectedRange.length = i - expectedRange.location + 1;
+    }
+    return expectedRange;
+}
+
 @end
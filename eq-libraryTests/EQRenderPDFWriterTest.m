@@ -0,0 +1,140 @@
+//
+//  EQRenderPDFWriterTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "EQRenderPDFWriter.h"
+#import "EQRenderEquation.h"
+#import "EQRenderStem.h"
+#import "EQRenderData.h"
+#import "EQTrueTypeSubsetter.h"
+
+@interface EQRenderPDFWriterTest : XCTestCase
+{
+    EQRenderEquation *testEquation;
+}
+
+- (NSString *)stringForPDFData: (NSData *)pdfData;
+
+@end
+
+@implementation EQRenderPDFWriterTest
+
+- (void)setUp
+{
+    [super setUp];
+    // Put setup code here; it will be run once, before the first test case.
+    EQRenderData *testData = [[EQRenderData alloc] initWithString:@"x+1"];
+    EQRenderStem *rootStem = [[EQRenderStem alloc] initWithObject:testData andStemType:stemTypeRoot];
+    rootStem.drawOrigin = CGPointMake(40.0, 40.0);
+    [rootStem layoutChildren];
+
+    testEquation = [[EQRenderEquation alloc] initWithEquationLines:@[@[testData]] andEquationStems:@[rootStem]];
+}
+
+- (void)tearDown
+{
+    // Put teardown code here; it will be run once, after the last test case.
+    [super tearDown];
+}
+
+- (NSString *)stringForPDFData: (NSData *)pdfData
+{
+    return [[NSString alloc] initWithData:pdfData encoding:NSISOLatin1StringEncoding];
+}
+
+- (void)testPDFDataWithNoPages
+{
+    EQRenderPDFWriter *testWriter = [[EQRenderPDFWriter alloc] init];
+    XCTAssertNil([testWriter pdfData], @"Should return nil without any pages.");
+
+    [testWriter addPageWithRenderEquation:[[EQRenderEquation alloc] init]];
+    XCTAssertEqual(testWriter.pageCount, (NSUInteger)0, @"Should not add a page for an empty equation.");
+}
+
+- (void)testPDFDataWithEmbeddedFonts
+{
+    NSData *testData = nil;
+    XCTAssertNoThrow(testData = [EQRenderPDFWriter pdfDataWithRenderEquation:testEquation], @"Should not throw without a graphics context.");
+
+    NSString *testString = [self stringForPDFData:testData];
+    XCTAssertTrue([testString hasPrefix:@"%PDF-1.4"], @"Should return a PDF document.");
+    XCTAssertTrue([testString hasSuffix:@"%%EOF\n"], @"Should end with the trailer.");
+    XCTAssertTrue([testString rangeOfString:@"/FontFile2"].location != NSNotFound
+                  || [testString rangeOfString:@"/Type3"].location != NSNotFound, @"Should embed the fonts it uses.");
+    XCTAssertTrue([testString rangeOfString:@"/ToUnicode"].location != NSNotFound, @"Should map the glyphs back to text.");
+}
+
+- (void)testPDFDataSharesFontsAcrossPages
+{
+    EQRenderPDFWriter *testWriter = [[EQRenderPDFWriter alloc] init];
+    testWriter.compressStreams = NO;
+    [testWriter addPageWithRenderEquation:testEquation];
+    NSString *singleString = [self stringForPDFData:[testWriter pdfData]];
+
+    [testWriter addPageWithRenderEquation:testEquation];
+    [testWriter addPageWithRenderEquation:testEquation];
+    NSString *multipleString = [self stringForPDFData:[testWriter pdfData]];
+
+    XCTAssertEqual(testWriter.pageCount, (NSUInteger)3, @"Should add a page for each equation.");
+    XCTAssertTrue([multipleString rangeOfString:@"/Count 3"].location != NSNotFound, @"Should list every page.");
+
+    NSUInteger singleFonts = [singleString componentsSeparatedByString:@"/Type /Font "].count;
+    NSUInteger multipleFonts = [multipleString componentsSeparatedByString:@"/Type /Font "].count;
+    XCTAssertEqual(singleFonts, multipleFonts, @"Should only embed each font once.");
+    XCTAssertTrue([multipleString rangeOfString:@" TJ"].location != NSNotFound, @"Should write the text as glyph runs.");
+}
+
+- (void)testSubsetKeepsOnlyUsedMetrics
+{
+    CTFontRef testFont = CTFontCreateWithName(CFSTR("Times New Roman"), 12.0, NULL);
+    if (![EQTrueTypeSubsetter fontHasTrueTypeOutlines:testFont])
+    {
+        CFRelease(testFont);
+        return;
+    }
+
+    UniChar testChar = 'x';
+    CGGlyph testGlyph = 0;
+    CTFontGetGlyphsForCharacters(testFont, &testChar, &testGlyph, 1);
+    NSDictionary *fontTables = [EQTrueTypeSubsetter tablesForFont:testFont];
+    CFRelease(testFont);
+
+    NSData *fullData = [EQTrueTypeSubsetter subsetFontWithTables:fontTables glyphs:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, 0xFFFF)]];
+    NSData *subsetData = [EQTrueTypeSubsetter subsetFontWithTables:fontTables glyphs:[NSIndexSet indexSetWithIndex:testGlyph]];
+    XCTAssertNotNil(subsetData, @"Should subset a TrueType font.");
+    XCTAssertTrue(subsetData.length < fullData.length, @"Should drop the unused outlines and metrics.");
+
+    CGDataProviderRef subsetProvider = CGDataProviderCreateWithCFData((__bridge CFDataRef)subsetData);
+    CGFontRef subsetCGFont = CGFontCreateWithDataProvider(subsetProvider);
+    CGDataProviderRelease(subsetProvider);
+    XCTAssertTrue(NULL != subsetCGFont, @"Should write a font that can be loaded again.");
+
+    if (NULL != subsetCGFont)
+    {
+        CTFontRef subsetFont = CTFontCreateWithGraphicsFont(subsetCGFont, 12.0, NULL, NULL);
+        CTFontRef originalFont = CTFontCreateWithName(CFSTR("Times New Roman"), 12.0, NULL);
+        CGFloat subsetAdvance = CTFontGetAdvancesForGlyphs(subsetFont, kCTFontOrientationHorizontal, &testGlyph, NULL, 1);
+        CGFloat originalAdvance = CTFontGetAdvancesForGlyphs(originalFont, kCTFontOrientationHorizontal, &testGlyph, NULL, 1);
+        XCTAssertEqualWithAccuracy(subsetAdvance, originalAdvance, 0.001, @"Should keep the advance of a used glyph.");
+        CFRelease(originalFont);
+        CFRelease(subsetFont);
+        CGFontRelease(subsetCGFont);
+    }
+}
+
+@end
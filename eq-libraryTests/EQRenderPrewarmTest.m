@@ -0,0 +1,72 @@
+//
+//  EQRenderPrewarmTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "EQRenderPrewarm.h"
+#import "EQRenderFontDictionary.h"
+#import "EQRenderTypesetter.h"
+
+@interface EQRenderPrewarmTest : XCTestCase
+
+@end
+
+@implementation EQRenderPrewarmTest
+
+- (void)setUp
+{
+    [super setUp];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+- (void)testPrewarmTimings
+{
+    NSArray *stepTimings = nil;
+    XCTAssertNoThrow(stepTimings = [EQRenderPrewarm prewarm], @"Should not throw.");
+    XCTAssertTrue([EQRenderPrewarm hasPrewarmed], @"Should be prewarmed.");
+    XCTAssertEqual(stepTimings.count, (NSUInteger)4, @"Should time each step.");
+    XCTAssertEqualObjects(stepTimings[0][0], kPREWARM_FONTS_STEP, @"Should load the fonts first.");
+    XCTAssertEqualObjects(stepTimings.lastObject[0], kPREWARM_LAYOUT_STEP, @"Should lay out the sample equation last.");
+    XCTAssertEqualObjects([EQRenderPrewarm prewarm], stepTimings, @"Should only prewarm once.");
+}
+
+- (void)testPrewarmInBackground
+{
+    XCTestExpectation *prewarmExpectation = [self expectationWithDescription:@"prewarm"];
+    [EQRenderPrewarm prewarmInBackgroundWithCompletion:^(NSArray *stepTimings)
+    {
+        XCTAssertTrue([NSThread isMainThread], @"Should complete on the main thread.");
+        XCTAssertEqual(stepTimings.count, (NSUInteger)4, @"Should pass the timings.");
+        XCTAssertEqualObjects(stepTimings.lastObject[0], kPREWARM_LAYOUT_STEP, @"Should lay out the sample equation last.");
+        XCTAssertTrue([EQRenderPrewarm hasPrewarmed], @"Should be prewarmed before the completion block.");
+        [prewarmExpectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:30.0 handler:nil];
+}
+
+- (void)testSharedTables
+{
+    XCTAssertTrue([EQRenderTypesetter getOperatorCharacterSet] == [EQRenderTypesetter getOperatorCharacterSet], @"Should build each table once.");
+    XCTAssertTrue([EQRenderFontDictionary pinDefaultFonts] > 0, @"Should pin the default fonts.");
+    XCTAssertEqual([EQRenderFontDictionary pinDefaultFonts], [EQRenderFontDictionary pinDefaultFonts], @"Should only pin the fonts once.");
+}
+
+@end
@@ -0,0 +1,308 @@
+//
+//  EQRenderRasterizerTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import <UIKit/UIKit.h>
+#import <fcntl.h>
+#import "EQRenderRasterizer.h"
+#import "EQRenderEquation.h"
+#import "EQRenderStem.h"
+#import "EQRenderData.h"
+#import "EQPNGWriter.h"
+#import "EQRenderFrozenEquation.h"
+#import "EQGlyphAtlas.h"
+#import "ConvertMathToImage.h"
+
+@interface EQRenderRasterizerTest : XCTestCase
+{
+    EQRenderEquation *testEquation;
+}
+
+@end
+
+@implementation EQRenderRasterizerTest
+
+- (void)setUp
+{
+    [super setUp];
+    // Put setup code here; it will be run once, before the first test case.
+    EQRenderData *testData = [[EQRenderData alloc] initWithString:@"x+1"];
+    EQRenderStem *rootStem = [[EQRenderStem alloc] initWithObject:testData andStemType:stemTypeRoot];
+    rootStem.drawOrigin = CGPointMake(40.0, 40.0);
+    [rootStem layoutChildren];
+
+    testEquation = [[EQRenderEquation alloc] initWithEquationLines:@[@[testData]] andEquationStems:@[rootStem]];
+    [testEquation layoutEquationLines];
+}
+
+- (void)tearDown
+{
+    // Put teardown code here; it will be run once, after the last test case.
+    [super tearDown];
+}
+
+- (void)testAlphaContextHasInk
+{
+    EQRenderRasterizer *testRasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:testEquation];
+    CGSize testSize = CGSizeMake(testEquation.drawSize.width + 60.0, testEquation.drawSize.height + 60.0);
+    CGContextRef testContext = [testRasterizer createAlphaContextWithSize:testSize drawRect:CGRectZero];
+    XCTAssertTrue(NULL != testContext, @"Should create an alpha context.");
+    XCTAssertEqual(CGBitmapContextGetBitsPerPixel(testContext), (size_t)8, @"Should only store alpha.");
+
+    const uint8_t *testBytes = CGBitmapContextGetData(testContext);
+    size_t byteCount = CGBitmapContextGetBytesPerRow(testContext) * CGBitmapContextGetHeight(testContext);
+    BOOL foundInk = NO;
+    for (size_t i = 0; i < byteCount && !foundInk; i ++)
+    {
+        foundInk = (testBytes[i] != 0);
+    }
+    XCTAssertTrue(foundInk, @"Should draw the glyphs.");
+    CGContextRelease(testContext);
+}
+
+- (void)testPNGDataDecodes
+{
+    EQRenderRasterizer *testRasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:testEquation];
+    testRasterizer.pixelScale = 2.0;
+    CGSize testSize = CGSizeMake(100.0, 80.0);
+    NSData *testData = [testRasterizer pngDataWithSize:testSize drawRect:CGRectZero compressionLevel:9];
+    XCTAssertTrue(testData.length > 8, @"Should return PNG data.");
+
+    const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    XCTAssertEqual(memcmp(testData.bytes, pngSignature, 8), 0, @"Should start with the PNG signature.");
+
+    UIImage *testImage = [UIImage imageWithData:testData];
+    XCTAssertNotNil(testImage, @"Should decode as an image.");
+    XCTAssertEqual(testImage.size.width, (CGFloat)200.0, @"Should apply the pixel scale.");
+    XCTAssertEqual(testImage.size.height, (CGFloat)160.0, @"Should apply the pixel scale.");
+}
+
+- (void)testInkBoundsContainInk
+{
+    CGRect inkBounds = [testEquation inkBounds];
+    XCTAssertFalse(CGRectIsNull(inkBounds), @"Should find ink for a non-empty equation.");
+    XCTAssertTrue(inkBounds.size.width < testEquation.drawSize.width + 60.0, @"Should be tighter than the padded draw size.");
+
+    // Drawing with the ink origin moved to the margin should fill the first column inside the margin.
+    CGFloat testMargin = 2.0;
+    CGSize testSize = CGSizeMake(ceil(inkBounds.size.width) + 2.0 * testMargin, ceil(inkBounds.size.height) + 2.0 * testMargin);
+    CGRect testRect = CGRectMake(testMargin - floor(inkBounds.origin.x), testMargin - floor(inkBounds.origin.y), testSize.width, testSize.height);
+    EQRenderRasterizer *testRasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:testEquation];
+    CGContextRef testContext = [testRasterizer createAlphaContextWithSize:testSize drawRect:testRect];
+    XCTAssertTrue(NULL != testContext, @"Should create an alpha context.");
+
+    const uint8_t *testBytes = CGBitmapContextGetData(testContext);
+    size_t bytesPerRow = CGBitmapContextGetBytesPerRow(testContext);
+    BOOL edgeHasInk = NO;
+    for (size_t row = 0; row < CGBitmapContextGetHeight(testContext); row ++)
+    {
+        edgeHasInk = edgeHasInk || (testBytes[row * bytesPerRow] != 0);
+    }
+    XCTAssertFalse(edgeHasInk, @"Should leave the margin empty.");
+    CGContextRelease(testContext);
+}
+
+- (void)testInlineMetricsMatchInkBounds
+{
+    EQInlineMetrics testMetrics = [testEquation layoutInlineEquation];
+    CGRect inkBounds = [testEquation inkBounds];
+    XCTAssertTrue(testMetrics.width > 0.0, @"Should measure the width during layout.");
+    XCTAssertTrue(testMetrics.ascent > 0.0, @"Should have ink above the baseline.");
+    XCTAssertEqualWithAccuracy(testMetrics.width, inkBounds.size.width, 1.0, @"Should match the ink width.");
+    XCTAssertEqualWithAccuracy(testMetrics.ascent + testMetrics.descent, inkBounds.size.height, 1.0, @"Should match the ink height.");
+    XCTAssertEqualWithAccuracy(testMetrics.baselineOrigin.y - testMetrics.ascent, CGRectGetMinY(inkBounds), 1.0, @"Should place the baseline below the top of the ink.");
+}
+
+- (void)testInlineMetricsIncludeRules
+{
+    // The fraction bar and the radical overline are drawn as lines, not glyphs.
+    EQRenderEquation *ruleEquation = [ConvertMathToImage importMathML:@"<math><mfrac><mn>1</mn><msqrt><mi>x</mi></msqrt></mfrac></math>"];
+    EQInlineMetrics testMetrics = [ruleEquation layoutInlineEquation];
+    CGRect inkBounds = [ruleEquation inkBounds];
+    XCTAssertEqualWithAccuracy(testMetrics.width, inkBounds.size.width, 0.01, @"Should use the ink bounds for the width.");
+    XCTAssertEqualWithAccuracy(testMetrics.ascent + testMetrics.descent, inkBounds.size.height, 0.01, @"Should use the ink bounds for the height.");
+
+    __block NSUInteger ruleCount = 0;
+    __block CGRect ruleBounds = CGRectNull;
+    CGContextRef measureContext = CGBitmapContextCreate(NULL, 1, 1, 8, 0, NULL, (CGBitmapInfo)kCGImageAlphaOnly);
+    [ruleEquation enumerateDrawElementsInContext:measureContext stringBlock:nil lineBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+    {
+        CGRect lineRect = CGRectStandardize(CGRectMake(startPoint.x, startPoint.y, endPoint.x - startPoint.x, endPoint.y - startPoint.y));
+        ruleBounds = CGRectUnion(ruleBounds, CGRectInset(lineRect, -0.5 * lineWidth, -0.5 * lineWidth));
+        ruleCount ++;
+    }];
+    CGContextRelease(measureContext);
+
+    XCTAssertTrue(ruleCount >= 2, @"Should draw the fraction bar and the radical overline.");
+    CGFloat inkTop = testMetrics.baselineOrigin.y - testMetrics.ascent;
+    XCTAssertTrue(testMetrics.baselineOrigin.x <= CGRectGetMinX(ruleBounds) + 0.01, @"Should start at or before the rules.");
+    XCTAssertTrue(testMetrics.baselineOrigin.x + testMetrics.width >= CGRectGetMaxX(ruleBounds) - 0.01, @"Should be wide enough for the rules.");
+    XCTAssertTrue(inkTop <= CGRectGetMinY(ruleBounds) + 0.01, @"Should be tall enough for the rules.");
+    XCTAssertTrue(testMetrics.baselineOrigin.y + testMetrics.descent >= CGRectGetMaxY(ruleBounds) - 0.01, @"Should be deep enough for the rules.");
+}
+
+- (void)testInkBoundsMatchDrawnElements
+{
+    // The ink is collected during layout, so compare it with a pass over everything that is drawn.
+    NSString *mathMLStr = @"<math><mrow><mo>(</mo><mfrac><mn>1</mn><msqrt><mi>x</mi></msqrt></mfrac><mo>)</mo></mrow></math>";
+    EQRenderEquation *stretchyEquation = [ConvertMathToImage importMathML:mathMLStr];
+    CGRect inkBounds = [stretchyEquation inkBounds];
+
+    __block CGRect drawnBounds = CGRectNull;
+    CGContextRef measureContext = CGBitmapContextCreate(NULL, 1, 1, 8, 0, NULL, (CGBitmapInfo)kCGImageAlphaOnly);
+    [stretchyEquation enumerateDrawElementsInContext:measureContext stringBlock:^(NSAttributedString *renderString, CGPoint drawPoint)
+    {
+        CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)renderString);
+        CGRect imageBounds = CTLineGetImageBounds(line, measureContext);
+        CFRelease(line);
+        if (CGRectIsEmpty(imageBounds))
+            return;
+
+        drawnBounds = CGRectUnion(drawnBounds, CGRectMake(drawPoint.x + imageBounds.origin.x, drawPoint.y - CGRectGetMaxY(imageBounds),
+                                                          imageBounds.size.width, imageBounds.size.height));
+    }
+    lineBlock:^(CGPoint startPoint, CGPoint endPoint, CGFloat lineWidth)
+    {
+        CGRect lineRect = CGRectStandardize(CGRectMake(startPoint.x, startPoint.y, endPoint.x - startPoint.x, endPoint.y - startPoint.y));
+        drawnBounds = CGRectUnion(drawnBounds, CGRectInset(lineRect, -0.5 * lineWidth, -0.5 * lineWidth));
+    }];
+    CGContextRelease(measureContext);
+
+    XCTAssertFalse(CGRectIsNull(inkBounds), @"Should collect ink during layout.");
+    XCTAssertEqualWithAccuracy(CGRectGetMinX(inkBounds), CGRectGetMinX(drawnBounds), 0.01, @"Should match the drawn left edge.");
+    XCTAssertEqualWithAccuracy(CGRectGetMaxX(inkBounds), CGRectGetMaxX(drawnBounds), 0.01, @"Should match the drawn right edge.");
+    XCTAssertEqualWithAccuracy(CGRectGetMinY(inkBounds), CGRectGetMinY(drawnBounds), 0.01, @"Should match the drawn top edge.");
+    XCTAssertEqualWithAccuracy(CGRectGetMaxY(inkBounds), CGRectGetMaxY(drawnBounds), 0.01, @"Should match the drawn bottom edge.");
+}
+
+- (void)testPNGWriterRejectsEmptyBuffer
+{
+    XCTAssertNil([EQPNGWriter pngDataWithAlphaBuffer:NULL width:10 height:10 bytesPerRow:10 compressionLevel:6], @"Should return nil without a buffer.");
+    uint8_t testBuffer[4] = {0, 0, 0, 0};
+    XCTAssertNil([EQPNGWriter pngDataWithAlphaBuffer:testBuffer width:4 height:1 bytesPerRow:2 compressionLevel:6], @"Should reject short rows.");
+}
+
+- (void)testPNGWriterWritesFileDescriptor
+{
+    size_t testWidth = 300;
+    size_t testHeight = 200;
+    NSMutableData *testBuffer = [[NSMutableData alloc] initWithLength:testWidth * testHeight];
+    uint8_t *testBytes = testBuffer.mutableBytes;
+    for (size_t i = 0; i < testBuffer.length; i++)
+    {
+        testBytes[i] = (uint8_t)((i * 7919) & 0xFF);
+    }
+
+    NSString *testPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    int fileDescriptor = open(testPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    XCTAssertTrue(fileDescriptor >= 0, @"Should open the test file.");
+    BOOL didWrite = [EQPNGWriter writeAlphaBuffer:testBytes width:testWidth height:testHeight bytesPerRow:testWidth
+                                 compressionLevel:0 toFileDescriptor:fileDescriptor];
+    close(fileDescriptor);
+
+    NSData *fileData = [NSData dataWithContentsOfFile:testPath];
+    [[NSFileManager defaultManager] removeItemAtPath:testPath error:nil];
+    NSData *memoryData = [EQPNGWriter pngDataWithAlphaBuffer:testBytes width:testWidth height:testHeight bytesPerRow:testWidth compressionLevel:0];
+    XCTAssertTrue(didWrite, @"Should write to a file descriptor.");
+    XCTAssertEqualObjects(fileData, memoryData, @"Should write every byte to the file.");
+}
+
+- (void)testFrozenEquationRoundTrips
+{
+    EQRenderFrozenEquation *frozenEquation = [testEquation frozenEquation];
+    XCTAssertNotNil(frozenEquation, @"Should freeze a laid out equation.");
+    XCTAssertEqual(frozenEquation.glyphCount, (NSUInteger)3, @"Should store one glyph per character.");
+    XCTAssertTrue(CGRectEqualToRect(frozenEquation.inkBounds, [testEquation inkBounds]), @"Should keep the ink bounds.");
+
+    NSData *frozenData = [frozenEquation dataRepresentation];
+    EQRenderFrozenEquation *thawedEquation = [[EQRenderFrozenEquation alloc] initWithData:frozenData];
+    XCTAssertNotNil(thawedEquation, @"Should read its own data.");
+    XCTAssertEqual(thawedEquation.glyphRunCount, frozenEquation.glyphRunCount, @"Should keep the glyph runs.");
+    XCTAssertEqualObjects([thawedEquation dataRepresentation], frozenData, @"Should write the same data after reading it.");
+    XCTAssertNil([[EQRenderFrozenEquation alloc] initWithData:[frozenData subdataWithRange:NSMakeRange(0, frozenData.length - 1)]],
+                 @"Should reject truncated data.");
+}
+
+- (void)testFrozenEquationMatchesRenderEquation
+{
+    CGSize testSize = CGSizeMake(testEquation.drawSize.width + 60.0, testEquation.drawSize.height + 60.0);
+    EQRenderRasterizer *liveRasterizer = [[EQRenderRasterizer alloc] initWithRenderEquation:testEquation];
+    EQRenderRasterizer *frozenRasterizer = [[EQRenderRasterizer alloc] initWithFrozenEquation:[testEquation frozenEquation]];
+    liveRasterizer.pixelScale = 2.0;
+    frozenRasterizer.pixelScale = 2.0;
+
+    CGContextRef liveContext = [liveRasterizer createAlphaContextWithSize:testSize drawRect:CGRectZero];
+    CGContextRef frozenContext = [frozenRasterizer createAlphaContextWithSize:testSize drawRect:CGRectZero];
+    XCTAssertTrue(NULL != liveContext && NULL != frozenContext, @"Should create both contexts.");
+    if (NULL == liveContext || NULL == frozenContext)
+        return;
+
+    size_t byteCount = CGBitmapContextGetBytesPerRow(liveContext) * CGBitmapContextGetHeight(liveContext);
+    XCTAssertEqual(byteCount, CGBitmapContextGetBytesPerRow(frozenContext) * CGBitmapContextGetHeight(frozenContext), @"Should be the same size.");
+
+    // The frozen positions are stored as floats, so allow for a glyph landing in a different subpixel bucket.
+    const uint8_t *liveBytes = CGBitmapContextGetData(liveContext);
+    const uint8_t *frozenBytes = CGBitmapContextGetData(frozenContext);
+    double liveInk = 0.0;
+    double frozenInk = 0.0;
+    for (size_t i = 0; i < byteCount; i ++)
+    {
+        liveInk += liveBytes[i];
+        frozenInk += frozenBytes[i];
+    }
+    XCTAssertTrue(liveInk > 0.0, @"Should draw the glyphs.");
+    XCTAssertEqualWithAccuracy(frozenInk, liveInk, 0.01 * liveInk, @"Should draw the same ink from the frozen glyph runs.");
+    CGContextRelease(liveContext);
+    CGContextRelease(frozenContext);
+}
+
+
+- (void)testGlyphAtlasEvictsLeastRecentlyUsedMasks
+{
+    EQGlyphAtlas *testAtlas = [[EQGlyphAtlas alloc] init];
+    CTFontRef testFont = CTFontCreateWithName(CFSTR("Helvetica"), 20.0, NULL);
+    UniChar testChars[3] = {'x', 'y', 'z'};
+    CGGlyph testGlyphs[3];
+    CTFontGetGlyphsForCharacters(testFont, testChars, testGlyphs, 3);
+
+    CGImageRef firstMask = [testAtlas copyMaskForGlyph:testGlyphs[0] inFont:testFont pixelScale:1.0 subpixelOffset:0.0 originOffset:NULL];
+    XCTAssertTrue(NULL != firstMask, @"Should create a mask.");
+    NSUInteger oneMaskBytes = testAtlas.maskByteCount;
+    XCTAssertTrue(oneMaskBytes > 0, @"Should count the mask bytes.");
+
+    // Allow for roughly two masks, then touch the first so the second is the oldest.
+    testAtlas.maxMaskBytes = oneMaskBytes * 2 + oneMaskBytes / 2;
+    CGImageRelease([testAtlas copyMaskForGlyph:testGlyphs[1] inFont:testFont pixelScale:1.0 subpixelOffset:0.0 originOffset:NULL]);
+    CGImageRelease([testAtlas copyMaskForGlyph:testGlyphs[0] inFont:testFont pixelScale:1.0 subpixelOffset:0.0 originOffset:NULL]);
+    CGImageRelease([testAtlas copyMaskForGlyph:testGlyphs[2] inFont:testFont pixelScale:1.0 subpixelOffset:0.0 originOffset:NULL]);
+    XCTAssertTrue(testAtlas.maskByteCount <= testAtlas.maxMaskBytes, @"Should stay under the byte limit.");
+    XCTAssertTrue(testAtlas.maskCount < 3, @"Should evict a mask.");
+
+    CGImageRef reusedMask = [testAtlas copyMaskForGlyph:testGlyphs[0] inFont:testFont pixelScale:1.0 subpixelOffset:0.0 originOffset:NULL];
+    XCTAssertTrue(reusedMask == firstMask, @"Should keep the recently used mask.");
+    CGImageRelease(reusedMask);
+
+    // The returned mask is retained, so it outlives the atlas entry.
+    [testAtlas removeAllMasks];
+    XCTAssertEqual(testAtlas.maskCount, (NSUInteger)0, @"Should remove every mask.");
+    XCTAssertTrue(CGImageGetWidth(firstMask) > 0, @"Should still be able to use the returned mask.");
+    CGImageRelease(firstMask);
+    CFRelease(testFont);
+}
+
+@end
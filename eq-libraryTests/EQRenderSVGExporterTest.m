@@ -0,0 +1,78 @@
+//
+//  EQRenderSVGExporterTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "EQRenderSVGExporter.h"
+#import "EQRenderEquation.h"
+#import "EQRenderStem.h"
+#import "EQRenderData.h"
+
+@interface EQRenderSVGExporterTest : XCTestCase
+{
+    EQRenderEquation *testEquation;
+}
+
+@end
+
+@implementation EQRenderSVGExporterTest
+
+- (void)setUp
+{
+    [super setUp];
+    // Put setup code here; it will be run once, before the first test case.
+    EQRenderData *testData = [[EQRenderData alloc] initWithString:@"x+1"];
+    EQRenderStem *rootStem = [[EQRenderStem alloc] initWithObject:testData andStemType:stemTypeRoot];
+    rootStem.drawOrigin = CGPointMake(40.0, 40.0);
+    [rootStem layoutChildren];
+
+    testEquation = [[EQRenderEquation alloc] initWithEquationLines:@[@[testData]] andEquationStems:@[rootStem]];
+}
+
+- (void)tearDown
+{
+    // Put teardown code here; it will be run once, after the last test case.
+    [super tearDown];
+}
+
+- (void)testSVGStringWithEmptyEquation
+{
+    EQRenderEquation *emptyEquation = [[EQRenderEquation alloc] init];
+    XCTAssertNil([EQRenderSVGExporter svgStringWithRenderEquation:emptyEquation], @"Should return nil for an empty equation.");
+    XCTAssertNil([EQRenderSVGExporter svgStringWithRenderEquation:nil], @"Should return nil for a nil equation.");
+}
+
+- (void)testSVGStringWithGlyphPaths
+{
+    NSString *testString = nil;
+    XCTAssertNoThrow(testString = [EQRenderSVGExporter svgStringWithRenderEquation:testEquation], @"Should not throw without a graphics context.");
+    XCTAssertTrue([testString hasPrefix:@"<svg"], @"Should return an SVG document.");
+    XCTAssertTrue([testString rangeOfString:@"<defs>"].location != NSNotFound, @"Should store the glyphs in defs.");
+    XCTAssertTrue([testString rangeOfString:@"<use "].location != NSNotFound, @"Should reference the stored glyphs.");
+}
+
+- (void)testSVGStringWithText
+{
+    EQRenderSVGExporter *testExporter = [[EQRenderSVGExporter alloc] initWithRenderEquation:testEquation];
+    testExporter.useGlyphPaths = NO;
+    NSString *testString = [testExporter svgString];
+    XCTAssertTrue([testString rangeOfString:@"<text "].location != NSNotFound, @"Should write text elements.");
+    XCTAssertTrue([testString rangeOfString:@"x+1"].location != NSNotFound, @"Should include the equation text.");
+    XCTAssertTrue([testString rangeOfString:@"<defs>"].location == NSNotFound, @"Should not need defs for text.");
+}
+
+@end
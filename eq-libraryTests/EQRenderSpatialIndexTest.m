@@ -0,0 +1,95 @@
+//
+//  EQRenderSpatialIndexTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "EQRenderSpatialIndex.h"
+#import "EQRenderEquation.h"
+#import "EQRenderStem.h"
+#import "EQRenderData.h"
+
+@interface EQRenderSpatialIndexTest : XCTestCase
+{
+    EQRenderEquation *testEquation;
+    EQRenderData *testData;
+}
+
+@end
+
+@implementation EQRenderSpatialIndexTest
+
+- (void)setUp
+{
+    [super setUp];
+    // Put setup code here; it will be run once, before the first test case.
+    testData = [[EQRenderData alloc] initWithString:@"x+1"];
+    EQRenderStem *rootStem = [[EQRenderStem alloc] initWithObject:testData andStemType:stemTypeRoot];
+    rootStem.drawOrigin = CGPointMake(40.0, 40.0);
+    [rootStem layoutChildren];
+
+    testEquation = [[EQRenderEquation alloc] initWithEquationLines:@[@[testData]] andEquationStems:@[rootStem]];
+    [testEquation layoutEquationLines];
+}
+
+- (void)tearDown
+{
+    // Put teardown code here; it will be run once, after the last test case.
+    [super tearDown];
+}
+
+- (void)testThatSpatialIndexExists
+{
+    EQRenderSpatialIndex *testIndex = [testEquation spatialIndex];
+    XCTAssertNotNil(testIndex, @"Should build an index after layout.");
+    XCTAssertEqual(testIndex.lineCount, (NSUInteger)1, @"Should index every line.");
+    XCTAssertTrue([testEquation spatialIndex] == testIndex, @"Should reuse the index until the next layout.");
+
+    [testEquation layoutEquationLines];
+    XCTAssertFalse([testEquation spatialIndex] == testIndex, @"Should build a new index after layout.");
+}
+
+- (void)testCaretRectsRoundTrip
+{
+    EQRenderSpatialIndex *testIndex = [testEquation spatialIndex];
+    for (NSUInteger i = 0; i <= testData.renderString.length; i ++)
+    {
+        EQTextPosition *testPosition = [EQTextPosition textPositionWithIndex:i andLocation:0 andEquationLoc:0];
+        CGRect caretRect = [testIndex caretRectForPosition:testPosition];
+        XCTAssertFalse(CGRectIsNull(caretRect), @"Should find a caret for each index.");
+
+        CGPoint testPoint = CGPointMake(CGRectGetMinX(caretRect), CGRectGetMidY(caretRect));
+        EQTextPosition *foundPosition = [testIndex closestPositionToPoint:testPoint];
+        XCTAssertEqual(foundPosition.index, i, @"Should map the caret back to the same index.");
+        XCTAssertEqual(foundPosition.dataLoc, (NSUInteger)0, @"Should find the only render data.");
+    }
+
+    EQTextPosition *testPosition = [EQTextPosition textPositionWithIndex:0 andLocation:1 andEquationLoc:0];
+    XCTAssertTrue(CGRectIsNull([testIndex caretRectForPosition:testPosition]), @"Should return a null rect outside of the index.");
+}
+
+- (void)testPointsOutsideUseClosestPosition
+{
+    EQRenderSpatialIndex *testIndex = [testEquation spatialIndex];
+    CGRect dataBounds = [testIndex boundsForDataAtLocation:0 equationLoc:0];
+    EQTextPosition *leftPosition = [testIndex closestPositionToPoint:CGPointMake(CGRectGetMinX(dataBounds) - 100.0, CGRectGetMinY(dataBounds) - 100.0)];
+    XCTAssertEqual(leftPosition.index, (NSUInteger)0, @"Should use the start of the data.");
+
+    EQTextPosition *rightPosition = [testIndex closestPositionToPoint:CGPointMake(CGRectGetMaxX(dataBounds) + 100.0, CGRectGetMaxY(dataBounds) + 100.0)];
+    XCTAssertEqual(rightPosition.index, testData.renderString.length, @"Should use the end of the data.");
+}
+
+@end
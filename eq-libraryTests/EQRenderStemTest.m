@@ -22,6 +22,16 @@
 #import "EQRenderData.h"
 #import "EQRenderFracStem.h"
 #import "EQRenderMatrixStem.h"
+#import "EQRenderLayout.h"
+#import "EQRenderTypesetter.h"
+#import "EQTextRange.h"
+
+// Exposes the pair sizing so it can be compared with the nested scan it replaced.
+@interface EQRenderStem (StretchyPairTesting)
+
+- (NSArray *)sizedPairsForStretchyCharacters: (NSArray *)foundStretchyCharacters;
+
+@end
 
 @interface EQRenderStemTest : XCTestCase
 {
@@ -1544,4 +1554,347 @@
 }
 
 
+- (void)testCountDescendentsUpToLimit
+{
+    XCTAssertTrue([testStem respondsToSelector:@selector(countDescendentsUpToLimit:)], @"Should respond to method call.");
+    XCTAssertTrue([testStem countDescendentsUpToLimit:100] == 0, @"Should have no descendents when empty.");
+
+    EQRenderMatrixStem *testMatrixStem = [[EQRenderMatrixStem alloc] initWithStoredCharacterData:@"3x3"];
+    // Three rows, nine cells and nine renderData.
+    XCTAssertTrue([testMatrixStem countDescendentsUpToLimit:100] == 21, @"Should count every descendent.");
+    XCTAssertTrue([testMatrixStem countDescendentsUpToLimit:5] == 5, @"Should stop counting at the limit.");
+}
+
+- (void)testParallelLayoutMatchesSequentialLayout
+{
+    EQRenderMatrixStem *sequentialStem = [[EQRenderMatrixStem alloc] initWithStoredCharacterData:@"4x4"];
+    [sequentialStem layoutChildren];
+
+    BOOL storedUsesParallel = [EQRenderStem usesParallelLayout];
+    NSUInteger storedThreshold = [EQRenderStem parallelLayoutThreshold];
+    [EQRenderStem setUsesParallelLayout:YES];
+    [EQRenderStem setParallelLayoutThreshold:1];
+
+    EQRenderMatrixStem *parallelStem = [[EQRenderMatrixStem alloc] initWithStoredCharacterData:@"4x4"];
+    XCTAssertNoThrow([parallelStem layoutChildren], @"Should not throw during parallel layout.");
+
+    [EQRenderStem setUsesParallelLayout:storedUsesParallel];
+    [EQRenderStem setParallelLayoutThreshold:storedThreshold];
+
+    XCTAssertTrue(CGSizeEqualToSize(sequentialStem.drawSize, parallelStem.drawSize), @"Should produce the same size.");
+    EQRenderData *sequentialData = [sequentialStem getFirstCellObj];
+    EQRenderData *parallelData = [parallelStem getFirstCellObj];
+    XCTAssertTrue(CGPointEqualToPoint(sequentialData.drawOrigin, parallelData.drawOrigin), @"Should produce the same origins.");
+}
+
+
+// Collects the stretchy characters in the same way as layoutRowStem.
+- (NSArray *)stretchyRangesForRowStem: (EQRenderStem *)rowStem
+{
+    NSSet *stretchyBracers = [EQRenderTypesetter getStretchyBracerCharacters];
+    NSMutableArray *foundRanges = [[NSMutableArray alloc] init];
+    for (NSUInteger childLoc = 0; childLoc < rowStem.renderArray.count; childLoc ++)
+    {
+        id childObj = rowStem.renderArray[childLoc];
+        if ([childObj isKindOfClass:[EQRenderData class]])
+        {
+            NSString *childStr = [(EQRenderData *)childObj renderString].string;
+            [childStr enumerateSubstringsInRange:NSMakeRange(0, childStr.length) options:NSStringEnumerationByComposedCharacterSequences
+                                      usingBlock:^(NSString *substring, NSRange substringRange, NSRange enclosingRange, BOOL *stop)
+            {
+                if ([stretchyBracers containsObject:substring])
+                {
+                    [foundRanges addObject:[EQTextRange textRangeWithRange:substringRange andLocation:childLoc andEquationLoc:0]];
+                }
+            }];
+        }
+        else if ([childObj isKindOfClass:[EQRenderStem class]])
+        {
+            NSString *bracerStr = [(EQRenderStem *)childObj nestedStretchyBracerCheck];
+            if (nil != bracerStr)
+            {
+                [foundRanges addObject:[EQTextRange textRangeWithRange:NSMakeRange(0, bracerStr.length) andLocation:childLoc andEquationLoc:0]];
+            }
+        }
+    }
+    return foundRanges;
+}
+
+// The pairing and sizing rules from before the single pass.
+// Pairs are bucketed by the location of the left bracer and the children between them are scanned for each pair.
+- (NSArray *)referenceSizedPairsForRowStem: (EQRenderStem *)rowStem stretchyRanges: (NSArray *)foundRanges
+{
+    NSSet *leftStretchyChars = [EQRenderTypesetter getLeftStretchyBracerCharacters];
+    NSSet *rightStretchyChars = [EQRenderTypesetter getRightStretchyBracerCharacters];
+    NSSet *verticalStretchyChars = [EQRenderTypesetter getVerticalStretchyBracerCharacters];
+
+    NSMutableArray *matchedBuckets = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < rowStem.renderArray.count; i ++)
+    {
+        [matchedBuckets addObject:[[NSMutableArray alloc] init]];
+    }
+
+    NSMutableArray *leftStack = [[NSMutableArray alloc] init];
+    EQTextRange *currentLeft = nil;
+    EQTextRange *currentVertical = nil;
+    for (EQTextRange *charRange in foundRanges)
+    {
+        id renderObj = rowStem.renderArray[charRange.dataLoc];
+        NSString *stretchyChar = nil;
+        if ([renderObj isKindOfClass:[EQRenderData class]])
+        {
+            stretchyChar = [[(EQRenderData *)renderObj renderString].string substringWithRange:charRange.range];
+        }
+        else
+        {
+            stretchyChar = [(EQRenderStem *)renderObj nestedStretchyBracerCheck];
+        }
+
+        if ([leftStretchyChars containsObject:stretchyChar])
+        {
+            if (nil != currentLeft)
+            {
+                [leftStack addObject:currentLeft];
+            }
+            currentLeft = charRange;
+        }
+        else if ([rightStretchyChars containsObject:stretchyChar] && nil != currentLeft)
+        {
+            [matchedBuckets[currentLeft.dataLoc] addObject:@[currentLeft, charRange]];
+            currentLeft = leftStack.lastObject;
+            if (leftStack.count > 0)
+            {
+                [leftStack removeLastObject];
+            }
+        }
+        else if ([verticalStretchyChars containsObject:stretchyChar])
+        {
+            if (nil == currentVertical)
+            {
+                currentVertical = charRange;
+            }
+            else
+            {
+                [matchedBuckets[currentVertical.dataLoc] addObject:@[currentVertical, charRange]];
+                currentVertical = nil;
+            }
+        }
+    }
+
+    NSMutableArray *sizedPairs = [[NSMutableArray alloc] init];
+    for (NSArray *matchedPairs in matchedBuckets)
+    {
+        for (NSArray *matchedPair in matchedPairs)
+        {
+            EQTextRange *leftLoc = matchedPair[0];
+            EQTextRange *rightLoc = matchedPair[1];
+            CGFloat useHeight = 0.0;
+            BOOL containsDescenderData = NO;
+            CGPoint useDescenderOrigin = CGPointZero;
+
+            for (NSUInteger testLoc = leftLoc.dataLoc; testLoc < rightLoc.dataLoc; testLoc ++)
+            {
+                id renderObj = rowStem.renderArray[testLoc];
+                if ([renderObj isKindOfClass:[EQRenderStem class]])
+                {
+                    EQRenderStem *renderStem = (EQRenderStem *)renderObj;
+                    CGFloat testHeight = renderStem.drawSize.height;
+                    BOOL testSupHeight = (renderStem.stemType == stemTypeSup || renderStem.stemType == stemTypeSub || renderStem.stemType == stemTypeSubSup)
+                                         && [renderStem hasOnlyRenderDataChildren];
+                    if ([renderStem isStemWithDescender])
+                    {
+                        CGPoint testDescenderOrigin = [EQRenderLayout findLowestChildOrigin:renderStem];
+                        if (![renderStem isKindOfClass:[EQRenderMatrixStem class]])
+                        {
+                            CGFloat heightAdjust = testDescenderOrigin.y - renderStem.drawOrigin.y;
+                            testHeight += heightAdjust * 0.3333;
+                            testDescenderOrigin.y -= heightAdjust * 0.3333;
+                            if (renderStem.stemType == stemTypeFraction || renderStem.isBinomialStemType)
+                            {
+                                testDescenderOrigin.y += 3.0;
+                                testHeight += 6.0;
+                            }
+                        }
+
+                        if (containsDescenderData == NO || useDescenderOrigin.y < testDescenderOrigin.y)
+                        {
+                            containsDescenderData = YES;
+                            useDescenderOrigin = testDescenderOrigin;
+                        }
+                    }
+                    else if (testSupHeight == YES)
+                    {
+                        EQRenderData *testChildData = renderStem.getFirstChild;
+                        useHeight = MAX(useHeight, testChildData.imageBounds.size.height);
+                        continue;
+                    }
+                    useHeight = MAX(useHeight, testHeight);
+                }
+                else if ([renderObj isKindOfClass:[EQRenderData class]])
+                {
+                    EQRenderData *renderData = (EQRenderData *)renderObj;
+                    if (testLoc == leftLoc.dataLoc)
+                    {
+                        NSInteger subStrLoc = leftLoc.range.location + leftLoc.range.length;
+                        NSInteger subStrLength = renderData.renderString.length - subStrLoc;
+                        if (subStrLength > 0)
+                        {
+                            NSAttributedString *subStr = [renderData.renderString attributedSubstringFromRange:NSMakeRange(subStrLoc, subStrLength)];
+                            renderData = [[EQRenderData alloc] initWithAttributedString:subStr];
+                        }
+                    }
+                    useHeight = MAX(useHeight, renderData.imageBounds.size.height);
+                }
+            }
+
+            if (useHeight > 0)
+            {
+                NSArray *storedPairData = @[@(useHeight), @(containsDescenderData), [NSValue valueWithCGPoint:useDescenderOrigin]];
+                [sizedPairs addObject:@[matchedPair, storedPairData]];
+            }
+        }
+    }
+    return sizedPairs;
+}
+
+- (void)assertSizedPairsForRowStem: (EQRenderStem *)rowStem matchReferenceWithMessage: (NSString *)message
+{
+    NSArray *foundRanges = [self stretchyRangesForRowStem:rowStem];
+    if (foundRanges.count == 0)
+        return;
+
+    NSArray *referencePairs = [self referenceSizedPairsForRowStem:rowStem stretchyRanges:foundRanges];
+    NSArray *testPairs = [rowStem sizedPairsForStretchyCharacters:foundRanges];
+    XCTAssertEqual(testPairs.count, referencePairs.count, @"%@: Should size the same pairs.", message);
+    if (testPairs.count != referencePairs.count)
+        return;
+
+    for (NSUInteger i = 0; i < testPairs.count; i ++)
+    {
+        NSArray *testLocs = testPairs[i][0];
+        NSArray *referenceLocs = referencePairs[i][0];
+        for (NSUInteger j = 0; j < 2; j ++)
+        {
+            EQTextRange *testRange = testLocs[j];
+            EQTextRange *referenceRange = referenceLocs[j];
+            XCTAssertEqual(testRange.dataLoc, referenceRange.dataLoc, @"%@: Pair %lu should match the same bracers.", message, (unsigned long)i);
+            XCTAssertTrue(NSEqualRanges(testRange.range, referenceRange.range), @"%@: Pair %lu should match the same bracers.", message, (unsigned long)i);
+        }
+
+        NSArray *testData = testPairs[i][1];
+        NSArray *referenceData = referencePairs[i][1];
+        XCTAssertEqualWithAccuracy([testData[0] floatValue], [referenceData[0] floatValue], 0.001, @"%@: Pair %lu should have the same height.", message, (unsigned long)i);
+        XCTAssertEqual([testData[1] boolValue], [referenceData[1] boolValue], @"%@: Pair %lu should have the same descender flag.", message, (unsigned long)i);
+        CGPoint testPoint = [testData[2] CGPointValue];
+        CGPoint referencePoint = [referenceData[2] CGPointValue];
+        XCTAssertEqualWithAccuracy(testPoint.x, referencePoint.x, 0.001, @"%@: Pair %lu should have the same descender point.", message, (unsigned long)i);
+        XCTAssertEqualWithAccuracy(testPoint.y, referencePoint.y, 0.001, @"%@: Pair %lu should have the same descender point.", message, (unsigned long)i);
+    }
+}
+
+- (EQRenderFracStem *)testFractionWithNumerator: (NSString *)numeratorStr denominator: (NSString *)denominatorStr
+{
+    EQRenderFracStem *testFrac = [[EQRenderFracStem alloc] init];
+    [testFrac appendChild:[[EQRenderData alloc] initWithString:numeratorStr]];
+    [testFrac appendChild:[[EQRenderData alloc] initWithString:denominatorStr]];
+    return testFrac;
+}
+
+- (void)testNestedStretchyBracers
+{
+    // Each bracer pair should be sized from the fraction inside, however deeply it is nested.
+    EQRenderFracStem *testFrac = [self testFractionWithNumerator:@"x" denominator:@"y"];
+
+    NSArray *leftStrings = @[@"(", @"[", @"{"];
+    NSArray *rightStrings = @[@"}", @"]", @")"];
+    NSMutableArray *leftData = [[NSMutableArray alloc] init];
+    testStem.stemType = stemTypeRoot;
+    testStem.drawOrigin = CGPointMake(40.0, 40.0);
+    for (NSString *leftString in leftStrings)
+    {
+        EQRenderData *bracerData = [[EQRenderData alloc] initWithString:leftString];
+        [leftData addObject:bracerData];
+        [testStem appendChild:bracerData];
+    }
+    [testStem appendChild:testFrac];
+    for (NSString *rightString in rightStrings)
+    {
+        [testStem appendChild:[[EQRenderData alloc] initWithString:rightString]];
+    }
+
+    XCTAssertNoThrow([testStem layoutChildren], @"Should lay out nested bracers.");
+    for (EQRenderData *bracerData in leftData)
+    {
+        XCTAssertTrue(bracerData.hasStretchyCharacterData, @"Should stretch every bracer around the fraction.");
+    }
+
+    NSArray *foundRanges = [self stretchyRangesForRowStem:testStem];
+    NSArray *sizedPairs = [testStem sizedPairsForStretchyCharacters:foundRanges];
+    XCTAssertEqual(sizedPairs.count, (NSUInteger)3, @"Should size every pair.");
+    for (NSArray *sizedPair in sizedPairs)
+    {
+        NSArray *pairData = sizedPair[1];
+        XCTAssertTrue([pairData[0] floatValue] >= testFrac.drawSize.height, @"Should be at least as tall as the fraction.");
+        XCTAssertTrue([pairData[1] boolValue], @"Should center on the fraction's descender.");
+    }
+    [self assertSizedPairsForRowStem:testStem matchReferenceWithMessage:@"Nested bracers"];
+}
+
+// Builds random rows of bracers, text, fractions, scripts with bracer bases and nested rows,
+// and checks the single pass against the nested scan it replaced.
+- (void)testStretchyPairsMatchNestedScan
+{
+    NSArray *dataStrings = @[@"(", @"[", @"{", @")", @"]", @"}", @"|", @"x", @"y+1", @"(x", @"a)", @"|b|", @"[(q", @"p)]", @"g"];
+    NSArray *baseStrings = @[@"(", @")", @"[", @"]", @"|", @"x"];
+    srand48(41);
+
+    for (NSUInteger trial = 0; trial < 300; trial ++)
+    {
+        EQRenderStem *rowStem = [[EQRenderStem alloc] init];
+        rowStem.stemType = stemTypeRoot;
+        rowStem.drawOrigin = CGPointMake(40.0, 40.0);
+
+        NSUInteger childCount = 1 + (NSUInteger)(drand48() * 10);
+        for (NSUInteger i = 0; i < childCount; i ++)
+        {
+            double childChoice = drand48();
+            if (childChoice < 0.5)
+            {
+                NSString *dataStr = dataStrings[(NSUInteger)(drand48() * dataStrings.count)];
+                [rowStem appendChild:[[EQRenderData alloc] initWithString:dataStr]];
+            }
+            else if (childChoice < 0.7)
+            {
+                EQRenderFracStem *testFrac = [self testFractionWithNumerator:@"x" denominator:(drand48() < 0.5 ? @"y" : @"a+b")];
+                if (drand48() < 0.3)
+                {
+                    [testFrac setChild:[self testFractionWithNumerator:@"1" denominator:@"2"] atLoc:1];
+                }
+                [rowStem appendChild:testFrac];
+            }
+            else if (childChoice < 0.9)
+            {
+                EQRenderStem *scriptStem = [[EQRenderStem alloc] init];
+                scriptStem.stemType = (drand48() < 0.5) ? stemTypeSup : stemTypeSub;
+                NSString *baseStr = baseStrings[(NSUInteger)(drand48() * baseStrings.count)];
+                [scriptStem appendChild:[[EQRenderData alloc] initWithString:baseStr]];
+                [scriptStem appendChild:[[EQRenderData alloc] initWithString:@"2"]];
+                [rowStem appendChild:scriptStem];
+            }
+            else
+            {
+                EQRenderStem *innerRow = [[EQRenderStem alloc] init];
+                innerRow.stemType = stemTypeRow;
+                [innerRow appendChild:[[EQRenderData alloc] initWithString:@"("]];
+                [innerRow appendChild:[self testFractionWithNumerator:@"u" denominator:@"v"]];
+                [innerRow appendChild:[[EQRenderData alloc] initWithString:@")"]];
+                [rowStem appendChild:innerRow];
+            }
+        }
+
+        XCTAssertNoThrow([rowStem layoutChildren], @"Trial %lu: Should lay out the row.", (unsigned long)trial);
+        [self assertSizedPairsForRowStem:rowStem matchReferenceWithMessage:[NSString stringWithFormat:@"Trial %lu", (unsigned long)trial]];
+    }
+}
+
 @end
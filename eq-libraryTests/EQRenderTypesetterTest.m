@@ -20,6 +20,9 @@
 #import <XCTest/XCTest.h>
 #import "EQRenderTypesetter.h"
 #import "MockEquationViewDataSource.h"
+#import "EquationViewDataSource.h"
+#import "EQRenderData.h"
+#import "EQRenderFontDictionary.h"
 
 @interface EQRenderTypesetterTest : XCTestCase
 {
@@ -310,6 +313,61 @@
     XCTAssertTrue([testDelegate functionCallsForKey:@"sendFinishedUpdating"] == 1, @"Should call sendFinishedUpdating.");
 }
 
+// Tests that a run of tokens only finishes updating once.
+- (void) testTypesetterAddTokensMethod
+{
+    XCTAssertTrue([testTypesetter respondsToSelector:@selector(addTokens:)], @"Object should respond to addTokens:");
+    testTypesetter.typesetterDelegate = testDelegate;
+    XCTAssertNoThrow([testTypesetter addTokens:nil], @"Should not throw when adding nil tokens.");
+    XCTAssertNoThrow([testTypesetter addTokens:@[]], @"Should not throw when adding empty tokens.");
+    XCTAssertTrue([testDelegate functionCallsForKey:@"getRenderData"] == 0, @"Should not call getRenderData with no tokens.");
+    XCTAssertTrue([testDelegate functionCallsForKey:@"sendFinishedUpdating"] == 0, @"Should not call sendFinishedUpdating with no tokens.");
+
+    XCTAssertNoThrow([testTypesetter addTokens:@[@"x", @"+", @"1"]], @"Should not throw when adding valid tokens.");
+    XCTAssertTrue([testDelegate functionCallsForKey:@"sendFinishedUpdating"] == 1, @"Should call sendFinishedUpdating once per batch.");
+}
+
+// Tests that a run of tokens gives the same strings and styles as adding them one at a time.
+- (void) testTypesetterAddTokensMatchesAddData
+{
+    NSArray *testRuns = @[@[@"s", @"i", @"n", @"x", @"-", @"1"],
+                          @[@"-", @"x", @"*", @"y", @" ", @"c", @"o", @"s", @"y", @"+", @"l", @"o", @"g", @"2"],
+                          @[@"a", @"=", @"b", @"^", @"2", @"+", @"c"]];
+    for (NSArray *testTokens in testRuns)
+    {
+        EquationViewDataSource *addDataSource = [[EquationViewDataSource alloc] init];
+        [addDataSource sendEditingWillBegin];
+        for (NSString *token in testTokens)
+        {
+            [addDataSource addData:token];
+        }
+
+        EquationViewDataSource *addTokensSource = [[EquationViewDataSource alloc] init];
+        [addTokensSource sendEditingWillBegin];
+        [addTokensSource.typesetter addTokens:testTokens];
+
+        NSArray *addDataLines = [addDataSource buildRenderEquation].equationLines;
+        NSArray *addTokensLines = [addTokensSource buildRenderEquation].equationLines;
+        XCTAssertEqual(addDataLines.count, addTokensLines.count, @"Should add the same lines for %@.", testTokens);
+        for (NSUInteger lineLoc = 0; lineLoc < MIN(addDataLines.count, addTokensLines.count); lineLoc ++)
+        {
+            NSArray *addDataLine = addDataLines[lineLoc];
+            NSArray *addTokensLine = addTokensLines[lineLoc];
+            XCTAssertEqual(addDataLine.count, addTokensLine.count, @"Should add the same data for %@.", testTokens);
+            for (NSUInteger dataLoc = 0; dataLoc < MIN(addDataLine.count, addTokensLine.count); dataLoc ++)
+            {
+                NSAttributedString *addDataStr = [(EQRenderData *)addDataLine[dataLoc] renderString];
+                NSAttributedString *addTokensStr = [(EQRenderData *)addTokensLine[dataLoc] renderString];
+                XCTAssertEqualObjects(addTokensStr.string, addDataStr.string, @"Should parse %@ in the same way.", testTokens);
+                XCTAssertTrue([addTokensStr isEqualToAttributedString:addDataStr], @"Should style and kern %@ in the same way.", testTokens);
+            }
+        }
+
+        [addDataSource sendEditingWillEnd];
+        [addTokensSource sendEditingWillEnd];
+    }
+}
+
 // Tests when it calls the delegate and when it throws. It doesn't test the output of the data.
 - (void) testTypesetterReplaceDataMethod
 {
@@ -403,6 +461,29 @@
     XCTAssertNoThrow([testTypesetter kernMathInAttributedString:[[NSMutableAttributedString alloc]init]], @"Should not throw for empty data.");
 }
 
+// Kerning only the edited range should give the same result as kerning the whole string.
+- (void) testKernMathEditedRange
+{
+    NSDictionary *testAttributes = [EQRenderFontDictionary defaultItalicFontDictionaryWithSize:kDEFAULT_FONT_SIZE];
+    NSArray *testStrings = @[@"3.14 + 2x", @"f(x) = 1,000.5dx", @"a − (b + c)", @"dy/dx"];
+    for (NSString *testString in testStrings)
+    {
+        NSMutableAttributedString *fullString = [[NSMutableAttributedString alloc] initWithString:testString attributes:testAttributes];
+        [testTypesetter kernMathInAttributedString:fullString];
+
+        // Build the string one character at a time, kerning only the new character.
+        NSMutableAttributedString *editedString = [[NSMutableAttributedString alloc] init];
+        for (NSUInteger i = 0; i < testString.length; i ++)
+        {
+            NSAttributedString *nextChar = [[NSAttributedString alloc] initWithString:[testString substringWithRange:NSMakeRange(i, 1)]
+                                                                           attributes:testAttributes];
+            [editedString appendAttributedString:nextChar];
+            [testTypesetter kernMathInAttributedString:editedString editedRange:NSMakeRange(i, 1)];
+        }
+        XCTAssertEqualObjects(editedString, fullString, @"Incremental kerning should match full kerning for %@.", testString);
+    }
+}
+
 // Doesn't test output, just tests responses to bad input.
 - (void) testParseTextForOperationMethod
 {
@@ -488,4 +569,21 @@
     XCTAssertNoThrow([testTypesetter applyStyleToSelection:nil], @"Should not throw with nil input data.");
 }
 
+- (void) testSharedStyleAttributes
+{
+    NSDictionary *firstDict = [EQRenderFontDictionary fontDictWithName:kDEFAULT_FONT size:kDEFAULT_FONT_SIZE kernValue:0.0];
+    NSDictionary *secondDict = [EQRenderFontDictionary fontDictWithName:kDEFAULT_FONT size:kDEFAULT_FONT_SIZE kernValue:0.0];
+    XCTAssertTrue(firstDict == secondDict, @"Equal font dictionaries should be shared.");
+
+    NSDictionary *builtDict = @{NSFontAttributeName: firstDict[NSFontAttributeName], NSKernAttributeName: @(0.0)};
+    XCTAssertTrue([EQRenderFontDictionary sharedAttributes:builtDict] == firstDict, @"Built dictionaries should map to the shared copy.");
+
+    NSDictionary *sumOpDict = [EQRenderFontDictionary sumOpFontDictWithName:kDEFAULT_FONT size:kDEFAULT_FONT_SIZE kernValue:0.0];
+    XCTAssertFalse(sumOpDict == firstDict, @"Different flags should not be shared.");
+
+    NSMutableAttributedString *testString = [[NSMutableAttributedString alloc] initWithString:@"x+y" attributes:builtDict];
+    [EQRenderFontDictionary addAttributes:@{NSKernAttributeName: @(0.0)} toAttributedString:testString range:NSMakeRange(0, 3)];
+    XCTAssertTrue([testString attributesAtIndex:2 effectiveRange:NULL] == firstDict, @"Styled runs should use the shared copy.");
+}
+
 @end
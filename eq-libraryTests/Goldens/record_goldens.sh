@@ -0,0 +1,78 @@
+#!/bin/sh
+#
+# Records the geometry goldens from the layout of an older commit, so the current layout can be checked against it.
+#
+# Usage: record_goldens.sh <baseline-commit>
+#
+# The baseline is checked out in a temporary worktree. The golden test and EQRenderGeometryDump are copied into it
+# from this tree and added to its test target, so only the layout code comes from the baseline. The test runs with
+# EQ_RECORD_GEOMETRY_GOLDENS set and writes the JSON files into this directory. Check them in once they have been written.
+#
+# Set EQ_GOLDEN_DESTINATION to pick the simulator, for example "platform=iOS Simulator,name=iPhone 8".
+
+set -e
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <baseline-commit>" >&2
+    exit 2
+fi
+
+GOLDEN_DIR=$(cd "$(dirname "$0")" && pwd)
+REPO_DIR=$(git -C "$GOLDEN_DIR" rev-parse --show-toplevel)
+WORKTREE_DIR=$(mktemp -d "${TMPDIR:-/tmp}/eq-goldens.XXXXXX")
+DESTINATION=${EQ_GOLDEN_DESTINATION:-"platform=iOS Simulator,name=iPhone 8"}
+PROJECT_FILE=eq-library.xcodeproj/project.pbxproj
+HARNESS_FILES="eq-libraryTests/EQRenderGeometryGoldenTest.m eq-libraryTests/EQRenderGeometryDump.h eq-libraryTests/EQRenderGeometryDump.m"
+
+# Project entries for the harness files, matched by the object IDs they have in this tree.
+HARNESS_BUILD_FILES="A4EF25F6FE2E9FA916B15BB2|22F0DAEADB290616595EAC74"
+HARNESS_FILE_REFS="5EA0A2E3C6C5C88B0D20D91C|74519577924A5380AA7B49EB|38F30005F8CA4C2FDC5EDED7"
+
+# The harness entries go after the MockEquationViewDataSource ones, which the baseline project already has.
+MOCK_BUILD_FILE="7179A7A31ABBD70900D6DD14"
+MOCK_FILE_REF="7179A79A1ABBD70900D6DD14"
+
+cleanup()
+{
+    git -C "$REPO_DIR" worktree remove --force "$WORKTREE_DIR" >/dev/null 2>&1 || true
+}
+trap cleanup EXIT
+
+git -C "$REPO_DIR" worktree add --detach "$WORKTREE_DIR" "$1"
+
+for HARNESS_FILE in $HARNESS_FILES; do
+    cp "$REPO_DIR/$HARNESS_FILE" "$WORKTREE_DIR/$HARNESS_FILE"
+done
+
+# Each section of the project file has one anchor line, so the matching harness lines are inserted after it in order:
+# build files, file references, group children, then the sources build phase.
+grep -E "^[[:space:]]*($HARNESS_BUILD_FILES) /\* .* \*/ = \{isa = PBXBuildFile" "$REPO_DIR/$PROJECT_FILE" > "$WORKTREE_DIR/build_files.txt"
+grep -E "^[[:space:]]*($HARNESS_FILE_REFS) /\* .* \*/ = \{isa = PBXFileReference" "$REPO_DIR/$PROJECT_FILE" > "$WORKTREE_DIR/file_refs.txt"
+grep -E "^[[:space:]]*($HARNESS_FILE_REFS) /\* [^*]* \*/,$" "$REPO_DIR/$PROJECT_FILE" > "$WORKTREE_DIR/group_children.txt"
+grep -E "^[[:space:]]*($HARNESS_BUILD_FILES) /\* [^*]* \*/,$" "$REPO_DIR/$PROJECT_FILE" > "$WORKTREE_DIR/sources.txt"
+
+awk -v dir="$WORKTREE_DIR" -v mockBuildFile="$MOCK_BUILD_FILE" -v mockFileRef="$MOCK_FILE_REF" '
+function insert(name,    line)
+{
+    while ((getline line < (dir "/" name)) > 0)
+    {
+        print line
+    }
+    close(dir "/" name)
+}
+{
+    print
+    if (index($0, mockBuildFile " /*") && index($0, "isa = PBXBuildFile")) insert("build_files.txt")
+    else if (index($0, mockFileRef " /*") && index($0, "isa = PBXFileReference")) insert("file_refs.txt")
+    else if (index($0, mockFileRef " /*") && $0 ~ /\*\/,$/) insert("group_children.txt")
+    else if (index($0, mockBuildFile " /*") && $0 ~ /\*\/,$/) insert("sources.txt")
+}' "$WORKTREE_DIR/$PROJECT_FILE" > "$WORKTREE_DIR/project.pbxproj.new"
+mv "$WORKTREE_DIR/project.pbxproj.new" "$WORKTREE_DIR/$PROJECT_FILE"
+
+# Variables starting with TEST_RUNNER_ are passed to the test process without the prefix.
+cd "$WORKTREE_DIR"
+TEST_RUNNER_EQ_RECORD_GEOMETRY_GOLDENS=1 TEST_RUNNER_EQ_GEOMETRY_GOLDEN_DIR="$GOLDEN_DIR" \
+    xcodebuild test -project eq-library.xcodeproj -scheme eq-library -destination "$DESTINATION" \
+    -only-testing:eq-libraryTests/EQRenderGeometryGoldenTest/testGeometryMatchesGoldens
+
+ls "$GOLDEN_DIR"/*.json
@@ -0,0 +1,139 @@
+//
+//  RenderMathWorkerTest.m
+//  eq-library
+//
+//  Created by Raymond Hodgson on 10/19/26.
+//  Copyright (c) 2014-2015 Raymond Hodgson. All rights reserved.
+/*
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * Neither the names of the authors nor the names of their affiliation may be used to endorse or promote products derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#import <XCTest/XCTest.h>
+#import "RenderMathWorker.h"
+
+@interface RenderMathWorkerTest : XCTestCase
+{
+    NSString *testMathML;
+}
+
+@end
+
+@implementation RenderMathWorkerTest
+
+- (void)setUp
+{
+    [super setUp];
+    testMathML = @"<math><mrow><mi>x</mi><mo>+</mo><mn>1</mn></mrow></math>";
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+- (void)testShouldRunWithArguments
+{
+    char *appArguments[] = {"eq-library", NULL};
+    char *workerArguments[] = {"eq-library", "--render-worker", NULL};
+    XCTAssertFalse([RenderMathWorker shouldRunWithArgc:1 argv:appArguments], @"Should launch the app by default.");
+    XCTAssertTrue([RenderMathWorker shouldRunWithArgc:2 argv:workerArguments], @"Should run the worker when asked.");
+}
+
+- (void)testHandleRequest
+{
+    RenderMathWorker *testWorker = [[RenderMathWorker alloc] initWithInputFile:NULL outputFile:NULL];
+    NSData *resultData = nil;
+    NSDictionary *response = [testWorker handleRequest:@{@"id": @"eq1", @"math": testMathML, @"format": @"svg"} resultData:&resultData];
+
+    XCTAssertEqualObjects(response[@"id"], @"eq1", @"Should echo the request id.");
+    XCTAssertEqualObjects(response[@"status"], @"ok", @"Should render the request.");
+    XCTAssertNotNil(resultData, @"Should return the result without an output path.");
+    XCTAssertEqualObjects(response[@"length"], @(resultData.length), @"Should report the result length.");
+    XCTAssertNotNil(response[@"timings"][@"render"], @"Should report the render time.");
+
+    resultData = nil;
+    response = [testWorker handleRequest:@{@"math": @""} resultData:&resultData];
+    XCTAssertEqualObjects(response[@"status"], @"error", @"Should refuse empty math.");
+    XCTAssertNil(resultData, @"Should not return a result for an error.");
+}
+
+// Runs a worker over the input bytes and returns what it wrote.
+- (NSData *)outputOfWorkerWithInput: (NSData *)inputData framing: (RenderMathWorkerFraming)framing exitStatus: (int *)exitStatus
+{
+    NSString *requestPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"RenderMathWorkerTest.txt"];
+    [inputData writeToFile:requestPath atomically:YES];
+    FILE *inputFile = fopen(requestPath.fileSystemRepresentation, "r");
+    FILE *outputFile = tmpfile();
+
+    RenderMathWorker *testWorker = [[RenderMathWorker alloc] initWithInputFile:inputFile outputFile:outputFile];
+    testWorker.framing = framing;
+    *exitStatus = [testWorker run];
+
+    long outputLength = ftell(outputFile);
+    NSMutableData *outputData = [[NSMutableData alloc] initWithLength:(NSUInteger)outputLength];
+    rewind(outputFile);
+    fread(outputData.mutableBytes, 1, (size_t)outputLength, outputFile);
+    fclose(inputFile);
+    fclose(outputFile);
+    return outputData;
+}
+
+- (void)testRunWithLines
+{
+    NSString *requestString = [NSString stringWithFormat:@"{\"id\": \"a\", \"math\": \"%@\", \"format\": \"pdf\"}\n\n%@\n", testMathML, testMathML];
+    int exitStatus = -1;
+    NSData *outputData = [self outputOfWorkerWithInput:[requestString dataUsingEncoding:NSUTF8StringEncoding] framing:workerFramingLines exitStatus:&exitStatus];
+    XCTAssertEqual(exitStatus, 0, @"Should finish when the input is closed.");
+
+    NSString *outputString = [[NSString alloc] initWithData:outputData encoding:NSISOLatin1StringEncoding];
+    XCTAssertTrue([outputString hasPrefix:@"{"], @"Should start with a response.");
+    XCTAssertTrue([outputString rangeOfString:@"%PDF"].location != NSNotFound, @"Should write the PDF after the first response.");
+    XCTAssertTrue([outputString rangeOfString:@"PNG"].location != NSNotFound, @"Should render plain lines as PNG.");
+}
+
+- (void)testRunAnswersRequestThatIsNotUTF8
+{
+    NSMutableData *inputData = [[NSMutableData alloc] init];
+    const uint8_t badBytes[] = {0xff, 0xfe, 0x80, '\n'};
+    [inputData appendBytes:badBytes length:sizeof(badBytes)];
+    NSString *requestString = [NSString stringWithFormat:@"{\"id\": \"b\", \"math\": \"%@\", \"format\": \"svg\"}\n", testMathML];
+    [inputData appendData:[requestString dataUsingEncoding:NSUTF8StringEncoding]];
+
+    int exitStatus = -1;
+    NSData *outputData = [self outputOfWorkerWithInput:inputData framing:workerFramingLines exitStatus:&exitStatus];
+    XCTAssertEqual(exitStatus, 0, @"Should keep reading after a bad line.");
+
+    NSString *outputString = [[NSString alloc] initWithData:outputData encoding:NSISOLatin1StringEncoding];
+    NSString *firstLine = [outputString componentsSeparatedByString:@"\n"].firstObject;
+    NSDictionary *firstResponse = [NSJSONSerialization JSONObjectWithData:[firstLine dataUsingEncoding:NSUTF8StringEncoding] options:0 error:nil];
+    XCTAssertEqualObjects(firstResponse[@"status"], @"error", @"Should answer the bad line with an error.");
+    XCTAssertTrue([outputString rangeOfString:@"\"id\":\"b\""].location != NSNotFound, @"Should still render the next request.");
+}
+
+- (void)testRunFailsOnOversizedLength
+{
+    const uint8_t lengthBytes[] = {0xff, 0xff, 0xff, 0xff};
+    int exitStatus = 0;
+    NSData *outputData = [self outputOfWorkerWithInput:[NSData dataWithBytes:lengthBytes length:sizeof(lengthBytes)]
+                                               framing:workerFramingLengthPrefixed exitStatus:&exitStatus];
+    XCTAssertEqual(exitStatus, 1, @"Should exit with an error when the framing is broken.");
+    XCTAssertTrue(outputData.length > 4, @"Should write an error response.");
+    if (outputData.length <= 4)
+        return;
+
+    const uint8_t *outputBytes = outputData.bytes;
+    uint32_t responseLength = ((uint32_t)outputBytes[0] << 24) | ((uint32_t)outputBytes[1] << 16) | ((uint32_t)outputBytes[2] << 8) | outputBytes[3];
+    XCTAssertEqual((NSUInteger)responseLength + 4, outputData.length, @"Should frame the response.");
+    NSDictionary *response = [NSJSONSerialization JSONObjectWithData:[outputData subdataWithRange:NSMakeRange(4, outputData.length - 4)] options:0 error:nil];
+    XCTAssertEqualObjects(response[@"status"], @"error", @"Should report the framing error.");
+}
+
+@end